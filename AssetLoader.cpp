@@ -0,0 +1,117 @@
+#include "AssetLoader.h"
+
+#include <cassert>
+
+AssetLoader::AssetLoader(uint32_t threadCount)
+	: threadPool_(threadCount) {
+}
+
+void AssetLoader::Update(uint32_t maxCompletions) {
+	// 先に足されたコールバックを呼ぶ。読み込みはもう終わっている
+	std::vector<uint32_t> lateCallbackIndices;
+	lateCallbackIndices.swap(lateCallbackIndices_);
+	for (uint32_t index : lateCallbackIndices) {
+		Complete(index);
+	}
+
+	// 読み終わった物を順に取り出す。Waitで先に終わらせた物は飛ばす
+	std::vector<uint32_t> finishedIndices;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		size_t count = 0;
+		while (count < finishedIndices_.size() && maxCompletions > 0) {
+			if (!entries_[finishedIndices_[count]]->isReady) {
+				--maxCompletions;
+			}
+			++count;
+		}
+		finishedIndices.assign(finishedIndices_.begin(), finishedIndices_.begin() + count);
+		finishedIndices_.erase(finishedIndices_.begin(), finishedIndices_.begin() + count);
+	}
+	for (uint32_t index : finishedIndices) {
+		Complete(index);
+	}
+}
+
+void AssetLoader::WaitAll() {
+	for (uint32_t index = 0; index < entries_.size(); ++index) {
+		WaitEntry(index);
+	}
+	Update();
+}
+
+AssetLoadProgress AssetLoader::GetProgress() const {
+	AssetLoadProgress progress{};
+	progress.requestedCount = static_cast<uint32_t>(entries_.size());
+	progress.readyCount = readyCount_;
+	std::lock_guard<std::mutex> lock(mutex_);
+	progress.decodedCount = decodedCount_;
+	return progress;
+}
+
+bool AssetLoader::Register(const std::string& key, const void* type, uint32_t& index) {
+	auto it = indices_.find(key);
+	if (it != indices_.end()) {
+		index = it->second;
+		assert(entries_[index]->type == type);
+		return false;
+	}
+
+	// ワーカースレッドは番号でEntryを引くので、先に置いておく
+	index = static_cast<uint32_t>(entries_.size());
+	std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+	entry->type = type;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		entries_.push_back(std::move(entry));
+	}
+	indices_.emplace(key, index);
+	return true;
+}
+
+void AssetLoader::Enqueue(uint32_t index, std::function<std::shared_ptr<void>()> load) {
+	Entry* entry = entries_[index].get();
+	threadPool_.Enqueue([this, index, entry, load = std::move(load)]() {
+		std::shared_ptr<void> asset = load();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			entry->asset = std::move(asset);
+			entry->isDecoded = true;
+			finishedIndices_.push_back(index);
+			++decodedCount_;
+		}
+		decodedCondition_.notify_all();
+	});
+}
+
+void AssetLoader::AddCallback(uint32_t index, std::function<void()> callback) {
+	Entry& entry = *entries_[index];
+	entry.callbacks.push_back(std::move(callback));
+	if (entry.isReady) {
+		lateCallbackIndices_.push_back(index);
+	}
+}
+
+void AssetLoader::WaitEntry(uint32_t index) {
+	Entry& entry = *entries_[index];
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		decodedCondition_.wait(lock, [&entry]() { return entry.isDecoded; });
+	}
+	Complete(index);
+}
+
+void AssetLoader::Complete(uint32_t index) {
+	Entry& entry = *entries_[index];
+	if (!entry.isReady) {
+		entry.isReady = true;
+		++readyCount_;
+	}
+
+	// コールバックの中でLoadが呼ばれてもよいように、取り出してから呼ぶ
+	std::vector<std::function<void()>> callbacks;
+	callbacks.swap(entry.callbacks);
+	for (std::function<void()>& callback : callbacks) {
+		callback();
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+/// <summary>
+/// 読み込んだアセットを指す番号。型ごとに分けて、取り違えないようにする
+/// </summary>
+template <typename T>
+struct AssetHandle final {
+	static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+	uint32_t index = kInvalidIndex;
+
+	bool IsValid() const { return index != kInvalidIndex; }
+};
+
+/// <summary>
+/// 読み込みの進み具合
+/// </summary>
+struct AssetLoadProgress final {
+	uint32_t requestedCount; // 頼まれた数
+	uint32_t decodedCount; // ワーカースレッドで読み終わった数
+	uint32_t readyCount; // メインスレッドでコールバックまで終わって、使える数
+
+	// 使える割合。何も頼まれていなければ1
+	float GetRatio() const { return requestedCount == 0 ? 1.0f : static_cast<float>(readyCount) / static_cast<float>(requestedCount); }
+};
+
+/// <summary>
+/// ファイルの読み込みや解析をワーカースレッドで行い、終わったらメインスレッドでコールバックを呼ぶ
+/// 同じキーは一度だけ読む。コールバックはUpdateかWaitの中でだけ呼ぶので、D3D12のリソース作りなどもそこで行える
+/// Load、Update、Wait、Get、Findはメインスレッドからだけ呼ぶ
+/// </summary>
+class AssetLoader final {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="threadCount">ワーカースレッド数。0ならハードウェアのスレッド数</param>
+	explicit AssetLoader(uint32_t threadCount = 0);
+
+	// コピー禁止
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	/// <summary>
+	/// 読み込みを頼む。すでに頼んだキーなら読み直さず、同じ番号を返してコールバックだけ足す
+	/// </summary>
+	/// <param name="key">アセットを見分けるキー。ファイルパスなど</param>
+	/// <param name="load">ワーカースレッドで呼ぶ読み込み。メインスレッドのものには触らない</param>
+	/// <param name="onLoaded">読み終わった後にメインスレッドで呼ぶ。中身を動かしてもよい</param>
+	template <typename T>
+	AssetHandle<T> Load(const std::string& key, std::function<T()> load, std::function<void(T&)> onLoaded = nullptr);
+
+	/// <summary>
+	/// 読み終わったアセットのコールバックを、読み終わった順に呼ぶ。毎フレーム呼ぶ
+	/// </summary>
+	/// <param name="maxCompletions">このフレームで終わらせる最大の数。重い後処理を何フレームかに分ける時に使う</param>
+	void Update(uint32_t maxCompletions = UINT32_MAX);
+
+	/// <summary>
+	/// 読み終わるまで待ち、このアセットのコールバックを呼んで返す。他のアセットのコールバックは呼ばない
+	/// </summary>
+	template <typename T>
+	T& Wait(AssetHandle<T> handle);
+
+	/// <summary>
+	/// 全部読み終わるまで待って、全部のコールバックを呼ぶ
+	/// </summary>
+	void WaitAll();
+
+	/// <summary>
+	/// 使えるようになっていればアセットを、まだならnullptrを返す
+	/// </summary>
+	template <typename T>
+	T* Find(AssetHandle<T> handle);
+
+	/// <summary>
+	/// 使えるようになっていればアセットを、まだなら代わりの物を返す
+	/// </summary>
+	template <typename T>
+	const T& Get(AssetHandle<T> handle, const T& placeholder) { const T* asset = Find(handle); return asset != nullptr ? *asset : placeholder; }
+
+	// コールバックまで終わって使えるか
+	bool IsReady(uint32_t index) const { return entries_[index]->isReady; }
+	// 進み具合
+	AssetLoadProgress GetProgress() const;
+
+private:
+	// 頼まれたアセット1つ
+	struct Entry final {
+		const void* type; // Tごとに違うアドレス。同じキーを違う型で頼んでいないか確かめる
+		std::shared_ptr<void> asset; // ワーカースレッドが読み終わったら入れる
+		std::vector<std::function<void()>> callbacks; // メインスレッドだけが触る
+		bool isDecoded = false; // mutex_で守る
+		bool isReady = false; // メインスレッドだけが触る
+	};
+
+	// 型ごとに違うアドレスを返す
+	template <typename T>
+	static const void* TypeOf() { static const char tag = 0; return &tag; }
+
+	/// <summary>
+	/// 頼まれたアセットを登録する。新しく登録した時はワーカースレッドに積むのでtrue
+	/// </summary>
+	bool Register(const std::string& key, const void* type, uint32_t& index);
+
+	/// <summary>
+	/// ワーカースレッドに読み込みを積む
+	/// </summary>
+	void Enqueue(uint32_t index, std::function<std::shared_ptr<void>()> load);
+
+	/// <summary>
+	/// コールバックを足す。使えるようになっていれば、次のUpdateで呼ぶ
+	/// </summary>
+	void AddCallback(uint32_t index, std::function<void()> callback);
+
+	/// <summary>
+	/// 読み終わるまで待ってコールバックを呼ぶ
+	/// </summary>
+	void WaitEntry(uint32_t index);
+
+	/// <summary>
+	/// コールバックを呼んで使えるようにする
+	/// </summary>
+	void Complete(uint32_t index);
+
+	std::vector<std::unique_ptr<Entry>> entries_; // Entryの場所はずっと変わらない
+	std::unordered_map<std::string, uint32_t> indices_; // キー -> 番号
+	std::vector<uint32_t> finishedIndices_; // ワーカースレッドで読み終わった順。mutex_で守る
+	std::vector<uint32_t> lateCallbackIndices_; // 使えるようになった後にコールバックが足されたもの
+	uint32_t decodedCount_ = 0; // mutex_で守る
+	uint32_t readyCount_ = 0;
+	mutable std::mutex mutex_;
+	std::condition_variable decodedCondition_;
+	ThreadPool threadPool_; // 最後に作って最初に消す。消す時に積んだ読み込みを全部終わらせる
+};
+
+template <typename T>
+AssetHandle<T> AssetLoader::Load(const std::string& key, std::function<T()> load, std::function<void(T&)> onLoaded) {
+	AssetHandle<T> handle{};
+	if (Register(key, TypeOf<T>(), handle.index)) {
+		Enqueue(handle.index, [load = std::move(load)]() -> std::shared_ptr<void> { return std::make_shared<T>(load()); });
+	}
+	if (onLoaded) {
+		AddCallback(handle.index, [this, handle, onLoaded = std::move(onLoaded)]() { onLoaded(*static_cast<T*>(entries_[handle.index]->asset.get())); });
+	}
+	return handle;
+}
+
+template <typename T>
+T& AssetLoader::Wait(AssetHandle<T> handle) {
+	assert(handle.IsValid() && entries_[handle.index]->type == TypeOf<T>());
+	WaitEntry(handle.index);
+	return *static_cast<T*>(entries_[handle.index]->asset.get());
+}
+
+template <typename T>
+T* AssetLoader::Find(AssetHandle<T> handle) {
+	assert(handle.IsValid() && entries_[handle.index]->type == TypeOf<T>());
+	Entry& entry = *entries_[handle.index];
+	return entry.isReady ? static_cast<T*>(entry.asset.get()) : nullptr;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+
+/// <summary>
+/// 多数のAABB(軸に平行な箱)を要素ごとの配列に分けたもの(SoA)。全ての配列は同じ長さにする
+/// </summary>
+struct BoundingBoxArrays final {
+	std::vector<float> minX;
+	std::vector<float> minY;
+	std::vector<float> minZ;
+	std::vector<float> maxX;
+	std::vector<float> maxY;
+	std::vector<float> maxZ;
+};
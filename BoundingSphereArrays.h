@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+
+/// <summary>
+/// 多数の境界球を要素ごとの配列に分けたもの(SoA)。全ての配列は同じ長さにする
+/// </summary>
+struct BoundingSphereArrays final {
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+};
@@ -0,0 +1,498 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+	// SAHで分ける所を探す時の区間の数
+	constexpr uint32_t kBinCount = 16;
+	// 分けるより手間が少なければ、この数までは1つの葉にまとめる
+	constexpr uint32_t kMaxLeafObjectCount = 8;
+	// これより深くはしない。調べる時のスタックがあふれないようにする
+	constexpr uint32_t kMaxDepth = 60;
+	constexpr uint32_t kStackSize = kMaxDepth + 4;
+	// 節を1つ調べる手間。オブジェクトを1つ調べる手間を1とする
+	constexpr float kTraversalCost = 1.0f;
+	// 視錐台の完全に内側にある節の印
+	constexpr uint32_t kInsideFlag = 0x80000000u;
+
+	constexpr uint32_t kInvalidIndex = std::numeric_limits<uint32_t>::max();
+
+	struct Bounds final {
+		Vector3 min;
+		Vector3 max;
+	};
+
+	Bounds EmptyBounds() {
+		constexpr float kInfinity = std::numeric_limits<float>::infinity();
+		return { { kInfinity, kInfinity, kInfinity }, { -kInfinity, -kInfinity, -kInfinity } };
+	}
+
+	void Grow(Bounds& bounds, const Vector3& min, const Vector3& max) {
+		bounds.min = { std::min(bounds.min.x, min.x), std::min(bounds.min.y, min.y), std::min(bounds.min.z, min.z) };
+		bounds.max = { std::max(bounds.max.x, max.x), std::max(bounds.max.y, max.y), std::max(bounds.max.z, max.z) };
+	}
+
+	// 表面積の半分。比べるだけなので2倍しない
+	float HalfArea(const Bounds& bounds) {
+		Vector3 size = { bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y, bounds.max.z - bounds.min.z };
+		if (size.x < 0.0f) {
+			return 0.0f; // 空
+		}
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	float Axis(const Vector3& vector, int axis) {
+		return axis == 0 ? vector.x : (axis == 1 ? vector.y : vector.z);
+	}
+
+	Vector3 ObjectMin(const BoundingBoxArrays& boxes, uint32_t object) {
+		return { boxes.minX[object], boxes.minY[object], boxes.minZ[object] };
+	}
+
+	Vector3 ObjectMax(const BoundingBoxArrays& boxes, uint32_t object) {
+		return { boxes.maxX[object], boxes.maxY[object], boxes.maxZ[object] };
+	}
+
+	/// *****************************************************
+	/// 作る
+	/// *****************************************************
+	// これから分ける範囲
+	struct BuildRange final {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+	};
+
+	// 作る間だけ使う、オブジェクトのAABBと中心。範囲ごとに並べ替えるので、続けて読めるように1つにまとめる
+	struct BuildObject final {
+		Vector3 min;
+		Vector3 max;
+		Vector3 centroid;
+		uint32_t object;
+	};
+
+	// 分ける所
+	struct Split final {
+		int axis;
+		uint32_t bin; // この区間より前を左にする
+		float cost;
+	};
+
+	// 中心がどの区間に入るか。分ける時と数える時で同じ式を使う
+	uint32_t BinIndex(float centroid, float centroidMin, float scale) {
+		float bin = (centroid - centroidMin) * scale;
+		return std::min(static_cast<uint32_t>(std::max(bin, 0.0f)), kBinCount - 1);
+	}
+
+	// 3つの軸で区間ごとに数と範囲を集め、区間の境目で分けた時のSAHの手間が一番小さい所を探す
+	Split FindBestSplit(const BuildObject* objects, uint32_t count, const Bounds& centroidBounds) {
+		float centroidMin[3];
+		float scale[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			centroidMin[axis] = Axis(centroidBounds.min, axis);
+			float extent = Axis(centroidBounds.max, axis) - centroidMin[axis];
+			scale[axis] = extent > 0.0f ? static_cast<float>(kBinCount) / extent : 0.0f;
+		}
+
+		// オブジェクトを読むのは1回にして、3つの軸の区間へ同時に入れる
+		Bounds binBounds[3][kBinCount];
+		uint32_t binCounts[3][kBinCount] = {};
+		for (Bounds(&axisBounds)[kBinCount] : binBounds) {
+			std::fill(std::begin(axisBounds), std::end(axisBounds), EmptyBounds());
+		}
+		for (uint32_t i = 0; i < count; ++i) {
+			const BuildObject& object = objects[i];
+			for (int axis = 0; axis < 3; ++axis) {
+				uint32_t bin = BinIndex(Axis(object.centroid, axis), centroidMin[axis], scale[axis]);
+				++binCounts[axis][bin];
+				Grow(binBounds[axis][bin], object.min, object.max);
+			}
+		}
+
+		Split best = { -1, 0, std::numeric_limits<float>::infinity() };
+		for (int axis = 0; axis < 3; ++axis) {
+			if (scale[axis] == 0.0f) {
+				continue; // 全て同じ位置なので、この軸では分けられない
+			}
+
+			// 右から積み上げた手間を先に求めておき、左から積み上げながら足す
+			float rightCosts[kBinCount] = {};
+			uint32_t rightCounts[kBinCount] = {};
+			Bounds right = EmptyBounds();
+			uint32_t rightCount = 0;
+			for (uint32_t bin = kBinCount - 1; bin > 0; --bin) {
+				Grow(right, binBounds[axis][bin].min, binBounds[axis][bin].max);
+				rightCount += binCounts[axis][bin];
+				rightCosts[bin] = HalfArea(right) * static_cast<float>(rightCount);
+				rightCounts[bin] = rightCount;
+			}
+			Bounds left = EmptyBounds();
+			uint32_t leftCount = 0;
+			for (uint32_t bin = 1; bin < kBinCount; ++bin) {
+				Grow(left, binBounds[axis][bin - 1].min, binBounds[axis][bin - 1].max);
+				leftCount += binCounts[axis][bin - 1];
+				if (leftCount == 0 || rightCounts[bin] == 0) {
+					continue; // 片方が空になる所では分けない
+				}
+				float cost = HalfArea(left) * static_cast<float>(leftCount) + rightCosts[bin];
+				if (cost < best.cost) {
+					best = { axis, bin, cost };
+				}
+			}
+		}
+		return best;
+	}
+
+	/// *****************************************************
+	/// 調べる
+	/// *****************************************************
+	enum class FrustumSide {
+		Outside,
+		Intersect,
+		Inside,
+	};
+
+	// 箱が視錐台のどこにあるか。法線の向きに一番出ている頂点で外側か、一番引っ込んでいる頂点で内側かを調べる
+	FrustumSide ClassifyBox(const Frustum& frustum, const Vector3& min, const Vector3& max) {
+		FrustumSide side = FrustumSide::Inside;
+		for (const Vector4& plane : frustum.planes) {
+			float x = plane.x >= 0.0f ? max.x : min.x;
+			float y = plane.y >= 0.0f ? max.y : min.y;
+			float z = plane.z >= 0.0f ? max.z : min.z;
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+				return FrustumSide::Outside;
+			}
+			x = plane.x >= 0.0f ? min.x : max.x;
+			y = plane.y >= 0.0f ? min.y : max.y;
+			z = plane.z >= 0.0f ? min.z : max.z;
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+				side = FrustumSide::Intersect;
+			}
+		}
+		return side;
+	}
+
+	// 光線が箱に入る距離。[0, maxDistance]の中で当たらなければfalse
+	bool IntersectRayBox(const Vector3& origin, const Vector3& inverseDirection, float maxDistance, const Vector3& min, const Vector3& max, float& distance) {
+		float x1 = (min.x - origin.x) * inverseDirection.x;
+		float x2 = (max.x - origin.x) * inverseDirection.x;
+		float y1 = (min.y - origin.y) * inverseDirection.y;
+		float y2 = (max.y - origin.y) * inverseDirection.y;
+		float z1 = (min.z - origin.z) * inverseDirection.z;
+		float z2 = (max.z - origin.z) * inverseDirection.z;
+		float enter = std::max({ std::min(x1, x2), std::min(y1, y2), std::min(z1, z2), 0.0f });
+		float exit = std::min({ std::max(x1, x2), std::max(y1, y2), std::max(z1, z2), maxDistance });
+		distance = enter;
+		return enter <= exit;
+	}
+
+	// 点から箱までの距離の2乗。中なら0
+	float DistanceSquared(const Vector3& point, const Vector3& min, const Vector3& max) {
+		float x = std::max({ min.x - point.x, 0.0f, point.x - max.x });
+		float y = std::max({ min.y - point.y, 0.0f, point.y - max.y });
+		float z = std::max({ min.z - point.z, 0.0f, point.z - max.z });
+		return x * x + y * y + z * z;
+	}
+
+	// 調べる途中の節と、そこまでの距離
+	struct NodeDistance final {
+		uint32_t node;
+		float distance;
+	};
+
+	// 葉のAABBを、持っているオブジェクトから作り直す
+	Bounds LeafBounds(const Bvh& bvh, const BoundingBoxArrays& boxes, const BvhNode& leaf) {
+		Bounds bounds = EmptyBounds();
+		for (uint32_t i = leaf.first; i < leaf.first + leaf.count; ++i) {
+			uint32_t object = bvh.objectIndices[i];
+			Grow(bounds, ObjectMin(boxes, object), ObjectMax(boxes, object));
+		}
+		return bounds;
+	}
+
+	// 内側の節のAABBを、2つの子から作り直す
+	Bounds InnerBounds(const Bvh& bvh, const BvhNode& node) {
+		const BvhNode& left = bvh.nodes[node.first];
+		const BvhNode& right = bvh.nodes[node.first + 1];
+		Bounds bounds = { left.min, left.max };
+		Grow(bounds, right.min, right.max);
+		return bounds;
+	}
+
+	bool SetBounds(BvhNode& node, const Bounds& bounds) {
+		bool isChanged = node.min.x != bounds.min.x || node.min.y != bounds.min.y || node.min.z != bounds.min.z ||
+			node.max.x != bounds.max.x || node.max.y != bounds.max.y || node.max.z != bounds.max.z;
+		node.min = bounds.min;
+		node.max = bounds.max;
+		return isChanged;
+	}
+}
+
+void BuildBvh(const BoundingBoxArrays& boxes, Bvh& bvh) {
+	size_t objectCount = boxes.minX.size();
+	assert(boxes.minY.size() == objectCount && boxes.minZ.size() == objectCount);
+	assert(boxes.maxX.size() == objectCount && boxes.maxY.size() == objectCount && boxes.maxZ.size() == objectCount);
+	assert(objectCount < kInsideFlag / 2);
+
+	bvh.nodes.clear();
+	bvh.parents.clear();
+	bvh.objectIndices.resize(objectCount);
+	bvh.leafOfObject.assign(objectCount, kInvalidIndex);
+	if (objectCount == 0) {
+		return;
+	}
+	bvh.nodes.reserve(objectCount * 2 - 1);
+	bvh.parents.reserve(objectCount * 2 - 1);
+
+	std::vector<BuildObject> buildObjects(objectCount);
+	for (uint32_t object = 0; object < objectCount; ++object) {
+		Vector3 min = ObjectMin(boxes, object);
+		Vector3 max = ObjectMax(boxes, object);
+		buildObjects[object] = { min, max, { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f }, object };
+	}
+
+	bvh.nodes.push_back({});
+	bvh.parents.push_back(kInvalidIndex);
+	std::vector<BuildRange> ranges = { { 0, 0, static_cast<uint32_t>(objectCount), 0 } };
+	while (!ranges.empty()) {
+		BuildRange range = ranges.back();
+		ranges.pop_back();
+		BuildObject* objects = buildObjects.data() + range.first;
+
+		Bounds bounds = EmptyBounds();
+		Bounds centroidBounds = EmptyBounds();
+		for (uint32_t i = 0; i < range.count; ++i) {
+			Grow(bounds, objects[i].min, objects[i].max);
+			Grow(centroidBounds, objects[i].centroid, objects[i].centroid);
+		}
+		SetBounds(bvh.nodes[range.node], bounds);
+
+		// 分けた方が手間が少ない時だけ分ける。多過ぎる時は手間が増えても分ける
+		Split split = { -1, 0, 0.0f };
+		if (range.count > 1 && range.depth < kMaxDepth) {
+			split = FindBestSplit(objects, range.count, centroidBounds);
+			float leafCost = HalfArea(bounds) * static_cast<float>(range.count);
+			if (split.axis >= 0 && kTraversalCost * HalfArea(bounds) + split.cost >= leafCost && range.count <= kMaxLeafObjectCount) {
+				split.axis = -1;
+			}
+		}
+
+		if (split.axis < 0) {
+			BvhNode& leaf = bvh.nodes[range.node];
+			leaf.first = range.first;
+			leaf.count = range.count;
+			for (uint32_t i = 0; i < range.count; ++i) {
+				bvh.objectIndices[range.first + i] = objects[i].object;
+				bvh.leafOfObject[objects[i].object] = range.node;
+			}
+			continue;
+		}
+
+		float centroidMin = Axis(centroidBounds.min, split.axis);
+		float scale = static_cast<float>(kBinCount) / (Axis(centroidBounds.max, split.axis) - centroidMin);
+		BuildObject* middle = std::partition(objects, objects + range.count, [&](const BuildObject& object) {
+			return BinIndex(Axis(object.centroid, split.axis), centroidMin, scale) < split.bin;
+			});
+		uint32_t leftCount = static_cast<uint32_t>(middle - objects);
+
+		// 子は2つ並べて、親より後ろに置く
+		uint32_t leftNode = static_cast<uint32_t>(bvh.nodes.size());
+		bvh.nodes.push_back({});
+		bvh.nodes.push_back({});
+		bvh.parents.push_back(range.node);
+		bvh.parents.push_back(range.node);
+		bvh.nodes[range.node].first = leftNode;
+		bvh.nodes[range.node].count = 0;
+
+		// 左から先に取り出す
+		ranges.push_back({ leftNode + 1, range.first + leftCount, range.count - leftCount, range.depth + 1 });
+		ranges.push_back({ leftNode, range.first, leftCount, range.depth + 1 });
+	}
+}
+
+void RefitBvh(Bvh& bvh, const BoundingBoxArrays& boxes) {
+	assert(boxes.minX.size() == bvh.leafOfObject.size());
+	for (size_t index = bvh.nodes.size(); index-- > 0;) {
+		BvhNode& node = bvh.nodes[index];
+		SetBounds(node, node.count > 0 ? LeafBounds(bvh, boxes, node) : InnerBounds(bvh, node));
+	}
+}
+
+void RefitBvh(Bvh& bvh, const BoundingBoxArrays& boxes, const std::vector<uint32_t>& changedObjects) {
+	assert(boxes.minX.size() == bvh.leafOfObject.size());
+	for (uint32_t object : changedObjects) {
+		uint32_t node = bvh.leafOfObject[object];
+		if (!SetBounds(bvh.nodes[node], LeafBounds(bvh, boxes, bvh.nodes[node]))) {
+			continue;
+		}
+
+		// 変わらなくなった所より上は、他の子に合わせて作り直してあるのでそのままでよい
+		for (node = bvh.parents[node]; node != kInvalidIndex; node = bvh.parents[node]) {
+			if (!SetBounds(bvh.nodes[node], InnerBounds(bvh, bvh.nodes[node]))) {
+				break;
+			}
+		}
+	}
+}
+
+void QueryBvhFrustum(const Bvh& bvh, const BoundingBoxArrays& boxes, const Frustum& frustum, std::vector<uint32_t>& visibleIndices) {
+	visibleIndices.clear();
+	if (bvh.nodes.empty()) {
+		return;
+	}
+
+	uint32_t stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		uint32_t entry = stack[--stackSize];
+		uint32_t nodeIndex = entry & ~kInsideFlag;
+		const BvhNode& node = bvh.nodes[nodeIndex];
+
+		// 親が完全に内側なら、子も調べなくてよい
+		bool isInside = (entry & kInsideFlag) != 0;
+		if (!isInside) {
+			FrustumSide side = ClassifyBox(frustum, node.min, node.max);
+			if (side == FrustumSide::Outside) {
+				continue;
+			}
+			isInside = side == FrustumSide::Inside;
+		}
+
+		if (node.count == 0) {
+			uint32_t flag = isInside ? kInsideFlag : 0;
+			stack[stackSize++] = (node.first + 1) | flag;
+			stack[stackSize++] = node.first | flag;
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+			uint32_t object = bvh.objectIndices[i];
+			if (isInside || IsAabbInFrustum(frustum, ObjectMin(boxes, object), ObjectMax(boxes, object))) {
+				visibleIndices.push_back(object);
+			}
+		}
+	}
+}
+
+bool RaycastBvh(const Bvh& bvh, const BoundingBoxArrays& boxes, const Vector3& origin, const Vector3& direction, float maxDistance, BvhRayHit& hit) {
+	if (bvh.nodes.empty()) {
+		return false;
+	}
+
+	// 0の成分は無限大になり、その軸の板は常に通るか全く通らないかになる
+	Vector3 inverseDirection = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+	float nearestDistance = maxDistance;
+	uint32_t nearestObject = kInvalidIndex;
+
+	NodeDistance stack[kStackSize];
+	uint32_t stackSize = 0;
+	float rootDistance = 0.0f;
+	if (IntersectRayBox(origin, inverseDirection, nearestDistance, bvh.nodes[0].min, bvh.nodes[0].max, rootDistance)) {
+		stack[stackSize++] = { 0, rootDistance };
+	}
+	while (stackSize > 0) {
+		NodeDistance entry = stack[--stackSize];
+		if (entry.distance > nearestDistance) {
+			continue; // 積んだ後に、もっと近くで当たった
+		}
+		const BvhNode& node = bvh.nodes[entry.node];
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				uint32_t object = bvh.objectIndices[i];
+				float distance = 0.0f;
+				if (IntersectRayBox(origin, inverseDirection, nearestDistance, ObjectMin(boxes, object), ObjectMax(boxes, object), distance) &&
+					(nearestObject == kInvalidIndex || distance < nearestDistance)) {
+					nearestDistance = distance;
+					nearestObject = object;
+				}
+			}
+			continue;
+		}
+
+		// 近い方の子を後に積んで、先に調べる
+		const BvhNode& left = bvh.nodes[node.first];
+		const BvhNode& right = bvh.nodes[node.first + 1];
+		float leftDistance = 0.0f;
+		float rightDistance = 0.0f;
+		bool hitLeft = IntersectRayBox(origin, inverseDirection, nearestDistance, left.min, left.max, leftDistance);
+		bool hitRight = IntersectRayBox(origin, inverseDirection, nearestDistance, right.min, right.max, rightDistance);
+		if (hitLeft && hitRight) {
+			if (leftDistance < rightDistance) {
+				stack[stackSize++] = { node.first + 1, rightDistance };
+				stack[stackSize++] = { node.first, leftDistance };
+			} else {
+				stack[stackSize++] = { node.first, leftDistance };
+				stack[stackSize++] = { node.first + 1, rightDistance };
+			}
+		} else if (hitLeft) {
+			stack[stackSize++] = { node.first, leftDistance };
+		} else if (hitRight) {
+			stack[stackSize++] = { node.first + 1, rightDistance };
+		}
+	}
+
+	if (nearestObject == kInvalidIndex) {
+		return false;
+	}
+	hit = { nearestObject, nearestDistance };
+	return true;
+}
+
+bool FindNearestBvh(const Bvh& bvh, const BoundingBoxArrays& boxes, const Vector3& point, float maxDistance, BvhNearestHit& hit) {
+	if (bvh.nodes.empty()) {
+		return false;
+	}
+
+	// 比べるのは2乗のまま行い、最後に平方根を取る
+	float nearestDistanceSquared = maxDistance * maxDistance;
+	uint32_t nearestObject = kInvalidIndex;
+
+	NodeDistance stack[kStackSize];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = { 0, DistanceSquared(point, bvh.nodes[0].min, bvh.nodes[0].max) };
+	while (stackSize > 0) {
+		NodeDistance entry = stack[--stackSize];
+		if (entry.distance > nearestDistanceSquared) {
+			continue;
+		}
+		const BvhNode& node = bvh.nodes[entry.node];
+
+		if (node.count > 0) {
+			for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+				uint32_t object = bvh.objectIndices[i];
+				float distanceSquared = DistanceSquared(point, ObjectMin(boxes, object), ObjectMax(boxes, object));
+				if (distanceSquared <= nearestDistanceSquared && (nearestObject == kInvalidIndex || distanceSquared < nearestDistanceSquared)) {
+					nearestDistanceSquared = distanceSquared;
+					nearestObject = object;
+				}
+			}
+			continue;
+		}
+
+		// 近い方の子を後に積んで、先に調べる
+		const BvhNode& left = bvh.nodes[node.first];
+		const BvhNode& right = bvh.nodes[node.first + 1];
+		float leftDistance = DistanceSquared(point, left.min, left.max);
+		float rightDistance = DistanceSquared(point, right.min, right.max);
+		if (leftDistance < rightDistance) {
+			stack[stackSize++] = { node.first + 1, rightDistance };
+			stack[stackSize++] = { node.first, leftDistance };
+		} else {
+			stack[stackSize++] = { node.first, leftDistance };
+			stack[stackSize++] = { node.first + 1, rightDistance };
+		}
+	}
+
+	if (nearestObject == kInvalidIndex) {
+		return false;
+	}
+	hit = { nearestObject, std::sqrt(nearestDistanceSquared) };
+	return true;
+}
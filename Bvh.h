@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BoundingBoxArrays.h"
+#include "Frustum.h"
+#include "Vector3.h"
+
+/// <summary>
+/// BVHの節。countが0なら内側の節で、子はfirstとfirst+1。0より大きければ葉で、objectIndices[first]からcount個を持つ
+/// </summary>
+struct BvhNode final {
+	Vector3 min;
+	uint32_t first;
+	Vector3 max;
+	uint32_t count;
+};
+
+/// <summary>
+/// シーンのオブジェクトのAABBをまとめた木(Bounding Volume Hierarchy)
+/// 節は親より後ろに並ぶので、後ろから順に作り直せば子から親へ広げられる
+/// </summary>
+struct Bvh final {
+	std::vector<BvhNode> nodes; // 0番が根
+	std::vector<uint32_t> parents; // 節ごとの親。根はUINT32_MAX
+	std::vector<uint32_t> objectIndices; // 葉が持つオブジェクトの番号を、葉の順に並べたもの
+	std::vector<uint32_t> leafOfObject; // オブジェクトごとに、入っている葉の番号
+};
+
+/// <summary>
+/// 光線が当たったオブジェクト
+/// </summary>
+struct BvhRayHit final {
+	uint32_t objectIndex;
+	float distance; // 光線の始点から、AABBに入る所までの距離(directionの長さを1とした時)
+};
+
+/// <summary>
+/// 一番近いオブジェクト
+/// </summary>
+struct BvhNearestHit final {
+	uint32_t objectIndex;
+	float distance; // 点からAABBまでの距離。AABBの中なら0
+};
+
+/// <summary>
+/// オブジェクトのAABBからBVHを作る。分け方はSAH(表面積から見積もった調べる手間)が一番小さくなる所を、区間に分けて探す
+/// </summary>
+/// <param name="boxes">オブジェクトのAABB</param>
+/// <param name="bvh">作ったBVHを書き込む。中身は作り直される</param>
+void BuildBvh(const BoundingBoxArrays& boxes, Bvh& bvh);
+
+/// <summary>
+/// 全てのオブジェクトが動いた時に、木の形はそのままで節のAABBを作り直す
+/// 動いた量が大きいと木の質が落ちるので、その時はBuildBvhで作り直す
+/// </summary>
+/// <param name="bvh">BuildBvhで作ったBVH</param>
+/// <param name="boxes">動いた後のAABB。作った時と同じ数にする</param>
+void RefitBvh(Bvh& bvh, const BoundingBoxArrays& boxes);
+
+/// <summary>
+/// 一部のオブジェクトが動いた時に、それを含む葉から根までの節だけを作り直す
+/// </summary>
+/// <param name="bvh">BuildBvhで作ったBVH</param>
+/// <param name="boxes">動いた後のAABB。作った時と同じ数にする</param>
+/// <param name="changedObjects">動いたオブジェクトの番号</param>
+void RefitBvh(Bvh& bvh, const BoundingBoxArrays& boxes, const std::vector<uint32_t>& changedObjects);
+
+/// <summary>
+/// 視錐台に入っているオブジェクトを集める。CullBoxesと同じものが、木の順番で並ぶ
+/// </summary>
+/// <param name="bvh">BVH</param>
+/// <param name="boxes">オブジェクトのAABB</param>
+/// <param name="frustum">視錐台</param>
+/// <param name="visibleIndices">見えるオブジェクトの番号を書き込む。中身は上書きされる</param>
+void QueryBvhFrustum(const Bvh& bvh, const BoundingBoxArrays& boxes, const Frustum& frustum, std::vector<uint32_t>& visibleIndices);
+
+/// <summary>
+/// 光線が最初に当たるオブジェクトのAABBを探す。マウスで選ぶ時などに使う
+/// </summary>
+/// <param name="bvh">BVH</param>
+/// <param name="boxes">オブジェクトのAABB</param>
+/// <param name="origin">光線の始点</param>
+/// <param name="direction">光線の向き。長さが1でなくてもよい</param>
+/// <param name="maxDistance">これより遠い所は調べない(directionの長さが単位)</param>
+/// <param name="hit">当たった時に書き込む</param>
+/// <returns>当たればtrue</returns>
+bool RaycastBvh(const Bvh& bvh, const BoundingBoxArrays& boxes, const Vector3& origin, const Vector3& direction, float maxDistance, BvhRayHit& hit);
+
+/// <summary>
+/// 点に一番近いオブジェクトのAABBを探す
+/// </summary>
+/// <param name="bvh">BVH</param>
+/// <param name="boxes">オブジェクトのAABB</param>
+/// <param name="point">点</param>
+/// <param name="maxDistance">これより遠いものは探さない</param>
+/// <param name="hit">見つかった時に書き込む</param>
+/// <returns>maxDistance以内にあればtrue</returns>
+bool FindNearestBvh(const Bvh& bvh, const BoundingBoxArrays& boxes, const Vector3& point, float maxDistance, BvhNearestHit& hit);
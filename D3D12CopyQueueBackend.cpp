@@ -0,0 +1,111 @@
+#include "D3D12CopyQueueBackend.h"
+
+#include <cassert>
+
+D3D12CopyQueueBackend::D3D12CopyQueueBackend(ID3D12Device* device, ID3D12CommandQueue* directQueue, const D3D12UploadPageBackend& pageBackend)
+	: device_(device), directQueue_(directQueue), pageBackend_(pageBackend) {
+	assert(device_ != nullptr && directQueue_ != nullptr);
+
+	// コピー専用のキュー。描画と並んで動ける
+	D3D12_COMMAND_QUEUE_DESC commandQueueDesc{};
+	commandQueueDesc.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+	HRESULT hr = device_->CreateCommandQueue(&commandQueueDesc, IID_PPV_ARGS(&copyQueue_));
+	assert(SUCCEEDED(hr));
+
+	// 初期値0でFenceを作る
+	hr = device_->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
+	assert(SUCCEEDED(hr));
+
+	// CommandListは1つを使い回す。作った時は開いているので閉じておく
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator = AcquireCommandAllocator();
+	hr = device_->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, commandAllocator.Get(), nullptr, IID_PPV_ARGS(&commandList_));
+	assert(SUCCEEDED(hr));
+	hr = commandList_->Close();
+	assert(SUCCEEDED(hr));
+	pendingAllocators_.push_back({ commandAllocator, 0 });
+
+	// FenceのSignalを待つためのイベントを作成する
+	fenceEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+	assert(fenceEvent_ != nullptr);
+}
+
+D3D12CopyQueueBackend::~D3D12CopyQueueBackend() {
+	CloseHandle(fenceEvent_);
+}
+
+void D3D12CopyQueueBackend::ExecuteCopies(const std::vector<BufferCopy>& bufferCopies, const std::vector<TextureCopy>& textureCopies, uint64_t fenceValue) {
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator = AcquireCommandAllocator();
+	HRESULT hr = commandList_->Reset(commandAllocator.Get(), nullptr);
+	assert(SUCCEEDED(hr));
+
+	for (const BufferCopy& copy : bufferCopies) {
+		commandList_->CopyBufferRegion(static_cast<ID3D12Resource*>(copy.destination), copy.destinationOffset,
+			pageBackend_.GetResource(copy.sourcePage), copy.sourceOffset, copy.size);
+	}
+
+	for (const TextureCopy& copy : textureCopies) {
+		// コピー先はSubresourceの番号で指定する
+		D3D12_TEXTURE_COPY_LOCATION destination{};
+		destination.pResource = static_cast<ID3D12Resource*>(copy.destination);
+		destination.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		destination.SubresourceIndex = copy.subresource;
+
+		// コピー元はステージングのバッファの中の並び方で指定する
+		D3D12_TEXTURE_COPY_LOCATION source{};
+		source.pResource = pageBackend_.GetResource(copy.sourcePage);
+		source.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		source.PlacedFootprint.Offset = copy.sourceOffset;
+		source.PlacedFootprint.Footprint.Format = DXGI_FORMAT(copy.format);
+		source.PlacedFootprint.Footprint.Width = copy.width;
+		source.PlacedFootprint.Footprint.Height = copy.height;
+		source.PlacedFootprint.Footprint.Depth = 1;
+		source.PlacedFootprint.Footprint.RowPitch = copy.rowPitch;
+
+		commandList_->CopyTextureRegion(&destination, 0, copy.destinationY, 0, &source, nullptr);
+	}
+
+	hr = commandList_->Close();
+	assert(SUCCEEDED(hr));
+	ID3D12CommandList* commandLists[] = { commandList_.Get() };
+	copyQueue_->ExecuteCommandLists(1, commandLists);
+
+	// コピーが終わったらFenceを進める。CommandAllocatorもそれまで使い回さない
+	hr = copyQueue_->Signal(fence_.Get(), fenceValue);
+	assert(SUCCEEDED(hr));
+	pendingAllocators_.push_back({ commandAllocator, fenceValue });
+}
+
+uint64_t D3D12CopyQueueBackend::GetCompletedValue() {
+	return fence_->GetCompletedValue();
+}
+
+void D3D12CopyQueueBackend::Wait(uint64_t value) {
+	// 指定したSignalにたどり着いていないので、たどり着くまで待つようにイベントを設定する
+	if (fence_->GetCompletedValue() < value) {
+		HRESULT hr = fence_->SetEventOnCompletion(value, fenceEvent_);
+		assert(SUCCEEDED(hr));
+		WaitForSingleObject(fenceEvent_, INFINITE);
+	}
+}
+
+void D3D12CopyQueueBackend::WaitOnDirectQueue(uint64_t value) {
+	// 描画用のキューは、コピーが終わるまで後のコマンドを始めない
+	HRESULT hr = directQueue_->Wait(fence_.Get(), value);
+	assert(SUCCEEDED(hr));
+}
+
+Microsoft::WRL::ComPtr<ID3D12CommandAllocator> D3D12CopyQueueBackend::AcquireCommandAllocator() {
+	// 一番古いものがGPUで終わっていれば、Resetして使い回す
+	if (!pendingAllocators_.empty() && pendingAllocators_.front().fenceValue <= fence_->GetCompletedValue()) {
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator = pendingAllocators_.front().commandAllocator;
+		pendingAllocators_.pop_front();
+		HRESULT hr = commandAllocator->Reset();
+		assert(SUCCEEDED(hr));
+		return commandAllocator;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator = nullptr;
+	HRESULT hr = device_->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&commandAllocator));
+	assert(SUCCEEDED(hr));
+	return commandAllocator;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Windows.h>
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "UploadManager.h"
+#include "D3D12UploadPageBackend.h"
+
+/// <summary>
+/// COPYのCommandQueueでステージングからDEFAULTヒープのリソースにコピーする
+/// 描画用のキューとはFenceで合わせる。コピー先はCOMMONで作っておけば、バリア無しで使える
+/// </summary>
+class D3D12CopyQueueBackend final : public CopyQueueBackend {
+public:
+	/// <summary>
+	/// コンストラクタ。COPYのキューとFence、CommandListを作る
+	/// </summary>
+	/// <param name="device">デバイス</param>
+	/// <param name="directQueue">コピーしたリソースを使う描画用のキュー</param>
+	/// <param name="pageBackend">ステージングのページを作った所。handleからバッファを引く</param>
+	D3D12CopyQueueBackend(ID3D12Device* device, ID3D12CommandQueue* directQueue, const D3D12UploadPageBackend& pageBackend);
+	~D3D12CopyQueueBackend() override;
+
+	// コピー禁止
+	D3D12CopyQueueBackend(const D3D12CopyQueueBackend&) = delete;
+	D3D12CopyQueueBackend& operator=(const D3D12CopyQueueBackend&) = delete;
+
+	void ExecuteCopies(const std::vector<BufferCopy>& bufferCopies, const std::vector<TextureCopy>& textureCopies, uint64_t fenceValue) override;
+	uint64_t GetCompletedValue() override;
+	void Wait(uint64_t value) override;
+	void WaitOnDirectQueue(uint64_t value) override;
+
+private:
+	/// <summary>
+	/// GPUが使い終わったCommandAllocatorを返す。無ければ作る
+	/// </summary>
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> AcquireCommandAllocator();
+
+	// 使い終わるのを待っているCommandAllocator
+	struct PendingAllocator final {
+		Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+		uint64_t fenceValue;
+	};
+
+	ID3D12Device* device_;
+	ID3D12CommandQueue* directQueue_;
+	const D3D12UploadPageBackend& pageBackend_;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> copyQueue_;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList_;
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
+	HANDLE fenceEvent_ = nullptr;
+	std::deque<PendingAllocator> pendingAllocators_; // 出した順
+};
@@ -0,0 +1,39 @@
+#include "D3D12FrameFence.h"
+
+#include <cassert>
+
+D3D12FrameFence::D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* commandQueue)
+	: commandQueue_(commandQueue) {
+	assert(device != nullptr && commandQueue_ != nullptr);
+
+	// 初期値0でFenceを作る
+	HRESULT hr = device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence_));
+	assert(SUCCEEDED(hr));
+
+	// FenceのSignalを待つためのイベントを作成する
+	fenceEvent_ = CreateEvent(NULL, FALSE, FALSE, NULL);
+	assert(fenceEvent_ != nullptr);
+}
+
+D3D12FrameFence::~D3D12FrameFence() {
+	CloseHandle(fenceEvent_);
+}
+
+void D3D12FrameFence::Signal(uint64_t value) {
+	// GPUがここまでたどり着いたときに、Fenceの値を指定した値に代入するようにSignalを送る
+	HRESULT hr = commandQueue_->Signal(fence_.Get(), value);
+	assert(SUCCEEDED(hr));
+}
+
+uint64_t D3D12FrameFence::GetCompletedValue() {
+	return fence_->GetCompletedValue();
+}
+
+void D3D12FrameFence::Wait(uint64_t value) {
+	// 指定したSignalにたどり着いていないので、たどり着くまで待つようにイベントを設定する
+	if (fence_->GetCompletedValue() < value) {
+		HRESULT hr = fence_->SetEventOnCompletion(value, fenceEvent_);
+		assert(SUCCEEDED(hr));
+		WaitForSingleObject(fenceEvent_, INFINITE);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <Windows.h>
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include "FramePacer.h"
+
+/// <summary>
+/// コマンドキューのSignalとID3D12Fenceで、フレームの終わりを知らせて待つ
+/// </summary>
+class D3D12FrameFence final : public FrameFence {
+public:
+	/// <summary>
+	/// コンストラクタ。初期値0のFenceと、待つためのイベントを作る
+	/// </summary>
+	/// <param name="device">Fenceを作るデバイス</param>
+	/// <param name="commandQueue">Signalを積むキュー</param>
+	D3D12FrameFence(ID3D12Device* device, ID3D12CommandQueue* commandQueue);
+	~D3D12FrameFence() override;
+
+	// コピー禁止
+	D3D12FrameFence(const D3D12FrameFence&) = delete;
+	D3D12FrameFence& operator=(const D3D12FrameFence&) = delete;
+
+	void Signal(uint64_t value) override;
+	uint64_t GetCompletedValue() override;
+	void Wait(uint64_t value) override;
+
+private:
+	ID3D12CommandQueue* commandQueue_;
+	Microsoft::WRL::ComPtr<ID3D12Fence> fence_;
+	HANDLE fenceEvent_ = nullptr;
+};
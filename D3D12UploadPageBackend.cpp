@@ -0,0 +1,68 @@
+#include "D3D12UploadPageBackend.h"
+
+#include <cassert>
+#include <utility>
+
+D3D12UploadPageBackend::D3D12UploadPageBackend(ID3D12Device* device)
+	: device_(device) {
+	assert(device_ != nullptr);
+}
+
+D3D12UploadPageBackend::~D3D12UploadPageBackend() {
+	for (Microsoft::WRL::ComPtr<ID3D12Resource>& resource : resources_) {
+		if (resource) {
+			resource->Unmap(0, nullptr);
+		}
+	}
+}
+
+UploadPage D3D12UploadPageBackend::CreatePage(size_t size) {
+	// UploadHeapを使う
+	D3D12_HEAP_PROPERTIES uploadHeapProperties{};
+	uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+	// バッファリソース。バッファの場合は高さなどを1にして、ROW_MAJORにする決まり
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = size;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
+	HRESULT hr = device_->CreateCommittedResource(&uploadHeapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&resource));
+	assert(SUCCEEDED(hr));
+
+	// UploadHeapはMapしたままでよいので、ここで1回だけMapする
+	UploadPage page{};
+	hr = resource->Map(0, nullptr, reinterpret_cast<void**>(&page.cpuAddress));
+	assert(SUCCEEDED(hr));
+	(void)hr;
+	page.gpuAddress = resource->GetGPUVirtualAddress();
+	page.size = size;
+
+	if (freeHandles_.empty()) {
+		page.handle = static_cast<uint32_t>(resources_.size());
+		resources_.push_back(std::move(resource));
+	} else {
+		page.handle = freeHandles_.back();
+		freeHandles_.pop_back();
+		resources_[page.handle] = std::move(resource);
+	}
+	return page;
+}
+
+void D3D12UploadPageBackend::DestroyPage(const UploadPage& page) {
+	assert(page.handle < resources_.size() && resources_[page.handle]);
+	resources_[page.handle]->Unmap(0, nullptr);
+	resources_[page.handle].Reset();
+	freeHandles_.push_back(page.handle);
+}
+
+ID3D12Resource* D3D12UploadPageBackend::GetResource(uint32_t handle) const {
+	assert(handle < resources_.size() && resources_[handle]);
+	return resources_[handle].Get();
+}
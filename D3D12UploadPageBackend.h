@@ -0,0 +1,36 @@
+#pragma once
+#include <d3d12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <vector>
+#include "UploadAllocator.h"
+
+/// <summary>
+/// UploadHeapのバッファをページとして作る。作ったらMapしたままにして、消す時にUnmapする
+/// </summary>
+class D3D12UploadPageBackend final : public UploadPageBackend {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="device">バッファを作るデバイス</param>
+	explicit D3D12UploadPageBackend(ID3D12Device* device);
+	~D3D12UploadPageBackend() override;
+
+	// コピー禁止
+	D3D12UploadPageBackend(const D3D12UploadPageBackend&) = delete;
+	D3D12UploadPageBackend& operator=(const D3D12UploadPageBackend&) = delete;
+
+	UploadPage CreatePage(size_t size) override;
+	void DestroyPage(const UploadPage& page) override;
+
+	/// <summary>
+	/// ページのバッファ。CopyBufferRegionなどでコピー元に指定する時に使う
+	/// </summary>
+	ID3D12Resource* GetResource(uint32_t handle) const;
+
+private:
+	ID3D12Device* device_;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> resources_; // handleで引く。消した所は空にする
+	std::vector<uint32_t> freeHandles_; // 空いているhandle
+};
@@ -0,0 +1,41 @@
+#include "FramePacer.h"
+
+#include <cassert>
+
+FramePacer::FramePacer(FrameFence& fence, uint32_t framesInFlight)
+	: fence_(fence), framesInFlight_(framesInFlight) {
+	assert(framesInFlight_ >= kMinFramesInFlight && framesInFlight_ <= kMaxFramesInFlight);
+}
+
+uint32_t FramePacer::BeginFrame() {
+	assert(!isFrameOpen_);
+
+	// 枠の前のフレームがまだGPUで終わっていない時だけ待つ
+	uint64_t slotFenceValue = slotFenceValues_[frameIndex_];
+	if (fence_.GetCompletedValue() < slotFenceValue) {
+		fence_.Wait(slotFenceValue);
+		++waitCount_;
+	}
+	assert(fence_.GetCompletedValue() >= slotFenceValue);
+
+	isFrameOpen_ = true;
+	return frameIndex_;
+}
+
+uint64_t FramePacer::EndFrame() {
+	assert(isFrameOpen_);
+
+	++lastSignaledValue_;
+	fence_.Signal(lastSignaledValue_);
+	slotFenceValues_[frameIndex_] = lastSignaledValue_;
+
+	frameIndex_ = (frameIndex_ + 1) % framesInFlight_;
+	isFrameOpen_ = false;
+	return lastSignaledValue_;
+}
+
+void FramePacer::WaitForIdle() {
+	if (fence_.GetCompletedValue() < lastSignaledValue_) {
+		fence_.Wait(lastSignaledValue_);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// フレームの終わりを知らせて待つためのFence。D3D12ではコマンドキューのSignalとID3D12Fenceを使う
+/// 数を進めるだけのものに差し替えれば、GPU無しでFramePacerを確かめられる
+/// </summary>
+class FrameFence {
+public:
+	virtual ~FrameFence() = default;
+
+	/// <summary>
+	/// 今までキューに積んだコマンドが終わった時に、Fenceをvalueにする
+	/// </summary>
+	virtual void Signal(uint64_t value) = 0;
+
+	/// <summary>
+	/// GPUが終わった所のFenceの値
+	/// </summary>
+	virtual uint64_t GetCompletedValue() = 0;
+
+	/// <summary>
+	/// Fenceがvalueになるまで、CPUを止めて待つ
+	/// </summary>
+	virtual void Wait(uint64_t value) = 0;
+};
+
+/// <summary>
+/// 同時に進めるフレームの数だけ枠を持ち、枠ごとにCommandAllocatorなどを分けて使い回す
+/// 枠にはその枠で最後に出したフレームのFenceの値を覚えておき、枠をもう一度使う時だけ、そのフレームが終わるのを待つ
+/// </summary>
+class FramePacer final {
+public:
+	// 同時に進めるフレームの数の範囲
+	static constexpr uint32_t kMinFramesInFlight = 1;
+	static constexpr uint32_t kMaxFramesInFlight = 3;
+
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="fence">フレームの終わりを知らせるFence。このクラスより長く生きるようにする</param>
+	/// <param name="framesInFlight">同時に進めるフレームの数。kMinFramesInFlightからkMaxFramesInFlightまで</param>
+	FramePacer(FrameFence& fence, uint32_t framesInFlight);
+
+	// コピー禁止
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+
+	/// <summary>
+	/// 次のフレームを始める。この枠の前のフレームがGPUで終わっていなければ、終わるまで待つ
+	/// </summary>
+	/// <returns>このフレームが使う枠の番号</returns>
+	uint32_t BeginFrame();
+
+	/// <summary>
+	/// コマンドをキューに積んだ後に呼び、フレームを閉じる。Signalした値を枠に覚えておく
+	/// </summary>
+	/// <returns>このフレームでSignalした値。GPUがこの値に着いたら、このフレームで使った物を使い回せる</returns>
+	uint64_t EndFrame();
+
+	/// <summary>
+	/// 出した全部のフレームがGPUで終わるまで待つ。リソースを消す前に呼ぶ
+	/// </summary>
+	void WaitForIdle();
+
+	// 同時に進めるフレームの数
+	uint32_t GetFramesInFlight() const { return framesInFlight_; }
+	// 今のフレームの枠の番号。EndFrameの後は次のフレームの枠になる
+	uint32_t GetFrameIndex() const { return frameIndex_; }
+	// BeginFrameからEndFrameまでの間か
+	bool IsFrameOpen() const { return isFrameOpen_; }
+	// 最後にSignalした値
+	uint64_t GetLastSignaledValue() const { return lastSignaledValue_; }
+	// 枠を使い回す時に、GPUを待った回数
+	uint64_t GetWaitCount() const { return waitCount_; }
+
+private:
+	FrameFence& fence_;
+	uint32_t framesInFlight_;
+	uint32_t frameIndex_ = 0;
+	uint64_t slotFenceValues_[kMaxFramesInFlight] = {}; // 枠で最後に出したフレームの値。0ならまだ使っていない
+	uint64_t lastSignaledValue_ = 0;
+	uint64_t waitCount_ = 0;
+	bool isFrameOpen_ = false;
+};
@@ -0,0 +1,92 @@
+#include "FrameRingAllocator.h"
+
+#include <cassert>
+
+namespace {
+
+	// alignmentの倍数に切り上げる。alignmentは2の累乗
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool IsPowerOfTwo(size_t value) {
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+}
+
+FrameRingAllocator::FrameRingAllocator(UploadPageBackend& backend, size_t capacity)
+	: backend_(backend), page_(backend.CreatePage(capacity)), capacity_(capacity) {
+	assert(capacity_ > 0);
+	assert(page_.cpuAddress != nullptr && page_.size >= capacity_);
+	assert(page_.gpuAddress % LinearUploadAllocator::kPageAlignment == 0);
+}
+
+FrameRingAllocator::~FrameRingAllocator() {
+	backend_.DestroyPage(page_);
+}
+
+bool FrameRingAllocator::TryAllocate(size_t size, size_t alignment, UploadAllocation& allocation) {
+	assert(IsPowerOfTwo(alignment) && alignment <= LinearUploadAllocator::kPageAlignment);
+	if (usedBytes_ == capacity_ || size > capacity_) {
+		return false;
+	}
+
+	// 空いているのは、折り返していなければ[tail, capacity)と[0, head)、折り返していれば[tail, head)
+	size_t alignedOffset = static_cast<size_t>(AlignUp(page_.gpuAddress + tail_, alignment) - page_.gpuAddress);
+	size_t offset = 0;
+	if (tail_ >= head_) {
+		if (alignedOffset + size <= capacity_) {
+			offset = alignedOffset;
+		} else if (size <= head_) {
+			offset = 0; // 終わりの残りを捨てて先頭に戻る。ページの先頭は境界にそろっている
+		} else {
+			return false;
+		}
+	} else {
+		if (alignedOffset + size <= head_) {
+			offset = alignedOffset;
+		} else {
+			return false;
+		}
+	}
+
+	// 境界のために空けた所と、先頭に戻る時に捨てた所も、このフレームが使ったことにする
+	size_t consumed = offset >= tail_ ? offset + size - tail_ : capacity_ - tail_ + offset + size;
+	usedBytes_ += consumed;
+	frameBytes_ += consumed;
+	tail_ = offset + size;
+	assert(usedBytes_ <= capacity_);
+
+	allocation = { page_.cpuAddress + offset, page_.gpuAddress + offset, size };
+	return true;
+}
+
+bool FrameRingAllocator::TryAllocateConstantBuffer(size_t size, UploadAllocation& allocation) {
+	constexpr size_t kAlignment = LinearUploadAllocator::kConstantBufferAlignment;
+	return TryAllocate(static_cast<size_t>(AlignUp(size, kAlignment)), kAlignment, allocation);
+}
+
+void FrameRingAllocator::FinishFrame(uint64_t fenceValue) {
+	assert(frames_.empty() || frames_.back().fenceValue < fenceValue);
+	frames_.push_back({ fenceValue, tail_, frameBytes_ });
+	frameBytes_ = 0;
+}
+
+void FrameRingAllocator::Reclaim(uint64_t completedFenceValue) {
+	while (!frames_.empty() && frames_.front().fenceValue <= completedFenceValue) {
+		head_ = frames_.front().endOffset;
+		usedBytes_ -= frames_.front().bytes;
+		frames_.pop_front();
+	}
+
+	// 全部空いたら先頭に戻しておく。途中から始めると、輪の大きさに近いものが入らなくなる
+	if (frames_.empty() && usedBytes_ == 0) {
+		head_ = 0;
+		tail_ = 0;
+	}
+}
+
+uint64_t FrameRingAllocator::GetOldestFenceValue() const {
+	assert(!frames_.empty());
+	return frames_.front().fenceValue;
+}
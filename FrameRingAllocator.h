@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include "UploadAllocator.h"
+
+/// <summary>
+/// 毎フレーム書き換えるCBufferなどを、1枚のページから輪のように順に切り出す
+/// フレームの終わりにFenceの値を付けておき、GPUがその値まで進んだら、そのフレームで切り出した所を使い回す
+/// Fenceの値を受け取るだけなので、D3D12のFenceが無くても数を進めるだけで確かめられる
+/// </summary>
+class FrameRingAllocator final {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="backend">ページを作る所。このクラスより長く生きるようにする</param>
+	/// <param name="capacity">輪の大きさ。同時に進むフレームの分が入る大きさにする</param>
+	FrameRingAllocator(UploadPageBackend& backend, size_t capacity);
+	~FrameRingAllocator();
+
+	// コピー禁止
+	FrameRingAllocator(const FrameRingAllocator&) = delete;
+	FrameRingAllocator& operator=(const FrameRingAllocator&) = delete;
+
+	/// <summary>
+	/// 今のフレーム用に切り出す。終わりに入らなければ、残りを捨てて先頭に戻る
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="alignment">GPUアドレスの境界。2の累乗でLinearUploadAllocator::kPageAlignment以下</param>
+	/// <param name="allocation">切り出した範囲を書き込む</param>
+	/// <returns>GPUが使っている所に追いついて入らなければfalse。古いフレームのFenceを待ってReclaimしてからやり直す</returns>
+	bool TryAllocate(size_t size, size_t alignment, UploadAllocation& allocation);
+
+	/// <summary>
+	/// CBV用に切り出す。アドレスを256の境界にそろえ、大きさも256の倍数に切り上げる
+	/// </summary>
+	bool TryAllocateConstantBuffer(size_t size, UploadAllocation& allocation);
+
+	/// <summary>
+	/// 今のフレームを閉じる。このフレームで切り出した所は、fenceValueが終わるまで使わない
+	/// </summary>
+	/// <param name="fenceValue">このフレームのコマンドの後にSignalする値</param>
+	void FinishFrame(uint64_t fenceValue);
+
+	/// <summary>
+	/// GPUが終わったフレームの分を空ける
+	/// </summary>
+	/// <param name="completedFenceValue">FenceのGetCompletedValue</param>
+	void Reclaim(uint64_t completedFenceValue);
+
+	// GPUが終わるのを待っているフレームの数
+	size_t GetPendingFrameCount() const { return frames_.size(); }
+	// 一番古い、待っているフレームのFenceの値。待っているフレームがある時だけ呼ぶ
+	uint64_t GetOldestFenceValue() const;
+	// 輪の大きさ
+	size_t GetCapacity() const { return capacity_; }
+	// 使っている大きさ(先頭に戻る時に捨てた所も含む)
+	size_t GetUsedBytes() const { return usedBytes_; }
+	// 切り出しているページ。コピー元をリソースとオフセットで指定する時に使う
+	const UploadPage& GetPage() const { return page_; }
+
+private:
+	// 閉じたフレーム
+	struct FrameRecord final {
+		uint64_t fenceValue;
+		size_t endOffset; // 閉じた時の書き込み位置。GPUが終わったら、ここまでが空く
+		size_t bytes; // このフレームで使った大きさ
+	};
+
+	UploadPageBackend& backend_;
+	UploadPage page_;
+	size_t capacity_;
+	size_t head_ = 0; // 使っている所の始まり
+	size_t tail_ = 0; // 次に切り出す所
+	size_t usedBytes_ = 0; // headからtailまでの大きさ。headとtailが同じ時に、空か満杯かを見分ける
+	size_t frameBytes_ = 0; // 今のフレームで使った大きさ
+	std::deque<FrameRecord> frames_;
+};
@@ -0,0 +1,61 @@
+#include "Frustum.h"
+#include "VectorMath.h"
+
+#include <cmath>
+
+namespace {
+
+	// 行列の列をVector4で取り出す。行ベクトルなのでクリップ座標の各成分は列との内積になる
+	Vector4 Column(const Matrix4x4& matrix, int column) {
+		return { matrix.m[0][column], matrix.m[1][column], matrix.m[2][column], matrix.m[3][column] };
+	}
+
+	// 法線の長さを1にして、wが距離になるようにする
+	Vector4 NormalizePlane(const Vector4& plane) {
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length == 0.0f) {
+			return plane;
+		}
+		return { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+	}
+}
+
+Frustum MakeFrustum(const Matrix4x4& viewProjection) {
+	Vector4 x = Column(viewProjection, 0);
+	Vector4 y = Column(viewProjection, 1);
+	Vector4 z = Column(viewProjection, 2);
+	Vector4 w = Column(viewProjection, 3);
+
+	// -w <= x <= w、-w <= y <= w、0 <= z <= w をそれぞれ平面にする
+	Frustum frustum;
+	frustum.planes[0] = NormalizePlane(w + x); // 左
+	frustum.planes[1] = NormalizePlane(w - x); // 右
+	frustum.planes[2] = NormalizePlane(w + y); // 下
+	frustum.planes[3] = NormalizePlane(w - y); // 上
+	frustum.planes[4] = NormalizePlane(z); // 近
+	frustum.planes[5] = NormalizePlane(w - z); // 遠
+	return frustum;
+}
+
+bool IsSphereInFrustum(const Frustum& frustum, const Vector3& center, float radius) {
+	for (const Vector4& plane : frustum.planes) {
+		// 平面の外側に半径より離れていれば見えない
+		if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsAabbInFrustum(const Frustum& frustum, const Vector3& min, const Vector3& max) {
+	for (const Vector4& plane : frustum.planes) {
+		// 法線の向きに一番出ている頂点が平面の外側なら、箱全体が外側にある
+		float x = plane.x >= 0.0f ? max.x : min.x;
+		float y = plane.y >= 0.0f ? max.y : min.y;
+		float z = plane.z >= 0.0f ? max.z : min.z;
+		if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+			return false;
+		}
+	}
+	return true;
+}
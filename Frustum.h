@@ -0,0 +1,37 @@
+#pragma once
+#include "Matrix4x4.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+/// <summary>
+/// 視錐台。6枚の平面(xyzが内向きの法線、wが距離)で表す
+/// </summary>
+struct Frustum final {
+	Vector4 planes[6]; // 左、右、下、上、近、遠
+};
+
+/// <summary>
+/// 行列から視錐台を取り出す。WVPを渡せばモデルの座標系、VPを渡せばワールド座標系の視錐台になる
+/// </summary>
+/// <param name="viewProjection">行ベクトル(v*M)の行列。クリップ空間のzは[0,w]</param>
+/// <returns>法線を正規化した視錐台</returns>
+Frustum MakeFrustum(const Matrix4x4& viewProjection);
+
+/// <summary>
+/// 球が視錐台に少しでも入っているか
+/// </summary>
+/// <param name="frustum">視錐台</param>
+/// <param name="center">球の中心</param>
+/// <param name="radius">球の半径</param>
+/// <returns>入っていればtrue。完全に外ならfalse</returns>
+bool IsSphereInFrustum(const Frustum& frustum, const Vector3& center, float radius);
+
+/// <summary>
+/// 軸に平行な箱(AABB)が視錐台に少しでも入っているか
+/// 平面ごとに法線の向きに一番出ている頂点だけを調べる。視錐台の角の外側にある箱はtrueになることがある
+/// </summary>
+/// <param name="frustum">視錐台</param>
+/// <param name="min">箱の最小の角</param>
+/// <param name="max">箱の最大の角</param>
+/// <returns>入っていればtrue。完全に外ならfalse</returns>
+bool IsAabbInFrustum(const Frustum& frustum, const Vector3& min, const Vector3& max);
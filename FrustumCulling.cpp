@@ -0,0 +1,307 @@
+#include "FrustumCulling.h"
+#include "SimdConfig.h"
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+	void AssertSameCount(const BoundingSphereArrays& spheres) {
+		size_t count = spheres.radius.size();
+		assert(spheres.centerX.size() == count && spheres.centerY.size() == count && spheres.centerZ.size() == count);
+		assert(count <= std::numeric_limits<uint32_t>::max());
+		(void)spheres; (void)count;
+	}
+
+	void AssertSameCount(const BoundingBoxArrays& boxes) {
+		size_t count = boxes.minX.size();
+		assert(boxes.minY.size() == count && boxes.minZ.size() == count);
+		assert(boxes.maxX.size() == count && boxes.maxY.size() == count && boxes.maxZ.size() == count);
+		assert(count <= std::numeric_limits<uint32_t>::max());
+		(void)boxes; (void)count;
+	}
+
+#if MYMATH_USE_SIMD
+	// 一度に比べる数
+	constexpr uint32_t kCullBatch = 8;
+
+	// 見えるかどうかのビット(下位から順に8つ)を見て、番号を詰めて書き込む
+	// 分岐しないように毎回書き込み、見える時だけ書き込み先を進める。書き込み先は調べている番号を越えないので、はみ出さない
+	uint32_t* AppendVisible(uint32_t* output, uint32_t first, uint32_t visibleMask) {
+		for (uint32_t lane = 0; lane < kCullBatch; ++lane) {
+			*output = first + lane;
+			output += (visibleMask >> lane) & 1u;
+		}
+		return output;
+	}
+
+#if defined(__AVX__)
+	/// *****************************************************
+	/// AVXで8つずつ比べる
+	/// *****************************************************
+	// 平面を8レーンに広げたもの
+	struct FrustumLanes final {
+		__m256 x[6];
+		__m256 y[6];
+		__m256 z[6];
+		__m256 w[6];
+	};
+
+	FrustumLanes LoadFrustumLanes(const Frustum& frustum) {
+		FrustumLanes lanes;
+		for (int plane = 0; plane < 6; ++plane) {
+			lanes.x[plane] = _mm256_set1_ps(frustum.planes[plane].x);
+			lanes.y[plane] = _mm256_set1_ps(frustum.planes[plane].y);
+			lanes.z[plane] = _mm256_set1_ps(frustum.planes[plane].z);
+			lanes.w[plane] = _mm256_set1_ps(frustum.planes[plane].w);
+		}
+		return lanes;
+	}
+
+	// 平面までの距離。スカラー版と同じ順番で足す
+	__m256 PlaneDistance(const FrustumLanes& lanes, int plane, __m256 x, __m256 y, __m256 z) {
+		__m256 distance = _mm256_mul_ps(lanes.x[plane], x);
+		distance = _mm256_add_ps(distance, _mm256_mul_ps(lanes.y[plane], y));
+		distance = _mm256_add_ps(distance, _mm256_mul_ps(lanes.z[plane], z));
+		return _mm256_add_ps(distance, lanes.w[plane]);
+	}
+
+	size_t CullSpheresSimd(const Frustum& frustum, const BoundingSphereArrays& spheres, uint32_t*& output) {
+		size_t count = spheres.radius.size();
+		const FrustumLanes lanes = LoadFrustumLanes(frustum);
+		const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+		size_t index = 0;
+		for (; index + kCullBatch <= count; index += kCullBatch) {
+			__m256 x = _mm256_loadu_ps(spheres.centerX.data() + index);
+			__m256 y = _mm256_loadu_ps(spheres.centerY.data() + index);
+			__m256 z = _mm256_loadu_ps(spheres.centerZ.data() + index);
+			__m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(spheres.radius.data() + index), signBit);
+
+			// どれか1枚でも外側に半径より離れていれば見えない。NaNはスカラー版と同じく外側にしない
+			__m256 outside = _mm256_setzero_ps();
+			for (int plane = 0; plane < 6; ++plane) {
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(PlaneDistance(lanes, plane, x, y, z), negativeRadius, _CMP_LT_OQ));
+			}
+			output = AppendVisible(output, static_cast<uint32_t>(index), ~static_cast<uint32_t>(_mm256_movemask_ps(outside)));
+		}
+		return index;
+	}
+
+	size_t CullBoxesSimd(const Frustum& frustum, const BoundingBoxArrays& boxes, uint32_t*& output) {
+		size_t count = boxes.minX.size();
+		const FrustumLanes lanes = LoadFrustumLanes(frustum);
+
+		size_t index = 0;
+		for (; index + kCullBatch <= count; index += kCullBatch) {
+			__m256 minX = _mm256_loadu_ps(boxes.minX.data() + index);
+			__m256 minY = _mm256_loadu_ps(boxes.minY.data() + index);
+			__m256 minZ = _mm256_loadu_ps(boxes.minZ.data() + index);
+			__m256 maxX = _mm256_loadu_ps(boxes.maxX.data() + index);
+			__m256 maxY = _mm256_loadu_ps(boxes.maxY.data() + index);
+			__m256 maxZ = _mm256_loadu_ps(boxes.maxZ.data() + index);
+
+			// 法線の向きは8つとも同じなので、一番出ている頂点は平面ごとに選べばよい
+			__m256 outside = _mm256_setzero_ps();
+			for (int plane = 0; plane < 6; ++plane) {
+				const Vector4& normal = frustum.planes[plane];
+				__m256 x = normal.x >= 0.0f ? maxX : minX;
+				__m256 y = normal.y >= 0.0f ? maxY : minY;
+				__m256 z = normal.z >= 0.0f ? maxZ : minZ;
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(PlaneDistance(lanes, plane, x, y, z), _mm256_setzero_ps(), _CMP_LT_OQ));
+			}
+			output = AppendVisible(output, static_cast<uint32_t>(index), ~static_cast<uint32_t>(_mm256_movemask_ps(outside)));
+		}
+		return index;
+	}
+#else
+	/// *****************************************************
+	/// SSEで4つずつを2回、合わせて8つずつ比べる
+	/// *****************************************************
+	// 平面を4レーンに広げたもの
+	struct FrustumLanes final {
+		__m128 x[6];
+		__m128 y[6];
+		__m128 z[6];
+		__m128 w[6];
+	};
+
+	FrustumLanes LoadFrustumLanes(const Frustum& frustum) {
+		FrustumLanes lanes;
+		for (int plane = 0; plane < 6; ++plane) {
+			lanes.x[plane] = _mm_set1_ps(frustum.planes[plane].x);
+			lanes.y[plane] = _mm_set1_ps(frustum.planes[plane].y);
+			lanes.z[plane] = _mm_set1_ps(frustum.planes[plane].z);
+			lanes.w[plane] = _mm_set1_ps(frustum.planes[plane].w);
+		}
+		return lanes;
+	}
+
+	// 平面までの距離。スカラー版と同じ順番で足す
+	__m128 PlaneDistance(const FrustumLanes& lanes, int plane, __m128 x, __m128 y, __m128 z) {
+		__m128 distance = _mm_mul_ps(lanes.x[plane], x);
+		distance = _mm_add_ps(distance, _mm_mul_ps(lanes.y[plane], y));
+		distance = _mm_add_ps(distance, _mm_mul_ps(lanes.z[plane], z));
+		return _mm_add_ps(distance, lanes.w[plane]);
+	}
+
+	// index番目から4つの球のうち、見えないもののビット
+	uint32_t OutsideSpheres(const FrustumLanes& lanes, const BoundingSphereArrays& spheres, size_t index) {
+		__m128 x = _mm_loadu_ps(spheres.centerX.data() + index);
+		__m128 y = _mm_loadu_ps(spheres.centerY.data() + index);
+		__m128 z = _mm_loadu_ps(spheres.centerZ.data() + index);
+		__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(spheres.radius.data() + index), _mm_set1_ps(-0.0f));
+
+		// どれか1枚でも外側に半径より離れていれば見えない。NaNはスカラー版と同じく外側にしない
+		__m128 outside = _mm_setzero_ps();
+		for (int plane = 0; plane < 6; ++plane) {
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(PlaneDistance(lanes, plane, x, y, z), negativeRadius));
+		}
+		return static_cast<uint32_t>(_mm_movemask_ps(outside));
+	}
+
+	// index番目から4つの箱のうち、見えないもののビット
+	uint32_t OutsideBoxes(const Frustum& frustum, const FrustumLanes& lanes, const BoundingBoxArrays& boxes, size_t index) {
+		__m128 minX = _mm_loadu_ps(boxes.minX.data() + index);
+		__m128 minY = _mm_loadu_ps(boxes.minY.data() + index);
+		__m128 minZ = _mm_loadu_ps(boxes.minZ.data() + index);
+		__m128 maxX = _mm_loadu_ps(boxes.maxX.data() + index);
+		__m128 maxY = _mm_loadu_ps(boxes.maxY.data() + index);
+		__m128 maxZ = _mm_loadu_ps(boxes.maxZ.data() + index);
+
+		// 法線の向きは4つとも同じなので、一番出ている頂点は平面ごとに選べばよい
+		__m128 outside = _mm_setzero_ps();
+		for (int plane = 0; plane < 6; ++plane) {
+			const Vector4& normal = frustum.planes[plane];
+			__m128 x = normal.x >= 0.0f ? maxX : minX;
+			__m128 y = normal.y >= 0.0f ? maxY : minY;
+			__m128 z = normal.z >= 0.0f ? maxZ : minZ;
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(PlaneDistance(lanes, plane, x, y, z), _mm_setzero_ps()));
+		}
+		return static_cast<uint32_t>(_mm_movemask_ps(outside));
+	}
+
+	size_t CullSpheresSimd(const Frustum& frustum, const BoundingSphereArrays& spheres, uint32_t*& output) {
+		size_t count = spheres.radius.size();
+		const FrustumLanes lanes = LoadFrustumLanes(frustum);
+
+		size_t index = 0;
+		for (; index + kCullBatch <= count; index += kCullBatch) {
+			uint32_t outside = OutsideSpheres(lanes, spheres, index) | (OutsideSpheres(lanes, spheres, index + 4) << 4);
+			output = AppendVisible(output, static_cast<uint32_t>(index), ~outside);
+		}
+		return index;
+	}
+
+	size_t CullBoxesSimd(const Frustum& frustum, const BoundingBoxArrays& boxes, uint32_t*& output) {
+		size_t count = boxes.minX.size();
+		const FrustumLanes lanes = LoadFrustumLanes(frustum);
+
+		size_t index = 0;
+		for (; index + kCullBatch <= count; index += kCullBatch) {
+			uint32_t outside = OutsideBoxes(frustum, lanes, boxes, index) | (OutsideBoxes(frustum, lanes, boxes, index + 4) << 4);
+			output = AppendVisible(output, static_cast<uint32_t>(index), ~outside);
+		}
+		return index;
+	}
+#endif
+#endif
+}
+
+/// *****************************************************
+/// SoAの境界を扱う
+/// *****************************************************
+void ResizeBoundingSphereArrays(BoundingSphereArrays& spheres, size_t count) {
+	spheres.centerX.resize(count, 0.0f);
+	spheres.centerY.resize(count, 0.0f);
+	spheres.centerZ.resize(count, 0.0f);
+	spheres.radius.resize(count, 0.0f);
+}
+
+void SetBoundingSphere(BoundingSphereArrays& spheres, size_t index, const Vector3& center, float radius) {
+	spheres.centerX[index] = center.x;
+	spheres.centerY[index] = center.y;
+	spheres.centerZ[index] = center.z;
+	spheres.radius[index] = radius;
+}
+
+void ResizeBoundingBoxArrays(BoundingBoxArrays& boxes, size_t count) {
+	boxes.minX.resize(count, 0.0f);
+	boxes.minY.resize(count, 0.0f);
+	boxes.minZ.resize(count, 0.0f);
+	boxes.maxX.resize(count, 0.0f);
+	boxes.maxY.resize(count, 0.0f);
+	boxes.maxZ.resize(count, 0.0f);
+}
+
+void SetBoundingBox(BoundingBoxArrays& boxes, size_t index, const Vector3& min, const Vector3& max) {
+	boxes.minX[index] = min.x;
+	boxes.minY[index] = min.y;
+	boxes.minZ[index] = min.z;
+	boxes.maxX[index] = max.x;
+	boxes.maxY[index] = max.y;
+	boxes.maxZ[index] = max.z;
+}
+
+void SetTransformedBoundingBox(BoundingBoxArrays& boxes, size_t index, const Vector3& localMin, const Vector3& localMax, const Matrix4x4& world) {
+	Vector3 center = { (localMin.x + localMax.x) * 0.5f, (localMin.y + localMax.y) * 0.5f, (localMin.z + localMax.z) * 0.5f };
+	Vector3 extent = { (localMax.x - localMin.x) * 0.5f, (localMax.y - localMin.y) * 0.5f, (localMax.z - localMin.z) * 0.5f };
+	float worldCenter[3];
+	float worldExtent[3];
+	for (int column = 0; column < 3; ++column) {
+		worldCenter[column] = center.x * world.m[0][column] + center.y * world.m[1][column] + center.z * world.m[2][column] + world.m[3][column];
+		worldExtent[column] = extent.x * std::fabs(world.m[0][column]) + extent.y * std::fabs(world.m[1][column]) + extent.z * std::fabs(world.m[2][column]);
+	}
+	SetBoundingBox(boxes, index,
+		{ worldCenter[0] - worldExtent[0], worldCenter[1] - worldExtent[1], worldCenter[2] - worldExtent[2] },
+		{ worldCenter[0] + worldExtent[0], worldCenter[1] + worldExtent[1], worldCenter[2] + worldExtent[2] });
+}
+
+/// *****************************************************
+/// まとめて視錐台と比べる
+/// *****************************************************
+void CullSpheres(const Frustum& frustum, const BoundingSphereArrays& spheres, std::vector<uint32_t>& visibleIndices) {
+	AssertSameCount(spheres);
+	size_t count = spheres.radius.size();
+
+	// 全て見える時の長さにしておき、最後に見えた数まで縮める
+	visibleIndices.resize(count);
+	uint32_t* output = visibleIndices.data();
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	index = CullSpheresSimd(frustum, spheres, output);
+#endif
+
+	// 端数
+	for (; index < count; ++index) {
+		Vector3 center{ spheres.centerX[index], spheres.centerY[index], spheres.centerZ[index] };
+		*output = static_cast<uint32_t>(index);
+		output += IsSphereInFrustum(frustum, center, spheres.radius[index]) ? 1 : 0;
+	}
+	visibleIndices.resize(static_cast<size_t>(output - visibleIndices.data()));
+}
+
+void CullBoxes(const Frustum& frustum, const BoundingBoxArrays& boxes, std::vector<uint32_t>& visibleIndices) {
+	AssertSameCount(boxes);
+	size_t count = boxes.minX.size();
+
+	// 全て見える時の長さにしておき、最後に見えた数まで縮める
+	visibleIndices.resize(count);
+	uint32_t* output = visibleIndices.data();
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	index = CullBoxesSimd(frustum, boxes, output);
+#endif
+
+	// 端数
+	for (; index < count; ++index) {
+		Vector3 min{ boxes.minX[index], boxes.minY[index], boxes.minZ[index] };
+		Vector3 max{ boxes.maxX[index], boxes.maxY[index], boxes.maxZ[index] };
+		*output = static_cast<uint32_t>(index);
+		output += IsAabbInFrustum(frustum, min, max) ? 1 : 0;
+	}
+	visibleIndices.resize(static_cast<size_t>(output - visibleIndices.data()));
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BoundingBoxArrays.h"
+#include "BoundingSphereArrays.h"
+#include "Frustum.h"
+#include "Matrix4x4.h"
+#include "Vector3.h"
+
+/// <summary>
+/// 全ての配列の長さをそろえる
+/// </summary>
+/// <param name="spheres">SoAの境界球</param>
+/// <param name="count">数</param>
+void ResizeBoundingSphereArrays(BoundingSphereArrays& spheres, size_t count);
+
+/// <summary>
+/// index番目の境界球を書き込む
+/// </summary>
+void SetBoundingSphere(BoundingSphereArrays& spheres, size_t index, const Vector3& center, float radius);
+
+/// <summary>
+/// 全ての配列の長さをそろえる
+/// </summary>
+/// <param name="boxes">SoAのAABB</param>
+/// <param name="count">数</param>
+void ResizeBoundingBoxArrays(BoundingBoxArrays& boxes, size_t count);
+
+/// <summary>
+/// index番目のAABBを書き込む
+/// </summary>
+void SetBoundingBox(BoundingBoxArrays& boxes, size_t index, const Vector3& min, const Vector3& max);
+
+/// <summary>
+/// ローカル座標のAABBをWorld行列で動かし、それを囲むAABBをindex番目に書き込む
+/// 8つの角を変換する代わりに、中心を変換し、半分の大きさに行列の各成分の絶対値を掛けて広げる
+/// </summary>
+/// <param name="boxes">SoAのAABB</param>
+/// <param name="index">書き込む番号</param>
+/// <param name="localMin">ローカル座標のAABBの最小の角</param>
+/// <param name="localMax">ローカル座標のAABBの最大の角</param>
+/// <param name="world">アフィン変換のWorld行列(行ベクトル)</param>
+void SetTransformedBoundingBox(BoundingBoxArrays& boxes, size_t index, const Vector3& localMin, const Vector3& localMax, const Matrix4x4& world);
+
+/// <summary>
+/// N個の境界球をまとめて視錐台と比べ、見えるものの番号を詰めて書き出す
+/// 8つずつ比べる。1つずつのIsSphereInFrustumと同じ結果になる
+/// </summary>
+/// <param name="frustum">視錐台。球と同じ座標系のものを渡す</param>
+/// <param name="spheres">SoAの境界球</param>
+/// <param name="visibleIndices">見える球の番号を小さい順に書き込む。中身は上書きされ、長さは見える数になる</param>
+void CullSpheres(const Frustum& frustum, const BoundingSphereArrays& spheres, std::vector<uint32_t>& visibleIndices);
+
+/// <summary>
+/// N個のAABBをまとめて視錐台と比べ、見えるものの番号を詰めて書き出す
+/// 8つずつ比べる。1つずつのIsAabbInFrustumと同じ結果になる
+/// </summary>
+/// <param name="frustum">視錐台。箱と同じ座標系のものを渡す</param>
+/// <param name="boxes">SoAのAABB</param>
+/// <param name="visibleIndices">見える箱の番号を小さい順に書き込む。中身は上書きされ、長さは見える数になる</param>
+void CullBoxes(const Frustum& frustum, const BoundingBoxArrays& boxes, std::vector<uint32_t>& visibleIndices);
@@ -0,0 +1,25 @@
+#include "Logger.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdio>
+#include <cwchar>
+#endif
+
+// 出力ウィンドウに文字を出す
+void Log(const std::string& message) {
+#ifdef _WIN32
+	OutputDebugStringA(message.c_str());
+#else
+	std::fputs(message.c_str(), stderr);
+#endif
+}
+
+void Log(const std::wstring& message) {
+#ifdef _WIN32
+	OutputDebugStringW(message.c_str());
+#else
+	std::fputws(message.c_str(), stderr);
+#endif
+}
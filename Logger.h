@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+
+/// <summary>
+/// 出力ウィンドウに文字を出す
+/// </summary>
+/// <param name="message">出力する文字列</param>
+void Log(const std::string& message);
+
+/// <summary>
+/// 出力ウィンドウに文字を出す(ワイド文字列)
+/// </summary>
+/// <param name="message">出力する文字列</param>
+void Log(const std::wstring& message);
@@ -0,0 +1,133 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		Close();
+		data_ = std::exchange(other.data_, nullptr);
+		size_ = std::exchange(other.size_, 0);
+		isOpen_ = std::exchange(other.isOpen_, false);
+#ifdef _WIN32
+		fileHandle_ = std::exchange(other.fileHandle_, nullptr);
+		mappingHandle_ = std::exchange(other.mappingHandle_, nullptr);
+#else
+		fileDescriptor_ = std::exchange(other.fileDescriptor_, -1);
+#endif
+	}
+	return *this;
+}
+
+bool MappedFile::Open(const std::string& filePath) {
+	Close();
+
+#ifdef _WIN32
+	// パスをワイド文字列に変換する
+	int sizeNeeded = MultiByteToWideChar(CP_UTF8, 0, filePath.data(), static_cast<int>(filePath.size()), nullptr, 0);
+	std::wstring filePathW(sizeNeeded, 0);
+	MultiByteToWideChar(CP_UTF8, 0, filePath.data(), static_cast<int>(filePath.size()), filePathW.data(), sizeNeeded);
+
+	// ファイルを開く。先頭から順に読むことをOSに伝えておく
+	HANDLE file = CreateFileW(filePathW.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	fileHandle_ = file;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize)) {
+		Close();
+		return false;
+	}
+	size_ = static_cast<size_t>(fileSize.QuadPart);
+	isOpen_ = true;
+
+	// 空のファイルはマップできないので、開いただけにしておく
+	if (size_ == 0) {
+		return true;
+	}
+
+	// ファイル全体を読み取り専用でマップする
+	mappingHandle_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle_ == nullptr) {
+		Close();
+		return false;
+	}
+	data_ = static_cast<const char*>(MapViewOfFile(mappingHandle_, FILE_MAP_READ, 0, 0, 0));
+	if (data_ == nullptr) {
+		Close();
+		return false;
+	}
+#else
+	fileDescriptor_ = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor_ < 0) {
+		return false;
+	}
+
+	struct stat fileStatus {};
+	if (fstat(fileDescriptor_, &fileStatus) != 0) {
+		Close();
+		return false;
+	}
+	size_ = static_cast<size_t>(fileStatus.st_size);
+	isOpen_ = true;
+
+	if (size_ == 0) {
+		return true;
+	}
+
+	void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fileDescriptor_, 0);
+	if (mapped == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	madvise(mapped, size_, MADV_SEQUENTIAL);
+	data_ = static_cast<const char*>(mapped);
+#endif
+
+	return true;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+	if (data_ != nullptr) {
+		UnmapViewOfFile(data_);
+	}
+	if (mappingHandle_ != nullptr) {
+		CloseHandle(mappingHandle_);
+	}
+	if (fileHandle_ != nullptr) {
+		CloseHandle(fileHandle_);
+	}
+	mappingHandle_ = nullptr;
+	fileHandle_ = nullptr;
+#else
+	if (data_ != nullptr) {
+		munmap(const_cast<char*>(data_), size_);
+	}
+	if (fileDescriptor_ >= 0) {
+		close(fileDescriptor_);
+	}
+	fileDescriptor_ = -1;
+#endif
+	data_ = nullptr;
+	size_ = 0;
+	isOpen_ = false;
+}
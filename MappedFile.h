@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+/// <summary>
+/// 読み取り専用のメモリマップドファイル
+/// </summary>
+class MappedFile final {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	// コピー禁止
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// ムーブは可能
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	/// <summary>
+	/// ファイルを開いてメモリにマップする
+	/// </summary>
+	/// <param name="filePath">ファイルパス(UTF-8)</param>
+	/// <returns>開けたらtrue</returns>
+	bool Open(const std::string& filePath);
+
+	/// <summary>
+	/// マップを解除してファイルを閉じる
+	/// </summary>
+	void Close();
+
+	// 開いているか
+	bool IsOpen() const { return isOpen_; }
+
+	// 先頭アドレス
+	const char* GetData() const { return data_; }
+
+	// ファイルサイズ
+	size_t GetSize() const { return size_; }
+
+private:
+	const char* data_ = nullptr;
+	size_t size_ = 0;
+	bool isOpen_ = false;
+#ifdef _WIN32
+	void* fileHandle_ = nullptr;
+	void* mappingHandle_ = nullptr;
+#else
+	int fileDescriptor_ = -1;
+#endif
+};
@@ -1,7 +1,17 @@
 #pragma once
 /// <summary>
-/// 4x4行列
+/// 4x4行列。SIMDで1行ずつ読めるように16バイト境界に置く
 /// </summary>
-struct Matrix4x4 final {
+struct alignas(16) Matrix4x4 final {
 	float m[4][4];
-};
\ No newline at end of file
+
+	/// <summary>
+	/// 行列の掛け算の式(MatrixExpression.hのMatrixProduct)を、途中の行列を作らずに直接書き込む
+	/// </summary>
+	template<class Expression>
+		requires requires(const Expression& expression, Matrix4x4& destination) { expression.EvaluateTo(destination); }
+	Matrix4x4& operator=(const Expression& expression) {
+		expression.EvaluateTo(*this);
+		return *this;
+	}
+};
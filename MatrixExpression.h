@@ -0,0 +1,173 @@
+#pragma once
+#include "Matrix4x4.h"
+#include "SimdConfig.h"
+
+/// *****************************************************
+/// 行列の掛け算の式(expression template)
+/// *****************************************************
+// world * view * projection のような掛け算は、その場では計算せずに式として持っておき、
+// 代入する時に1行ずつ求めて書き込む。途中の行列を作らないので、MapしたCBufferへも直接書ける
+// 行ベクトル(v*M)なので、答えのi行目は「左端の行列のi行目」に残りの行列を順番に掛けたものになる
+
+template<class Left, class Right>
+struct MatrixProduct;
+
+/// <summary>
+/// 2つの行列(または式)の掛け算 left * right。代入するまで計算しない
+/// </summary>
+template<class Left, class Right>
+struct MatrixProduct final {
+	// 行列も式も値で持つ。auto p = a * MakeXxx() * b; のように一時的な行列を掛けても、pより先に消えない
+	Left left;
+	Right right;
+
+	/// <summary>
+	/// 計算して書き込む。書き込み先が式の中に出てくる行列でもよい(4行とも求めてから書く)
+	/// </summary>
+	void EvaluateTo(Matrix4x4& destination) const;
+
+	/// <summary>
+	/// 計算した行列を返す
+	/// </summary>
+	operator Matrix4x4() const {
+		Matrix4x4 result;
+		EvaluateTo(result);
+		return result;
+	}
+};
+
+#if MYMATH_USE_SIMD && defined(__AVX__)
+// 2行(上下の128bitに1行ずつ)に行列を掛ける。足す順番はMutiplyと同じなので、結果も一致する
+inline __m256 MutiplyRows(__m256 rows, const Matrix4x4& matrix) {
+	__m256 result = _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.m[0])));
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.m[1]))));
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.m[2]))));
+	result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(rows, rows, _MM_SHUFFLE(3, 3, 3, 3)), _mm256_broadcast_ps(reinterpret_cast<const __m128*>(matrix.m[3]))));
+	return result;
+}
+
+// 式を掛ける。rows * (A * B) = (rows * A) * B
+template<class Left, class Right>
+__m256 MutiplyRows(__m256 rows, const MatrixProduct<Left, Right>& product) {
+	return MutiplyRows(MutiplyRows(rows, product.left), product.right);
+}
+
+// row行目とその次の行を取り出す
+inline __m256 LoadRows(const Matrix4x4& matrix, int row) {
+	return _mm256_loadu_ps(matrix.m[row]);
+}
+
+template<class Left, class Right>
+__m256 LoadRows(const MatrixProduct<Left, Right>& product, int row) {
+	return MutiplyRows(LoadRows(product.left, row), product.right);
+}
+
+template<class Left, class Right>
+void MatrixProduct<Left, Right>::EvaluateTo(Matrix4x4& destination) const {
+	__m256 rows01 = LoadRows(*this, 0);
+	__m256 rows23 = LoadRows(*this, 2);
+	_mm256_storeu_ps(destination.m[0], rows01);
+	_mm256_storeu_ps(destination.m[2], rows23);
+}
+#elif MYMATH_USE_SIMD
+// 行ベクトルに行列を掛ける。足す順番はMutiplyと同じなので、結果も一致する
+inline __m128 MutiplyRow(__m128 row, const Matrix4x4& matrix) {
+	__m128 result = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), _mm_load_ps(matrix.m[0]));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), _mm_load_ps(matrix.m[1])));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2, 2, 2, 2)), _mm_load_ps(matrix.m[2])));
+	result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3, 3, 3, 3)), _mm_load_ps(matrix.m[3])));
+	return result;
+}
+
+// 式を掛ける。row * (A * B) = (row * A) * B
+template<class Left, class Right>
+__m128 MutiplyRow(__m128 row, const MatrixProduct<Left, Right>& product) {
+	return MutiplyRow(MutiplyRow(row, product.left), product.right);
+}
+
+// i行目を取り出す
+inline __m128 LoadRow(const Matrix4x4& matrix, int row) {
+	return _mm_load_ps(matrix.m[row]);
+}
+
+template<class Left, class Right>
+__m128 LoadRow(const MatrixProduct<Left, Right>& product, int row) {
+	return MutiplyRow(LoadRow(product.left, row), product.right);
+}
+
+template<class Left, class Right>
+void MatrixProduct<Left, Right>::EvaluateTo(Matrix4x4& destination) const {
+	__m128 row0 = LoadRow(*this, 0);
+	__m128 row1 = LoadRow(*this, 1);
+	__m128 row2 = LoadRow(*this, 2);
+	__m128 row3 = LoadRow(*this, 3);
+	_mm_storeu_ps(destination.m[0], row0);
+	_mm_storeu_ps(destination.m[1], row1);
+	_mm_storeu_ps(destination.m[2], row2);
+	_mm_storeu_ps(destination.m[3], row3);
+}
+#else
+// 1行分(4要素)
+struct MatrixRow final {
+	float v[4];
+};
+
+// 行ベクトルに行列を掛ける。足す順番はMutiplyScalarと同じ
+inline MatrixRow MutiplyRow(const MatrixRow& row, const Matrix4x4& matrix) {
+	MatrixRow result;
+	for (int column = 0; column < 4; ++column) {
+		result.v[column] = row.v[0] * matrix.m[0][column] + row.v[1] * matrix.m[1][column] + row.v[2] * matrix.m[2][column] + row.v[3] * matrix.m[3][column];
+	}
+	return result;
+}
+
+template<class Left, class Right>
+MatrixRow MutiplyRow(const MatrixRow& row, const MatrixProduct<Left, Right>& product) {
+	return MutiplyRow(MutiplyRow(row, product.left), product.right);
+}
+
+inline MatrixRow LoadRow(const Matrix4x4& matrix, int row) {
+	return { { matrix.m[row][0], matrix.m[row][1], matrix.m[row][2], matrix.m[row][3] } };
+}
+
+template<class Left, class Right>
+MatrixRow LoadRow(const MatrixProduct<Left, Right>& product, int row) {
+	return MutiplyRow(LoadRow(product.left, row), product.right);
+}
+
+template<class Left, class Right>
+void MatrixProduct<Left, Right>::EvaluateTo(Matrix4x4& destination) const {
+	MatrixRow rows[4];
+	for (int row = 0; row < 4; ++row) {
+		rows[row] = LoadRow(*this, row);
+	}
+	for (int row = 0; row < 4; ++row) {
+		for (int column = 0; column < 4; ++column) {
+			destination.m[row][column] = rows[row].v[column];
+		}
+	}
+}
+#endif
+
+/// *****************************************************
+/// 掛け算の演算子
+/// *****************************************************
+inline MatrixProduct<Matrix4x4, Matrix4x4> operator*(const Matrix4x4& m1, const Matrix4x4& m2) {
+	return { m1, m2 };
+}
+
+template<class Left, class Right>
+MatrixProduct<MatrixProduct<Left, Right>, Matrix4x4> operator*(const MatrixProduct<Left, Right>& m1, const Matrix4x4& m2) {
+	return { m1, m2 };
+}
+
+template<class Left, class Right>
+MatrixProduct<Matrix4x4, MatrixProduct<Left, Right>> operator*(const Matrix4x4& m1, const MatrixProduct<Left, Right>& m2) {
+	return { m1, m2 };
+}
+
+template<class Left1, class Right1, class Left2, class Right2>
+MatrixProduct<MatrixProduct<Left1, Right1>, MatrixProduct<Left2, Right2>> operator*(
+	const MatrixProduct<Left1, Right1>& m1, const MatrixProduct<Left2, Right2>& m2) {
+	return { m1, m2 };
+}
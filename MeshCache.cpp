@@ -0,0 +1,385 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <vector>
+
+namespace {
+
+	// ファイルの識別子('MSHC')
+	const uint32_t kMeshCacheMagic = 0x4348534D;
+
+	// 配列の先頭をそろえる境界
+	const uint64_t kMeshCacheAlignment = 16;
+
+	// 書き出す構造体のサイズとVertexDataのメンバの位置を混ぜた値(FNV-1a)。どれかのレイアウトが変わるとキャッシュを作り直す
+	constexpr uint32_t MakeDataLayout(std::initializer_list<size_t> values) {
+		uint32_t layout = 2166136261u;
+		for (size_t value : values) {
+			layout = (layout ^ static_cast<uint32_t>(value)) * 16777619u;
+		}
+		return layout;
+	}
+
+	constexpr uint32_t kDataLayout = MakeDataLayout({
+		sizeof(VertexData), offsetof(VertexData, texcoord), offsetof(VertexData, normal),
+		sizeof(SubMesh), sizeof(Meshlet), sizeof(MeshLod) });
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/// *****************************************************
+	/// xxHash64
+	/// *****************************************************
+	const uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t kPrime3 = 0x165667B19E3779F9ull;
+	const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t kPrime5 = 0x27D4EB2F165667C5ull;
+
+	uint64_t Read64(const uint8_t* p) {
+		uint64_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t Read32(const uint8_t* p) {
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint64_t Round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * kPrime2;
+		accumulator = std::rotl(accumulator, 31);
+		return accumulator * kPrime1;
+	}
+
+	uint64_t MergeRound(uint64_t accumulator, uint64_t value) {
+		accumulator ^= Round(0, value);
+		return accumulator * kPrime1 + kPrime4;
+	}
+
+	/// *****************************************************
+	/// マテリアルの書き出しと読み込み
+	/// *****************************************************
+
+	// 値をそのまま末尾に足す
+	template<typename T>
+	void WriteValue(std::vector<char>& buffer, const T& value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	// 長さを付けて文字列を末尾に足す
+	void WriteString(std::vector<char>& buffer, const std::string& value) {
+		WriteValue(buffer, static_cast<uint32_t>(value.size()));
+		buffer.insert(buffer.end(), value.begin(), value.end());
+	}
+
+	// 範囲を確認しながら読む
+	struct Reader {
+		const char* p;
+		const char* end;
+
+		template<typename T>
+		bool ReadValue(T& value) {
+			if (static_cast<size_t>(end - p) < sizeof(T)) {
+				return false;
+			}
+			std::memcpy(&value, p, sizeof(T));
+			p += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(std::string& value) {
+			uint32_t length = 0;
+			if (!ReadValue(length) || static_cast<size_t>(end - p) < length) {
+				return false;
+			}
+			value.assign(p, length);
+			p += length;
+			return true;
+		}
+	};
+
+	// マテリアルとmtlファイル名を1つのバイト列にする
+	std::vector<char> SerializeMaterials(const ModelData& modelData) {
+		std::vector<char> buffer;
+		WriteValue(buffer, static_cast<uint32_t>(modelData.materialLibraries.size()));
+		for (const std::string& library : modelData.materialLibraries) {
+			WriteString(buffer, library);
+		}
+		WriteValue(buffer, static_cast<uint32_t>(modelData.materials.size()));
+		for (const MaterialData& material : modelData.materials) {
+			WriteString(buffer, material.name);
+			WriteValue(buffer, material.color);
+			WriteString(buffer, material.textureFilePath);
+		}
+		return buffer;
+	}
+
+	bool DeserializeMaterials(const char* data, size_t size, ModelData& modelData) {
+		Reader reader{ data, data + size };
+		uint32_t libraryCount = 0;
+		if (!reader.ReadValue(libraryCount)) {
+			return false;
+		}
+		modelData.materialLibraries.resize(libraryCount);
+		for (std::string& library : modelData.materialLibraries) {
+			if (!reader.ReadString(library)) {
+				return false;
+			}
+		}
+		uint32_t materialCount = 0;
+		if (!reader.ReadValue(materialCount)) {
+			return false;
+		}
+		modelData.materials.resize(materialCount);
+		for (MaterialData& material : modelData.materials) {
+			if (!reader.ReadString(material.name) || !reader.ReadValue(material.color) || !reader.ReadString(material.textureFilePath)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// offsetからelementSizeバイトの要素がcount個、ファイルの中に収まっているか
+	// count * elementSizeは壊れたヘッダで溢れることがあるので、掛けずに割って比べる
+	bool IsInFile(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize) {
+		return offset <= fileSize && count <= (fileSize - offset) / elementSize;
+	}
+
+	// start から count 個が size 個の配列に収まっているか。uint32_t同士なので64bitで足せば溢れない
+	bool IsInArray(uint32_t start, uint32_t count, size_t size) {
+		return static_cast<uint64_t>(start) + count <= size;
+	}
+
+	bool IsValidSubMesh(const SubMesh& subMesh, const ModelData& modelData) {
+		return IsInArray(subMesh.indexStart, subMesh.indexCount, modelData.indices.size()) &&
+			subMesh.materialIndex < modelData.materials.size();
+	}
+
+	// 読み込んだ配列同士の参照が範囲内か。描画時に添字として使われるので、壊れたキャッシュはここで弾く
+	bool IsValidModelData(const ModelData& modelData) {
+		for (uint32_t index : modelData.indices) {
+			if (index >= modelData.vertices.size()) {
+				return false;
+			}
+		}
+		for (const SubMesh& subMesh : modelData.subMeshes) {
+			if (!IsValidSubMesh(subMesh, modelData)) {
+				return false;
+			}
+		}
+		for (const Meshlet& meshlet : modelData.meshlets) {
+			if (!IsInArray(meshlet.indexStart, meshlet.indexCount, modelData.indices.size()) ||
+				meshlet.subMeshIndex >= modelData.subMeshes.size()) {
+				return false;
+			}
+		}
+		// 各段はSubMeshと同じ数だけlodSubMeshesを使う
+		for (const MeshLod& lod : modelData.lods) {
+			if (lod.subMeshStart + static_cast<uint64_t>(modelData.subMeshes.size()) > modelData.lodSubMeshes.size()) {
+				return false;
+			}
+		}
+		for (const SubMesh& subMesh : modelData.lodSubMeshes) {
+			if (!IsValidSubMesh(subMesh, modelData)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+uint64_t HashBytes(const void* data, size_t size) {
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	const uint8_t* end = p + size;
+	uint64_t hash;
+
+	// 32バイトずつ4本並列に混ぜる
+	if (size >= 32) {
+		uint64_t v1 = kPrime1 + kPrime2;
+		uint64_t v2 = kPrime2;
+		uint64_t v3 = 0;
+		uint64_t v4 = 0 - kPrime1;
+		do {
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p + 32 <= end);
+
+		hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+		hash = MergeRound(hash, v1);
+		hash = MergeRound(hash, v2);
+		hash = MergeRound(hash, v3);
+		hash = MergeRound(hash, v4);
+	} else {
+		hash = kPrime5;
+	}
+	hash += static_cast<uint64_t>(size);
+
+	// 残りの端数
+	for (; p + 8 <= end; p += 8) {
+		hash ^= Round(0, Read64(p));
+		hash = std::rotl(hash, 27) * kPrime1 + kPrime4;
+	}
+	if (p + 4 <= end) {
+		hash ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+		hash = std::rotl(hash, 23) * kPrime2 + kPrime3;
+		p += 4;
+	}
+	for (; p < end; ++p) {
+		hash ^= (*p) * kPrime5;
+		hash = std::rotl(hash, 11) * kPrime1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+uint64_t HashMaterialLibraries(const std::string& directoryPath, const std::vector<std::string>& materialLibraries) {
+	std::vector<uint64_t> hashes;
+	for (const std::string& library : materialLibraries) {
+		MappedFile file;
+		if (file.Open(directoryPath + "/" + library)) {
+			hashes.push_back(HashBytes(file.GetData(), file.GetSize()));
+			hashes.push_back(file.GetSize());
+		} else {
+			hashes.push_back(0);
+			hashes.push_back(~0ull); // 開けなかったことも記録しておく
+		}
+	}
+	return HashBytes(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+bool LoadMeshCache(const std::string& cachePath, const std::string& directoryPath, uint64_t sourceHash, uint64_t sourceSize, uint32_t processingFlags, ModelData& modelData) {
+
+	// キャッシュをマップして、ヘッダを直接参照する
+	MappedFile file;
+	if (!file.Open(cachePath) || file.GetSize() < sizeof(MeshCacheHeader)) {
+		return false;
+	}
+	MeshCacheHeader header;
+	std::memcpy(&header, file.GetData(), sizeof(header));
+
+	// 形式と元ファイルが一致しているか確認する
+	if (header.magic != kMeshCacheMagic || header.version != kMeshCacheVersion || header.dataLayout != kDataLayout ||
+		header.processingFlags != processingFlags || header.sourceHash != sourceHash || header.sourceSize != sourceSize) {
+		return false;
+	}
+
+	// 配列がファイルの中に収まっているか確認する
+	if (!IsInFile(header.vertexOffset, header.vertexCount, sizeof(VertexData), file.GetSize()) ||
+		!IsInFile(header.indexOffset, header.indexCount, sizeof(uint32_t), file.GetSize()) ||
+		!IsInFile(header.subMeshOffset, header.subMeshCount, sizeof(SubMesh), file.GetSize()) ||
+		!IsInFile(header.meshletOffset, header.meshletCount, sizeof(Meshlet), file.GetSize()) ||
+		!IsInFile(header.lodOffset, header.lodCount, sizeof(MeshLod), file.GetSize()) ||
+		!IsInFile(header.lodSubMeshOffset, header.lodSubMeshCount, sizeof(SubMesh), file.GetSize()) ||
+		!IsInFile(header.materialOffset, header.materialSize, 1, file.GetSize())) {
+		return false;
+	}
+
+	// mtlファイルが書き換わっていないか確認する
+	if (!DeserializeMaterials(file.GetData() + header.materialOffset, static_cast<size_t>(header.materialSize), modelData) ||
+		HashMaterialLibraries(directoryPath, modelData.materialLibraries) != header.materialLibraryHash) {
+		return false;
+	}
+
+	// オフセットから配列の位置を求めて、そのままコピーする
+	const VertexData* vertices = reinterpret_cast<const VertexData*>(file.GetData() + header.vertexOffset);
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(file.GetData() + header.indexOffset);
+	modelData.vertices.assign(vertices, vertices + header.vertexCount);
+	const SubMesh* subMeshes = reinterpret_cast<const SubMesh*>(file.GetData() + header.subMeshOffset);
+	modelData.indices.assign(indices, indices + header.indexCount);
+	modelData.subMeshes.assign(subMeshes, subMeshes + header.subMeshCount);
+	const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(file.GetData() + header.meshletOffset);
+	modelData.meshlets.assign(meshlets, meshlets + header.meshletCount);
+	const MeshLod* lods = reinterpret_cast<const MeshLod*>(file.GetData() + header.lodOffset);
+	modelData.lods.assign(lods, lods + header.lodCount);
+	const SubMesh* lodSubMeshes = reinterpret_cast<const SubMesh*>(file.GetData() + header.lodSubMeshOffset);
+	modelData.lodSubMeshes.assign(lodSubMeshes, lodSubMeshes + header.lodSubMeshCount);
+
+	// 範囲外を指す添字があれば、呼び出し側で元ファイルから作り直してもらう
+	if (!IsValidModelData(modelData)) {
+		modelData = {};
+		return false;
+	}
+	return true;
+}
+
+bool SaveMeshCache(const std::string& cachePath, const std::string& directoryPath, uint64_t sourceHash, uint64_t sourceSize, uint32_t processingFlags, const ModelData& modelData) {
+
+	MeshCacheHeader header{};
+	header.magic = kMeshCacheMagic;
+	header.version = kMeshCacheVersion;
+	header.dataLayout = kDataLayout;
+	header.sourceHash = sourceHash;
+	header.processingFlags = processingFlags;
+	header.sourceSize = sourceSize;
+	header.vertexOffset = AlignUp(sizeof(MeshCacheHeader), kMeshCacheAlignment);
+	header.vertexCount = modelData.vertices.size();
+	header.indexOffset = AlignUp(header.vertexOffset + header.vertexCount * sizeof(VertexData), kMeshCacheAlignment);
+	header.indexCount = modelData.indices.size();
+	header.subMeshOffset = AlignUp(header.indexOffset + header.indexCount * sizeof(uint32_t), kMeshCacheAlignment);
+	header.subMeshCount = modelData.subMeshes.size();
+	header.meshletOffset = AlignUp(header.subMeshOffset + header.subMeshCount * sizeof(SubMesh), kMeshCacheAlignment);
+	header.meshletCount = modelData.meshlets.size();
+	header.lodOffset = AlignUp(header.meshletOffset + header.meshletCount * sizeof(Meshlet), kMeshCacheAlignment);
+	header.lodCount = modelData.lods.size();
+	header.lodSubMeshOffset = AlignUp(header.lodOffset + header.lodCount * sizeof(MeshLod), kMeshCacheAlignment);
+	header.lodSubMeshCount = modelData.lodSubMeshes.size();
+	header.materialOffset = AlignUp(header.lodSubMeshOffset + header.lodSubMeshCount * sizeof(SubMesh), kMeshCacheAlignment);
+	header.materialLibraryHash = HashMaterialLibraries(directoryPath, modelData.materialLibraries);
+	std::vector<char> materialBytes = SerializeMaterials(modelData);
+	header.materialSize = materialBytes.size();
+
+	// 途中で止まっても壊れたキャッシュが残らないように、一時ファイルに書いてから置き換える
+	std::string temporaryPath = cachePath + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			return false;
+		}
+
+		const char padding[kMeshCacheAlignment] = {};
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+		file.write(reinterpret_cast<const char*>(modelData.vertices.data()), static_cast<std::streamsize>(header.vertexCount * sizeof(VertexData)));
+		file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - header.vertexCount * sizeof(VertexData)));
+		file.write(reinterpret_cast<const char*>(modelData.indices.data()), static_cast<std::streamsize>(header.indexCount * sizeof(uint32_t)));
+		file.write(padding, static_cast<std::streamsize>(header.subMeshOffset - header.indexOffset - header.indexCount * sizeof(uint32_t)));
+		file.write(reinterpret_cast<const char*>(modelData.subMeshes.data()), static_cast<std::streamsize>(header.subMeshCount * sizeof(SubMesh)));
+		file.write(padding, static_cast<std::streamsize>(header.meshletOffset - header.subMeshOffset - header.subMeshCount * sizeof(SubMesh)));
+		file.write(reinterpret_cast<const char*>(modelData.meshlets.data()), static_cast<std::streamsize>(header.meshletCount * sizeof(Meshlet)));
+		file.write(padding, static_cast<std::streamsize>(header.lodOffset - header.meshletOffset - header.meshletCount * sizeof(Meshlet)));
+		file.write(reinterpret_cast<const char*>(modelData.lods.data()), static_cast<std::streamsize>(header.lodCount * sizeof(MeshLod)));
+		file.write(padding, static_cast<std::streamsize>(header.lodSubMeshOffset - header.lodOffset - header.lodCount * sizeof(MeshLod)));
+		file.write(reinterpret_cast<const char*>(modelData.lodSubMeshes.data()), static_cast<std::streamsize>(header.lodSubMeshCount * sizeof(SubMesh)));
+		file.write(padding, static_cast<std::streamsize>(header.materialOffset - header.lodSubMeshOffset - header.lodSubMeshCount * sizeof(SubMesh)));
+		file.write(materialBytes.data(), static_cast<std::streamsize>(materialBytes.size()));
+		if (!file) {
+			return false;
+		}
+	}
+
+	std::error_code errorCode;
+	std::filesystem::rename(temporaryPath, cachePath, errorCode);
+	if (errorCode) {
+		std::filesystem::remove(temporaryPath, errorCode);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "ModelData.h"
+
+/// <summary>
+/// メッシュキャッシュのファイル形式のバージョン。書き出す中身を変えたら上げる
+/// </summary>
+const uint32_t kMeshCacheVersion = 9;
+
+/// <summary>
+/// メッシュキャッシュの先頭に置くヘッダ
+/// </summary>
+struct MeshCacheHeader final {
+	uint32_t magic; // 'MSHC'
+	uint32_t version; // kMeshCacheVersion
+	uint32_t dataLayout; // 書き出す構造体(VertexData、SubMesh、Meshlet、MeshLod)のレイアウトから作った値
+	uint32_t processingFlags; // キャッシュの中身を変える読み込み設定。読むときの設定と違えば読まない
+	uint64_t sourceHash; // 元ファイルのハッシュ
+	uint64_t sourceSize; // 元ファイルのサイズ
+	uint64_t materialLibraryHash; // mtllibで参照したファイルのハッシュ
+	uint64_t vertexOffset; // ファイル先頭から頂点配列までのバイト数
+	uint64_t vertexCount;
+	uint64_t indexOffset; // ファイル先頭からIndex配列までのバイト数
+	uint64_t indexCount;
+	uint64_t subMeshOffset; // ファイル先頭からSubMesh配列までのバイト数
+	uint64_t subMeshCount;
+	uint64_t meshletOffset; // ファイル先頭からMeshlet配列までのバイト数
+	uint64_t meshletCount;
+	uint64_t lodOffset; // ファイル先頭からMeshLod配列までのバイト数
+	uint64_t lodCount;
+	uint64_t lodSubMeshOffset; // ファイル先頭からLODのSubMesh配列までのバイト数
+	uint64_t lodSubMeshCount;
+	uint64_t materialOffset; // ファイル先頭からマテリアル(文字列を含む)までのバイト数
+	uint64_t materialSize; // マテリアルのバイト数
+};
+
+/// <summary>
+/// バイト列のハッシュ(xxHash64)
+/// </summary>
+/// <param name="data">先頭アドレス</param>
+/// <param name="size">バイト数</param>
+/// <returns>64bitのハッシュ値</returns>
+uint64_t HashBytes(const void* data, size_t size);
+
+/// <summary>
+/// mtllibで参照したファイルをまとめたハッシュ。開けないファイルも区別する
+/// </summary>
+/// <param name="directoryPath">mtlファイルのあるディレクトリ</param>
+/// <param name="materialLibraries">mtlファイル名</param>
+/// <returns>64bitのハッシュ値</returns>
+uint64_t HashMaterialLibraries(const std::string& directoryPath, const std::vector<std::string>& materialLibraries);
+
+/// <summary>
+/// メッシュキャッシュを読む。元ファイルやmtlファイル、読み込み設定、書き出した構造体のレイアウトが変わっていたら読まない
+/// </summary>
+/// <param name="cachePath">キャッシュのパス</param>
+/// <param name="directoryPath">元ファイルのあるディレクトリ</param>
+/// <param name="sourceHash">元ファイルのハッシュ</param>
+/// <param name="sourceSize">元ファイルのサイズ</param>
+/// <param name="processingFlags">キャッシュの中身を変える読み込み設定</param>
+/// <param name="modelData">読んだ結果の格納先</param>
+/// <returns>キャッシュが有効で読めたらtrue</returns>
+bool LoadMeshCache(const std::string& cachePath, const std::string& directoryPath, uint64_t sourceHash, uint64_t sourceSize, uint32_t processingFlags, ModelData& modelData);
+
+/// <summary>
+/// メッシュキャッシュを書き出す
+/// </summary>
+/// <param name="cachePath">キャッシュのパス</param>
+/// <param name="directoryPath">元ファイルのあるディレクトリ</param>
+/// <param name="sourceHash">元ファイルのハッシュ</param>
+/// <param name="sourceSize">元ファイルのサイズ</param>
+/// <param name="processingFlags">キャッシュの中身を変える読み込み設定</param>
+/// <param name="modelData">書き出すModelData</param>
+/// <returns>書き出せたらtrue</returns>
+bool SaveMeshCache(const std::string& cachePath, const std::string& directoryPath, uint64_t sourceHash, uint64_t sourceSize, uint32_t processingFlags, const ModelData& modelData);
@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// LODの1段分。ModelData::lodSubMeshesの中の、SubMeshと同じ数の範囲を指す
+/// </summary>
+struct MeshLod final {
+	uint32_t subMeshStart; // ModelData::lodSubMeshesの開始位置
+	uint32_t triangleCount; // この段の三角形の数
+	float error; // 元の形からのずれの上限(モデルの座標系での距離)。元のどの頂点も、この段の面からこの距離以内にある。段が進んでも小さくならない
+};
@@ -0,0 +1,281 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+	/// *****************************************************
+	/// Forsythの頂点キャッシュ最適化で使う値
+	/// *****************************************************
+
+	// スコアを付けるのに使うLRUのキャッシュのサイズ
+	const uint32_t kCacheSize = 32;
+
+	// キャッシュの位置によるスコア。直前の三角形の頂点は少し下げて、同じ頂点ばかり回るのを防ぐ
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriangleScore = 0.75f;
+
+	// 残りの三角形が少ない頂点を優先して、取り残される頂点を減らす
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+
+	// スコアを引く表の大きさ。これより多くの三角形から使われる頂点は同じスコアにする
+	const uint32_t kMaxValence = 64;
+
+	// スコアの表
+	struct VertexScoreTable {
+		float cache[kCacheSize + 3];
+		float valence[kMaxValence];
+
+		VertexScoreTable() {
+			for (uint32_t i = 0; i < kCacheSize + 3; ++i) {
+				if (i < 3) {
+					cache[i] = kLastTriangleScore;
+				} else if (i < kCacheSize) {
+					float scaler = 1.0f - static_cast<float>(i - 3) / static_cast<float>(kCacheSize - 3);
+					cache[i] = std::pow(scaler, kCacheDecayPower);
+				} else {
+					cache[i] = 0.0f; // 追い出される直前
+				}
+			}
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i < kMaxValence; ++i) {
+				valence[i] = kValenceBoostScale * std::pow(static_cast<float>(i), -kValenceBoostPower);
+			}
+		}
+	};
+
+	// 頂点の数だけ要る作業用の配列。SubMeshごとに確保し直さず、使った頂点だけを元に戻して使い回す
+	// 呼び出しの間は、どの頂点もremainingTriangles、fillCountsが0、cachePositionsが-1になっている
+	struct VertexCacheWorkspace {
+		std::vector<uint32_t> remainingTriangles;
+		std::vector<uint32_t> adjacencyOffsets;
+		std::vector<uint32_t> fillCounts;
+		std::vector<int32_t> cachePositions;
+		std::vector<float> vertexScores;
+		std::vector<uint32_t> touchedVertices; // 今の呼び出しで使われた頂点
+
+		explicit VertexCacheWorkspace(size_t vertexCount)
+			: remainingTriangles(vertexCount, 0), adjacencyOffsets(vertexCount, 0), fillCounts(vertexCount, 0),
+			cachePositions(vertexCount, -1), vertexScores(vertexCount, 0.0f) {
+		}
+	};
+
+	// 頂点のスコア。cachePositionが負ならキャッシュに無い
+	float VertexScore(const VertexScoreTable& table, int32_t cachePosition, uint32_t remainingTriangles) {
+		if (remainingTriangles == 0) {
+			return -1.0f; // もう使われない
+		}
+		float score = cachePosition >= 0 ? table.cache[cachePosition] : 0.0f;
+		return score + table.valence[std::min(remainingTriangles, kMaxValence - 1)];
+	}
+}
+
+/// *****************************************************
+/// 頂点キャッシュの効率を計る
+/// *****************************************************
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStatistics statistics{};
+
+	// 頂点ごとに、キャッシュに入った時の番号を覚えておく。今の番号との差がサイズ未満ならまだ残っている
+	std::vector<size_t> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> isUsed(vertexCount, false);
+	size_t timestamp = cacheSize + 1;
+	size_t usedVertexCount = 0;
+	for (size_t i = 0; i < indexCount; ++i) {
+		uint32_t vertex = indices[i];
+		if (timestamp - cacheTimestamps[vertex] > cacheSize) {
+			cacheTimestamps[vertex] = timestamp++;
+			++statistics.vertexTransformCount;
+		}
+		if (!isUsed[vertex]) {
+			isUsed[vertex] = true;
+			++usedVertexCount;
+		}
+	}
+
+	size_t triangleCount = indexCount / 3;
+	statistics.acmr = triangleCount > 0 ? static_cast<float>(statistics.vertexTransformCount) / static_cast<float>(triangleCount) : 0.0f;
+	statistics.atvr = usedVertexCount > 0 ? static_cast<float>(statistics.vertexTransformCount) / static_cast<float>(usedVertexCount) : 0.0f;
+	return statistics;
+}
+
+/// *****************************************************
+/// 三角形の並べ替え(Forsyth, "Linear-Speed Vertex Cache Optimisation")
+/// *****************************************************
+static void OptimizeVertexCache(uint32_t* indices, size_t indexCount, VertexCacheWorkspace& workspace) {
+	static const VertexScoreTable kScoreTable;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+	std::vector<uint32_t>& remainingTriangles = workspace.remainingTriangles;
+	std::vector<uint32_t>& adjacencyOffsets = workspace.adjacencyOffsets;
+	std::vector<uint32_t>& fillCounts = workspace.fillCounts;
+	std::vector<int32_t>& cachePositions = workspace.cachePositions;
+	std::vector<float>& vertexScores = workspace.vertexScores;
+	std::vector<uint32_t>& touchedVertices = workspace.touchedVertices;
+
+	// 頂点ごとに使っている三角形の一覧を作る。使われた頂点だけを見る
+	touchedVertices.clear();
+	for (size_t i = 0; i < triangleCount * 3; ++i) {
+		if (remainingTriangles[indices[i]]++ == 0) {
+			touchedVertices.push_back(indices[i]);
+		}
+	}
+	uint32_t adjacencyCount = 0;
+	for (uint32_t vertex : touchedVertices) {
+		adjacencyOffsets[vertex] = adjacencyCount;
+		adjacencyCount += remainingTriangles[vertex];
+	}
+	std::vector<uint32_t> adjacency(adjacencyCount);
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = indices[triangle * 3 + corner];
+			adjacency[adjacencyOffsets[vertex] + fillCounts[vertex]++] = static_cast<uint32_t>(triangle);
+		}
+	}
+
+	// 初期のスコア
+	for (uint32_t vertex : touchedVertices) {
+		vertexScores[vertex] = VertexScore(kScoreTable, -1, remainingTriangles[vertex]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> isEmitted(triangleCount, false);
+	for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+		triangleScores[triangle] =
+			vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+	}
+
+	// 並べ替えた結果は元の配列を読み終わるまで別に置く
+	std::vector<uint32_t> output(triangleCount * 3);
+
+	// LRUのキャッシュ。新しく使った頂点が先頭。追い出される分を含めて+3
+	uint32_t cache[kCacheSize + 3];
+	uint32_t cacheCount = 0;
+
+	size_t nextCandidate = 0; // キャッシュから選べない時に、前から探す位置
+	size_t bestTriangle = 0;
+	float bestScore = triangleScores[0];
+	for (size_t triangle = 1; triangle < triangleCount; ++triangle) {
+		if (triangleScores[triangle] > bestScore) {
+			bestScore = triangleScores[triangle];
+			bestTriangle = triangle;
+		}
+	}
+
+	for (size_t emitted = 0; emitted < triangleCount; ++emitted) {
+
+		// キャッシュに関係する三角形が無ければ、残っている最初の三角形から続ける
+		if (bestScore < 0.0f) {
+			while (isEmitted[nextCandidate]) {
+				++nextCandidate;
+			}
+			bestTriangle = nextCandidate;
+		}
+
+		// 三角形を出力して、頂点の一覧から外す
+		const uint32_t* triangleIndices = indices + bestTriangle * 3;
+		std::copy(triangleIndices, triangleIndices + 3, output.begin() + emitted * 3);
+		isEmitted[bestTriangle] = true;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t vertex = triangleIndices[corner];
+			uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+			uint32_t* end = begin + remainingTriangles[vertex];
+			uint32_t* it = std::find(begin, end, static_cast<uint32_t>(bestTriangle));
+			*it = *(end - 1);
+			--remainingTriangles[vertex];
+		}
+
+		// 三角形の頂点をキャッシュの先頭に入れて、残りを後ろにずらす
+		uint32_t newCache[kCacheSize + 3];
+		uint32_t newCacheCount = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			newCache[newCacheCount++] = triangleIndices[corner];
+		}
+		for (uint32_t i = 0; i < cacheCount; ++i) {
+			uint32_t vertex = cache[i];
+			if (vertex != triangleIndices[0] && vertex != triangleIndices[1] && vertex != triangleIndices[2]) {
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		// キャッシュの頂点のスコアを更新する。あふれた頂点はキャッシュから外す
+		for (uint32_t i = 0; i < newCacheCount; ++i) {
+			uint32_t vertex = newCache[i];
+			cachePositions[vertex] = i < kCacheSize ? static_cast<int32_t>(i) : -1;
+			vertexScores[vertex] = VertexScore(kScoreTable, cachePositions[vertex], remainingTriangles[vertex]);
+		}
+
+		// キャッシュの頂点を使う三角形のスコアを更新して、次に出す三角形を選ぶ
+		bestScore = -1.0f;
+		for (uint32_t i = 0; i < newCacheCount; ++i) {
+			uint32_t vertex = newCache[i];
+			const uint32_t* begin = adjacency.data() + adjacencyOffsets[vertex];
+			const uint32_t* end = begin + remainingTriangles[vertex];
+			for (const uint32_t* it = begin; it != end; ++it) {
+				uint32_t triangle = *it;
+				const uint32_t* corners = indices + size_t(triangle) * 3;
+				float score = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+				triangleScores[triangle] = score;
+				// 同じスコアなら元の順番が早い方にして、結果を一意にする
+				if (score > bestScore || (score == bestScore && triangle < bestTriangle)) {
+					bestScore = score;
+					bestTriangle = triangle;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, kCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+
+	// 次の呼び出しのために、使った頂点だけを元に戻す。remainingTrianglesは全部出したので0になっている
+	for (uint32_t vertex : touchedVertices) {
+		fillCounts[vertex] = 0;
+		cachePositions[vertex] = -1;
+	}
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount) {
+	VertexCacheWorkspace workspace(vertexCount);
+	OptimizeVertexCache(indices, indexCount, workspace);
+}
+
+/// *****************************************************
+/// 頂点の並べ替え
+/// *****************************************************
+void OptimizeVertexFetch(ModelData& modelData) {
+	const uint32_t kUnused = UINT32_MAX;
+	std::vector<uint32_t> remap(modelData.vertices.size(), kUnused);
+	std::vector<VertexData> vertices;
+	vertices.reserve(modelData.vertices.size());
+
+	// Indexで最初に出てきた順に新しい番号を振る
+	for (uint32_t& index : modelData.indices) {
+		if (remap[index] == kUnused) {
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(modelData.vertices[index]);
+		}
+		index = remap[index];
+	}
+	modelData.vertices = std::move(vertices);
+}
+
+/// *****************************************************
+/// メッシュの最適化
+/// *****************************************************
+void OptimizeMesh(ModelData& modelData) {
+	// SubMeshをまたいで並べ替えるとマテリアルが変わるので、範囲ごとに行う
+	// 頂点の数だけの配列は一度だけ確保して、SubMeshごとには使った頂点だけを戻す
+	VertexCacheWorkspace workspace(modelData.vertices.size());
+	for (const SubMesh& subMesh : modelData.subMeshes) {
+		OptimizeVertexCache(modelData.indices.data() + subMesh.indexStart, subMesh.indexCount, workspace);
+	}
+	OptimizeVertexFetch(modelData);
+}
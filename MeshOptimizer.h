@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ModelData.h"
+
+/// <summary>
+/// 頂点キャッシュの効率。FIFOのキャッシュを真似て数える
+/// </summary>
+struct VertexCacheStatistics final {
+	size_t vertexTransformCount; // キャッシュに無く、VertexShaderが走る回数
+	float acmr; // 三角形あたりのVertexShaderの回数(Average Cache Miss Ratio)。0.5に近いほど良い
+	float atvr; // 使われる頂点あたりのVertexShaderの回数(Average Transform to Vertex Ratio)。1.0に近いほど良い
+};
+
+/// <summary>
+/// 計測に使うFIFOのキャッシュのサイズ
+/// </summary>
+const uint32_t kVertexCacheMeasureSize = 16;
+
+/// <summary>
+/// Indexの並びで頂点キャッシュの効率を計る
+/// </summary>
+/// <param name="indices">三角形リストのIndex</param>
+/// <param name="indexCount">Indexの数</param>
+/// <param name="vertexCount">頂点の数</param>
+/// <param name="cacheSize">FIFOのキャッシュのサイズ</param>
+/// <returns>計った結果</returns>
+VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = kVertexCacheMeasureSize);
+
+/// <summary>
+/// 頂点キャッシュに乗りやすいように三角形を並べ替える(Forsythの方法)。三角形内の頂点の順番は変えない
+/// </summary>
+/// <param name="indices">並べ替えるIndex。その場で書き換える</param>
+/// <param name="indexCount">Indexの数</param>
+/// <param name="vertexCount">頂点の数</param>
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+/// <summary>
+/// 頂点をIndexで最初に使われる順に並べ替えて、読み込みを連続させる。使われない頂点は捨てる
+/// </summary>
+/// <param name="modelData">verticesとindicesを書き換える</param>
+void OptimizeVertexFetch(ModelData& modelData);
+
+/// <summary>
+/// SubMeshごとに三角形を並べ替えてから頂点を並べ替える
+/// </summary>
+/// <param name="modelData">verticesとindicesを書き換える。SubMeshの範囲は変わらない</param>
+void OptimizeMesh(ModelData& modelData);
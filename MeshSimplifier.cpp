@@ -0,0 +1,468 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "VectorMath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+	// 段の三角形の数が前の段のこの割合より多ければ、もう減らせないので段を作るのをやめる
+	const float kMinLodReduction = 0.85f;
+
+	// 1回の走査で縮約する候補の割合。安い方から順に使い、高い候補は次の走査で見直す
+	const float kPassCollapseRatio = 1.0f / 3.0f;
+
+	// 開いた縁の形を保つための二次誤差の重み
+	const double kBorderWeight = 10.0;
+
+	/// *****************************************************
+	/// 二次誤差(対称な4x4行列の上三角と、足した重みの合計)
+	/// *****************************************************
+	struct Quadric {
+		double a00, a01, a02, a03;
+		double a11, a12, a13;
+		double a22, a23;
+		double a33;
+		double weight;
+	};
+
+	// 平面ax+by+cz+d=0までの距離の2乗に重みを掛けたもの
+	Quadric MakePlaneQuadric(double a, double b, double c, double d, double weight) {
+		return {
+			a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+			b * b * weight, b * c * weight, b * d * weight,
+			c * c * weight, c * d * weight,
+			d * d * weight,
+			weight };
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& r) {
+		q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+		q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+		q.a22 += r.a22; q.a23 += r.a23;
+		q.a33 += r.a33;
+		q.weight += r.weight;
+	}
+
+	// 平面までの距離の2乗の、重み付きの平均
+	double EvaluateQuadric(const Quadric& q, const Vector3& p) {
+		if (q.weight == 0.0) {
+			return 0.0;
+		}
+		double x = p.x, y = p.y, z = p.z;
+		double sum = q.a00 * x * x + 2.0 * q.a01 * x * y + 2.0 * q.a02 * x * z + 2.0 * q.a03 * x +
+			q.a11 * y * y + 2.0 * q.a12 * y * z + 2.0 * q.a13 * y +
+			q.a22 * z * z + 2.0 * q.a23 * z +
+			q.a33;
+		return std::max(sum / q.weight, 0.0);
+	}
+
+	/// *****************************************************
+	/// 頂点から三角形を引く表
+	/// *****************************************************
+	struct Adjacency {
+		std::vector<uint32_t> offsets; // 頂点ごとの開始位置。頂点の数+1個
+		std::vector<uint32_t> triangles; // 頂点を使う三角形の番号
+	};
+
+	void BuildAdjacency(const std::vector<uint32_t>& triangles, size_t vertexCount, Adjacency& adjacency) {
+		adjacency.offsets.assign(vertexCount + 1, 0);
+		for (uint32_t index : triangles) {
+			++adjacency.offsets[index + 1];
+		}
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			adjacency.offsets[vertex + 1] += adjacency.offsets[vertex];
+		}
+		adjacency.triangles.resize(triangles.size());
+		std::vector<uint32_t> fillCounts(vertexCount, 0);
+		for (size_t i = 0; i < triangles.size(); ++i) {
+			uint32_t vertex = triangles[i];
+			adjacency.triangles[adjacency.offsets[vertex] + fillCounts[vertex]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	// 三角形の角ごとに、その角から次の角への辺を使う三角形の数を数える。1なら開いた縁、3以上なら面が枝分かれしている
+	std::vector<uint32_t> CountEdgeTriangles(const std::vector<uint32_t>& triangles, const Adjacency& adjacency) {
+		std::vector<uint32_t> edgeCounts(triangles.size(), 0);
+		for (size_t i = 0; i < triangles.size(); ++i) {
+			uint32_t a = triangles[i];
+			uint32_t b = triangles[i - i % 3 + (i + 1) % 3];
+			for (uint32_t j = adjacency.offsets[a]; j < adjacency.offsets[a + 1]; ++j) {
+				const uint32_t* corners = triangles.data() + size_t(adjacency.triangles[j]) * 3;
+				edgeCounts[i] += corners[0] == b || corners[1] == b || corners[2] == b;
+			}
+		}
+		return edgeCounts;
+	}
+
+	// 頂点の動かし方
+	enum class VertexKind {
+		Manifold, // 面の内側。どの隣にも寄せられる
+		Border, // 開いた縁。縁に沿った隣にだけ寄せる
+		Locked, // 継ぎ目やSubMeshの境目。動かさない
+	};
+
+	// 頂点fromを頂点toに寄せる縮約
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	/// *****************************************************
+	/// 縮約の途中の状態
+	/// *****************************************************
+	struct SimplifyState {
+		std::vector<Vector3> positions;
+		std::vector<bool> isLocked; // 継ぎ目やSubMeshの境目の頂点
+		std::vector<Quadric> quadrics;
+		std::vector<uint32_t> triangles; // 3つで1つの三角形。SubMeshの順に並んでいる
+		std::vector<uint32_t> triangleSubMeshes; // 三角形ごとのSubMeshの番号
+		std::vector<uint32_t> collapsedTo; // 縮約で寄せた先の頂点。寄せていなければ自分
+	};
+
+	// 元の頂点が今どの頂点に寄せられているかを、寄せた先を辿って求める。辿った道は縮めておく
+	uint32_t FindRepresentative(std::vector<uint32_t>& collapsedTo, uint32_t vertex) {
+		uint32_t root = vertex;
+		while (collapsedTo[root] != root) {
+			root = collapsedTo[root];
+		}
+		while (collapsedTo[vertex] != root) {
+			uint32_t next = collapsedTo[vertex];
+			collapsedTo[vertex] = root;
+			vertex = next;
+		}
+		return root;
+	}
+
+	// 元の頂点と、寄せた先の頂点との距離の最大。寄せた先はLODの面の上にあるので、元の頂点からLODの面までの距離はこれを越えない
+	// LODの頂点は元の頂点を動かさずに使っているので、逆向きの頂点の距離は0になる
+	double MeasureMaxDisplacement(SimplifyState& state, const std::vector<bool>& isUsed) {
+		double maxDistanceSquared = 0.0;
+		for (uint32_t vertex = 0; vertex < state.positions.size(); ++vertex) {
+			if (!isUsed[vertex]) {
+				continue;
+			}
+			const Vector3& p = state.positions[vertex];
+			const Vector3& q = state.positions[FindRepresentative(state.collapsedTo, vertex)];
+			double dx = double(p.x) - q.x, dy = double(p.y) - q.y, dz = double(p.z) - q.z;
+			maxDistanceSquared = std::max(maxDistanceSquared, dx * dx + dy * dy + dz * dz);
+		}
+		return std::sqrt(maxDistanceSquared);
+	}
+
+	// 縮約を1回走査する。減った三角形の数を返す
+	size_t SimplifyPass(SimplifyState& state, size_t targetTriangleCount) {
+		size_t vertexCount = state.positions.size();
+		size_t triangleCount = state.triangles.size() / 3;
+
+		Adjacency adjacency;
+		BuildAdjacency(state.triangles, vertexCount, adjacency);
+		std::vector<uint32_t> edgeCounts = CountEdgeTriangles(state.triangles, adjacency);
+
+		// 頂点の動かし方を決める。縁が2本でない縁の頂点や、枝分かれした辺の頂点は動かさない
+		std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+		std::vector<uint32_t> borderEdgeCounts(vertexCount, 0);
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t a = state.triangles[triangle * 3 + corner];
+				uint32_t b = state.triangles[triangle * 3 + (corner + 1) % 3];
+				uint32_t count = edgeCounts[triangle * 3 + corner];
+				if (count == 1) {
+					++borderEdgeCounts[a];
+					++borderEdgeCounts[b];
+				} else if (count > 2) {
+					kinds[a] = VertexKind::Locked;
+					kinds[b] = VertexKind::Locked;
+				}
+			}
+		}
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+			if (state.isLocked[vertex] || (borderEdgeCounts[vertex] != 0 && borderEdgeCounts[vertex] != 2)) {
+				kinds[vertex] = VertexKind::Locked;
+			} else if (kinds[vertex] != VertexKind::Locked && borderEdgeCounts[vertex] == 2) {
+				kinds[vertex] = VertexKind::Border;
+			}
+		}
+
+		// 頂点ごとに一番安い縮約を選ぶ
+		std::vector<Collapse> bestCollapses(vertexCount, { 0, 0, -1.0 });
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			for (size_t corner = 0; corner < 3; ++corner) {
+				uint32_t a = state.triangles[triangle * 3 + corner];
+				uint32_t b = state.triangles[triangle * 3 + (corner + 1) % 3];
+				bool isBorderEdge = edgeCounts[triangle * 3 + corner] == 1;
+				for (int32_t direction = 0; direction < 2; ++direction) {
+					uint32_t from = direction == 0 ? a : b;
+					uint32_t to = direction == 0 ? b : a;
+					if (kinds[from] == VertexKind::Locked || (kinds[from] == VertexKind::Border && !isBorderEdge)) {
+						continue;
+					}
+					Quadric quadric = state.quadrics[from];
+					AddQuadric(quadric, state.quadrics[to]);
+					double cost = EvaluateQuadric(quadric, state.positions[to]);
+					Collapse& best = bestCollapses[from];
+					if (best.cost < 0.0 || cost < best.cost || (cost == best.cost && to < best.to)) {
+						best = { from, to, cost };
+					}
+				}
+			}
+		}
+		std::vector<Collapse> collapses;
+		for (const Collapse& collapse : bestCollapses) {
+			if (collapse.cost >= 0.0) {
+				collapses.push_back(collapse);
+			}
+		}
+		if (collapses.empty()) {
+			return 0;
+		}
+
+		// 安い順に並べる。同じ値なら番号順にして結果を一意にする
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			return a.cost < b.cost || (a.cost == b.cost && a.from < b.from);
+		});
+		collapses.resize(std::max<size_t>(1, static_cast<size_t>(static_cast<float>(collapses.size()) * kPassCollapseRatio)));
+
+		// 縮約する。周りの三角形が変わった頂点は、表が古くなるのでこの走査では触らない
+		std::vector<bool> isTouched(vertexCount, false);
+		std::vector<bool> isRemoved(triangleCount, false);
+		size_t removedCount = 0;
+		for (const Collapse& collapse : collapses) {
+			if (triangleCount - removedCount <= targetTriangleCount) {
+				break;
+			}
+			if (isTouched[collapse.from] || isTouched[collapse.to]) {
+				continue;
+			}
+
+			// 寄せた後に裏返ったり潰れたりする三角形があれば諦める
+			const uint32_t* begin = adjacency.triangles.data() + adjacency.offsets[collapse.from];
+			const uint32_t* end = adjacency.triangles.data() + adjacency.offsets[collapse.from + 1];
+			bool isValid = true;
+			size_t removedByCollapse = 0;
+			for (const uint32_t* it = begin; it != end && isValid; ++it) {
+				const uint32_t* corners = state.triangles.data() + size_t(*it) * 3;
+				if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to) {
+					++removedByCollapse;
+					continue; // この三角形は消える
+				}
+				Vector3 before[3];
+				Vector3 after[3];
+				for (size_t corner = 0; corner < 3; ++corner) {
+					before[corner] = state.positions[corners[corner]];
+					after[corner] = corners[corner] == collapse.from ? state.positions[collapse.to] : before[corner];
+				}
+				Vector3 normalBefore = Cross(before[1] - before[0], before[2] - before[0]);
+				Vector3 normalAfter = Cross(after[1] - after[0], after[2] - after[0]);
+				float dot = Dot(normalBefore, normalAfter);
+				isValid = dot > 0.0f && dot * dot > 1e-6f * Dot(normalBefore, normalBefore) * Dot(normalAfter, normalAfter);
+			}
+			// 孤立した三角形を丸ごと消すような縮約はしない
+			if (!isValid || removedByCollapse == static_cast<size_t>(end - begin)) {
+				continue;
+			}
+
+			for (const uint32_t* it = begin; it != end; ++it) {
+				uint32_t* corners = state.triangles.data() + size_t(*it) * 3;
+				for (size_t corner = 0; corner < 3; ++corner) {
+					isTouched[corners[corner]] = true;
+					if (corners[corner] == collapse.from) {
+						corners[corner] = collapse.to;
+					}
+				}
+				if (corners[0] == corners[1] || corners[1] == corners[2] || corners[2] == corners[0]) {
+					isRemoved[*it] = true;
+					++removedCount;
+				}
+			}
+			AddQuadric(state.quadrics[collapse.to], state.quadrics[collapse.from]);
+			state.collapsedTo[collapse.from] = collapse.to;
+		}
+
+		// 消えた三角形を詰める。順番は変えないのでSubMeshの順のまま
+		size_t writeTriangle = 0;
+		for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+			if (isRemoved[triangle]) {
+				continue;
+			}
+			std::copy_n(state.triangles.begin() + triangle * 3, 3, state.triangles.begin() + writeTriangle * 3);
+			state.triangleSubMeshes[writeTriangle] = state.triangleSubMeshes[triangle];
+			++writeTriangle;
+		}
+		state.triangles.resize(writeTriangle * 3);
+		state.triangleSubMeshes.resize(writeTriangle);
+		return removedCount;
+	}
+}
+
+/// *****************************************************
+/// LODを作る
+/// *****************************************************
+void BuildLods(ModelData& modelData) {
+	modelData.lods.clear();
+	modelData.lodSubMeshes = modelData.subMeshes;
+
+	// 元のメッシュが0段目
+	SimplifyState state;
+	for (uint32_t subMeshIndex = 0; subMeshIndex < modelData.subMeshes.size(); ++subMeshIndex) {
+		const SubMesh& subMesh = modelData.subMeshes[subMeshIndex];
+		state.triangles.insert(state.triangles.end(),
+			modelData.indices.begin() + subMesh.indexStart, modelData.indices.begin() + subMesh.indexStart + subMesh.indexCount);
+		state.triangleSubMeshes.insert(state.triangleSubMeshes.end(), subMesh.indexCount / 3, subMeshIndex);
+	}
+	modelData.lods.push_back({ 0, static_cast<uint32_t>(state.triangles.size() / 3), 0.0f });
+	if (state.triangles.empty()) {
+		return;
+	}
+
+	size_t vertexCount = modelData.vertices.size();
+	state.positions.resize(vertexCount);
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+		const Vector4& position = modelData.vertices[vertex].position;
+		state.positions[vertex] = { position.x, position.y, position.z };
+	}
+	state.collapsedTo.resize(vertexCount);
+	for (uint32_t vertex = 0; vertex < vertexCount; ++vertex) {
+		state.collapsedTo[vertex] = vertex;
+	}
+	std::vector<bool> isUsed(vertexCount, false);
+	for (uint32_t index : state.triangles) {
+		isUsed[index] = true;
+	}
+
+	// 同じ位置に複数の頂点(UVや法線の違い)がある継ぎ目と、複数のSubMeshで使う頂点は動かさない
+	state.isLocked.assign(vertexCount, false);
+	{
+		struct PositionKey {
+			float x, y, z;
+			bool operator==(const PositionKey&) const = default;
+		};
+		struct PositionKeyHash {
+			size_t operator()(const PositionKey& key) const {
+				return std::hash<float>()(key.x) ^ (std::hash<float>()(key.y) * 0x9E3779B9u) ^ (std::hash<float>()(key.z) * 0x85EBCA6Bu);
+			}
+		};
+		std::unordered_map<PositionKey, uint32_t, PositionKeyHash> firstVertices;
+		std::vector<uint32_t> vertexSubMeshes(vertexCount, UINT32_MAX);
+		for (size_t i = 0; i < state.triangles.size(); ++i) {
+			uint32_t vertex = state.triangles[i];
+			uint32_t subMeshIndex = state.triangleSubMeshes[i / 3];
+			if (vertexSubMeshes[vertex] != UINT32_MAX && vertexSubMeshes[vertex] != subMeshIndex) {
+				state.isLocked[vertex] = true;
+			}
+			vertexSubMeshes[vertex] = subMeshIndex;
+
+			const Vector3& position = state.positions[vertex];
+			auto [it, isInserted] = firstVertices.try_emplace(PositionKey{ position.x, position.y, position.z }, vertex);
+			if (!isInserted && it->second != vertex) {
+				state.isLocked[vertex] = true;
+				state.isLocked[it->second] = true;
+			}
+		}
+	}
+
+	// 三角形の平面の二次誤差を、面積を重みにして頂点に足す。開いた縁には縁を含む垂直な平面も足す
+	state.quadrics.assign(vertexCount, Quadric{});
+	{
+		Adjacency adjacency;
+		BuildAdjacency(state.triangles, vertexCount, adjacency);
+		std::vector<uint32_t> edgeCounts = CountEdgeTriangles(state.triangles, adjacency);
+		for (size_t triangle = 0; triangle < state.triangles.size() / 3; ++triangle) {
+			const uint32_t* corners = state.triangles.data() + triangle * 3;
+			const Vector3& p0 = state.positions[corners[0]];
+			Vector3 normal = Cross(state.positions[corners[1]] - p0, state.positions[corners[2]] - p0);
+			double length = std::sqrt(static_cast<double>(Dot(normal, normal)));
+			if (length == 0.0) {
+				continue;
+			}
+			double a = normal.x / length, b = normal.y / length, c = normal.z / length;
+			Quadric plane = MakePlaneQuadric(a, b, c, -(a * p0.x + b * p0.y + c * p0.z), length * 0.5);
+			for (size_t corner = 0; corner < 3; ++corner) {
+				AddQuadric(state.quadrics[corners[corner]], plane);
+
+				uint32_t edgeBegin = corners[corner];
+				uint32_t edgeEnd = corners[(corner + 1) % 3];
+				if (edgeCounts[triangle * 3 + corner] != 1) {
+					continue;
+				}
+				Vector3 edge = state.positions[edgeEnd] - state.positions[edgeBegin];
+				Vector3 borderNormal = Cross(edge, normal);
+				double borderLength = std::sqrt(static_cast<double>(Dot(borderNormal, borderNormal)));
+				if (borderLength == 0.0) {
+					continue;
+				}
+				const Vector3& q = state.positions[edgeBegin];
+				double ba = borderNormal.x / borderLength, bb = borderNormal.y / borderLength, bc = borderNormal.z / borderLength;
+				Quadric border = MakePlaneQuadric(ba, bb, bc, -(ba * q.x + bb * q.y + bc * q.z), Dot(edge, edge) * kBorderWeight);
+				AddQuadric(state.quadrics[edgeBegin], border);
+				AddQuadric(state.quadrics[edgeEnd], border);
+			}
+		}
+	}
+
+	// 前の段から続けて減らしていき、目標に届いたら段として書き出す
+	size_t previousTriangleCount = state.triangles.size() / 3;
+	double previousError = 0.0;
+	for (uint32_t level = 1; level < kMaxLodCount; ++level) {
+		size_t targetTriangleCount = static_cast<size_t>(static_cast<float>(previousTriangleCount) * kLodTriangleRatio);
+		while (state.triangles.size() / 3 > targetTriangleCount) {
+			if (SimplifyPass(state, targetTriangleCount) == 0) {
+				break;
+			}
+		}
+		size_t triangleCount = state.triangles.size() / 3;
+		if (static_cast<float>(triangleCount) > static_cast<float>(previousTriangleCount) * kMinLodReduction) {
+			break;
+		}
+
+		// 誤差は元の頂点が動いた距離の最大。段が進んでも小さくならないように、前の段の値と比べて大きい方にする
+		// floatに丸めて小さくならないよう、1ULPだけ切り上げる
+		double error = std::max(previousError, MeasureMaxDisplacement(state, isUsed));
+		float errorBound = static_cast<float>(error);
+		if (static_cast<double>(errorBound) < error) {
+			errorBound = std::nextafter(errorBound, FLT_MAX);
+		}
+		previousError = error;
+
+		// SubMeshごとに頂点キャッシュの順に並べ替えて、Indexの後ろに足す
+		MeshLod lod{ static_cast<uint32_t>(modelData.lodSubMeshes.size()), static_cast<uint32_t>(triangleCount), errorBound };
+		size_t triangle = 0;
+		for (uint32_t subMeshIndex = 0; subMeshIndex < modelData.subMeshes.size(); ++subMeshIndex) {
+			size_t begin = triangle;
+			while (triangle < triangleCount && state.triangleSubMeshes[triangle] == subMeshIndex) {
+				++triangle;
+			}
+			SubMesh subMesh{ static_cast<uint32_t>(modelData.indices.size()), static_cast<uint32_t>((triangle - begin) * 3), modelData.subMeshes[subMeshIndex].materialIndex };
+			modelData.indices.insert(modelData.indices.end(), state.triangles.begin() + begin * 3, state.triangles.begin() + triangle * 3);
+			OptimizeVertexCache(modelData.indices.data() + subMesh.indexStart, subMesh.indexCount, vertexCount);
+			modelData.lodSubMeshes.push_back(subMesh);
+		}
+		modelData.lods.push_back(lod);
+		previousTriangleCount = triangleCount;
+	}
+}
+
+/// *****************************************************
+/// LODを選ぶ
+/// *****************************************************
+float ComputeScreenError(float error, float distance, float fovY, float screenHeight) {
+	// 距離distanceでの画面の高さの半分はdistance*tan(fovY/2)
+	float halfHeight = std::max(distance, 1e-6f) * std::tan(fovY * 0.5f);
+	return error / halfHeight * (screenHeight * 0.5f);
+}
+
+uint32_t SelectLod(const std::vector<MeshLod>& lods, float worldScale, float distance, float fovY, float screenHeight, float maxScreenError) {
+	// 誤差は段が進むほど大きくなるので、許容範囲に収まる一番後ろの段を選ぶ
+	uint32_t selected = 0;
+	for (uint32_t level = 1; level < lods.size(); ++level) {
+		if (ComputeScreenError(lods[level].error * worldScale, distance, fovY, screenHeight) > maxScreenError) {
+			break;
+		}
+		selected = level;
+	}
+	return selected;
+}
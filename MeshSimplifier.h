@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ModelData.h"
+
+/// <summary>
+/// 作るLODの段数の最大(元のメッシュを含む)
+/// </summary>
+const uint32_t kMaxLodCount = 5;
+
+/// <summary>
+/// 段ごとに三角形の数をこの割合まで減らす
+/// </summary>
+const float kLodTriangleRatio = 0.5f;
+
+/// <summary>
+/// 三角形の数を減らす(二次誤差による辺の縮約)。頂点は既存の頂点に寄せるだけで、新しく作らない
+/// UV/法線の継ぎ目の頂点、SubMeshの境目の頂点は動かさない。開いた縁の頂点は縁に沿ってのみ動かす
+/// </summary>
+/// <param name="modelData">元のメッシュ(subMeshesの範囲)を読み、indicesの後ろにLODのIndexを足して、lodsとlodSubMeshesを書く</param>
+void BuildLods(ModelData& modelData);
+
+/// <summary>
+/// 物体の座標系での誤差を、画面上のピクセル数にする
+/// </summary>
+/// <param name="error">モデルの座標系でのずれにワールドの拡大率を掛けたもの</param>
+/// <param name="distance">カメラから物体までの距離</param>
+/// <param name="fovY">MakePerspectiveFovMatrixに渡した縦の画角</param>
+/// <param name="screenHeight">画面の高さ(ピクセル)</param>
+/// <returns>画面上の誤差(ピクセル)</returns>
+float ComputeScreenError(float error, float distance, float fovY, float screenHeight);
+
+/// <summary>
+/// 画面上の誤差が許容範囲に収まる中で、一番粗いLODを選ぶ
+/// </summary>
+/// <param name="lods">ModelData::lods</param>
+/// <param name="worldScale">ワールド行列の拡大率(一番大きい軸)</param>
+/// <param name="distance">カメラから物体までの距離</param>
+/// <param name="fovY">MakePerspectiveFovMatrixに渡した縦の画角</param>
+/// <param name="screenHeight">画面の高さ(ピクセル)</param>
+/// <param name="maxScreenError">許容する画面上の誤差(ピクセル)</param>
+/// <returns>lodsの番号</returns>
+uint32_t SelectLod(const std::vector<MeshLod>& lods, float worldScale, float distance, float fovY, float screenHeight, float maxScreenError = 1.0f);
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include "Vector3.h"
+
+/// <summary>
+/// メッシュを小さく分けた塊。ModelData::indicesの連続した範囲を指す
+/// </summary>
+struct Meshlet final {
+	uint32_t indexStart; // ModelData::indicesの開始位置
+	uint32_t indexCount; // 三角形の数*3
+	uint32_t subMeshIndex; // 含まれるSubMesh。1つのMeshletが複数のSubMeshにまたがることはない
+	uint32_t vertexCount; // 参照する頂点の数
+	Vector3 center; // 頂点を囲む球の中心
+	float radius;
+	Vector3 coneAxis; // 三角形の法線がまとまっている向き
+	float coneCutoff; // 法線の広がり(sin)。1なら裏面かどうかで間引かない
+};
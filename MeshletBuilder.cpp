@@ -0,0 +1,161 @@
+#include "MeshletBuilder.h"
+#include "VectorMath.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+
+	// 法線のまとまりがこれより広ければ、裏面で間引けることはほぼ無いので諦める
+	const float kMinConeDot = 0.1f;
+
+	Vector3 ToVector3(const Vector4& v) {
+		return { v.x, v.y, v.z };
+	}
+
+	// Meshletの範囲から囲む球と法線の向きを求める
+	void ComputeMeshletBounds(const ModelData& modelData, Meshlet& meshlet) {
+		const uint32_t* indices = modelData.indices.data() + meshlet.indexStart;
+
+		// AABBの中心から一番遠い頂点までを半径にする
+		Vector3 boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+			Vector3 position = ToVector3(modelData.vertices[indices[i]].position);
+			boundsMin = { std::min(boundsMin.x, position.x), std::min(boundsMin.y, position.y), std::min(boundsMin.z, position.z) };
+			boundsMax = { std::max(boundsMax.x, position.x), std::max(boundsMax.y, position.y), std::max(boundsMax.z, position.z) };
+		}
+		meshlet.center = { (boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f };
+		meshlet.radius = 0.0f;
+		for (uint32_t i = 0; i < meshlet.indexCount; ++i) {
+			meshlet.radius = std::max(meshlet.radius, Length(ToVector3(modelData.vertices[indices[i]].position) - meshlet.center));
+		}
+
+		// 三角形の法線。ModelDataの三角形は表から見て時計回りで、位置のyも反転しているので、この外積が外向きになる
+		std::vector<Vector3> normals;
+		normals.reserve(meshlet.indexCount / 3);
+		Vector3 normalSum = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i + 2 < meshlet.indexCount; i += 3) {
+			Vector3 p0 = ToVector3(modelData.vertices[indices[i]].position);
+			Vector3 p1 = ToVector3(modelData.vertices[indices[i + 1]].position);
+			Vector3 p2 = ToVector3(modelData.vertices[indices[i + 2]].position);
+			Vector3 normal = Cross(p1 - p0, p2 - p0);
+			float length = Length(normal);
+			if (length == 0.0f) {
+				continue; // 潰れた三角形は向きが無い
+			}
+			normal /= length;
+			normals.push_back(normal);
+			normalSum += normal;
+		}
+
+		// 平均の向きを軸にして、一番離れた法線との角度で広がりを決める
+		meshlet.coneAxis = { 0.0f, 0.0f, 1.0f };
+		meshlet.coneCutoff = 1.0f;
+		float sumLength = Length(normalSum);
+		if (normals.empty() || sumLength == 0.0f) {
+			return;
+		}
+		meshlet.coneAxis = normalSum / sumLength;
+		float minDot = 1.0f;
+		for (const Vector3& normal : normals) {
+			minDot = std::min(minDot, Dot(normal, meshlet.coneAxis));
+		}
+		if (minDot >= kMinConeDot) {
+			meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	// 全ての三角形がカメラから裏を向いているか。球の中のどこから見ても裏になる時だけtrue
+	bool IsMeshletBackfacing(const Meshlet& meshlet, const Vector3& cameraPosition) {
+		if (meshlet.coneCutoff >= 1.0f) {
+			return false;
+		}
+		Vector3 toCenter = meshlet.center - cameraPosition;
+		return Dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * Length(toCenter) + meshlet.radius;
+	}
+}
+
+/// *****************************************************
+/// Meshletを作る
+/// *****************************************************
+void BuildMeshlets(ModelData& modelData) {
+	modelData.meshlets.clear();
+
+	// 頂点がどのMeshletで最後に使われたか。今のMeshletの番号と同じなら数え済み
+	std::vector<uint32_t> vertexTags(modelData.vertices.size(), UINT32_MAX);
+
+	for (uint32_t subMeshIndex = 0; subMeshIndex < modelData.subMeshes.size(); ++subMeshIndex) {
+		const SubMesh& subMesh = modelData.subMeshes[subMeshIndex];
+		uint32_t indexEnd = subMesh.indexStart + subMesh.indexCount;
+
+		// 三角形は頂点キャッシュの順に並んでいるので、前から詰めていくだけで近い三角形がまとまる
+		for (uint32_t index = subMesh.indexStart; index < indexEnd;) {
+			Meshlet meshlet{};
+			meshlet.indexStart = index;
+			meshlet.subMeshIndex = subMeshIndex;
+			uint32_t tag = static_cast<uint32_t>(modelData.meshlets.size());
+
+			for (; index + 2 < indexEnd && meshlet.indexCount < kMeshletMaxTriangles * 3; index += 3) {
+				uint32_t newVertexCount = 0;
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					uint32_t vertex = modelData.indices[index + corner];
+					bool isDuplicate = false;
+					for (uint32_t other = 0; other < corner; ++other) {
+						isDuplicate |= modelData.indices[index + other] == vertex;
+					}
+					newVertexCount += (vertexTags[vertex] != tag && !isDuplicate) ? 1 : 0;
+				}
+				if (meshlet.vertexCount + newVertexCount > kMeshletMaxVertices) {
+					break; // 頂点があふれるので次のMeshletにする
+				}
+				for (uint32_t corner = 0; corner < 3; ++corner) {
+					vertexTags[modelData.indices[index + corner]] = tag;
+				}
+				meshlet.vertexCount += newVertexCount;
+				meshlet.indexCount += 3;
+			}
+
+			ComputeMeshletBounds(modelData, meshlet);
+			modelData.meshlets.push_back(meshlet);
+		}
+	}
+}
+
+/// *****************************************************
+/// Meshletを間引く
+/// *****************************************************
+MeshletCullStatistics CullMeshlets(const ModelData& modelData, const Frustum& frustum, const Vector3& cameraPosition,
+	std::vector<uint32_t>& indices, std::vector<SubMesh>& subMeshes) {
+	MeshletCullStatistics statistics{};
+	indices.clear();
+	subMeshes.resize(modelData.subMeshes.size());
+	for (size_t i = 0; i < subMeshes.size(); ++i) {
+		subMeshes[i] = { 0, 0, modelData.subMeshes[i].materialIndex };
+	}
+
+	// MeshletはSubMeshの順に並んでいるので、SubMeshごとにまとまって書き出される
+	for (const Meshlet& meshlet : modelData.meshlets) {
+		if (!IsSphereInFrustum(frustum, meshlet.center, meshlet.radius)) {
+			++statistics.frustumCulledMeshletCount;
+			continue;
+		}
+		if (IsMeshletBackfacing(meshlet, cameraPosition)) {
+			++statistics.backfaceCulledMeshletCount;
+			continue;
+		}
+
+		SubMesh& subMesh = subMeshes[meshlet.subMeshIndex];
+		if (subMesh.indexCount == 0) {
+			subMesh.indexStart = static_cast<uint32_t>(indices.size());
+		}
+		const uint32_t* begin = modelData.indices.data() + meshlet.indexStart;
+		indices.insert(indices.end(), begin, begin + meshlet.indexCount);
+		subMesh.indexCount += meshlet.indexCount;
+
+		++statistics.visibleMeshletCount;
+		statistics.visibleTriangleCount += meshlet.indexCount / 3;
+	}
+	return statistics;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Frustum.h"
+#include "ModelData.h"
+
+/// <summary>
+/// 1つのMeshletに入れる頂点の最大数
+/// </summary>
+const uint32_t kMeshletMaxVertices = 64;
+
+/// <summary>
+/// 1つのMeshletに入れる三角形の最大数
+/// </summary>
+const uint32_t kMeshletMaxTriangles = 124;
+
+/// <summary>
+/// Meshletの間引きの結果
+/// </summary>
+struct MeshletCullStatistics final {
+	size_t visibleMeshletCount;
+	size_t visibleTriangleCount;
+	size_t frustumCulledMeshletCount; // 視錐台の外で間引いた数
+	size_t backfaceCulledMeshletCount; // 全て裏を向いていて間引いた数
+};
+
+/// <summary>
+/// SubMeshの範囲を前から順にMeshletに分けて、囲む球と法線の向きを求める
+/// </summary>
+/// <param name="modelData">vertices、indices、subMeshesを読み、meshletsを書く</param>
+void BuildMeshlets(ModelData& modelData);
+
+/// <summary>
+/// 見えないMeshletを間引いて、残ったMeshletのIndexを詰めて書き出す
+/// </summary>
+/// <param name="modelData">meshletsを作ったModelData</param>
+/// <param name="frustum">モデルの座標系の視錐台</param>
+/// <param name="cameraPosition">モデルの座標系のカメラの位置</param>
+/// <param name="indices">詰めたIndexの書き出し先</param>
+/// <param name="subMeshes">modelData.subMeshesと同じ並びで、indicesの中の範囲を書く。全て間引いたSubMeshはindexCountが0</param>
+/// <returns>間引いた結果</returns>
+MeshletCullStatistics CullMeshlets(const ModelData& modelData, const Frustum& frustum, const Vector3& cameraPosition,
+	std::vector<uint32_t>& indices, std::vector<SubMesh>& subMeshes);
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "PackedVertexData.h"
+#include "Vector3.h"
+#include "Vector4.h"
+#include "VertexData.h"
+
+/// <summary>
+/// マテリアルの情報(mtlファイルのnewmtl1つ分)
+/// </summary>
+struct MaterialData final {
+	std::string name; // newmtlの名前
+	Vector4 color; // Kdとd(不透明度)
+	std::string textureFilePath; // map_Kd。無ければ空
+};
+
+/// <summary>
+/// 同じマテリアルで描く範囲
+/// </summary>
+struct SubMesh final {
+	uint32_t indexStart; // ModelData::indicesの開始位置
+	uint32_t indexCount;
+	uint32_t materialIndex; // ModelData::materialsの番号
+};
+
+/// <summary>
+/// ModelData
+/// </summary>
+struct ModelData final {
+	std::vector<VertexData> vertices; // 重複のない頂点
+	std::vector<PackedVertexData> packedVertices; // 圧縮した頂点。ObjLoadDesc::packVerticesの時だけ作る
+	Vector3 boundsMin; // 頂点の位置のAABB
+	Vector3 boundsMax;
+	std::vector<uint32_t> indices; // 三角形リストのIndex
+	std::vector<SubMesh> subMeshes; // o/usemtlで区切った範囲。ファイル順
+	std::vector<Meshlet> meshlets; // SubMeshを細かく分けた範囲。SubMeshの順に並ぶ
+	std::vector<MeshLod> lods; // 0段目が元のメッシュ。段が進むほど粗い
+	std::vector<SubMesh> lodSubMeshes; // 段ごとにsubMeshesと同じ数、同じ順で並ぶ。0段目はsubMeshesと同じ
+	std::vector<MaterialData> materials;
+	std::vector<std::string> materialLibraries; // mtllibで参照したファイル名
+};
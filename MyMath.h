@@ -1,6 +1,9 @@
 #pragma once
 #include "Matrix3x3.h"
 #include "Matrix4x4.h"
+#include "Quaternion.h"
+#include "SimdConfig.h"
+#include "SinCos.h"
 #include "Vector2.h"
 #include "Vector3.h"
 #include "Vector4.h"
@@ -11,12 +14,13 @@
 #include <iostream>
 #include <array>
 #include <assert.h>
+#include <type_traits>
 
 // π
-float pi() { return static_cast<float>(M_PI); }
+constexpr float pi() { return static_cast<float>(M_PI); }
 
 // 平行移動
-Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
+constexpr Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
     Matrix4x4 translateMatrix = { {
        {1, 0, 0, 0},
        {0, 1, 0, 0},
@@ -28,7 +32,7 @@ Matrix4x4 MakeTranslateMatrix(const Vector3& translate) {
 }
 
 // 拡縮行列
-Matrix4x4 MakeScalseMatrix(const Vector3& scale) {
+constexpr Matrix4x4 MakeScalseMatrix(const Vector3& scale) {
     Matrix4x4 scaleMatrix = { {
        {scale.x, 0, 0, 0},
        {0, scale.y, 0, 0},
@@ -41,12 +45,15 @@ Matrix4x4 MakeScalseMatrix(const Vector3& scale) {
 
 // X軸回転行列
 Matrix4x4 MakeRotateXMatrix(float radian) {
+    float sinValue, cosValue;
+    SinCos(radian, sinValue, cosValue);
+
     /*外側の中かっこは、Matrix4x4構造体の初期化を表しており、
       内側の中かっこは配列の初期化を表しています。*/
     Matrix4x4 result = { {
        {1, 0, 0, 0},
-       {0, cos(radian), sin(radian), 0},
-       {0, -sin(radian), cos(radian), 0},
+       {0, cosValue, sinValue, 0},
+       {0, -sinValue, cosValue, 0},
        {0, 0, 0, 1}
    } };
 
@@ -55,10 +62,13 @@ Matrix4x4 MakeRotateXMatrix(float radian) {
 
 // Y軸回転行列
 Matrix4x4 MakeRotateYMatrix(float radian) {
+    float sinValue, cosValue;
+    SinCos(radian, sinValue, cosValue);
+
     Matrix4x4 result = { {
-       {cos(radian), 0, -sin(radian), 0},
+       {cosValue, 0, -sinValue, 0},
        {0, 1, 0, 0},
-       {sin(radian), 0, cos(radian), 0},
+       {sinValue, 0, cosValue, 0},
        {0, 0, 0, 1}
    } };
 
@@ -67,9 +77,12 @@ Matrix4x4 MakeRotateYMatrix(float radian) {
 
 // Z軸回転行列
 Matrix4x4 MakeRotateZMatrix(float radian) {
+    float sinValue, cosValue;
+    SinCos(radian, sinValue, cosValue);
+
     Matrix4x4 result = { {
-       {cos(radian), sin(radian), 0, 0},
-       {-sin(radian), cos(radian), 0, 0},
+       {cosValue, sinValue, 0, 0},
+       {-sinValue, cosValue, 0, 0},
        {0, 0, 1, 0},
        {0, 0, 0, 1}
    } };
@@ -77,8 +90,8 @@ Matrix4x4 MakeRotateZMatrix(float radian) {
     return result;
 }
 
-// 行列同士の掛け算
-Matrix4x4 Mutiply(const Matrix4x4& m1, const Matrix4x4& m2) {
+// 行列同士の掛け算(スカラー版)。SIMD版の結果を確かめる基準
+constexpr Matrix4x4 MutiplyScalar(const Matrix4x4& m1, const Matrix4x4& m2) {
     Matrix4x4 answer = {};
     for (int x = 0; x < 4; ++x) {
         for (int y = 0; y < 4; ++y) {
@@ -94,8 +107,62 @@ Matrix4x4 Mutiply(const Matrix4x4& m1, const Matrix4x4& m2) {
     return answer;
 }
 
-// 3次元アフィン変換行列
-Matrix4x4 MakeAffineMatrix(
+// 行列同士の掛け算
+// 答えのx行目は、m1のx行目の各要素をm2の各行に掛けて足したもの。足す順番はスカラー版と同じなので結果も一致する
+// (FMAを使うと丸めが1回減って結果が変わるので使わない)
+constexpr Matrix4x4 Mutiply(const Matrix4x4& m1, const Matrix4x4& m2) {
+    // コンパイル時には組み込み関数を使えないので、スカラー版で計算する
+    if (std::is_constant_evaluated()) {
+        return MutiplyScalar(m1, m2);
+    }
+
+#if MYMATH_USE_SIMD && defined(__AVX__)
+    Matrix4x4 answer;
+
+    // m2の各行を上下の128bitに複製する
+    __m256 row0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[0]));
+    __m256 row1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[1]));
+    __m256 row2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[2]));
+    __m256 row3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m2.m[3]));
+
+    // m1の2行ずつ。上下の128bitの中で要素を並べて掛ける
+    for (int x = 0; x < 4; x += 2) {
+        __m256 a = _mm256_loadu_ps(m1.m[x]);
+        __m256 result = _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), row0);
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), row1));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), row2));
+        result = _mm256_add_ps(result, _mm256_mul_ps(_mm256_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), row3));
+        _mm256_storeu_ps(answer.m[x], result);
+    }
+
+    return answer;
+#elif MYMATH_USE_SIMD
+    Matrix4x4 answer;
+
+    // m2の各行
+    __m128 row0 = _mm_load_ps(m2.m[0]);
+    __m128 row1 = _mm_load_ps(m2.m[1]);
+    __m128 row2 = _mm_load_ps(m2.m[2]);
+    __m128 row3 = _mm_load_ps(m2.m[3]);
+
+    // m1の1行ずつ。各要素を4つに並べて掛ける
+    for (int x = 0; x < 4; ++x) {
+        __m128 a = _mm_load_ps(m1.m[x]);
+        __m128 result = _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)), row0);
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)), row1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)), row2));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)), row3));
+        _mm_store_ps(answer.m[x], result);
+    }
+
+    return answer;
+#else
+    return MutiplyScalar(m1, m2);
+#endif
+}
+
+// 3次元アフィン変換行列(S,Rx,Ry,Rz,Tの行列を掛けて作る版)。MakeAffineMatrixの結果を確かめる基準
+Matrix4x4 MakeAffineMatrixReference(
 	const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
 
     // 平行移動(T)
@@ -118,10 +185,66 @@ Matrix4x4 MakeAffineMatrix(
     return affineMatrix_;
 }
 
+// 3次元アフィン変換行列
+// S*Rx*Ry*Rzの3x3部分を直接求め、平行移動を4行目に入れる。sin/cosは軸ごとに1回ずつ
+Matrix4x4 MakeAffineMatrix(
+    const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+
+    // 3軸のsin/cosはまとめて求める
+    Vector3 sinRotate, cosRotate;
+    SinCos(rotate, sinRotate, cosRotate);
+    float sinX = sinRotate.x, cosX = cosRotate.x;
+    float sinY = sinRotate.y, cosY = cosRotate.y;
+    float sinZ = sinRotate.z, cosZ = cosRotate.z;
+
+    // Rx*Ry*Rzの各行に、その行の拡縮を掛ける
+    Matrix4x4 result = { {
+        {(cosY * cosZ) * scale.x, (cosY * sinZ) * scale.x, (-sinY) * scale.x, 0},
+        {(sinX * sinY * cosZ - cosX * sinZ) * scale.y, (sinX * sinY * sinZ + cosX * cosZ) * scale.y, (sinX * cosY) * scale.y, 0},
+        {(cosX * sinY * cosZ + sinX * sinZ) * scale.z, (cosX * sinY * sinZ - sinX * cosZ) * scale.z, (cosX * cosY) * scale.z, 0},
+        {translate.x, translate.y, translate.z, 1}
+    } };
+
+    return result;
+}
+
+// 3次元アフィン変換行列の逆行列
+// (S*R*T)^-1 = T^-1 * R^T * S^-1。回転は転置、拡縮は逆数にして、平行移動は回転と拡縮を戻した向きで引く
+Matrix4x4 MakeAffineInverse(
+    const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+
+    assert(scale.x != 0.0f && scale.y != 0.0f && scale.z != 0.0f);
+
+    // 3軸のsin/cosはまとめて求める
+    Vector3 sinRotate, cosRotate;
+    SinCos(rotate, sinRotate, cosRotate);
+    float sinX = sinRotate.x, cosX = cosRotate.x;
+    float sinY = sinRotate.y, cosY = cosRotate.y;
+    float sinZ = sinRotate.z, cosZ = cosRotate.z;
+    float invScaleX = 1.0f / scale.x;
+    float invScaleY = 1.0f / scale.y;
+    float invScaleZ = 1.0f / scale.z;
+
+    // R^Tの各列に、その列の拡縮の逆数を掛ける
+    Matrix4x4 result = { {
+        {(cosY * cosZ) * invScaleX, (sinX * sinY * cosZ - cosX * sinZ) * invScaleY, (cosX * sinY * cosZ + sinX * sinZ) * invScaleZ, 0},
+        {(cosY * sinZ) * invScaleX, (sinX * sinY * sinZ + cosX * cosZ) * invScaleY, (cosX * sinY * sinZ - sinX * cosZ) * invScaleZ, 0},
+        {(-sinY) * invScaleX, (sinX * cosY) * invScaleY, (cosX * cosY) * invScaleZ, 0},
+        {0, 0, 0, 1}
+    } };
+
+    // 4行目は -translate * (R^T * S^-1)
+    for (int column = 0; column < 3; ++column) {
+        result.m[3][column] = -(translate.x * result.m[0][column] + translate.y * result.m[1][column] + translate.z * result.m[2][column]);
+    }
+
+    return result;
+}
+
 // 単位行列の作成
-Matrix4x4 MakeIdenitiy4x4() {
+constexpr Matrix4x4 MakeIdenitiy4x4() {
 
-    Matrix4x4 answer;
+    Matrix4x4 answer = {};
     for (int row = 0; row < 4; row++) {
         for (int col = 0; col < 4; col++) {
 
@@ -138,14 +261,14 @@ Matrix4x4 MakeIdenitiy4x4() {
 }
 
 // 転置行列
-Matrix4x4 Transpose(const Matrix4x4& m) {
+constexpr Matrix4x4 Transpose(const Matrix4x4& m) {
 
-    Matrix4x4 answer;
+    Matrix4x4 answer = {};
 
     for (int row = 0; row < 4; row++) {
         for (int col = 0; col < 4; col++) {
 
-            answer.m[row][col] = m.m[row][col];
+            answer.m[row][col] = m.m[col][row];
         }
     }
 
@@ -153,7 +276,7 @@ Matrix4x4 Transpose(const Matrix4x4& m) {
 }
 
 // ビューポート変換行列
-Matrix4x4 MakeViewportMatrix(
+constexpr Matrix4x4 MakeViewportMatrix(
     float left, float top, float width, float height, float minDepth, float maxDepth) {
 
     float scaleX = width / 2.0f;
@@ -193,7 +316,7 @@ Matrix4x4 MakePerspectiveFovMatrix(
 };
 
 // 正射影行列
-Matrix4x4 MakeOrethographicMatrx(
+constexpr Matrix4x4 MakeOrethographicMatrx(
     float left, float top, float right, float bottom, float nearClip, float farClip) {
 
     float scaleX = 2.0f / (right - left);
@@ -213,17 +336,42 @@ Matrix4x4 MakeOrethographicMatrx(
     return result;
 };
 
-// 逆行列
-Matrix4x4 Inverse(const Matrix4x4& m) {
-    Matrix4x4 invMatrix;
+// 逆行列が無いとみなす、行列式と各行の長さの積の比。丸め誤差で行列式が0にならない時も拾う
+constexpr float kSingularTolerance = 1e-6f;
+
+// 左上のcolumnCount列までで見た、各行の長さの2乗の積。floatでは大きい/小さい行列ですぐに溢れるのでdoubleで求める
+double RowLengthSquaredProduct(const Matrix4x4& m, int columnCount) {
+    double product = 1.0;
+    for (int row = 0; row < columnCount; ++row) {
+        double lengthSquared = 0.0;
+        for (int column = 0; column < columnCount; ++column) {
+            lengthSquared += static_cast<double>(m.m[row][column]) * m.m[row][column];
+        }
+        product *= lengthSquared;
+    }
+    return product;
+}
+
+// 行列式が各行の長さの積(行列式の絶対値の上限)に比べて十分小さければ、逆行列が無いとみなす
+// rowLengthSquaredProductは各行の長さの2乗の積(RowLengthSquaredProduct)
+// 行列式か、その逆数がfloatで表せない時も、逆行列を正しく作れないので無いとみなす
+bool IsSingular(float det, double rowLengthSquaredProduct) {
+    double detSquared = static_cast<double>(det) * det;
+    return !(detSquared > static_cast<double>(kSingularTolerance) * kSingularTolerance * rowLengthSquaredProduct) || !std::isfinite(det) || !std::isfinite(1.0f / det);
+}
+
+// アフィン変換行列の逆行列。左上3x3の逆行列から平行移動を戻す。4列目は(0,0,0,1)とみなす
+// 3x3が逆行列を持たなければ単位行列を入れてfalseを返す
+bool TryInverseAffine(const Matrix4x4& m, Matrix4x4& invMatrix) {
 
     float det =
         m.m[0][0] * (m.m[1][1] * m.m[2][2] - m.m[1][2] * m.m[2][1]) +
         m.m[0][1] * (m.m[1][2] * m.m[2][0] - m.m[1][0] * m.m[2][2]) +
         m.m[0][2] * (m.m[1][0] * m.m[2][1] - m.m[1][1] * m.m[2][0]);
 
-    if (det == 0) {
-        return invMatrix; // ゼロ除算のエラー処理
+    if (IsSingular(det, RowLengthSquaredProduct(m, 3))) {
+        invMatrix = MakeIdenitiy4x4();
+        return false; // 逆行列が無い
     }
 
     float invDet = 1.0f / det;
@@ -248,5 +396,393 @@ Matrix4x4 Inverse(const Matrix4x4& m) {
     invMatrix.m[3][2] = -(m.m[3][0] * invMatrix.m[0][2] + m.m[3][1] * invMatrix.m[1][2] + m.m[3][2] * invMatrix.m[2][2]);
     invMatrix.m[3][3] = 1.0f;
 
-    return invMatrix;
+    return true;
+}
+
+// アフィン変換行列の逆行列。逆行列が無い時は止める
+Matrix4x4 InverseAffine(const Matrix4x4& m) {
+    Matrix4x4 result;
+    bool isInvertible = TryInverseAffine(m, result);
+    assert(isInvertible);
+    (void)isInvertible;
+    return result;
+}
+
+// 回転と平行移動だけの行列(剛体変換)の逆行列。左上3x3が正規直交であることを前提に、転置で逆回転を作る
+constexpr Matrix4x4 InverseRigid(const Matrix4x4& m) {
+    Matrix4x4 result = { {
+        {m.m[0][0], m.m[1][0], m.m[2][0], 0},
+        {m.m[0][1], m.m[1][1], m.m[2][1], 0},
+        {m.m[0][2], m.m[1][2], m.m[2][2], 0},
+        {0, 0, 0, 1}
+    } };
+
+    // 4行目は -translate * R^T。R^Tのj列目はRのj行目
+    for (int column = 0; column < 3; ++column) {
+        result.m[3][column] = -(m.m[3][0] * m.m[column][0] + m.m[3][1] * m.m[column][1] + m.m[3][2] * m.m[column][2]);
+    }
+
+    return result;
+}
+
+// 一般の4x4行列の逆行列(スカラー版)。余因子を並べて行列式で割る。TryInverseの結果を確かめる基準
+// 逆行列を持たなければ単位行列を入れてfalseを返す
+bool TryInverseScalar(const Matrix4x4& m, Matrix4x4& result) {
+    // 下2行の2x2小行列式
+    float s0 = m.m[0][0] * m.m[1][1] - m.m[1][0] * m.m[0][1];
+    float s1 = m.m[0][0] * m.m[1][2] - m.m[1][0] * m.m[0][2];
+    float s2 = m.m[0][0] * m.m[1][3] - m.m[1][0] * m.m[0][3];
+    float s3 = m.m[0][1] * m.m[1][2] - m.m[1][1] * m.m[0][2];
+    float s4 = m.m[0][1] * m.m[1][3] - m.m[1][1] * m.m[0][3];
+    float s5 = m.m[0][2] * m.m[1][3] - m.m[1][2] * m.m[0][3];
+    float c5 = m.m[2][2] * m.m[3][3] - m.m[3][2] * m.m[2][3];
+    float c4 = m.m[2][1] * m.m[3][3] - m.m[3][1] * m.m[2][3];
+    float c3 = m.m[2][1] * m.m[3][2] - m.m[3][1] * m.m[2][2];
+    float c2 = m.m[2][0] * m.m[3][3] - m.m[3][0] * m.m[2][3];
+    float c1 = m.m[2][0] * m.m[3][2] - m.m[3][0] * m.m[2][2];
+    float c0 = m.m[2][0] * m.m[3][1] - m.m[3][0] * m.m[2][1];
+
+    float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (IsSingular(det, RowLengthSquaredProduct(m, 4))) {
+        result = MakeIdenitiy4x4();
+        return false; // 逆行列が無い
+    }
+
+    float invDet = 1.0f / det;
+    result.m[0][0] = (m.m[1][1] * c5 - m.m[1][2] * c4 + m.m[1][3] * c3) * invDet;
+    result.m[0][1] = (-m.m[0][1] * c5 + m.m[0][2] * c4 - m.m[0][3] * c3) * invDet;
+    result.m[0][2] = (m.m[3][1] * s5 - m.m[3][2] * s4 + m.m[3][3] * s3) * invDet;
+    result.m[0][3] = (-m.m[2][1] * s5 + m.m[2][2] * s4 - m.m[2][3] * s3) * invDet;
+
+    result.m[1][0] = (-m.m[1][0] * c5 + m.m[1][2] * c2 - m.m[1][3] * c1) * invDet;
+    result.m[1][1] = (m.m[0][0] * c5 - m.m[0][2] * c2 + m.m[0][3] * c1) * invDet;
+    result.m[1][2] = (-m.m[3][0] * s5 + m.m[3][2] * s2 - m.m[3][3] * s1) * invDet;
+    result.m[1][3] = (m.m[2][0] * s5 - m.m[2][2] * s2 + m.m[2][3] * s1) * invDet;
+
+    result.m[2][0] = (m.m[1][0] * c4 - m.m[1][1] * c2 + m.m[1][3] * c0) * invDet;
+    result.m[2][1] = (-m.m[0][0] * c4 + m.m[0][1] * c2 - m.m[0][3] * c0) * invDet;
+    result.m[2][2] = (m.m[3][0] * s4 - m.m[3][1] * s2 + m.m[3][3] * s0) * invDet;
+    result.m[2][3] = (-m.m[2][0] * s4 + m.m[2][1] * s2 - m.m[2][3] * s0) * invDet;
+
+    result.m[3][0] = (-m.m[1][0] * c3 + m.m[1][1] * c1 - m.m[1][2] * c0) * invDet;
+    result.m[3][1] = (m.m[0][0] * c3 - m.m[0][1] * c1 + m.m[0][2] * c0) * invDet;
+    result.m[3][2] = (-m.m[3][0] * s3 + m.m[3][1] * s1 - m.m[3][2] * s0) * invDet;
+    result.m[3][3] = (m.m[2][0] * s3 - m.m[2][1] * s1 + m.m[2][2] * s0) * invDet;
+
+    return true;
+}
+
+#if MYMATH_USE_SIMD
+// 4要素の並べ替え。x,y,z,wは取り出す要素の番号
+#define MYMATH_SWIZZLE(vector, x, y, z, w) _mm_shuffle_ps(vector, vector, _MM_SHUFFLE(w, z, y, x))
+#define MYMATH_SHUFFLE(vector1, vector2, x, y, z, w) _mm_shuffle_ps(vector1, vector2, _MM_SHUFFLE(w, z, y, x))
+
+// 2x2行列(1本に行順で入れたもの)の掛け算 A*B
+__m128 Matrix2x2Mutiply(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, MYMATH_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(MYMATH_SWIZZLE(a, 1, 0, 3, 2), MYMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// 2x2行列の余因子行列との掛け算 adj(A)*B
+__m128 Matrix2x2AdjugateMutiply(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(MYMATH_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(MYMATH_SWIZZLE(a, 1, 1, 2, 2), MYMATH_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// 2x2行列と余因子行列の掛け算 A*adj(B)
+__m128 Matrix2x2MutiplyAdjugate(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, MYMATH_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(MYMATH_SWIZZLE(a, 1, 0, 3, 2), MYMATH_SWIZZLE(b, 2, 1, 2, 1)));
+}
+#endif
+
+// 一般の4x4行列の逆行列。透視投影を含む行列(VPの逆行列など)にも使える
+// 行列を2x2の小行列4つ[A B; C D]に分けて、小行列の行列式と余因子から求める
+// 逆行列を持たなければ単位行列を入れてfalseを返す
+bool TryInverse(const Matrix4x4& m, Matrix4x4& result) {
+#if MYMATH_USE_SIMD
+    __m128 row0 = _mm_load_ps(m.m[0]);
+    __m128 row1 = _mm_load_ps(m.m[1]);
+    __m128 row2 = _mm_load_ps(m.m[2]);
+    __m128 row3 = _mm_load_ps(m.m[3]);
+
+    // 2x2の小行列
+    __m128 a = _mm_movelh_ps(row0, row1);
+    __m128 b = _mm_movehl_ps(row1, row0);
+    __m128 c = _mm_movelh_ps(row2, row3);
+    __m128 d = _mm_movehl_ps(row3, row2);
+
+    // 小行列の行列式(|A|, |B|, |C|, |D|)
+    __m128 detSub = _mm_sub_ps(
+        _mm_mul_ps(MYMATH_SHUFFLE(row0, row2, 0, 2, 0, 2), MYMATH_SHUFFLE(row1, row3, 1, 3, 1, 3)),
+        _mm_mul_ps(MYMATH_SHUFFLE(row0, row2, 1, 3, 1, 3), MYMATH_SHUFFLE(row1, row3, 0, 2, 0, 2)));
+    __m128 detA = MYMATH_SWIZZLE(detSub, 0, 0, 0, 0);
+    __m128 detB = MYMATH_SWIZZLE(detSub, 1, 1, 1, 1);
+    __m128 detC = MYMATH_SWIZZLE(detSub, 2, 2, 2, 2);
+    __m128 detD = MYMATH_SWIZZLE(detSub, 3, 3, 3, 3);
+
+    // 逆行列を 1/|M| * [X Y; Z W] として、それぞれの余因子行列を求める
+    __m128 adjDC = Matrix2x2AdjugateMutiply(d, c);
+    __m128 adjAB = Matrix2x2AdjugateMutiply(a, b);
+    __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Matrix2x2Mutiply(b, adjDC));
+    __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Matrix2x2Mutiply(c, adjAB));
+    __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Matrix2x2MutiplyAdjugate(d, adjAB));
+    __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Matrix2x2MutiplyAdjugate(a, adjDC));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B * adj(D)C)
+    __m128 trace = _mm_mul_ps(adjAB, MYMATH_SWIZZLE(adjDC, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, MYMATH_SWIZZLE(trace, 1, 0, 3, 2));
+    trace = _mm_add_ps(trace, MYMATH_SWIZZLE(trace, 2, 3, 0, 1));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), trace);
+
+    float det = _mm_cvtss_f32(detM);
+    if (IsSingular(det, RowLengthSquaredProduct(m, 4))) {
+        result = MakeIdenitiy4x4();
+        return false; // 逆行列が無い
+    }
+
+    // 余因子行列の符号(+ - - +)を掛けながら行列式で割る
+    __m128 invDet = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+    x = _mm_mul_ps(x, invDet);
+    y = _mm_mul_ps(y, invDet);
+    z = _mm_mul_ps(z, invDet);
+    w = _mm_mul_ps(w, invDet);
+
+    // 余因子行列の並べ替えと、4x4の行への並べ替えをまとめて行う
+    _mm_store_ps(result.m[0], MYMATH_SHUFFLE(x, y, 3, 1, 3, 1));
+    _mm_store_ps(result.m[1], MYMATH_SHUFFLE(x, y, 2, 0, 2, 0));
+    _mm_store_ps(result.m[2], MYMATH_SHUFFLE(z, w, 3, 1, 3, 1));
+    _mm_store_ps(result.m[3], MYMATH_SHUFFLE(z, w, 2, 0, 2, 0));
+    return true;
+#else
+    return TryInverseScalar(m, result);
+#endif
+}
+
+// 一般の4x4行列の逆行列。逆行列が無い時は止める
+Matrix4x4 Inverse(const Matrix4x4& m) {
+    Matrix4x4 result;
+    bool isInvertible = TryInverse(m, result);
+    assert(isInvertible);
+    (void)isInvertible;
+    return result;
+}
+
+// 座標変換(行ベクトル、同次座標で割る)(スカラー版)
+constexpr Vector3 TransformPointScalar(const Vector3& vector, const Matrix4x4& matrix) {
+    Vector3 result = {};
+    result.x = vector.x * matrix.m[0][0] + vector.y * matrix.m[1][0] + vector.z * matrix.m[2][0] + matrix.m[3][0];
+    result.y = vector.x * matrix.m[0][1] + vector.y * matrix.m[1][1] + vector.z * matrix.m[2][1] + matrix.m[3][1];
+    result.z = vector.x * matrix.m[0][2] + vector.y * matrix.m[1][2] + vector.z * matrix.m[2][2] + matrix.m[3][2];
+    float w = vector.x * matrix.m[0][3] + vector.y * matrix.m[1][3] + vector.z * matrix.m[2][3] + matrix.m[3][3];
+    assert(w != 0.0f);
+    result.x /= w;
+    result.y /= w;
+    result.z /= w;
+    return result;
+}
+
+// 座標変換(行ベクトル、同次座標で割る)
+// 行列の各行に座標の要素を掛けて足す。足す順番はスカラー版と同じ
+constexpr Vector3 TransformPoint(const Vector3& vector, const Matrix4x4& matrix) {
+    if (std::is_constant_evaluated()) {
+        return TransformPointScalar(vector, matrix);
+    }
+
+#if MYMATH_USE_SIMD
+    __m128 result = _mm_mul_ps(_mm_set1_ps(vector.x), _mm_load_ps(matrix.m[0]));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vector.y), _mm_load_ps(matrix.m[1])));
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(vector.z), _mm_load_ps(matrix.m[2])));
+    result = _mm_add_ps(result, _mm_load_ps(matrix.m[3]));
+
+    float w = _mm_cvtss_f32(_mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 3, 3, 3)));
+    assert(w != 0.0f);
+    result = _mm_div_ps(result, _mm_set1_ps(w));
+
+    alignas(16) float answer[4];
+    _mm_store_ps(answer, result);
+    return { answer[0], answer[1], answer[2] };
+#else
+    return TransformPointScalar(vector, matrix);
+#endif
+}
+
+// 単位クォータニオン(回転しない)
+constexpr Quaternion MakeIdentityQuaternion() {
+    return { 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+// クォータニオン同士の掛け算。q1*q2は、q2の回転の後にq1の回転をする
+constexpr Quaternion Mutiply(const Quaternion& q1, const Quaternion& q2) {
+    return {
+        q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y,
+        q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x,
+        q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w,
+        q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z };
+}
+
+// 共役クォータニオン。単位クォータニオンなら逆回転になる
+constexpr Quaternion Conjugate(const Quaternion& quaternion) {
+    return { -quaternion.x, -quaternion.y, -quaternion.z, quaternion.w };
+}
+
+// 内積
+constexpr float Dot(const Quaternion& q1, const Quaternion& q2) {
+    return q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+}
+
+// 長さを1にする
+Quaternion Normalize(const Quaternion& quaternion) {
+    float length = std::sqrt(Dot(quaternion, quaternion));
+    assert(length != 0.0f);
+    float invLength = 1.0f / length;
+    return { quaternion.x * invLength, quaternion.y * invLength, quaternion.z * invLength, quaternion.w * invLength };
+}
+
+// 任意軸回転のクォータニオン。axisは正規化しておく
+Quaternion MakeRotateAxisAngleQuaternion(const Vector3& axis, float angle) {
+    float halfSin, halfCos;
+    SinCos(angle * 0.5f, halfSin, halfCos);
+    return { axis.x * halfSin, axis.y * halfSin, axis.z * halfSin, halfCos };
+}
+
+// オイラー角からクォータニオンを作る。MakeAffineMatrixと同じく、X、Y、Zの順に回す(qz*qy*qx)
+Quaternion MakeRotateQuaternion(const Vector3& rotate) {
+    Vector3 sinHalf, cosHalf;
+    SinCos(Vector3{ rotate.x * 0.5f, rotate.y * 0.5f, rotate.z * 0.5f }, sinHalf, cosHalf);
+    float sinX = sinHalf.x, cosX = cosHalf.x;
+    float sinY = sinHalf.y, cosY = cosHalf.y;
+    float sinZ = sinHalf.z, cosZ = cosHalf.z;
+    return {
+        sinX * cosY * cosZ - cosX * sinY * sinZ,
+        cosX * sinY * cosZ + sinX * cosY * sinZ,
+        cosX * cosY * sinZ - sinX * sinY * cosZ,
+        cosX * cosY * cosZ + sinX * sinY * sinZ };
+}
+
+// クォータニオンから回転行列を作る(行ベクトル用)
+constexpr Matrix4x4 MakeRotateMatrix(const Quaternion& quaternion) {
+    float x = quaternion.x, y = quaternion.y, z = quaternion.z, w = quaternion.w;
+
+    Matrix4x4 result = { {
+        {1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0},
+        {2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0},
+        {2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0},
+        {0, 0, 0, 1}
+    } };
+
+    return result;
+}
+
+// 回転行列からクォータニオンを作る。左上3x3の各行の長さで割るので、正の拡縮を含んでいてもよい(反転は表せない)
+// 対角成分の一番大きいところから求めて、打ち消し合いによる誤差を避ける
+Quaternion MakeRotateQuaternion(const Matrix4x4& m) {
+    float r[3][3];
+    for (int row = 0; row < 3; ++row) {
+        float length = std::sqrt(m.m[row][0] * m.m[row][0] + m.m[row][1] * m.m[row][1] + m.m[row][2] * m.m[row][2]);
+        assert(length != 0.0f);
+        for (int column = 0; column < 3; ++column) {
+            r[row][column] = m.m[row][column] / length;
+        }
+    }
+
+    Quaternion result;
+    float trace = r[0][0] + r[1][1] + r[2][2];
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        result = { (r[1][2] - r[2][1]) / s, (r[2][0] - r[0][2]) / s, (r[0][1] - r[1][0]) / s, 0.25f * s };
+    } else if (r[0][0] > r[1][1] && r[0][0] > r[2][2]) {
+        float s = std::sqrt(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+        result = { 0.25f * s, (r[1][0] + r[0][1]) / s, (r[2][0] + r[0][2]) / s, (r[1][2] - r[2][1]) / s };
+    } else if (r[1][1] > r[2][2]) {
+        float s = std::sqrt(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+        result = { (r[1][0] + r[0][1]) / s, 0.25f * s, (r[2][1] + r[1][2]) / s, (r[2][0] - r[0][2]) / s };
+    } else {
+        float s = std::sqrt(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+        result = { (r[2][0] + r[0][2]) / s, (r[2][1] + r[1][2]) / s, 0.25f * s, (r[0][1] - r[1][0]) / s };
+    }
+
+    return Normalize(result);
+}
+
+// ベクトルを回転する
+Vector3 RotateVector(const Vector3& vector, const Quaternion& quaternion) {
+    Quaternion result = Mutiply(Mutiply(quaternion, { vector.x, vector.y, vector.z, 0.0f }), Conjugate(quaternion));
+    return { result.x, result.y, result.z };
+}
+
+// 正規化線形補間。近い方の向きで補間し、長さを1に戻す
+Quaternion Nlerp(const Quaternion& q0, const Quaternion& q1, float t) {
+    float sign = Dot(q0, q1) < 0.0f ? -1.0f : 1.0f;
+    Quaternion result = {
+        q0.x + (q1.x * sign - q0.x) * t,
+        q0.y + (q1.y * sign - q0.y) * t,
+        q0.z + (q1.z * sign - q0.z) * t,
+        q0.w + (q1.w * sign - q0.w) * t };
+    return Normalize(result);
+}
+
+// 球面線形補間。角速度が一定になる。近い方の向きで補間する
+Quaternion Slerp(const Quaternion& q0, const Quaternion& q1, float t) {
+    float dot = Dot(q0, q1);
+    Quaternion end = q1;
+    if (dot < 0.0f) {
+        dot = -dot;
+        end = { -q1.x, -q1.y, -q1.z, -q1.w };
+    }
+
+    // ほぼ同じ向きならsinθが0に近く割り算が不安定なので、線形補間で代える
+    if (dot > 0.9995f) {
+        return Nlerp(q0, end, t);
+    }
+
+    float theta = std::acos(dot);
+    float invSinTheta = 1.0f / std::sin(theta);
+    float scale0 = std::sin((1.0f - t) * theta) * invSinTheta;
+    float scale1 = std::sin(t * theta) * invSinTheta;
+    return {
+        q0.x * scale0 + end.x * scale1,
+        q0.y * scale0 + end.y * scale1,
+        q0.z * scale0 + end.z * scale1,
+        q0.w * scale0 + end.w * scale1 };
+}
+
+// 3次元アフィン変換行列(回転をクォータニオンで渡す)。sin/cosを呼ばない
+constexpr Matrix4x4 MakeAffineMatrix(
+    const Vector3& scale, const Quaternion& rotate, const Vector3& translate) {
+
+    Matrix4x4 result = MakeRotateMatrix(rotate);
+    for (int row = 0; row < 3; ++row) {
+        float rowScale = row == 0 ? scale.x : row == 1 ? scale.y : scale.z;
+        for (int column = 0; column < 3; ++column) {
+            result.m[row][column] *= rowScale;
+        }
+    }
+    result.m[3][0] = translate.x;
+    result.m[3][1] = translate.y;
+    result.m[3][2] = translate.z;
+
+    return result;
+}
+
+// コンパイル時に計算できることと、その結果を確かめる
+namespace MyMathCompileTimeCheck {
+    constexpr Matrix4x4 kIdentity = MakeIdenitiy4x4();
+    constexpr Matrix4x4 kScaleTranslate = Mutiply(MakeScalseMatrix({ 2.0f, 3.0f, 4.0f }), MakeTranslateMatrix({ 1.0f, -2.0f, 5.0f }));
+    static_assert(kIdentity.m[0][0] == 1.0f && kIdentity.m[3][3] == 1.0f && kIdentity.m[0][1] == 0.0f && kIdentity.m[3][0] == 0.0f);
+    static_assert(TransformPoint({ 1.0f, 1.0f, 1.0f }, kScaleTranslate).x == 3.0f);
+    static_assert(TransformPoint({ 1.0f, 1.0f, 1.0f }, kScaleTranslate).y == 1.0f);
+    static_assert(TransformPoint({ 1.0f, 1.0f, 1.0f }, kScaleTranslate).z == 9.0f);
+    static_assert(Transpose(kScaleTranslate).m[0][3] == 1.0f && Transpose(kScaleTranslate).m[3][0] == 0.0f);
+    static_assert(Mutiply(kScaleTranslate, kIdentity).m[3][2] == 5.0f);
+
+    // 剛体変換の逆行列を掛けると元に戻る(90度回転は誤差無く表せる)
+    constexpr Matrix4x4 kRigid = MakeAffineMatrix({ 1.0f, 1.0f, 1.0f }, Quaternion{ 0.0f, 0.0f, 0.70710678f, 0.70710678f }, { 1.0f, 2.0f, 3.0f });
+    static_assert(TransformPoint(TransformPoint({ 4.0f, 5.0f, 6.0f }, kRigid), InverseRigid(kRigid)).z == 6.0f);
+
+    // 画面の左上と右下が、正射影で(-1, 1)と(1, -1)になり、ビューポート変換で元に戻る
+    constexpr Matrix4x4 kScreen = Mutiply(MakeOrethographicMatrx(0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 100.0f), MakeViewportMatrix(0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 1.0f));
+    static_assert(TransformPoint({ 0.0f, 0.0f, 0.0f }, MakeOrethographicMatrx(0.0f, 0.0f, 1280.0f, 720.0f, 0.0f, 100.0f)).y == 1.0f);
+    static_assert(TransformPoint({ 1280.0f, 720.0f, 0.0f }, kScreen).x == 1280.0f && TransformPoint({ 1280.0f, 720.0f, 0.0f }, kScreen).y == 720.0f);
+
+    // クォータニオンと共役の積は単位クォータニオン
+    constexpr Quaternion kUnit = Mutiply(Quaternion{ 0.6f, 0.0f, 0.0f, 0.8f }, Conjugate(Quaternion{ 0.6f, 0.0f, 0.0f, 0.8f }));
+    static_assert(kUnit.x == 0.0f && kUnit.y == 0.0f && kUnit.z == 0.0f && Dot(kUnit, MakeIdentityQuaternion()) > 0.9999f);
 }
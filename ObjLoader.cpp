@@ -0,0 +1,838 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cfloat>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+	/// *****************************************************
+	/// ファイルの中身をその場で読み進める為の関数
+	/// *****************************************************
+
+	// 行内の空白を読み飛ばす
+	const char* SkipSpace(const char* p, const char* end) {
+		while (p < end && (*p == ' ' || *p == '\t')) {
+			++p;
+		}
+		return p;
+	}
+
+	// 次の行の先頭まで読み飛ばす
+	const char* SkipLine(const char* p, const char* end) {
+		const void* newLine = std::memchr(p, '\n', static_cast<size_t>(end - p));
+		return newLine ? static_cast<const char*>(newLine) + 1 : end;
+	}
+
+	// 区切り文字かどうか
+	bool IsDelimiter(char c) {
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	// 空白区切りの単語を1つ読む
+	std::string_view ReadToken(const char*& p, const char* end) {
+		p = SkipSpace(p, end);
+		const char* begin = p;
+		while (p < end && !IsDelimiter(*p)) {
+			++p;
+		}
+		return std::string_view(begin, static_cast<size_t>(p - begin));
+	}
+
+	// 浮動小数点数を1つ読む。読めなかった場合は0
+	float ReadFloat(const char*& p, const char* end) {
+		p = SkipSpace(p, end);
+		if (p < end && *p == '+') {
+			++p; // from_charsは先頭の+を受け付けない
+		}
+		float value = 0.0f;
+		auto [ptr, ec] = std::from_chars(p, end, value);
+		if (ec == std::errc()) {
+			p = ptr;
+		}
+		return value;
+	}
+
+	// 整数を1つ読む。読めなかった場合は0
+	int32_t ReadInt(const char*& p, const char* end) {
+		int32_t value = 0;
+		auto [ptr, ec] = std::from_chars(p, end, value);
+		if (ec == std::errc()) {
+			p = ptr;
+		}
+		return value;
+	}
+
+	/// *****************************************************
+	/// 分割して読んだ結果
+	/// *****************************************************
+
+	// 面の頂点が参照する要素の番号(ファイルに書かれた1始まりの値)
+	struct ObjCorner {
+		int32_t position;
+		int32_t texcoord;
+		int32_t normal;
+
+		bool operator==(const ObjCorner&) const = default;
+	};
+
+	// [位置/UV/法線]の組のハッシュ
+	struct ObjCornerHash {
+		size_t operator()(const ObjCorner& corner) const {
+			uint64_t hash = static_cast<uint32_t>(corner.position) * 0x9E3779B97F4A7C15ull;
+			hash ^= (hash >> 29) + static_cast<uint32_t>(corner.texcoord) * 0xBF58476D1CE4E5B9ull;
+			hash ^= (hash >> 27) + static_cast<uint32_t>(corner.normal) * 0x94D049BB133111EBull;
+			return static_cast<size_t>(hash ^ (hash >> 31));
+		}
+	};
+
+	// o/usemtlが出てきた位置。以降の面から新しいSubMeshになる
+	struct ObjGroupEvent {
+		size_t faceIndex; // この時点で読んだ面の数
+		size_t cornerIndex; // 三角形に分割した後の、この時点での三角形の頂点の数
+		bool isMaterial; // usemtlならtrue、oならfalse
+		std::string_view name;
+	};
+
+	// 負の番号(相対指定)を含む面の頂点。elementMaskのbitが立っている要素はチャンク内の0始まりの番号になっている
+	struct ObjRelativeCorner {
+		size_t cornerIndex;
+		uint32_t elementMask;
+	};
+
+	// 範囲外の番号を参照している面。見つけたら読み込みを失敗にする
+	struct ObjIndexError {
+		size_t faceIndex; // チャンク内の面の番号
+		const char* element; // "position"、"texcoord"、"normal"
+		int32_t index; // 相対指定を解決した後の1始まりの番号
+		size_t count; // その要素の数
+	};
+
+	// 1つのチャンクから読んだ要素。面の番号はまだ解決していない
+	struct ObjChunk {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+		std::vector<Vector4> positions;
+		std::vector<Vector2> texcoords;
+		std::vector<Vector3> normals;
+		std::vector<ObjCorner> corners; // 面の頂点。faceSizesの数ずつで1つの面
+		std::vector<uint32_t> faceSizes; // 面ごとの頂点の数
+		std::vector<ObjRelativeCorner> relativeCorners; // 相対指定を含む頂点
+		size_t generatedNormalCount = 0; // 法線の指定がなく、面の法線を作る面の数
+		std::vector<ObjCorner> triangles; // 三角形に分割した結果。3つで1つの三角形
+		std::optional<ObjIndexError> indexError; // 最初に見つけた範囲外の番号。あれば三角形に分割しない
+		std::vector<ObjGroupEvent> groupEvents; // o/usemtlの位置
+		std::vector<std::string_view> materialLibraries; // mtllib
+	};
+
+	// ファイルを行の境界で分割する
+	std::vector<ObjChunk> SplitChunks(const char* begin, const char* end, uint32_t chunkCount) {
+		std::vector<ObjChunk> chunks;
+		size_t chunkSize = static_cast<size_t>(end - begin) / chunkCount;
+		const char* p = begin;
+		for (uint32_t i = 0; i < chunkCount && p < end; ++i) {
+			const char* chunkEnd = end;
+			if (i + 1 < chunkCount && static_cast<size_t>(end - p) > chunkSize) {
+				chunkEnd = SkipLine(p + chunkSize, end); // 行の途中で切らない
+			}
+			ObjChunk& chunk = chunks.emplace_back();
+			chunk.begin = p;
+			chunk.end = chunkEnd;
+			p = chunkEnd;
+		}
+		return chunks;
+	}
+
+	// チャンク内のv/vt/vn/f/o/usemtl/mtllibを読む
+	void ParseChunk(ObjChunk& chunk) {
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end) {
+			std::string_view identifier = ReadToken(p, end); // 先頭の識別子を読む
+
+			// 頂点情報を得る
+			// 頂点位置
+			if (identifier == "v") {
+				Vector4 position;
+				position.x = ReadFloat(p, end);
+				position.y = ReadFloat(p, end);
+				position.z = ReadFloat(p, end);
+				position.w = 1.0f;
+				chunk.positions.push_back(position);
+				// 頂点テクスチャ座標
+			} else if (identifier == "vt") {
+				Vector2 texcoord;
+				texcoord.x = ReadFloat(p, end);
+				texcoord.y = ReadFloat(p, end);
+				chunk.texcoords.push_back(texcoord);
+				// 頂点法線
+			} else if (identifier == "vn") {
+				Vector3 normal;
+				normal.x = ReadFloat(p, end);
+				normal.y = ReadFloat(p, end);
+				normal.z = ReadFloat(p, end);
+				chunk.normals.push_back(normal);
+
+				// 面
+			} else if (identifier == "f") {
+
+				// 頂点の数は任意。三角形への分割は番号を解決してから行う
+				size_t faceBegin = chunk.corners.size();
+				size_t relativeBegin = chunk.relativeCorners.size();
+				bool hasMissingNormal = false;
+				const size_t elementCounts[3] = { chunk.positions.size(), chunk.texcoords.size(), chunk.normals.size() };
+				for (p = SkipSpace(p, end); p < end && !IsDelimiter(*p) && *p != '#'; p = SkipSpace(p, end)) {
+					const char* cornerBegin = p;
+
+					// 頂点の要素へのIndexは[位置/UV/法線]で格納されているので、分解してIndexを取得する
+					// v、v/vt、v//vn、v/vt/vnのどれでもよく、書かれていない要素は0になる
+					int32_t elementIndices[3] = {};
+					uint32_t elementMask = 0;
+					for (int32_t element = 0; element < 3; ++element) {
+						elementIndices[element] = ReadInt(p, end);
+						// 負の値はここまでに読んだ要素からの相対位置。チャンク内の番号にしておき、連結時に全体の番号にする
+						if (elementIndices[element] < 0) {
+							elementIndices[element] += static_cast<int32_t>(elementCounts[element]);
+							elementMask |= 1u << element;
+						}
+						if (p >= end || *p != '/') {
+							break;
+						}
+						++p; // 区切りを飛ばす
+					}
+					if (p == cornerBegin) {
+						break; // 番号として読めないものがあれば面はそこまで
+					}
+
+					if (elementMask != 0) {
+						chunk.relativeCorners.push_back({ chunk.corners.size(), elementMask });
+					}
+					hasMissingNormal |= elementIndices[2] == 0 && (elementMask & 4u) == 0;
+					chunk.corners.push_back({ elementIndices[0], elementIndices[1], elementIndices[2] });
+				}
+
+				// 3頂点に満たないものは面にならないので捨てる
+				size_t faceSize = chunk.corners.size() - faceBegin;
+				if (faceSize < 3) {
+					chunk.corners.resize(faceBegin);
+					chunk.relativeCorners.resize(relativeBegin);
+				} else {
+					chunk.faceSizes.push_back(static_cast<uint32_t>(faceSize));
+					chunk.generatedNormalCount += hasMissingNormal ? 1 : 0;
+				}
+
+				// マテリアル
+			} else if (identifier == "usemtl") {
+				chunk.groupEvents.push_back({ chunk.faceSizes.size(), 0, true, ReadToken(p, end) });
+				// オブジェクト
+			} else if (identifier == "o") {
+				chunk.groupEvents.push_back({ chunk.faceSizes.size(), 0, false, ReadToken(p, end) });
+				// マテリアルライブラリ。空白区切りで複数書ける
+			} else if (identifier == "mtllib") {
+				for (std::string_view library = ReadToken(p, end); !library.empty(); library = ReadToken(p, end)) {
+					chunk.materialLibraries.push_back(library);
+				}
+			}
+
+			// 読み残しは捨てて次の行へ。どの読み取りも改行の手前で止まる
+			p = SkipLine(p, end);
+		}
+	}
+
+	/// *****************************************************
+	/// 多角形の面を三角形に分割する為の関数
+	/// *****************************************************
+
+	// 面の法線(Newellの方法)。長さは正規化していない。凹でも頂点が同一平面から少しずれていても安定する
+	Vector3 ComputeFaceNormal(const ObjCorner* face, uint32_t faceSize, const std::vector<Vector4>& positions) {
+		Vector3 normal = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < faceSize; ++i) {
+			const Vector4& current = positions[face[i].position - 1];
+			const Vector4& next = positions[face[(i + 1) % faceSize].position - 1];
+			normal.x += (current.y - next.y) * (current.z + next.z);
+			normal.y += (current.z - next.z) * (current.x + next.x);
+			normal.z += (current.x - next.x) * (current.y + next.y);
+		}
+		return normal;
+	}
+
+	// 面の法線に一番近い軸を捨てて、表から見て反時計回りになる2次元座標に落とす
+	Vector2 ProjectToFace(const Vector4& position, const Vector3& normal) {
+		float absX = std::abs(normal.x), absY = std::abs(normal.y), absZ = std::abs(normal.z);
+		if (absX >= absY && absX >= absZ) {
+			return normal.x >= 0.0f ? Vector2{ position.y, position.z } : Vector2{ position.z, position.y };
+		}
+		if (absY >= absZ) {
+			return normal.y >= 0.0f ? Vector2{ position.z, position.x } : Vector2{ position.x, position.z };
+		}
+		return normal.z >= 0.0f ? Vector2{ position.x, position.y } : Vector2{ position.y, position.x };
+	}
+
+	// a->b->cが左回りなら正
+	float Cross2(const Vector2& a, const Vector2& b, const Vector2& c) {
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// 面を三角形に分割してtrianglesに足す。凸なら扇形、凹なら耳刈りで分割する
+	// pointsとremainingは作業用。面ごとに確保しないよう呼び出し側で使い回す
+	void TriangulateFace(const ObjCorner* face, uint32_t faceSize, const Vector3& normal, const std::vector<Vector4>& positions,
+		std::vector<Vector2>& points, std::vector<uint32_t>& remaining, std::vector<ObjCorner>& triangles) {
+
+		// 三角形はそのまま
+		if (faceSize == 3) {
+			triangles.insert(triangles.end(), face, face + 3);
+			return;
+		}
+
+		// 面の平面上の2次元座標にする
+		points.resize(faceSize);
+		for (uint32_t i = 0; i < faceSize; ++i) {
+			points[i] = ProjectToFace(positions[face[i].position - 1], normal);
+		}
+
+		// 全ての頂点で左に曲がっていれば凸なので、扇形に分割する
+		bool isConvex = true;
+		for (uint32_t i = 0; i < faceSize && isConvex; ++i) {
+			isConvex = Cross2(points[i], points[(i + 1) % faceSize], points[(i + 2) % faceSize]) >= 0.0f;
+		}
+
+		remaining.resize(faceSize);
+		for (uint32_t i = 0; i < faceSize; ++i) {
+			remaining[i] = i;
+		}
+
+		// 凹なら、中に他の頂点を含まない凸の角(耳)を1つずつ切り落とす
+		while (!isConvex && remaining.size() > 3) {
+			size_t count = remaining.size();
+			bool isClipped = false;
+			for (size_t i = 0; i < count && !isClipped; ++i) {
+				uint32_t prev = remaining[(i + count - 1) % count];
+				uint32_t current = remaining[i];
+				uint32_t next = remaining[(i + 1) % count];
+				if (Cross2(points[prev], points[current], points[next]) <= 0.0f) {
+					continue; // 凹の角か潰れた角
+				}
+				bool containsPoint = false;
+				for (size_t j = 0; j < count && !containsPoint; ++j) {
+					uint32_t other = remaining[j];
+					if (other == prev || other == current || other == next) {
+						continue;
+					}
+					containsPoint = Cross2(points[prev], points[current], points[other]) >= 0.0f &&
+						Cross2(points[current], points[next], points[other]) >= 0.0f &&
+						Cross2(points[next], points[prev], points[other]) >= 0.0f;
+				}
+				if (containsPoint) {
+					continue;
+				}
+				triangles.push_back(face[prev]);
+				triangles.push_back(face[current]);
+				triangles.push_back(face[next]);
+				remaining.erase(remaining.begin() + i);
+				isClipped = true;
+			}
+			// 自己交差などで耳が見つからなければ、残りは扇形にする
+			if (!isClipped) {
+				break;
+			}
+		}
+
+		// 残りを扇形に分割する
+		for (size_t i = 1; i + 1 < remaining.size(); ++i) {
+			triangles.push_back(face[remaining[0]]);
+			triangles.push_back(face[remaining[i]]);
+			triangles.push_back(face[remaining[i + 1]]);
+		}
+	}
+
+	// 面の頂点の番号が全て範囲内かを確かめる。位置は必ず要り、UVと法線は0(書かれていない)でもよい
+	// 相対指定は0以下に解決されたら、ファイルの先頭より前を指しているので範囲外にする
+	std::optional<ObjIndexError> ValidateCorners(const ObjChunk& chunk, size_t positionCount, size_t texcoordCount, size_t normalCount) {
+		std::vector<uint32_t> relativeMasks(chunk.corners.size(), 0);
+		for (const ObjRelativeCorner& relativeCorner : chunk.relativeCorners) {
+			relativeMasks[relativeCorner.cornerIndex] = relativeCorner.elementMask;
+		}
+
+		// 0を許す要素は、相対指定でなければ0を書かれていないものとして扱う
+		auto isInRange = [](int32_t index, size_t count, bool allowMissing) {
+			return (allowMissing && index == 0) || (index >= 1 && static_cast<size_t>(index) <= count);
+		};
+		size_t cornerIndex = 0;
+		for (size_t faceIndex = 0; faceIndex < chunk.faceSizes.size(); ++faceIndex) {
+			for (uint32_t i = 0; i < chunk.faceSizes[faceIndex]; ++i, ++cornerIndex) {
+				const ObjCorner& corner = chunk.corners[cornerIndex];
+				uint32_t relativeMask = relativeMasks[cornerIndex];
+				if (!isInRange(corner.position, positionCount, false)) {
+					return ObjIndexError{ faceIndex, "position", corner.position, positionCount };
+				}
+				if (!isInRange(corner.texcoord, texcoordCount, (relativeMask & 2u) == 0)) {
+					return ObjIndexError{ faceIndex, "texcoord", corner.texcoord, texcoordCount };
+				}
+				if (!isInRange(corner.normal, normalCount, (relativeMask & 4u) == 0)) {
+					return ObjIndexError{ faceIndex, "normal", corner.normal, normalCount };
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+	// 相対指定の番号を全体の番号にして、面を三角形に分割する。法線の無い面にはgeneratedNormalIndexから面の法線を書く
+	// 範囲外の番号があればchunk.indexErrorに入れて、分割はしない
+	void TriangulateChunk(ObjChunk& chunk, size_t positionOffset, size_t texcoordOffset, size_t normalOffset, size_t generatedNormalIndex,
+		size_t texcoordCount, size_t normalCount, const std::vector<Vector4>& positions, std::vector<Vector3>& normals) {
+
+		// チャンク内の0始まりの番号を、全体の1始まりの番号にする
+		for (const ObjRelativeCorner& relativeCorner : chunk.relativeCorners) {
+			ObjCorner& corner = chunk.corners[relativeCorner.cornerIndex];
+			if (relativeCorner.elementMask & 1u) {
+				corner.position += static_cast<int32_t>(positionOffset) + 1;
+			}
+			if (relativeCorner.elementMask & 2u) {
+				corner.texcoord += static_cast<int32_t>(texcoordOffset) + 1;
+			}
+			if (relativeCorner.elementMask & 4u) {
+				corner.normal += static_cast<int32_t>(normalOffset) + 1;
+			}
+		}
+
+		// 法線を作る数や位置を引く所は、番号が範囲内であることを前提にしている
+		chunk.indexError = ValidateCorners(chunk, positions.size(), texcoordCount, normalCount);
+		if (chunk.indexError) {
+			return;
+		}
+
+		chunk.triangles.reserve((chunk.corners.size() - 2 * chunk.faceSizes.size()) * 3);
+		std::vector<Vector2> points;
+		std::vector<uint32_t> remaining;
+		size_t eventIndex = 0;
+		size_t faceBegin = 0;
+		for (size_t faceIndex = 0; faceIndex < chunk.faceSizes.size(); ++faceIndex) {
+
+			// o/usemtlの位置を三角形の位置に直す
+			for (; eventIndex < chunk.groupEvents.size() && chunk.groupEvents[eventIndex].faceIndex <= faceIndex; ++eventIndex) {
+				chunk.groupEvents[eventIndex].cornerIndex = chunk.triangles.size();
+			}
+
+			ObjCorner* face = chunk.corners.data() + faceBegin;
+			uint32_t faceSize = chunk.faceSizes[faceIndex];
+			faceBegin += faceSize;
+
+			// 三角形で法線もあれば、法線を計算する必要はない
+			bool hasMissingNormal = false;
+			for (uint32_t i = 0; i < faceSize; ++i) {
+				hasMissingNormal |= face[i].normal == 0;
+			}
+			if (faceSize == 3 && !hasMissingNormal) {
+				chunk.triangles.insert(chunk.triangles.end(), face, face + 3);
+				continue;
+			}
+
+			Vector3 normal = ComputeFaceNormal(face, faceSize, positions);
+			if (hasMissingNormal) {
+				float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+				normals[generatedNormalIndex] = length > 0.0f ? Vector3{ normal.x / length, normal.y / length, normal.z / length } : Vector3{ 0.0f, 0.0f, 1.0f };
+				++generatedNormalIndex;
+				for (uint32_t i = 0; i < faceSize; ++i) {
+					if (face[i].normal == 0) {
+						face[i].normal = static_cast<int32_t>(generatedNormalIndex);
+					}
+				}
+			}
+			TriangulateFace(face, faceSize, normal, positions, points, remaining, chunk.triangles);
+		}
+		for (; eventIndex < chunk.groupEvents.size(); ++eventIndex) {
+			chunk.groupEvents[eventIndex].cornerIndex = chunk.triangles.size();
+		}
+
+		// 分割前の頂点はもう使わない
+		chunk.corners = {};
+		chunk.faceSizes = {};
+	}
+
+	// 要素へのIndexから、実際の要素の値を取得して、頂点を構築する。UVの無い頂点は(0,0)にする
+	VertexData MakeVertex(const ObjCorner& corner,
+		const std::vector<Vector4>& positions, const std::vector<Vector2>& texcoords, const std::vector<Vector3>& normals) {
+		Vector4 position = positions[corner.position - 1];
+		Vector2 texcoord = corner.texcoord != 0 ? texcoords[corner.texcoord - 1] : Vector2{ 0.0f, 0.0f };
+		Vector3 normal = normals[corner.normal - 1];
+		//position.x *= -1.0f; // 位置の反転
+		position.y *= -1.0f;
+		//normal.x *= -1.0f; // 法線の反転
+		normal.y *= -1.0f;
+		return { position, texcoord, normal };
+	}
+
+	// mtlファイルを読んでマテリアルを追加する
+	bool LoadMtlFile(const std::string& directoryPath, const std::string& filename, std::vector<MaterialData>& materials) {
+		MappedFile file;
+		if (!file.Open(directoryPath + "/" + filename)) {
+			return false;
+		}
+
+		const char* p = file.GetData();
+		const char* end = p + file.GetSize();
+		MaterialData* material = nullptr;
+		while (p < end) {
+			std::string_view identifier = ReadToken(p, end);
+
+			// 新しいマテリアル
+			if (identifier == "newmtl") {
+				material = &materials.emplace_back();
+				material->name = ReadToken(p, end);
+				material->color = { 1.0f, 1.0f, 1.0f, 1.0f };
+			} else if (material != nullptr) {
+				// 拡散反射色
+				if (identifier == "Kd") {
+					material->color.x = ReadFloat(p, end);
+					material->color.y = ReadFloat(p, end);
+					material->color.z = ReadFloat(p, end);
+					// 不透明度
+				} else if (identifier == "d") {
+					material->color.w = ReadFloat(p, end);
+					// 透明度(1 - d)
+				} else if (identifier == "Tr") {
+					material->color.w = 1.0f - ReadFloat(p, end);
+					// テクスチャ。オプションが前に付くことがあるので最後の単語をファイル名とする
+				} else if (identifier == "map_Kd") {
+					std::string_view textureFilename;
+					for (std::string_view token = ReadToken(p, end); !token.empty(); token = ReadToken(p, end)) {
+						textureFilename = token;
+					}
+					material->textureFilePath = directoryPath + "/" + std::string(textureFilename);
+				}
+			}
+			p = SkipLine(p, end);
+		}
+		return true;
+	}
+
+	/// *****************************************************
+	///　Objファイルの中身を解析する関数。範囲外の番号を参照する面があればfalse
+	/// *****************************************************
+	bool ParseObj(const MappedFile& file, const std::string& directoryPath, const std::string& filename, const ObjLoadDesc& desc, ModelData& modelData) {
+
+		auto startTime = std::chrono::steady_clock::now();
+
+		// 1.中で必要となる変数の宣言 //
+		modelData = {}; // 構築するModelData
+		std::vector<Vector4> positions; // 位置
+		std::vector<Vector3> normals; // 法線
+		std::vector<Vector2> texcoords; // テクスチャ座標
+
+		// 小さいファイルはスレッドを立てるだけ無駄なので分割しない
+		const size_t kMinChunkSize = 256 * 1024;
+		uint32_t threadCount = desc.threadCount != 0 ? desc.threadCount : std::max(1u, std::thread::hardware_concurrency());
+		uint32_t chunkCount = static_cast<uint32_t>(std::clamp<size_t>(file.GetSize() / kMinChunkSize, 1, threadCount));
+
+		std::unique_ptr<ThreadPool> threadPool;
+		if (chunkCount > 1) {
+			threadPool = std::make_unique<ThreadPool>(chunkCount);
+		}
+
+		// 1スレッドなら呼び出したスレッドで、それ以外はスレッドプールで実行する
+		auto parallelFor = [&](uint32_t count, const std::function<void(uint32_t)>& function) {
+			if (threadPool) {
+				threadPool->ParallelFor(count, function);
+			} else {
+				for (uint32_t i = 0; i < count; ++i) {
+					function(i);
+				}
+			}
+		};
+
+		// 2. 行の境界で分割して、チャンクごとに要素を読む
+		std::vector<ObjChunk> chunks = SplitChunks(file.GetData(), file.GetData() + file.GetSize(), chunkCount);
+		parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i) { ParseChunk(chunks[i]); });
+
+		auto parseTime = std::chrono::steady_clock::now();
+
+		// 3. ファイル順にチャンクを連結する。書き込み先はチャンクの順番だけで決まるので、分割数によらず同じ結果になる
+		std::vector<size_t> positionOffsets(chunks.size());
+		std::vector<size_t> texcoordOffsets(chunks.size());
+		std::vector<size_t> normalOffsets(chunks.size());
+		std::vector<size_t> generatedNormalOffsets(chunks.size());
+		std::vector<size_t> faceOffsets(chunks.size());
+		size_t positionCount = 0, texcoordCount = 0, normalCount = 0, generatedNormalCount = 0, faceCount = 0;
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			faceOffsets[i] = faceCount;
+			positionOffsets[i] = positionCount;
+			texcoordOffsets[i] = texcoordCount;
+			normalOffsets[i] = normalCount;
+			generatedNormalOffsets[i] = generatedNormalCount;
+			positionCount += chunks[i].positions.size();
+			texcoordCount += chunks[i].texcoords.size();
+			normalCount += chunks[i].normals.size();
+			generatedNormalCount += chunks[i].generatedNormalCount;
+			faceCount += chunks[i].faceSizes.size();
+		}
+		positions.resize(positionCount);
+		texcoords.resize(texcoordCount);
+		normals.resize(normalCount + generatedNormalCount); // 作った面の法線はファイルの法線の後ろに置く
+
+		parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i) {
+			std::copy(chunks[i].positions.begin(), chunks[i].positions.end(), positions.begin() + positionOffsets[i]);
+			std::copy(chunks[i].texcoords.begin(), chunks[i].texcoords.end(), texcoords.begin() + texcoordOffsets[i]);
+			std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), normals.begin() + normalOffsets[i]);
+		});
+
+		// 位置が揃ったので、チャンクごとに面を三角形に分割する
+		parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t i) {
+			TriangulateChunk(chunks[i], positionOffsets[i], texcoordOffsets[i], normalOffsets[i], normalCount + generatedNormalOffsets[i],
+				texcoordCount, normalCount, positions, normals);
+		});
+
+		// ファイルの順で最初の範囲外の番号を報告する
+		for (size_t i = 0; i < chunks.size(); ++i) {
+			if (chunks[i].indexError) {
+				const ObjIndexError& error = *chunks[i].indexError;
+				Log(std::format("LoadObjFile: {} face {} references {} {} (valid range 1..{})\n",
+					filename, faceOffsets[i] + error.faceIndex + 1, error.element, error.index, error.count));
+				modelData = {};
+				return false;
+			}
+		}
+		size_t cornerCount = 0;
+		for (const ObjChunk& chunk : chunks) {
+			cornerCount += chunk.triangles.size();
+		}
+
+		// 4. mtllibで参照されたマテリアルを読む
+		std::unordered_map<std::string, uint32_t> materialIndices;
+		for (const ObjChunk& chunk : chunks) {
+			for (std::string_view library : chunk.materialLibraries) {
+				modelData.materialLibraries.emplace_back(library);
+				if (!LoadMtlFile(directoryPath, std::string(library), modelData.materials)) {
+					Log(std::format("LoadObjFile: failed to open {}\n", library));
+				}
+			}
+		}
+		for (uint32_t i = 0; i < modelData.materials.size(); ++i) {
+			materialIndices.try_emplace(modelData.materials[i].name, i);
+		}
+
+		// 名前からマテリアルの番号を引く。見つからなければ白のマテリアルを足す
+		auto findMaterial = [&](std::string_view name) {
+			auto [it, isInserted] = materialIndices.try_emplace(std::string(name), static_cast<uint32_t>(modelData.materials.size()));
+			if (isInserted) {
+				modelData.materials.push_back({ std::string(name), { 1.0f, 1.0f, 1.0f, 1.0f }, {} });
+			}
+			return it->second;
+		};
+
+		// 5. 面の頂点を[位置/UV/法線]の組で重複排除してIndexを振る。
+		// 最初に出てきた順に番号を付けるので、分割数によらず同じ結果になる
+		std::unordered_map<ObjCorner, uint32_t, ObjCornerHash> vertexIndices;
+		std::vector<ObjCorner> uniqueCorners;
+		vertexIndices.reserve(cornerCount);
+		modelData.indices.reserve(cornerCount);
+
+		// usemtlより前の面は名前のないマテリアルを使う
+		std::optional<uint32_t> currentMaterial;
+		bool isNewGroup = true;
+		for (const ObjChunk& chunk : chunks) {
+			size_t eventIndex = 0;
+			for (size_t corner = 0; corner < chunk.triangles.size(); corner += 3) {
+
+				// この面より前にあるo/usemtlを反映する
+				for (; eventIndex < chunk.groupEvents.size() && chunk.groupEvents[eventIndex].cornerIndex <= corner; ++eventIndex) {
+					if (chunk.groupEvents[eventIndex].isMaterial) {
+						currentMaterial = findMaterial(chunk.groupEvents[eventIndex].name);
+					}
+					isNewGroup = true;
+				}
+
+				// 面が来た時点でSubMeshを区切る。空のSubMeshは作らない
+				if (isNewGroup) {
+					if (!currentMaterial) {
+						currentMaterial = findMaterial("");
+					}
+					if (modelData.subMeshes.empty() || modelData.subMeshes.back().indexCount != 0) {
+						modelData.subMeshes.push_back({ static_cast<uint32_t>(modelData.indices.size()), 0, *currentMaterial });
+					} else {
+						modelData.subMeshes.back().materialIndex = *currentMaterial;
+					}
+					isNewGroup = false;
+				}
+				modelData.subMeshes.back().indexCount += 3;
+
+				// 頂点を逆順で登録することで、周り順を逆にする
+				for (size_t faceVertex = 3; faceVertex-- > 0;) {
+					const ObjCorner& key = chunk.triangles[corner + faceVertex];
+					auto [it, isInserted] = vertexIndices.try_emplace(key, static_cast<uint32_t>(uniqueCorners.size()));
+					if (isInserted) {
+						uniqueCorners.push_back(key);
+					}
+					modelData.indices.push_back(it->second);
+				}
+			}
+			// 面が後に続かないo/usemtlも反映しておく
+			for (; eventIndex < chunk.groupEvents.size(); ++eventIndex) {
+				if (chunk.groupEvents[eventIndex].isMaterial) {
+					currentMaterial = findMaterial(chunk.groupEvents[eventIndex].name);
+				}
+				isNewGroup = true;
+			}
+		}
+
+		// 6. 全要素が揃ったので、重複のない頂点だけを構築する
+		modelData.vertices.resize(uniqueCorners.size());
+		uint32_t vertexChunkCount = static_cast<uint32_t>(chunks.size());
+		parallelFor(vertexChunkCount, [&](uint32_t i) {
+			size_t begin = uniqueCorners.size() * i / vertexChunkCount;
+			size_t end = uniqueCorners.size() * (i + 1) / vertexChunkCount;
+			for (size_t vertex = begin; vertex < end; ++vertex) {
+				modelData.vertices[vertex] = MakeVertex(uniqueCorners[vertex], positions, texcoords, normals);
+			}
+		});
+
+		auto mergeTime = std::chrono::steady_clock::now();
+
+		// 7. 頂点キャッシュに乗るように三角形を並べ替え、読む順に頂点を並べ替える
+		VertexCacheStatistics cacheBefore = AnalyzeVertexCache(modelData.indices.data(), modelData.indices.size(), modelData.vertices.size());
+		if (desc.optimizeMesh) {
+			OptimizeMesh(modelData);
+		}
+		VertexCacheStatistics cacheAfter = AnalyzeVertexCache(modelData.indices.data(), modelData.indices.size(), modelData.vertices.size());
+
+		// 8. 並べ替えた三角形を前からMeshletに分ける
+		BuildMeshlets(modelData);
+		size_t triangleCount = modelData.indices.size() / 3;
+
+		// 9. 三角形を減らしたLODを作って、Indexの後ろに足す。作らない時も元のメッシュを0段目にしておく
+		if (desc.buildLods) {
+			BuildLods(modelData);
+		} else {
+			modelData.lods = { MeshLod{ 0, static_cast<uint32_t>(triangleCount), 0.0f } };
+			modelData.lodSubMeshes = modelData.subMeshes;
+		}
+
+		// 読み込みにかかった時間をログに出す
+		auto endTime = std::chrono::steady_clock::now();
+		double milliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		double parseMilliseconds = std::chrono::duration<double, std::milli>(parseTime - startTime).count();
+		double megaBytes = static_cast<double>(file.GetSize()) / (1024.0 * 1024.0);
+		double optimizeMilliseconds = std::chrono::duration<double, std::milli>(endTime - mergeTime).count();
+		Log(std::format("LoadObjFile: {} {:.2f}MB {:.3f}ms (parse {:.3f}ms, merge {:.3f}ms, optimize {:.3f}ms, {} threads, {:.1f}MB/s)\n",
+			filename, megaBytes, milliseconds, parseMilliseconds, milliseconds - parseMilliseconds - optimizeMilliseconds, optimizeMilliseconds, chunks.size(),
+			milliseconds > 0.0 ? megaBytes / (milliseconds / 1000.0) : 0.0));
+		Log(std::format("LoadObjFile: {} {} faces -> {} triangles, {} corners -> {} vertices ({:.1f}% of corners), {} submeshes, {} materials\n",
+			filename, faceCount, triangleCount, cornerCount, modelData.vertices.size(),
+			cornerCount > 0 ? 100.0 * static_cast<double>(modelData.vertices.size()) / static_cast<double>(cornerCount) : 0.0,
+			modelData.subMeshes.size(), modelData.materials.size()));
+		Log(std::format("LoadObjFile: {} vertex cache (FIFO {}) ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}\n",
+			filename, kVertexCacheMeasureSize, cacheBefore.acmr, cacheAfter.acmr, cacheBefore.atvr, cacheAfter.atvr));
+		Log(std::format("LoadObjFile: {} {} meshlets (max {} vertices, {} triangles), {:.1f} vertices, {:.1f} triangles per meshlet\n",
+			filename, modelData.meshlets.size(), kMeshletMaxVertices, kMeshletMaxTriangles,
+			modelData.meshlets.empty() ? 0.0 : static_cast<double>(std::accumulate(modelData.meshlets.begin(), modelData.meshlets.end(), size_t(0),
+				[](size_t sum, const Meshlet& meshlet) { return sum + meshlet.vertexCount; })) / static_cast<double>(modelData.meshlets.size()),
+			modelData.meshlets.empty() ? 0.0 : static_cast<double>(triangleCount) / static_cast<double>(modelData.meshlets.size())));
+		for (size_t level = 1; level < modelData.lods.size(); ++level) {
+			Log(std::format("LoadObjFile: {} LOD{} {} triangles ({:.1f}%), error {:.6f}\n",
+				filename, level, modelData.lods[level].triangleCount,
+				triangleCount > 0 ? 100.0 * static_cast<double>(modelData.lods[level].triangleCount) / static_cast<double>(triangleCount) : 0.0,
+				modelData.lods[level].error));
+		}
+
+		return true;
+	}
+
+	/// *****************************************************
+	///　読んだ後の仕上げ(AABBと頂点の圧縮)
+	/// *****************************************************
+	void FinishModelData(ModelData& modelData, const std::string& filename, const ObjLoadDesc& desc) {
+
+		// AABBを求める
+		modelData.boundsMin = { 0.0f, 0.0f, 0.0f };
+		modelData.boundsMax = { 0.0f, 0.0f, 0.0f };
+		if (!modelData.vertices.empty()) {
+			modelData.boundsMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+			modelData.boundsMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		}
+		for (const VertexData& vertex : modelData.vertices) {
+			modelData.boundsMin.x = std::min(modelData.boundsMin.x, vertex.position.x);
+			modelData.boundsMin.y = std::min(modelData.boundsMin.y, vertex.position.y);
+			modelData.boundsMin.z = std::min(modelData.boundsMin.z, vertex.position.z);
+			modelData.boundsMax.x = std::max(modelData.boundsMax.x, vertex.position.x);
+			modelData.boundsMax.y = std::max(modelData.boundsMax.y, vertex.position.y);
+			modelData.boundsMax.z = std::max(modelData.boundsMax.z, vertex.position.z);
+		}
+
+		// 頂点を圧縮して、サイズと誤差をログに出す
+		if (desc.packVertices) {
+			VertexPackingError error = PackVertices(modelData);
+			Log(std::format("LoadObjFile: {} packed vertices {} -> {} bytes/vertex ({:.1f}KB -> {:.1f}KB), "
+				"position error max {:.6g} ({:.4f}% of bounds), normal error max {:.4f}deg mean {:.4f}deg, texcoord error max {:.6g}\n",
+				filename, sizeof(VertexData), sizeof(PackedVertexData),
+				static_cast<double>(sizeof(VertexData) * modelData.vertices.size()) / 1024.0,
+				static_cast<double>(sizeof(PackedVertexData) * modelData.packedVertices.size()) / 1024.0,
+				error.maxPositionError, error.maxPositionErrorRatio * 100.0f, error.maxNormalErrorDegrees, error.meanNormalErrorDegrees,
+				error.maxTexcoordError));
+		}
+	}
+}
+
+/// *****************************************************
+///　Objファイルを読む関数
+/// *****************************************************
+bool LoadObjFile(const std::string& directoryPath, const std::string& filename, ModelData& modelData, const ObjLoadDesc& desc) {
+
+	// ファイルを開く。行ごとにコピーせず、マップしたメモリをそのまま読む
+	MappedFile file;
+	if (!file.Open(directoryPath + "/" + filename)) {
+		Log(std::format("LoadObjFile: failed to open {}/{}\n", directoryPath, filename));
+		modelData = {};
+		return false;
+	}
+
+	if (!desc.useCache) {
+		if (!ParseObj(file, directoryPath, filename, desc, modelData)) {
+			return false;
+		}
+		FinishModelData(modelData, filename, desc);
+		return true;
+	}
+
+	// 元ファイルのハッシュが一致するキャッシュがあれば、解析せずにそちらを使う
+	auto startTime = std::chrono::steady_clock::now();
+	uint64_t sourceHash = HashBytes(file.GetData(), file.GetSize());
+	// 並べ替えやLODの有無でキャッシュの中身が変わるので、設定ごとに別のファイルにしてヘッダでも確かめる
+	uint32_t processingFlags = (desc.optimizeMesh ? 1u : 0u) | (desc.buildLods ? 2u : 0u);
+	std::string cachePath = std::format("{}/{}.{}.meshcache", directoryPath, filename, processingFlags);
+
+	if (LoadMeshCache(cachePath, directoryPath, sourceHash, file.GetSize(), processingFlags, modelData)) {
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+		Log(std::format("LoadObjFile: {} loaded from cache {:.3f}ms ({} vertices, {} indices)\n",
+			filename, milliseconds, modelData.vertices.size(), modelData.indices.size()));
+		FinishModelData(modelData, filename, desc);
+		return true;
+	}
+
+	// 無いか古ければ解析して、次回のためにキャッシュを書き出す。壊れたファイルはキャッシュしない
+	if (!ParseObj(file, directoryPath, filename, desc, modelData)) {
+		return false;
+	}
+	if (!SaveMeshCache(cachePath, directoryPath, sourceHash, file.GetSize(), processingFlags, modelData)) {
+		Log(std::format("LoadObjFile: failed to write {}\n", cachePath));
+	}
+	FinishModelData(modelData, filename, desc);
+	return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "ModelData.h"
+
+/// <summary>
+/// Objファイルの読み込み設定
+/// </summary>
+struct ObjLoadDesc final {
+	// 解析に使うスレッド数。0ならハードウェアのスレッド数、1なら呼び出したスレッドだけで読む
+	uint32_t threadCount = 1;
+
+	// 解析結果をバイナリのキャッシュ(ファイル名.設定.meshcache)に書き出し、次回以降はそちらを読む
+	bool useCache = true;
+
+	// verticesに加えて、圧縮した頂点(PackedVertexData)をpackedVerticesに作る
+	bool packVertices = false;
+
+	// 頂点キャッシュに乗るように三角形と頂点を並べ替える(OptimizeMesh)
+	bool optimizeMesh = true;
+
+	// 三角形を減らしたLODを作る(BuildLods)。falseならlodsは元のメッシュの0段目だけになる
+	bool buildLods = true;
+};
+
+/// <summary>
+/// Objファイルを読む
+/// </summary>
+/// <param name="directoryPath">ディレクトリパス</param>
+/// <param name="filename">ファイル名</param>
+/// <param name="modelData">構築したModelData。失敗した時は空にする</param>
+/// <param name="desc">読み込み設定。スレッド数によらず結果は同じになる</param>
+/// <returns>ファイルが開けない、または面が範囲外の番号を参照していればfalse。理由はログに出す</returns>
+bool LoadObjFile(const std::string& directoryPath, const std::string& filename, ModelData& modelData, const ObjLoadDesc& desc = {});
@@ -27,4 +27,29 @@ VertexShaderOutput main(VertexShaderInput input) {
     output.texcood = input.texcoord;
     output.normal = normalize(mul(input.normal, (float3x3) gTransformationMatrix.World));
     return output;
-}
\ No newline at end of file
+}
+
+/// ******************************
+/// 圧縮した頂点(PackedVertexData)用
+/// ******************************
+struct PackedVertexShaderInput {
+    float4 position : POSITION0; // R16G16B16A16_UNORM。AABBの中の[0,1]。元に戻す変換はWVPに掛けてある
+    float2 texcoord : TEXCOORD0; // R16G16_FLOAT
+    float2 normal : NORMAL0; // R16G16_SNORM。八面体に展開した法線
+};
+
+// 八面体に展開した法線を戻す。VertexPacking.cppのDecodeOctahedralNormalと同じ計算
+float3 DecodeOctahedralNormal(float2 encoded) {
+    float3 normal = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0f);
+    normal.xy += lerp(t, -t, step(0.0f, normal.xy));
+    return normalize(normal);
+}
+
+VertexShaderOutput mainPacked(PackedVertexShaderInput input) {
+    VertexShaderOutput output;
+    output.position = mul(input.position, gTransformationMatrix.WVP);
+    output.texcood = input.texcoord;
+    output.normal = normalize(mul(DecodeOctahedralNormal(input.normal), (float3x3) gTransformationMatrix.World));
+    return output;
+}
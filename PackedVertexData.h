@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// 圧縮した頂点データ(16byte)
+/// </summary>
+struct PackedVertexData final {
+	uint16_t position[4]; // AABBに対して16bitに量子化した位置(UNORM)。wは常に1
+	uint16_t texcoord[2]; // 半精度浮動小数点数のUV
+	int16_t normal[2]; // 八面体に展開した法線(SNORM)
+};
@@ -0,0 +1,10 @@
+#pragma once
+/// <summary>
+/// クォータニオン(xyzが虚部、wが実部)。回転は単位クォータニオンで表す
+/// </summary>
+struct Quaternion final {
+	float x;
+	float y;
+	float z;
+	float w;
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+
+/// <summary>
+/// 多数のクォータニオンを要素ごとの配列に分けたもの(SoA)。全ての配列は同じ長さにする
+/// </summary>
+struct QuaternionArrays final {
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> w;
+};
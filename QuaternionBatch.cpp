@@ -0,0 +1,174 @@
+#include "QuaternionBatch.h"
+#include "SimdConfig.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace {
+
+	// Slerpに近づけるための補正係数(dはfromとtoの内積の絶対値)
+	// 補間の両端と中央では誤差が出ないので、(t-0.5)^2の放物線でずらす
+	constexpr float kSlerpA0 = 1.0904f;
+	constexpr float kSlerpA1 = -3.2452f;
+	constexpr float kSlerpA2 = 3.55645f;
+	constexpr float kSlerpA3 = -1.43519f;
+	constexpr float kSlerpB0 = 0.848013f;
+	constexpr float kSlerpB1 = -1.06021f;
+	constexpr float kSlerpB2 = 0.215638f;
+
+	void AssertSameCount(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, const QuaternionArrays& result) {
+		size_t count = from.x.size();
+		assert(from.y.size() == count && from.z.size() == count && from.w.size() == count);
+		assert(to.x.size() == count && to.y.size() == count && to.z.size() == count && to.w.size() == count);
+		assert(result.x.size() == count && result.y.size() == count && result.z.size() == count && result.w.size() == count);
+		assert(t.size() == count);
+		(void)from; (void)to; (void)t; (void)result; (void)count;
+	}
+
+	/// *****************************************************
+	/// 1つずつ計算する(SIMDが使えない時と、4つに満たない端数)
+	/// *****************************************************
+	// 近い方の向きで線形補間して正規化する
+	void NlerpScalar(const QuaternionArrays& from, const QuaternionArrays& to, float t, size_t index, QuaternionArrays& result) {
+		float x0 = from.x[index], y0 = from.y[index], z0 = from.z[index], w0 = from.w[index];
+		float x1 = to.x[index], y1 = to.y[index], z1 = to.z[index], w1 = to.w[index];
+		float dot = x0 * x1 + y0 * y1 + z0 * z1 + w0 * w1;
+		if (dot < 0.0f) {
+			x1 = -x1; y1 = -y1; z1 = -z1; w1 = -w1;
+		}
+
+		float x = x0 + (x1 - x0) * t;
+		float y = y0 + (y1 - y0) * t;
+		float z = z0 + (z1 - z0) * t;
+		float w = w0 + (w1 - w0) * t;
+		float invLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+		result.x[index] = x * invLength;
+		result.y[index] = y * invLength;
+		result.z[index] = z * invLength;
+		result.w[index] = w * invLength;
+	}
+
+	// Slerpの角速度に合うようにtを補正する
+	float CorrectSlerpT(float dot, float t) {
+		float d = std::fabs(dot);
+		float a = kSlerpA0 + d * (kSlerpA1 + d * (kSlerpA2 + d * kSlerpA3));
+		float b = kSlerpB0 + d * (kSlerpB1 + d * kSlerpB2);
+		float centered = t - 0.5f;
+		float k = a * centered * centered + b;
+		return t + t * centered * (t - 1.0f) * k;
+	}
+
+#if MYMATH_USE_SIMD
+	// 4つずつ補間する。correctSlerpの時はtを補正する。スカラー版と同じ式を同じ順番で計算する
+	template<bool correctSlerp>
+	size_t InterpolateSimd(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, QuaternionArrays& result) {
+		size_t count = from.x.size();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+
+		size_t index = 0;
+		for (; index + 4 <= count; index += 4) {
+			__m128 x0 = _mm_loadu_ps(from.x.data() + index), y0 = _mm_loadu_ps(from.y.data() + index);
+			__m128 z0 = _mm_loadu_ps(from.z.data() + index), w0 = _mm_loadu_ps(from.w.data() + index);
+			__m128 x1 = _mm_loadu_ps(to.x.data() + index), y1 = _mm_loadu_ps(to.y.data() + index);
+			__m128 z1 = _mm_loadu_ps(to.z.data() + index), w1 = _mm_loadu_ps(to.w.data() + index);
+			__m128 factor = _mm_loadu_ps(t.data() + index);
+
+			__m128 dot = _mm_mul_ps(x0, x1);
+			dot = _mm_add_ps(dot, _mm_mul_ps(y0, y1));
+			dot = _mm_add_ps(dot, _mm_mul_ps(z0, z1));
+			dot = _mm_add_ps(dot, _mm_mul_ps(w0, w1));
+
+			// 内積が負の時は符号を反転する(符号ビットだけを取り出してxorする)
+			__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signBit);
+			x1 = _mm_xor_ps(x1, flip);
+			y1 = _mm_xor_ps(y1, flip);
+			z1 = _mm_xor_ps(z1, flip);
+			w1 = _mm_xor_ps(w1, flip);
+
+			if constexpr (correctSlerp) {
+				__m128 d = _mm_andnot_ps(signBit, dot);
+				__m128 a = _mm_add_ps(_mm_set1_ps(kSlerpA2), _mm_mul_ps(d, _mm_set1_ps(kSlerpA3)));
+				a = _mm_add_ps(_mm_set1_ps(kSlerpA1), _mm_mul_ps(d, a));
+				a = _mm_add_ps(_mm_set1_ps(kSlerpA0), _mm_mul_ps(d, a));
+				__m128 b = _mm_add_ps(_mm_set1_ps(kSlerpB1), _mm_mul_ps(d, _mm_set1_ps(kSlerpB2)));
+				b = _mm_add_ps(_mm_set1_ps(kSlerpB0), _mm_mul_ps(d, b));
+				__m128 centered = _mm_sub_ps(factor, half);
+				__m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(a, centered), centered), b);
+				factor = _mm_add_ps(factor, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(factor, centered), _mm_sub_ps(factor, one)), k));
+			}
+
+			__m128 x = _mm_add_ps(x0, _mm_mul_ps(_mm_sub_ps(x1, x0), factor));
+			__m128 y = _mm_add_ps(y0, _mm_mul_ps(_mm_sub_ps(y1, y0), factor));
+			__m128 z = _mm_add_ps(z0, _mm_mul_ps(_mm_sub_ps(z1, z0), factor));
+			__m128 w = _mm_add_ps(w0, _mm_mul_ps(_mm_sub_ps(w1, w0), factor));
+
+			// rsqrtは精度が足りないので、sqrtと割り算を使う
+			__m128 lengthSquared = _mm_mul_ps(x, x);
+			lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(y, y));
+			lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(z, z));
+			lengthSquared = _mm_add_ps(lengthSquared, _mm_mul_ps(w, w));
+			__m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+			_mm_storeu_ps(result.x.data() + index, _mm_mul_ps(x, invLength));
+			_mm_storeu_ps(result.y.data() + index, _mm_mul_ps(y, invLength));
+			_mm_storeu_ps(result.z.data() + index, _mm_mul_ps(z, invLength));
+			_mm_storeu_ps(result.w.data() + index, _mm_mul_ps(w, invLength));
+		}
+		return index;
+	}
+#endif
+}
+
+/// *****************************************************
+/// SoAのクォータニオンを扱う
+/// *****************************************************
+void ResizeQuaternionArrays(QuaternionArrays& quaternions, size_t count) {
+	quaternions.x.resize(count, 0.0f);
+	quaternions.y.resize(count, 0.0f);
+	quaternions.z.resize(count, 0.0f);
+	quaternions.w.resize(count, 1.0f);
+}
+
+void SetQuaternion(QuaternionArrays& quaternions, size_t index, const Quaternion& quaternion) {
+	quaternions.x[index] = quaternion.x;
+	quaternions.y[index] = quaternion.y;
+	quaternions.z[index] = quaternion.z;
+	quaternions.w[index] = quaternion.w;
+}
+
+Quaternion GetQuaternion(const QuaternionArrays& quaternions, size_t index) {
+	return { quaternions.x[index], quaternions.y[index], quaternions.z[index], quaternions.w[index] };
+}
+
+/// *****************************************************
+/// まとめて補間する
+/// *****************************************************
+void NlerpQuaternions(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, QuaternionArrays& result) {
+	AssertSameCount(from, to, t, result);
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	index = InterpolateSimd<false>(from, to, t, result);
+#endif
+
+	// 端数
+	for (; index < from.x.size(); ++index) {
+		NlerpScalar(from, to, t[index], index, result);
+	}
+}
+
+void SlerpQuaternions(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, QuaternionArrays& result) {
+	AssertSameCount(from, to, t, result);
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	index = InterpolateSimd<true>(from, to, t, result);
+#endif
+
+	// 端数
+	for (; index < from.x.size(); ++index) {
+		float dot = from.x[index] * to.x[index] + from.y[index] * to.y[index] + from.z[index] * to.z[index] + from.w[index] * to.w[index];
+		NlerpScalar(from, to, CorrectSlerpT(dot, t[index]), index, result);
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Quaternion.h"
+#include "QuaternionArrays.h"
+
+/// <summary>
+/// 全ての配列の長さをそろえる。増えた分は単位クォータニオンにする
+/// </summary>
+/// <param name="quaternions">SoAのクォータニオン</param>
+/// <param name="count">数</param>
+void ResizeQuaternionArrays(QuaternionArrays& quaternions, size_t count);
+
+/// <summary>
+/// index番目のクォータニオンを書き込む
+/// </summary>
+void SetQuaternion(QuaternionArrays& quaternions, size_t index, const Quaternion& quaternion);
+
+/// <summary>
+/// index番目のクォータニオンを読み出す
+/// </summary>
+Quaternion GetQuaternion(const QuaternionArrays& quaternions, size_t index);
+
+/// <summary>
+/// N個の正規化線形補間をまとめて行う。1つずつのNlerpと同じ結果になる
+/// </summary>
+/// <param name="from">補間の始まり(単位クォータニオン)</param>
+/// <param name="to">補間の終わり(単位クォータニオン)</param>
+/// <param name="t">0から1の補間係数</param>
+/// <param name="result">書き込み先。fromと同じ数にしておく。fromやtoと同じものを渡してよい</param>
+void NlerpQuaternions(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, QuaternionArrays& result);
+
+/// <summary>
+/// N個の球面線形補間をまとめて行う
+/// acosやsinを呼ばずに、tを多項式で補正してからNlerpすることで近似する。角度の誤差は1e-3ラジアン程度
+/// </summary>
+/// <param name="from">補間の始まり(単位クォータニオン)</param>
+/// <param name="to">補間の終わり(単位クォータニオン)</param>
+/// <param name="t">0から1の補間係数</param>
+/// <param name="result">書き込み先。fromと同じ数にしておく。fromやtoと同じものを渡してよい</param>
+void SlerpQuaternions(const QuaternionArrays& from, const QuaternionArrays& to, const std::vector<float>& t, QuaternionArrays& result);
@@ -0,0 +1,15 @@
+#pragma once
+
+// 計算にSIMDを使うか。0を定義しておけば、スカラー版だけでビルドできる
+// AVXが使える設定(/arch:AVX以上)ならAVX、それ以外はSSEで計算する
+#if !defined(MYMATH_USE_SIMD)
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MYMATH_USE_SIMD 1
+#else
+#define MYMATH_USE_SIMD 0
+#endif
+#endif
+
+#if MYMATH_USE_SIMD
+#include <immintrin.h>
+#endif
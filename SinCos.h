@@ -0,0 +1,186 @@
+#pragma once
+#include "SimdConfig.h"
+#include "Vector3.h"
+
+#include <cmath>
+
+// sinとcosを多項式で近似して一度に求める。libmのsin/cosを別々に呼ぶより速く、SIMDで4つ(AVXなら8つ)ずつ計算できる
+// 角度をπ/2の何倍か(象限)と[-π/4, π/4]の余りに分け、余りのsinとcosを多項式で求めてから象限に合わせて入れ替える
+// 同じ精度ならスカラー版とSIMD版の結果は一致する(FMAを使わず、同じ式を同じ順番で計算する)
+
+/// <summary>
+/// sin/cosの近似の精度
+/// </summary>
+enum class SinCosPrecision {
+	Fast,    // 最大誤差 約1.3e-5。5次と4次の多項式
+	Precise, // 最大誤差 約1e-7(floatの丸め誤差と同じくらい)。7次と8次の多項式
+};
+
+// 2/π
+constexpr float kSinCosTwoOverPi = 0.636619772f;
+
+// π/2を3つに分けたもの。象限の数を掛けても丸めないように、上の桁から順に引く
+constexpr float kSinCosPiOver2A = 1.5703125f;
+constexpr float kSinCosPiOver2B = 4.837512969970703125e-4f;
+constexpr float kSinCosPiOver2C = 7.54978995489188216e-8f;
+
+// [-π/4, π/4]での近似の係数。FastはRemez法で求めたミニマックス近似、PreciseはCephesのsinf/cosfと同じ
+constexpr float kSinFast1 = -0.166628338f;
+constexpr float kSinFast2 = 0.00815299234f;
+constexpr float kCosFast1 = -0.499776307f;
+constexpr float kCosFast2 = 0.0404889358f;
+constexpr float kSinPrecise1 = -1.6666654611e-1f;
+constexpr float kSinPrecise2 = 8.3321608736e-3f;
+constexpr float kSinPrecise3 = -1.9515295891e-4f;
+constexpr float kCosPrecise1 = -0.5f;
+constexpr float kCosPrecise2 = 4.166664568298827e-2f;
+constexpr float kCosPrecise3 = -1.388731625493765e-3f;
+constexpr float kCosPrecise4 = 2.443315711809948e-5f;
+
+#if MYMATH_USE_SIMD
+/// <summary>
+/// 4つのsinとcosを一度に求める。各要素はSIMDを使わないスカラー版と同じ結果になる
+/// </summary>
+inline void SinCos(__m128 radian, __m128& sinValue, __m128& cosValue, SinCosPrecision precision = SinCosPrecision::Precise) {
+	// 象限と余り。cvtps_epi32は最も近い整数(偶数丸め)にするので、スカラー版のnearbyintと同じ
+	__m128i quadrantInt = _mm_cvtps_epi32(_mm_mul_ps(radian, _mm_set1_ps(kSinCosTwoOverPi)));
+	__m128 quadrant = _mm_cvtepi32_ps(quadrantInt);
+	__m128 r = _mm_sub_ps(radian, _mm_mul_ps(quadrant, _mm_set1_ps(kSinCosPiOver2A)));
+	r = _mm_sub_ps(r, _mm_mul_ps(quadrant, _mm_set1_ps(kSinCosPiOver2B)));
+	r = _mm_sub_ps(r, _mm_mul_ps(quadrant, _mm_set1_ps(kSinCosPiOver2C)));
+	__m128 r2 = _mm_mul_ps(r, r);
+
+	__m128 sinR, cosR;
+	if (precision == SinCosPrecision::Fast) {
+		sinR = _mm_add_ps(_mm_set1_ps(kSinFast1), _mm_mul_ps(r2, _mm_set1_ps(kSinFast2)));
+		cosR = _mm_add_ps(_mm_set1_ps(kCosFast1), _mm_mul_ps(r2, _mm_set1_ps(kCosFast2)));
+	} else {
+		sinR = _mm_add_ps(_mm_set1_ps(kSinPrecise2), _mm_mul_ps(r2, _mm_set1_ps(kSinPrecise3)));
+		sinR = _mm_add_ps(_mm_set1_ps(kSinPrecise1), _mm_mul_ps(r2, sinR));
+		cosR = _mm_add_ps(_mm_set1_ps(kCosPrecise3), _mm_mul_ps(r2, _mm_set1_ps(kCosPrecise4)));
+		cosR = _mm_add_ps(_mm_set1_ps(kCosPrecise2), _mm_mul_ps(r2, cosR));
+		cosR = _mm_add_ps(_mm_set1_ps(kCosPrecise1), _mm_mul_ps(r2, cosR));
+	}
+	sinR = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sinR));
+	cosR = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, cosR));
+
+	// 奇数の象限ではsinとcosを入れ替え、符号ビットを象限に合わせて反転する
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrantInt, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 swappedSin = _mm_or_ps(_mm_and_ps(swap, cosR), _mm_andnot_ps(swap, sinR));
+	__m128 swappedCos = _mm_or_ps(_mm_and_ps(swap, sinR), _mm_andnot_ps(swap, cosR));
+	__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrantInt, _mm_set1_epi32(2)), 30));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrantInt, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+	sinValue = _mm_xor_ps(swappedSin, sinSign);
+	cosValue = _mm_xor_ps(swappedCos, cosSign);
+}
+#endif
+
+#if MYMATH_USE_SIMD && defined(__AVX__)
+/// <summary>
+/// 8つのsinとcosを一度に求める。AVXには整数の演算が無いので、象限の判定は浮動小数のまま行う
+/// </summary>
+inline void SinCos(__m256 radian, __m256& sinValue, __m256& cosValue, SinCosPrecision precision = SinCosPrecision::Precise) {
+	__m256 quadrant = _mm256_round_ps(_mm256_mul_ps(radian, _mm256_set1_ps(kSinCosTwoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256 r = _mm256_sub_ps(radian, _mm256_mul_ps(quadrant, _mm256_set1_ps(kSinCosPiOver2A)));
+	r = _mm256_sub_ps(r, _mm256_mul_ps(quadrant, _mm256_set1_ps(kSinCosPiOver2B)));
+	r = _mm256_sub_ps(r, _mm256_mul_ps(quadrant, _mm256_set1_ps(kSinCosPiOver2C)));
+	__m256 r2 = _mm256_mul_ps(r, r);
+
+	__m256 sinR, cosR;
+	if (precision == SinCosPrecision::Fast) {
+		sinR = _mm256_add_ps(_mm256_set1_ps(kSinFast1), _mm256_mul_ps(r2, _mm256_set1_ps(kSinFast2)));
+		cosR = _mm256_add_ps(_mm256_set1_ps(kCosFast1), _mm256_mul_ps(r2, _mm256_set1_ps(kCosFast2)));
+	} else {
+		sinR = _mm256_add_ps(_mm256_set1_ps(kSinPrecise2), _mm256_mul_ps(r2, _mm256_set1_ps(kSinPrecise3)));
+		sinR = _mm256_add_ps(_mm256_set1_ps(kSinPrecise1), _mm256_mul_ps(r2, sinR));
+		cosR = _mm256_add_ps(_mm256_set1_ps(kCosPrecise3), _mm256_mul_ps(r2, _mm256_set1_ps(kCosPrecise4)));
+		cosR = _mm256_add_ps(_mm256_set1_ps(kCosPrecise2), _mm256_mul_ps(r2, cosR));
+		cosR = _mm256_add_ps(_mm256_set1_ps(kCosPrecise1), _mm256_mul_ps(r2, cosR));
+	}
+	sinR = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), sinR));
+	cosR = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r2, cosR));
+
+	// 象限を4で割った余り(0から3)
+	__m256 index = _mm256_sub_ps(quadrant, _mm256_mul_ps(_mm256_floor_ps(_mm256_mul_ps(quadrant, _mm256_set1_ps(0.25f))), _mm256_set1_ps(4.0f)));
+	__m256 one = _mm256_set1_ps(1.0f);
+	__m256 two = _mm256_set1_ps(2.0f);
+	__m256 three = _mm256_set1_ps(3.0f);
+	__m256 signBit = _mm256_set1_ps(-0.0f);
+	__m256 swap = _mm256_or_ps(_mm256_cmp_ps(index, one, _CMP_EQ_OQ), _mm256_cmp_ps(index, three, _CMP_EQ_OQ));
+	__m256 swappedSin = _mm256_or_ps(_mm256_and_ps(swap, cosR), _mm256_andnot_ps(swap, sinR));
+	__m256 swappedCos = _mm256_or_ps(_mm256_and_ps(swap, sinR), _mm256_andnot_ps(swap, cosR));
+	__m256 sinSign = _mm256_and_ps(_mm256_cmp_ps(index, two, _CMP_GE_OQ), signBit);
+	__m256 cosSign = _mm256_and_ps(_mm256_or_ps(_mm256_cmp_ps(index, one, _CMP_EQ_OQ), _mm256_cmp_ps(index, two, _CMP_EQ_OQ)), signBit);
+	sinValue = _mm256_xor_ps(swappedSin, sinSign);
+	cosValue = _mm256_xor_ps(swappedCos, cosSign);
+}
+#endif
+
+// 余りを求める引き算は順番を変えると精度が落ちるので、/fp:fastでもこの関数は式の通りに計算させる
+#if defined(_MSC_VER)
+#pragma float_control(precise, on, push)
+#endif
+
+/// <summary>
+/// sinとcosを一度に求める
+/// </summary>
+/// <param name="radian">角度(ラジアン)。±数千ラジアンまでは精度が落ちない。NaNや無限大ならNaNを返す</param>
+/// <param name="sinValue">sinの書き込み先</param>
+/// <param name="cosValue">cosの書き込み先</param>
+/// <param name="precision">精度</param>
+inline void SinCos(float radian, float& sinValue, float& cosValue, SinCosPrecision precision = SinCosPrecision::Precise) {
+	// 象限と余り。nearbyintは既定の丸め方(最も近い整数、偶数丸め)なのでcvtps_epi32と同じになる
+	// 足して引く丸めは/fp:fastで消されることがあるので使わない
+	float quadrant = std::nearbyint(radian * kSinCosTwoOverPi);
+
+	// 象限がintに入らない(NaN、無限大、とても大きい角度)とキャストが未定義になる。そこまで大きいと近似の意味も無いのでlibmに任せる
+	constexpr float kMaxQuadrant = 2147483648.0f; // 2^31
+	if (!(std::fabs(quadrant) < kMaxQuadrant)) {
+		sinValue = std::sin(radian);
+		cosValue = std::cos(radian);
+		return;
+	}
+
+	float r = ((radian - quadrant * kSinCosPiOver2A) - quadrant * kSinCosPiOver2B) - quadrant * kSinCosPiOver2C;
+	float r2 = r * r;
+
+	float sinR, cosR;
+	if (precision == SinCosPrecision::Fast) {
+		sinR = r + r * r2 * (kSinFast1 + r2 * kSinFast2);
+		cosR = 1.0f + r2 * (kCosFast1 + r2 * kCosFast2);
+	} else {
+		sinR = r + r * r2 * (kSinPrecise1 + r2 * (kSinPrecise2 + r2 * kSinPrecise3));
+		cosR = 1.0f + r2 * (kCosPrecise1 + r2 * (kCosPrecise2 + r2 * (kCosPrecise3 + r2 * kCosPrecise4)));
+	}
+
+	// 象限(0から3)ごとに、sin = (sinR, cosR, -sinR, -cosR)、cos = (cosR, -sinR, -cosR, sinR)
+	// 角度がばらばらだと分岐の予測が外れるので、配列の添え字と±1の掛け算で選ぶ
+	int index = static_cast<int>(quadrant) & 3;
+	const float values[2] = { sinR, cosR };
+	sinValue = values[index & 1] * static_cast<float>(1 - (index & 2));
+	cosValue = values[(index & 1) ^ 1] * static_cast<float>(1 - ((index + 1) & 2));
+}
+
+#if defined(_MSC_VER)
+#pragma float_control(pop)
+#endif
+
+/// <summary>
+/// オイラー角の3軸のsinとcosを一度に求める
+/// </summary>
+inline void SinCos(const Vector3& radian, Vector3& sinValue, Vector3& cosValue, SinCosPrecision precision = SinCosPrecision::Precise) {
+#if MYMATH_USE_SIMD
+	__m128 sinValues, cosValues;
+	SinCos(_mm_setr_ps(radian.x, radian.y, radian.z, 0.0f), sinValues, cosValues, precision);
+	alignas(16) float sinArray[4];
+	alignas(16) float cosArray[4];
+	_mm_store_ps(sinArray, sinValues);
+	_mm_store_ps(cosArray, cosValues);
+	sinValue = { sinArray[0], sinArray[1], sinArray[2] };
+	cosValue = { cosArray[0], cosArray[1], cosArray[2] };
+#else
+	SinCos(radian.x, sinValue.x, cosValue.x, precision);
+	SinCos(radian.y, sinValue.y, cosValue.y, precision);
+	SinCos(radian.z, sinValue.z, cosValue.z, precision);
+#endif
+}
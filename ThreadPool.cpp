@@ -0,0 +1,66 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <latch>
+
+ThreadPool::ThreadPool(uint32_t threadCount) {
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	threads_.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i) {
+		threads_.emplace_back(&ThreadPool::WorkerMain, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		isStopping_ = true;
+	}
+	taskCondition_.notify_all();
+
+	// 積まれているタスクを全て処理してから終わる
+	for (std::thread& thread : threads_) {
+		thread.join();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		tasks_.push_back(std::move(task));
+	}
+	taskCondition_.notify_one();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& function) {
+	if (count == 0) {
+		return;
+	}
+
+	std::latch done(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		Enqueue([&function, &done, i]() {
+			function(i);
+			done.count_down();
+		});
+	}
+	done.wait();
+}
+
+void ThreadPool::WorkerMain() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			taskCondition_.wait(lock, [this]() { return isStopping_ || !tasks_.empty(); });
+			if (tasks_.empty()) {
+				return; // 終了要求が来ていて、残りのタスクもない
+			}
+			task = std::move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// ワーカースレッドを使い回してタスクを処理する
+/// </summary>
+class ThreadPool final {
+public:
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="threadCount">スレッド数。0ならハードウェアのスレッド数</param>
+	explicit ThreadPool(uint32_t threadCount = 0);
+	~ThreadPool();
+
+	// コピー禁止
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// <summary>
+	/// タスクを積む
+	/// </summary>
+	/// <param name="task">ワーカースレッドで実行する処理</param>
+	void Enqueue(std::function<void()> task);
+
+	/// <summary>
+	/// [0, count)の各番号で関数を並列に呼び、全て終わるまで待つ
+	/// </summary>
+	/// <param name="count">呼び出す回数</param>
+	/// <param name="function">番号を受け取る関数</param>
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& function);
+
+	// スレッド数
+	uint32_t GetThreadCount() const { return static_cast<uint32_t>(threads_.size()); }
+
+private:
+	// ワーカースレッドの処理
+	void WorkerMain();
+
+	std::vector<std::thread> threads_;
+	std::deque<std::function<void()>> tasks_;
+	std::mutex mutex_;
+	std::condition_variable taskCondition_;
+	bool isStopping_ = false;
+};
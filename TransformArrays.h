@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+
+/// <summary>
+/// 多数のTransform(拡縮、回転、平行移動)を要素ごとの配列に分けたもの(SoA)
+/// 同じ要素が並ぶので、SIMDで4つずつまとめて読める。全ての配列は同じ長さにする
+/// </summary>
+struct TransformArrays final {
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+	std::vector<float> rotateX; // ラジアン
+	std::vector<float> rotateY;
+	std::vector<float> rotateZ;
+	std::vector<float> translateX;
+	std::vector<float> translateY;
+	std::vector<float> translateZ;
+};
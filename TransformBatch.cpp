@@ -0,0 +1,253 @@
+#include "TransformBatch.h"
+#include "SimdConfig.h"
+#include "SinCos.h"
+
+#include <cassert>
+
+namespace {
+
+	// 1つ分の書き込み先
+	TransformationMatrix* OutputAt(TransformationMatrix* output, size_t outputStride, size_t index) {
+		return reinterpret_cast<TransformationMatrix*>(reinterpret_cast<char*>(output) + index * outputStride);
+	}
+
+	/// *****************************************************
+	/// 1つずつ計算する(SIMDが使えない時と、4つに満たない端数)
+	/// *****************************************************
+	// World*VPを求めて、Worldと一緒に書き込む。Worldの4列目は(0,0,0,1)なので、0を掛ける項を省く
+	void WriteTransformScalar(const Matrix4x4& world, const Matrix4x4& viewProjection, TransformationMatrix& output) {
+		Matrix4x4 wvp;
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				float value = world.m[row][0] * viewProjection.m[0][column] + world.m[row][1] * viewProjection.m[1][column] + world.m[row][2] * viewProjection.m[2][column];
+				wvp.m[row][column] = row == 3 ? value + viewProjection.m[3][column] : value;
+			}
+		}
+		output.WVP = wvp;
+		output.World = world;
+	}
+
+	void ComputeTransformScalar(const TransformArrays& transforms, size_t index, const Matrix4x4& viewProjection, SinCosPrecision precision, TransformationMatrix& output) {
+		Vector3 sinRotate, cosRotate;
+		SinCos(Vector3{ transforms.rotateX[index], transforms.rotateY[index], transforms.rotateZ[index] }, sinRotate, cosRotate, precision);
+		float sinX = sinRotate.x, cosX = cosRotate.x;
+		float sinY = sinRotate.y, cosY = cosRotate.y;
+		float sinZ = sinRotate.z, cosZ = cosRotate.z;
+
+		// Rx*Ry*Rzの3x3部分に、行ごとの拡縮を掛ける
+		float scaleX = transforms.scaleX[index], scaleY = transforms.scaleY[index], scaleZ = transforms.scaleZ[index];
+		Matrix4x4 world = { {
+			{ (cosY * cosZ) * scaleX, (cosY * sinZ) * scaleX, (-sinY) * scaleX, 0.0f },
+			{ (sinX * sinY * cosZ - cosX * sinZ) * scaleY, (sinX * sinY * sinZ + cosX * cosZ) * scaleY, (sinX * cosY) * scaleY, 0.0f },
+			{ (cosX * sinY * cosZ + sinX * sinZ) * scaleZ, (cosX * sinY * sinZ - sinX * cosZ) * scaleZ, (cosX * cosY) * scaleZ, 0.0f },
+			{ transforms.translateX[index], transforms.translateY[index], transforms.translateZ[index], 1.0f } } };
+
+		WriteTransformScalar(world, viewProjection, output);
+	}
+
+	// 回転をクォータニオンで持つ場合。MakeRotateMatrix(Quaternion)の各行に拡縮を掛ける
+	void ComputeTransformScalar(const TransformArrays& transforms, const QuaternionArrays& rotations, size_t index, const Matrix4x4& viewProjection, TransformationMatrix& output) {
+		float x = rotations.x[index], y = rotations.y[index], z = rotations.z[index], w = rotations.w[index];
+		float scaleX = transforms.scaleX[index], scaleY = transforms.scaleY[index], scaleZ = transforms.scaleZ[index];
+		Matrix4x4 world = { {
+			{ (1.0f - 2.0f * (y * y + z * z)) * scaleX, (2.0f * (x * y + w * z)) * scaleX, (2.0f * (x * z - w * y)) * scaleX, 0.0f },
+			{ (2.0f * (x * y - w * z)) * scaleY, (1.0f - 2.0f * (x * x + z * z)) * scaleY, (2.0f * (y * z + w * x)) * scaleY, 0.0f },
+			{ (2.0f * (x * z + w * y)) * scaleZ, (2.0f * (y * z - w * x)) * scaleZ, (1.0f - 2.0f * (x * x + y * y)) * scaleZ, 0.0f },
+			{ transforms.translateX[index], transforms.translateY[index], transforms.translateZ[index], 1.0f } } };
+
+		WriteTransformScalar(world, viewProjection, output);
+	}
+
+#if MYMATH_USE_SIMD
+	// 4つのオブジェクトの同じ行(要素ごとのレジスタ4本)を、オブジェクトごとの行に並べ替えて書く
+	void StoreRows(__m128 x, __m128 y, __m128 z, __m128 w, float* row0, float* row1, float* row2, float* row3) {
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(row0, x);
+		_mm_storeu_ps(row1, y);
+		_mm_storeu_ps(row2, z);
+		_mm_storeu_ps(row3, w);
+	}
+
+	// VPの各要素を4つに並べる
+	void BroadcastMatrix(const Matrix4x4& matrix, __m128 (&result)[4][4]) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				result[row][column] = _mm_set1_ps(matrix.m[row][column]);
+			}
+		}
+	}
+
+	// 4つ分のWorld(3列目まで)からWorld*VPを求めて、オブジェクトごとの行に並べ替えて書き込む
+	void WriteTransforms(const __m128 (&world)[4][3], const __m128 (&vp)[4][4], TransformationMatrix* output, size_t outputStride, size_t index) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 wvp[4][4];
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				__m128 value = _mm_mul_ps(world[row][0], vp[0][column]);
+				value = _mm_add_ps(value, _mm_mul_ps(world[row][1], vp[1][column]));
+				value = _mm_add_ps(value, _mm_mul_ps(world[row][2], vp[2][column]));
+				wvp[row][column] = row == 3 ? _mm_add_ps(value, vp[3][column]) : value;
+			}
+		}
+
+		TransformationMatrix* out[4];
+		for (size_t lane = 0; lane < 4; ++lane) {
+			out[lane] = OutputAt(output, outputStride, index + lane);
+		}
+		for (int row = 0; row < 4; ++row) {
+			StoreRows(wvp[row][0], wvp[row][1], wvp[row][2], wvp[row][3],
+				out[0]->WVP.m[row], out[1]->WVP.m[row], out[2]->WVP.m[row], out[3]->WVP.m[row]);
+			StoreRows(world[row][0], world[row][1], world[row][2], row == 3 ? one : zero,
+				out[0]->World.m[row], out[1]->World.m[row], out[2]->World.m[row], out[3]->World.m[row]);
+		}
+	}
+#endif
+}
+
+/// *****************************************************
+/// SoAのTransformを扱う
+/// *****************************************************
+void ResizeTransformArrays(TransformArrays& transforms, size_t count) {
+	transforms.scaleX.resize(count, 1.0f);
+	transforms.scaleY.resize(count, 1.0f);
+	transforms.scaleZ.resize(count, 1.0f);
+	transforms.rotateX.resize(count, 0.0f);
+	transforms.rotateY.resize(count, 0.0f);
+	transforms.rotateZ.resize(count, 0.0f);
+	transforms.translateX.resize(count, 0.0f);
+	transforms.translateY.resize(count, 0.0f);
+	transforms.translateZ.resize(count, 0.0f);
+}
+
+void SetTransform(TransformArrays& transforms, size_t index, const Vector3& scale, const Vector3& rotate, const Vector3& translate) {
+	transforms.scaleX[index] = scale.x;
+	transforms.scaleY[index] = scale.y;
+	transforms.scaleZ[index] = scale.z;
+	transforms.rotateX[index] = rotate.x;
+	transforms.rotateY[index] = rotate.y;
+	transforms.rotateZ[index] = rotate.z;
+	transforms.translateX[index] = translate.x;
+	transforms.translateY[index] = translate.y;
+	transforms.translateZ[index] = translate.z;
+}
+
+/// *****************************************************
+/// まとめて行列を作る
+/// *****************************************************
+void ComputeTransformBatch(const TransformArrays& transforms, const Matrix4x4& viewProjection, TransformationMatrix* output, size_t outputStride, SinCosPrecision precision) {
+	size_t count = transforms.scaleX.size();
+	assert(transforms.scaleY.size() == count && transforms.scaleZ.size() == count);
+	assert(transforms.rotateX.size() == count && transforms.rotateY.size() == count && transforms.rotateZ.size() == count);
+	assert(transforms.translateX.size() == count && transforms.translateY.size() == count && transforms.translateZ.size() == count);
+	assert(outputStride >= sizeof(TransformationMatrix));
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	__m128 vp[4][4];
+	BroadcastMatrix(viewProjection, vp);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	// 4つのオブジェクトを1本のレジスタの4要素に割り当てて、スカラー版と同じ式を同じ順番で計算する
+	for (; index + 4 <= count; index += 4) {
+		// 3軸×4つのsin/cos。AVXならX軸とY軸の8つをまとめて求める
+		__m128 rotateX = _mm_loadu_ps(transforms.rotateX.data() + index);
+		__m128 rotateY = _mm_loadu_ps(transforms.rotateY.data() + index);
+		__m128 rotateZ = _mm_loadu_ps(transforms.rotateZ.data() + index);
+		__m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+#if defined(__AVX__)
+		__m256 sinXY, cosXY;
+		SinCos(_mm256_set_m128(rotateY, rotateX), sinXY, cosXY, precision);
+		sinX = _mm256_castps256_ps128(sinXY);
+		cosX = _mm256_castps256_ps128(cosXY);
+		sinY = _mm256_extractf128_ps(sinXY, 1);
+		cosY = _mm256_extractf128_ps(cosXY, 1);
+#else
+		SinCos(rotateX, sinX, cosX, precision);
+		SinCos(rotateY, sinY, cosY, precision);
+#endif
+		SinCos(rotateZ, sinZ, cosZ, precision);
+		__m128 scaleX = _mm_loadu_ps(transforms.scaleX.data() + index);
+		__m128 scaleY = _mm_loadu_ps(transforms.scaleY.data() + index);
+		__m128 scaleZ = _mm_loadu_ps(transforms.scaleZ.data() + index);
+
+		// World行列の3x3部分
+		__m128 sinXsinY = _mm_mul_ps(sinX, sinY);
+		__m128 cosXsinY = _mm_mul_ps(cosX, sinY);
+		__m128 world[4][3];
+		world[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+		world[0][1] = _mm_mul_ps(_mm_mul_ps(cosY, sinZ), scaleX);
+		world[0][2] = _mm_mul_ps(_mm_xor_ps(sinY, signBit), scaleX);
+		world[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinXsinY, cosZ), _mm_mul_ps(cosX, sinZ)), scaleY);
+		world[1][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sinXsinY, sinZ), _mm_mul_ps(cosX, cosZ)), scaleY);
+		world[1][2] = _mm_mul_ps(_mm_mul_ps(sinX, cosY), scaleY);
+		world[2][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cosXsinY, cosZ), _mm_mul_ps(sinX, sinZ)), scaleZ);
+		world[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosXsinY, sinZ), _mm_mul_ps(sinX, cosZ)), scaleZ);
+		world[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+		world[3][0] = _mm_loadu_ps(transforms.translateX.data() + index);
+		world[3][1] = _mm_loadu_ps(transforms.translateY.data() + index);
+		world[3][2] = _mm_loadu_ps(transforms.translateZ.data() + index);
+
+		WriteTransforms(world, vp, output, outputStride, index);
+	}
+#endif
+
+	// 端数
+	for (; index < count; ++index) {
+		ComputeTransformScalar(transforms, index, viewProjection, precision, *OutputAt(output, outputStride, index));
+	}
+}
+
+void ComputeTransformBatch(const TransformArrays& transforms, const QuaternionArrays& rotations, const Matrix4x4& viewProjection,
+	TransformationMatrix* output, size_t outputStride) {
+	size_t count = transforms.scaleX.size();
+	assert(transforms.scaleY.size() == count && transforms.scaleZ.size() == count);
+	assert(rotations.x.size() == count && rotations.y.size() == count && rotations.z.size() == count && rotations.w.size() == count);
+	assert(transforms.translateX.size() == count && transforms.translateY.size() == count && transforms.translateZ.size() == count);
+	assert(outputStride >= sizeof(TransformationMatrix));
+
+	size_t index = 0;
+#if MYMATH_USE_SIMD
+	__m128 vp[4][4];
+	BroadcastMatrix(viewProjection, vp);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	// sin/cosを呼ばないので、全てレジスタの中で済む
+	for (; index + 4 <= count; index += 4) {
+		__m128 x = _mm_loadu_ps(rotations.x.data() + index);
+		__m128 y = _mm_loadu_ps(rotations.y.data() + index);
+		__m128 z = _mm_loadu_ps(rotations.z.data() + index);
+		__m128 w = _mm_loadu_ps(rotations.w.data() + index);
+		__m128 scaleX = _mm_loadu_ps(transforms.scaleX.data() + index);
+		__m128 scaleY = _mm_loadu_ps(transforms.scaleY.data() + index);
+		__m128 scaleZ = _mm_loadu_ps(transforms.scaleZ.data() + index);
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+		__m128 world[4][3];
+		world[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scaleX);
+		world[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scaleX);
+		world[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scaleX);
+		world[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scaleY);
+		world[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scaleY);
+		world[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scaleY);
+		world[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scaleZ);
+		world[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scaleZ);
+		world[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scaleZ);
+		world[3][0] = _mm_loadu_ps(transforms.translateX.data() + index);
+		world[3][1] = _mm_loadu_ps(transforms.translateY.data() + index);
+		world[3][2] = _mm_loadu_ps(transforms.translateZ.data() + index);
+
+		WriteTransforms(world, vp, output, outputStride, index);
+	}
+#endif
+
+	// 端数
+	for (; index < count; ++index) {
+		ComputeTransformScalar(transforms, rotations, index, viewProjection, *OutputAt(output, outputStride, index));
+	}
+}
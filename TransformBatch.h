@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include "Matrix4x4.h"
+#include "QuaternionArrays.h"
+#include "SinCos.h"
+#include "TransformArrays.h"
+#include "TransformationMatrix.h"
+#include "Vector3.h"
+
+/// <summary>
+/// 全ての配列の長さをそろえる
+/// </summary>
+/// <param name="transforms">SoAのTransform</param>
+/// <param name="count">オブジェクトの数</param>
+void ResizeTransformArrays(TransformArrays& transforms, size_t count);
+
+/// <summary>
+/// index番目のオブジェクトのTransformを書き込む
+/// </summary>
+void SetTransform(TransformArrays& transforms, size_t index, const Vector3& scale, const Vector3& rotate, const Vector3& translate);
+
+/// <summary>
+/// N個のオブジェクトのWorld行列とWVP行列をまとめて作り、TransformationMatrixの配列に書き込む
+/// World行列はMakeAffineMatrix(scale, rotate, translate)と同じ S*Rx*Ry*Rz*T を、行列の掛け算をせずに直接求める
+/// </summary>
+/// <param name="transforms">SoAのTransform</param>
+/// <param name="viewProjection">View行列とProjection行列を掛けたもの</param>
+/// <param name="output">書き込み先。MapしたUploadBufferを直接渡してよい(書くだけで読み出さない)</param>
+/// <param name="outputStride">1つ分のバイト数。1つずつCBVにする時は256の倍数にする</param>
+/// <param name="precision">sin/cosの精度。PreciseならMakeAffineMatrixと同じ結果になる</param>
+void ComputeTransformBatch(const TransformArrays& transforms, const Matrix4x4& viewProjection,
+	TransformationMatrix* output, size_t outputStride = sizeof(TransformationMatrix), SinCosPrecision precision = SinCosPrecision::Precise);
+
+/// <summary>
+/// 回転をクォータニオンで渡す版。transformsのrotateX/Y/Zは使わない
+/// World行列はMakeAffineMatrix(scale, Quaternion, translate)と同じで、sin/cosを呼ばない
+/// </summary>
+/// <param name="transforms">SoAのTransform(拡縮と平行移動)</param>
+/// <param name="rotations">SoAの単位クォータニオン。transformsと同じ数にする</param>
+/// <param name="viewProjection">View行列とProjection行列を掛けたもの</param>
+/// <param name="output">書き込み先</param>
+/// <param name="outputStride">1つ分のバイト数</param>
+void ComputeTransformBatch(const TransformArrays& transforms, const QuaternionArrays& rotations, const Matrix4x4& viewProjection,
+	TransformationMatrix* output, size_t outputStride = sizeof(TransformationMatrix));
@@ -0,0 +1,10 @@
+#pragma once
+#include "Matrix4x4.h"
+
+/// <summary>
+/// 頂点シェーダーに渡す行列(CBufferのTransformationMatrix)
+/// </summary>
+struct TransformationMatrix final {
+	Matrix4x4 WVP;
+	Matrix4x4 World;
+};
@@ -0,0 +1,95 @@
+#include "UploadAllocator.h"
+
+#include <cassert>
+
+namespace {
+
+	// alignmentの倍数に切り上げる。alignmentは2の累乗
+	uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	bool IsPowerOfTwo(size_t value) {
+		return value != 0 && (value & (value - 1)) == 0;
+	}
+}
+
+LinearUploadAllocator::LinearUploadAllocator(UploadPageBackend& backend, size_t pageSize)
+	: backend_(backend), pageSize_(pageSize) {
+	assert(pageSize_ > 0);
+}
+
+LinearUploadAllocator::~LinearUploadAllocator() {
+	for (const UploadPage& page : pages_) {
+		backend_.DestroyPage(page);
+	}
+	for (const UploadPage& page : largePages_) {
+		backend_.DestroyPage(page);
+	}
+}
+
+UploadAllocation LinearUploadAllocator::Allocate(size_t size, size_t alignment) {
+	assert(IsPowerOfTwo(alignment) && alignment <= kPageAlignment);
+	allocatedBytes_ += size;
+
+	// 1ページに入らないものは専用のページを作る。ページの先頭は境界にそろっている
+	if (size > pageSize_) {
+		UploadPage page = CreatePage(static_cast<size_t>(AlignUp(size, alignment)));
+		largePages_.push_back(page);
+		return { page.cpuAddress, page.gpuAddress, size };
+	}
+
+	// 今のページの残りに入らなければ、残りを捨てて次のページに移る
+	if (currentPage_ < pages_.size()) {
+		const UploadPage& page = pages_[currentPage_];
+		size_t alignedOffset = static_cast<size_t>(AlignUp(page.gpuAddress + offset_, alignment) - page.gpuAddress);
+		if (alignedOffset + size > pageSize_) {
+			wastedBytes_ += pageSize_ - offset_;
+			++currentPage_;
+			offset_ = 0;
+		}
+	}
+
+	// Resetの前に作ったページがあれば使い回す
+	if (currentPage_ == pages_.size()) {
+		pages_.push_back(CreatePage(pageSize_));
+	}
+
+	const UploadPage& page = pages_[currentPage_];
+	size_t alignedOffset = static_cast<size_t>(AlignUp(page.gpuAddress + offset_, alignment) - page.gpuAddress);
+	assert(alignedOffset + size <= pageSize_);
+	paddingBytes_ += alignedOffset - offset_;
+	offset_ = alignedOffset + size;
+	return { page.cpuAddress + alignedOffset, page.gpuAddress + alignedOffset, size };
+}
+
+UploadAllocation LinearUploadAllocator::AllocateConstantBuffer(size_t size) {
+	return Allocate(static_cast<size_t>(AlignUp(size, kConstantBufferAlignment)), kConstantBufferAlignment);
+}
+
+void LinearUploadAllocator::Reset() {
+	for (const UploadPage& page : largePages_) {
+		backend_.DestroyPage(page);
+	}
+	largePages_.clear();
+	currentPage_ = 0;
+	offset_ = 0;
+	allocatedBytes_ = 0;
+	paddingBytes_ = 0;
+	wastedBytes_ = 0;
+}
+
+size_t LinearUploadAllocator::GetReservedBytes() const {
+	size_t bytes = pageSize_ * pages_.size();
+	for (const UploadPage& page : largePages_) {
+		bytes += page.size;
+	}
+	return bytes;
+}
+
+UploadPage LinearUploadAllocator::CreatePage(size_t size) {
+	UploadPage page = backend_.CreatePage(size);
+	assert(page.cpuAddress != nullptr && page.size >= size);
+	assert(page.gpuAddress % kPageAlignment == 0);
+	return page;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// CPUから書き込めてGPUからも読める、大きなメモリ1枚(ページ)
+/// </summary>
+struct UploadPage final {
+	uint8_t* cpuAddress;
+	uint64_t gpuAddress; // kPageAlignmentの倍数にする
+	size_t size;
+	uint32_t handle; // バックエンドが自分のリソースを見つけるための番号
+};
+
+/// <summary>
+/// ページから切り出した範囲。cpuAddressに書き込んだものをgpuAddressから読める
+/// </summary>
+struct UploadAllocation final {
+	void* cpuAddress;
+	uint64_t gpuAddress;
+	size_t size;
+};
+
+/// <summary>
+/// ページを作って消す所。D3D12ではUploadHeapのバッファを作ってMapしたままにする
+/// 切り出し方はここに依らないので、普通のメモリを返すものに差し替えればD3D12無しで確かめられる
+/// </summary>
+class UploadPageBackend {
+public:
+	virtual ~UploadPageBackend() = default;
+
+	/// <summary>
+	/// ページを作る
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <returns>作ったページ。GPUのアドレスはkPageAlignmentの倍数にする</returns>
+	virtual UploadPage CreatePage(size_t size) = 0;
+
+	/// <summary>
+	/// ページを消す。GPUが使い終わってから呼ぶ
+	/// </summary>
+	virtual void DestroyPage(const UploadPage& page) = 0;
+};
+
+/// <summary>
+/// 大きなページの先頭から順に切り出す。1つずつは解放できず、Resetでまとめて最初に戻す
+/// 小さなCBufferや頂点ごとにリソースを作らないので、リソースの数とMapの回数、64KB単位の確保で空く分が減る
+/// </summary>
+class LinearUploadAllocator final {
+public:
+	// ページのGPUアドレスの境界。D3D12のバッファは64KB境界に置かれる
+	static constexpr size_t kPageAlignment = 64 * 1024;
+	// 1ページの大きさ
+	static constexpr size_t kDefaultPageSize = 64 * 1024;
+	// CBVはアドレスも大きさも256の倍数にする
+	static constexpr size_t kConstantBufferAlignment = 256;
+	// 頂点やIndexのバッファの境界
+	static constexpr size_t kBufferAlignment = 16;
+
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="backend">ページを作る所。このクラスより長く生きるようにする</param>
+	/// <param name="pageSize">1ページの大きさ。これより大きいものは専用のページを作る</param>
+	explicit LinearUploadAllocator(UploadPageBackend& backend, size_t pageSize = kDefaultPageSize);
+	~LinearUploadAllocator();
+
+	// コピー禁止
+	LinearUploadAllocator(const LinearUploadAllocator&) = delete;
+	LinearUploadAllocator& operator=(const LinearUploadAllocator&) = delete;
+
+	/// <summary>
+	/// 切り出す。今のページに入らなければ次のページに移る
+	/// </summary>
+	/// <param name="size">バイト数</param>
+	/// <param name="alignment">GPUアドレスの境界。2の累乗でkPageAlignment以下</param>
+	/// <returns>切り出した範囲</returns>
+	UploadAllocation Allocate(size_t size, size_t alignment = kBufferAlignment);
+
+	/// <summary>
+	/// CBV用に切り出す。アドレスを256の境界にそろえ、大きさも256の倍数に切り上げる
+	/// </summary>
+	/// <param name="size">CBufferのバイト数</param>
+	/// <returns>切り出した範囲。sizeは切り上げた大きさ</returns>
+	UploadAllocation AllocateConstantBuffer(size_t size);
+
+	/// <summary>
+	/// 全て最初に戻す。普通のページは残して使い回し、専用のページは消す
+	/// 切り出したものをGPUが使い終わってから呼ぶ
+	/// </summary>
+	void Reset();
+
+	// 持っているページの数(専用のページも含む)
+	size_t GetPageCount() const { return pages_.size() + largePages_.size(); }
+	// 持っているページの合計のバイト数
+	size_t GetReservedBytes() const;
+	// Resetしてから切り出した大きさの合計
+	size_t GetAllocatedBytes() const { return allocatedBytes_; }
+	// 境界をそろえるために空けた大きさの合計
+	size_t GetPaddingBytes() const { return paddingBytes_; }
+	// 入らなくて次のページに移った時に、前のページの残りで使わなかった大きさの合計
+	size_t GetWastedBytes() const { return wastedBytes_; }
+
+private:
+	// バックエンドにページを作らせて、境界を確かめる
+	UploadPage CreatePage(size_t size);
+
+	UploadPageBackend& backend_;
+	size_t pageSize_;
+	std::vector<UploadPage> pages_; // 普通の大きさのページ
+	std::vector<UploadPage> largePages_; // 1ページに入らないもの専用のページ
+	size_t currentPage_ = 0; // 切り出し中のページ。pages_.size()ならまだ無い
+	size_t offset_ = 0; // 切り出し中のページで、次に使える所
+	size_t allocatedBytes_ = 0;
+	size_t paddingBytes_ = 0;
+	size_t wastedBytes_ = 0;
+};
@@ -0,0 +1,111 @@
+#include "UploadManager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace {
+
+	// alignmentの倍数に切り上げる。alignmentは2の累乗
+	size_t AlignUp(size_t value, size_t alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}
+
+UploadManager::UploadManager(UploadPageBackend& pageBackend, CopyQueueBackend& copyQueue, size_t stagingCapacity)
+	: copyQueue_(copyQueue), stagingRing_(pageBackend, stagingCapacity),
+	maxChunkSize_(std::max<size_t>(stagingCapacity / kMaxChunkDivisor, kTexturePlacementAlignment)) {
+}
+
+void UploadManager::UploadBuffer(void* destination, uint64_t destinationOffset, const void* data, size_t size) {
+	assert(destination != nullptr && (data != nullptr || size == 0));
+	const uint8_t* source = static_cast<const uint8_t*>(data);
+
+	// 大きいものは分けて送る。分けた分は先に出して、ステージングを空けながら進める
+	for (size_t offset = 0; offset < size;) {
+		size_t chunkSize = std::min(size - offset, maxChunkSize_);
+		UploadAllocation staging = Stage(chunkSize, LinearUploadAllocator::kBufferAlignment);
+		std::memcpy(staging.cpuAddress, source + offset, chunkSize);
+
+		const UploadPage& page = stagingRing_.GetPage();
+		bufferCopies_.push_back({ destination, destinationOffset + offset, page.handle, staging.gpuAddress - page.gpuAddress, chunkSize });
+		offset += chunkSize;
+	}
+}
+
+void UploadManager::UploadTexture(void* destination, uint32_t subresource, const TextureSubresourceData& data) {
+	assert(destination != nullptr && data.pixels != nullptr && data.rowCount > 0);
+	const size_t rowSize = data.rowPitch;
+	const size_t stagingRowPitch = AlignUp(rowSize, kTextureRowPitchAlignment);
+	assert(stagingRowPitch <= maxChunkSize_);
+
+	// 1回で送れる行の数。行で分けられるのは、1行が1ピクセルの高さの時だけ
+	uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<size_t>(maxChunkSize_ / stagingRowPitch, data.rowCount));
+	assert(rowsPerChunk == data.rowCount || data.rowCount == data.height);
+
+	const uint8_t* source = static_cast<const uint8_t*>(data.pixels);
+	for (uint32_t firstRow = 0; firstRow < data.rowCount; firstRow += rowsPerChunk) {
+		uint32_t rowCount = std::min(rowsPerChunk, data.rowCount - firstRow);
+		UploadAllocation staging = Stage(stagingRowPitch * rowCount, kTexturePlacementAlignment);
+
+		// ステージングでは1行を256の倍数に広げて置く
+		uint8_t* stagingRows = static_cast<uint8_t*>(staging.cpuAddress);
+		for (uint32_t row = 0; row < rowCount; ++row) {
+			std::memcpy(stagingRows + stagingRowPitch * row, source + rowSize * (firstRow + row), rowSize);
+		}
+
+		const UploadPage& page = stagingRing_.GetPage();
+		uint32_t height = rowCount == data.rowCount ? data.height : rowCount;
+		textureCopies_.push_back({ destination, subresource, firstRow, page.handle, staging.gpuAddress - page.gpuAddress,
+			data.format, data.width, height, static_cast<uint32_t>(stagingRowPitch) });
+	}
+}
+
+uint64_t UploadManager::Flush() {
+	if (GetPendingCopyCount() > 0) {
+		++submittedFenceValue_;
+		copyQueue_.ExecuteCopies(bufferCopies_, textureCopies_, submittedFenceValue_);
+		stagingRing_.FinishFrame(submittedFenceValue_);
+		bufferCopies_.clear();
+		textureCopies_.clear();
+		++batchCount_;
+	}
+	return submittedFenceValue_;
+}
+
+void UploadManager::SynchronizeDirectQueue() {
+	uint64_t fenceValue = Flush();
+
+	// 前に待たせた値から進んでいる時だけ積む
+	if (fenceValue > directQueueWaitValue_) {
+		copyQueue_.WaitOnDirectQueue(fenceValue);
+		directQueueWaitValue_ = fenceValue;
+	}
+}
+
+void UploadManager::Reclaim() {
+	stagingRing_.Reclaim(copyQueue_.GetCompletedValue());
+}
+
+void UploadManager::WaitForIdle() {
+	Flush();
+	if (copyQueue_.GetCompletedValue() < submittedFenceValue_) {
+		copyQueue_.Wait(submittedFenceValue_);
+	}
+	Reclaim();
+}
+
+UploadAllocation UploadManager::Stage(size_t size, size_t alignment) {
+	assert(size <= stagingRing_.GetCapacity());
+	UploadAllocation allocation{};
+	Reclaim();
+	while (!stagingRing_.TryAllocate(size, alignment, allocation)) {
+		// 積んだままのコピーが使っている所は、出さないと空かない
+		Flush();
+		assert(stagingRing_.GetPendingFrameCount() > 0);
+		copyQueue_.Wait(stagingRing_.GetOldestFenceValue());
+		Reclaim();
+	}
+	stagedBytes_ += allocation.size;
+	return allocation;
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "FrameRingAllocator.h"
+#include "UploadAllocator.h"
+
+/// <summary>
+/// ステージングからバッファへのコピー1つ
+/// </summary>
+struct BufferCopy final {
+	void* destination; // コピー先。D3D12ではDEFAULTヒープのID3D12Resource*
+	uint64_t destinationOffset;
+	uint32_t sourcePage; // コピー元のUploadPage::handle
+	uint64_t sourceOffset;
+	uint64_t size;
+};
+
+/// <summary>
+/// ステージングからTextureの1つのSubresourceへのコピー1つ。大きい時は行で分けて、destinationYから送る
+/// </summary>
+struct TextureCopy final {
+	void* destination; // コピー先。D3D12ではDEFAULTヒープのID3D12Resource*
+	uint32_t subresource;
+	uint32_t destinationY;
+	uint32_t sourcePage; // コピー元のUploadPage::handle
+	uint64_t sourceOffset; // UploadManager::kTexturePlacementAlignmentの倍数
+	uint32_t format; // DXGI_FORMAT
+	uint32_t width;
+	uint32_t height; // このコピーで送る行の数
+	uint32_t rowPitch; // ステージングでの1行の大きさ。UploadManager::kTextureRowPitchAlignmentの倍数
+};
+
+/// <summary>
+/// Textureの1つのSubresourceのCPU側のデータ
+/// </summary>
+struct TextureSubresourceData final {
+	const void* pixels;
+	size_t rowPitch; // pixelsの1行の大きさ
+	uint32_t rowCount; // 行の数。圧縮形式ではブロックの行の数になる
+	uint32_t format; // DXGI_FORMAT
+	uint32_t width;
+	uint32_t height;
+};
+
+/// <summary>
+/// コピー用のキュー。D3D12ではCOPYのCommandQueueとFenceを使う
+/// 積み方とFenceの数え方はここに依らないので、差し替えればデバイス無しで確かめられる
+/// </summary>
+class CopyQueueBackend {
+public:
+	virtual ~CopyQueueBackend() = default;
+
+	/// <summary>
+	/// コピーをまとめて1回でキューに出し、終わったらFenceをfenceValueにする
+	/// </summary>
+	virtual void ExecuteCopies(const std::vector<BufferCopy>& bufferCopies, const std::vector<TextureCopy>& textureCopies, uint64_t fenceValue) = 0;
+
+	/// <summary>
+	/// コピーが終わった所のFenceの値
+	/// </summary>
+	virtual uint64_t GetCompletedValue() = 0;
+
+	/// <summary>
+	/// Fenceがvalueになるまで、CPUを止めて待つ
+	/// </summary>
+	virtual void Wait(uint64_t value) = 0;
+
+	/// <summary>
+	/// 描画用のキューに、Fenceがvalueになるまで待つように積む。CPUは止めない
+	/// </summary>
+	virtual void WaitOnDirectQueue(uint64_t value) = 0;
+};
+
+/// <summary>
+/// 頂点やTextureのデータを輪のステージングに置き、コピー用のキューでDEFAULTヒープのリソースに送る
+/// コピーは溜めておいてFlushでまとめて出し、ステージングはそのコピーのFenceが終わったら使い回す
+/// </summary>
+class UploadManager final {
+public:
+	// ステージングのTextureの1行の大きさの境界(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT)
+	static constexpr size_t kTextureRowPitchAlignment = 256;
+	// ステージングのTextureの先頭の境界(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT)
+	static constexpr size_t kTexturePlacementAlignment = 512;
+	// 1回のコピーで送る最大の大きさ。ステージングの大きさに対する割合
+	static constexpr size_t kMaxChunkDivisor = 4;
+
+	/// <summary>
+	/// コンストラクタ
+	/// </summary>
+	/// <param name="pageBackend">ステージングのページを作る所。このクラスより長く生きるようにする</param>
+	/// <param name="copyQueue">コピー用のキュー。このクラスより長く生きるようにする</param>
+	/// <param name="stagingCapacity">ステージングの大きさ。大きいデータは分けて送る</param>
+	UploadManager(UploadPageBackend& pageBackend, CopyQueueBackend& copyQueue, size_t stagingCapacity);
+
+	// コピー禁止
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	/// <summary>
+	/// バッファへのコピーを積む。dataはすぐにステージングへ写すので、呼んだ後は捨ててよい
+	/// </summary>
+	/// <param name="destination">コピー先のバッファ</param>
+	/// <param name="destinationOffset">コピー先の始まり</param>
+	/// <param name="data">送るデータ</param>
+	/// <param name="size">バイト数</param>
+	void UploadBuffer(void* destination, uint64_t destinationOffset, const void* data, size_t size);
+
+	/// <summary>
+	/// Textureの1つのSubresourceへのコピーを積む。ステージングに入らない時は行で分ける
+	/// </summary>
+	/// <param name="destination">コピー先のTexture</param>
+	/// <param name="subresource">Subresourceの番号</param>
+	/// <param name="data">送るデータ。呼んだ後は捨ててよい</param>
+	void UploadTexture(void* destination, uint32_t subresource, const TextureSubresourceData& data);
+
+	/// <summary>
+	/// 積んだコピーをまとめてコピー用のキューに出す
+	/// </summary>
+	/// <returns>ここまでのコピーが全部終わるFenceの値。何も出していなければ0</returns>
+	uint64_t Flush();
+
+	/// <summary>
+	/// 積んだコピーを出してから、描画用のキューがそれを待つようにする。送ったリソースを描画で使う前に呼ぶ
+	/// </summary>
+	void SynchronizeDirectQueue();
+
+	/// <summary>
+	/// コピーが終わったステージングを空ける
+	/// </summary>
+	void Reclaim();
+
+	/// <summary>
+	/// 積んだコピーを出して、全部終わるまで待つ。リソースを消す前に呼ぶ
+	/// </summary>
+	void WaitForIdle();
+
+	// 積んでいて、まだ出していないコピーの数
+	size_t GetPendingCopyCount() const { return bufferCopies_.size() + textureCopies_.size(); }
+	// 最後に出したコピーのFenceの値
+	uint64_t GetSubmittedFenceValue() const { return submittedFenceValue_; }
+	// キューに出した回数
+	uint64_t GetBatchCount() const { return batchCount_; }
+	// ステージングに写した大きさ
+	uint64_t GetStagedBytes() const { return stagedBytes_; }
+
+private:
+	/// <summary>
+	/// ステージングを切り出す。空いていなければ、積んだコピーを出して古いものが終わるのを待つ
+	/// </summary>
+	UploadAllocation Stage(size_t size, size_t alignment);
+
+	CopyQueueBackend& copyQueue_;
+	FrameRingAllocator stagingRing_;
+	size_t maxChunkSize_;
+	std::vector<BufferCopy> bufferCopies_;
+	std::vector<TextureCopy> textureCopies_;
+	uint64_t submittedFenceValue_ = 0;
+	uint64_t directQueueWaitValue_ = 0; // 描画用のキューに待たせた最後の値
+	uint64_t batchCount_ = 0;
+	uint64_t stagedBytes_ = 0;
+};
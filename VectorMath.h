@@ -0,0 +1,206 @@
+#pragma once
+#include "Vector2.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+#include <cassert>
+#include <cmath>
+
+// ベクトルの四則演算と内積、外積、長さ、正規化。長さと正規化以外はコンパイル時にも計算できる
+
+/// *****************************************************
+/// Vector2(2次元ベクトル)
+/// *****************************************************
+constexpr Vector2 operator+(const Vector2& v1, const Vector2& v2) {
+	return { v1.x + v2.x, v1.y + v2.y };
+}
+
+constexpr Vector2 operator-(const Vector2& v1, const Vector2& v2) {
+	return { v1.x - v2.x, v1.y - v2.y };
+}
+
+constexpr Vector2 operator-(const Vector2& v) {
+	return { -v.x, -v.y };
+}
+
+constexpr Vector2 operator*(const Vector2& v, float scalar) {
+	return { v.x * scalar, v.y * scalar };
+}
+
+constexpr Vector2 operator*(float scalar, const Vector2& v) {
+	return v * scalar;
+}
+
+constexpr Vector2 operator/(const Vector2& v, float scalar) {
+	return { v.x / scalar, v.y / scalar };
+}
+
+constexpr Vector2& operator+=(Vector2& v1, const Vector2& v2) {
+	v1 = v1 + v2;
+	return v1;
+}
+
+constexpr Vector2& operator-=(Vector2& v1, const Vector2& v2) {
+	v1 = v1 - v2;
+	return v1;
+}
+
+constexpr Vector2& operator*=(Vector2& v, float scalar) {
+	v = v * scalar;
+	return v;
+}
+
+constexpr Vector2& operator/=(Vector2& v, float scalar) {
+	v = v / scalar;
+	return v;
+}
+
+// 内積
+constexpr float Dot(const Vector2& v1, const Vector2& v2) {
+	return v1.x * v2.x + v1.y * v2.y;
+}
+
+// 長さ
+inline float Length(const Vector2& v) {
+	return std::sqrt(Dot(v, v));
+}
+
+// 長さを1にする。長さが0のベクトルは渡さない
+inline Vector2 Normalize(const Vector2& v) {
+	float length = Length(v);
+	assert(length != 0.0f);
+	return v / length;
+}
+
+/// *****************************************************
+/// Vector3(3次元ベクトル)
+/// *****************************************************
+constexpr Vector3 operator+(const Vector3& v1, const Vector3& v2) {
+	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z };
+}
+
+constexpr Vector3 operator-(const Vector3& v1, const Vector3& v2) {
+	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z };
+}
+
+constexpr Vector3 operator-(const Vector3& v) {
+	return { -v.x, -v.y, -v.z };
+}
+
+constexpr Vector3 operator*(const Vector3& v, float scalar) {
+	return { v.x * scalar, v.y * scalar, v.z * scalar };
+}
+
+constexpr Vector3 operator*(float scalar, const Vector3& v) {
+	return v * scalar;
+}
+
+constexpr Vector3 operator/(const Vector3& v, float scalar) {
+	return { v.x / scalar, v.y / scalar, v.z / scalar };
+}
+
+constexpr Vector3& operator+=(Vector3& v1, const Vector3& v2) {
+	v1 = v1 + v2;
+	return v1;
+}
+
+constexpr Vector3& operator-=(Vector3& v1, const Vector3& v2) {
+	v1 = v1 - v2;
+	return v1;
+}
+
+constexpr Vector3& operator*=(Vector3& v, float scalar) {
+	v = v * scalar;
+	return v;
+}
+
+constexpr Vector3& operator/=(Vector3& v, float scalar) {
+	v = v / scalar;
+	return v;
+}
+
+// 内積
+constexpr float Dot(const Vector3& v1, const Vector3& v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+// 外積
+constexpr Vector3 Cross(const Vector3& v1, const Vector3& v2) {
+	return { v1.y * v2.z - v1.z * v2.y, v1.z * v2.x - v1.x * v2.z, v1.x * v2.y - v1.y * v2.x };
+}
+
+// 長さ
+inline float Length(const Vector3& v) {
+	return std::sqrt(Dot(v, v));
+}
+
+// 長さを1にする。長さが0のベクトルは渡さない
+inline Vector3 Normalize(const Vector3& v) {
+	float length = Length(v);
+	assert(length != 0.0f);
+	return v / length;
+}
+
+/// *****************************************************
+/// Vector4(4次元ベクトル)
+/// *****************************************************
+constexpr Vector4 operator+(const Vector4& v1, const Vector4& v2) {
+	return { v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w };
+}
+
+constexpr Vector4 operator-(const Vector4& v1, const Vector4& v2) {
+	return { v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w };
+}
+
+constexpr Vector4 operator-(const Vector4& v) {
+	return { -v.x, -v.y, -v.z, -v.w };
+}
+
+constexpr Vector4 operator*(const Vector4& v, float scalar) {
+	return { v.x * scalar, v.y * scalar, v.z * scalar, v.w * scalar };
+}
+
+constexpr Vector4 operator*(float scalar, const Vector4& v) {
+	return v * scalar;
+}
+
+constexpr Vector4 operator/(const Vector4& v, float scalar) {
+	return { v.x / scalar, v.y / scalar, v.z / scalar, v.w / scalar };
+}
+
+constexpr Vector4& operator+=(Vector4& v1, const Vector4& v2) {
+	v1 = v1 + v2;
+	return v1;
+}
+
+constexpr Vector4& operator-=(Vector4& v1, const Vector4& v2) {
+	v1 = v1 - v2;
+	return v1;
+}
+
+constexpr Vector4& operator*=(Vector4& v, float scalar) {
+	v = v * scalar;
+	return v;
+}
+
+constexpr Vector4& operator/=(Vector4& v, float scalar) {
+	v = v / scalar;
+	return v;
+}
+
+// 内積
+constexpr float Dot(const Vector4& v1, const Vector4& v2) {
+	return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z + v1.w * v2.w;
+}
+
+// 長さ
+inline float Length(const Vector4& v) {
+	return std::sqrt(Dot(v, v));
+}
+
+// 長さを1にする。長さが0のベクトルは渡さない
+inline Vector4 Normalize(const Vector4& v) {
+	float length = Length(v);
+	assert(length != 0.0f);
+	return v / length;
+}
@@ -0,0 +1,217 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+	// [0,1]をUNORM16にする
+	uint16_t ToUnorm16(float value) {
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+	}
+
+	// [-1,1]をSNORM16にする
+	int16_t ToSnorm16(float value) {
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+
+	// SNORM16を[-1,1]に戻す。-32768も-1になる
+	float FromSnorm16(int16_t value) {
+		return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+	}
+
+	// 符号。0は正として扱う
+	float SignNotZero(float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// 軸ごとの量子化の幅。幅の無い軸は全て最小値になる
+	float BoundsExtent(float min, float max) {
+		return max > min ? max - min : 0.0f;
+	}
+}
+
+/// *****************************************************
+/// 半精度浮動小数点数
+/// *****************************************************
+uint16_t FloatToHalf(float value) {
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t absolute = bits & 0x7FFFFFFFu;
+
+	// NaNとInf
+	if (absolute >= 0x7F800000u) {
+		return static_cast<uint16_t>(sign | 0x7C00u | (absolute > 0x7F800000u ? 0x200u : 0u));
+	}
+	// 半精度で表せない大きさはInf
+	if (absolute >= 0x477FF000u) {
+		return static_cast<uint16_t>(sign | 0x7C00u);
+	}
+	// 半精度の非正規化数。仮数を丸めながら右にずらす
+	if (absolute < 0x38800000u) {
+		if (absolute < 0x33000000u) {
+			return static_cast<uint16_t>(sign); // 0に丸まる
+		}
+		uint32_t exponent = absolute >> 23;
+		uint32_t mantissa = (absolute & 0x7FFFFFu) | 0x800000u;
+		uint32_t shift = 126u - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1u);
+		uint32_t halfway = 1u << (shift - 1u);
+		if (remainder > halfway || (remainder == halfway && (half & 1u))) {
+			++half;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+	// 正規化数。指数の基準を付け替えて、仮数を偶数丸めで13bit落とす
+	uint32_t half = (absolute - 0x38000000u) >> 13;
+	uint32_t remainder = absolute & 0x1FFFu;
+	if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) {
+		++half; // 繰り上がりで指数が増えても正しい値になる
+	}
+	return static_cast<uint16_t>(sign | half);
+}
+
+float HalfToFloat(uint16_t value) {
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1Fu;
+	uint32_t mantissa = value & 0x3FFu;
+	uint32_t bits;
+	if (exponent == 0x1Fu) {
+		bits = sign | 0x7F800000u | (mantissa << 13); // NaNとInf
+	} else if (exponent != 0) {
+		bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+	} else {
+		// 非正規化数はfloatでは正規化数になる
+		float result = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -result : result;
+	}
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+/// *****************************************************
+/// 八面体に展開した法線
+/// *****************************************************
+void EncodeOctahedralNormal(const Vector3& normal, int16_t encoded[2]) {
+	// |x|+|y|+|z|=1の八面体に射影する
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	float x = length > 0.0f ? normal.x / length : 0.0f;
+	float y = length > 0.0f ? normal.y / length : 0.0f;
+	float z = length > 0.0f ? normal.z / length : 1.0f;
+
+	// 下半分は外側に折り返す
+	if (z < 0.0f) {
+		float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+		float foldedY = (1.0f - std::abs(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// 丸めた4通りの中から、戻した時に一番近くなるものを選ぶ
+	float bestDot = -FLT_MAX;
+	for (int32_t candidate = 0; candidate < 4; ++candidate) {
+		float candidateX = (candidate & 1) ? std::ceil(x * 32767.0f) : std::floor(x * 32767.0f);
+		float candidateY = (candidate & 2) ? std::ceil(y * 32767.0f) : std::floor(y * 32767.0f);
+		int16_t candidateEncoded[2] = {
+			ToSnorm16(candidateX / 32767.0f),
+			ToSnorm16(candidateY / 32767.0f),
+		};
+		Vector3 decoded = DecodeOctahedralNormal(candidateEncoded);
+		float dot = decoded.x * normal.x + decoded.y * normal.y + decoded.z * normal.z;
+		if (dot > bestDot) {
+			bestDot = dot;
+			encoded[0] = candidateEncoded[0];
+			encoded[1] = candidateEncoded[1];
+		}
+	}
+}
+
+Vector3 DecodeOctahedralNormal(const int16_t encoded[2]) {
+	float x = FromSnorm16(encoded[0]);
+	float y = FromSnorm16(encoded[1]);
+	float z = 1.0f - std::abs(x) - std::abs(y);
+
+	// 折り返した下半分を戻す
+	float t = std::max(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	float length = std::sqrt(x * x + y * y + z * z);
+	return { x / length, y / length, z / length };
+}
+
+/// *****************************************************
+/// 頂点の圧縮
+/// *****************************************************
+PackedVertexData PackVertex(const VertexData& vertex, const Vector3& boundsMin, const Vector3& boundsMax) {
+	PackedVertexData packedVertex{};
+
+	// AABBの中の位置を[0,1]にして量子化する
+	float extentX = BoundsExtent(boundsMin.x, boundsMax.x);
+	float extentY = BoundsExtent(boundsMin.y, boundsMax.y);
+	float extentZ = BoundsExtent(boundsMin.z, boundsMax.z);
+	packedVertex.position[0] = ToUnorm16(extentX > 0.0f ? (vertex.position.x - boundsMin.x) / extentX : 0.0f);
+	packedVertex.position[1] = ToUnorm16(extentY > 0.0f ? (vertex.position.y - boundsMin.y) / extentY : 0.0f);
+	packedVertex.position[2] = ToUnorm16(extentZ > 0.0f ? (vertex.position.z - boundsMin.z) / extentZ : 0.0f);
+	packedVertex.position[3] = 65535; // UNORMの1。シェーダーでwをそのまま使える
+
+	packedVertex.texcoord[0] = FloatToHalf(vertex.texcoord.x);
+	packedVertex.texcoord[1] = FloatToHalf(vertex.texcoord.y);
+
+	EncodeOctahedralNormal(vertex.normal, packedVertex.normal);
+	return packedVertex;
+}
+
+VertexData UnpackVertex(const PackedVertexData& packedVertex, const Vector3& boundsMin, const Vector3& boundsMax) {
+	VertexData vertex{};
+	vertex.position.x = boundsMin.x + static_cast<float>(packedVertex.position[0]) / 65535.0f * BoundsExtent(boundsMin.x, boundsMax.x);
+	vertex.position.y = boundsMin.y + static_cast<float>(packedVertex.position[1]) / 65535.0f * BoundsExtent(boundsMin.y, boundsMax.y);
+	vertex.position.z = boundsMin.z + static_cast<float>(packedVertex.position[2]) / 65535.0f * BoundsExtent(boundsMin.z, boundsMax.z);
+	vertex.position.w = static_cast<float>(packedVertex.position[3]) / 65535.0f;
+	vertex.texcoord.x = HalfToFloat(packedVertex.texcoord[0]);
+	vertex.texcoord.y = HalfToFloat(packedVertex.texcoord[1]);
+	vertex.normal = DecodeOctahedralNormal(packedVertex.normal);
+	return vertex;
+}
+
+VertexPackingError PackVertices(ModelData& modelData) {
+	VertexPackingError error{};
+
+	// 圧縮して、戻したものとの差を測る
+	modelData.packedVertices.resize(modelData.vertices.size());
+	double normalErrorSum = 0.0;
+	for (size_t i = 0; i < modelData.vertices.size(); ++i) {
+		const VertexData& vertex = modelData.vertices[i];
+		modelData.packedVertices[i] = PackVertex(vertex, modelData.boundsMin, modelData.boundsMax);
+		VertexData unpacked = UnpackVertex(modelData.packedVertices[i], modelData.boundsMin, modelData.boundsMax);
+
+		float dx = unpacked.position.x - vertex.position.x;
+		float dy = unpacked.position.y - vertex.position.y;
+		float dz = unpacked.position.z - vertex.position.z;
+		error.maxPositionError = std::max(error.maxPositionError, std::sqrt(dx * dx + dy * dy + dz * dz));
+
+		float normalLength = std::sqrt(vertex.normal.x * vertex.normal.x + vertex.normal.y * vertex.normal.y + vertex.normal.z * vertex.normal.z);
+		if (normalLength > 0.0f) {
+			float dot = (unpacked.normal.x * vertex.normal.x + unpacked.normal.y * vertex.normal.y + unpacked.normal.z * vertex.normal.z) / normalLength;
+			float degrees = std::acos(std::clamp(dot, -1.0f, 1.0f)) * (180.0f / 3.14159265f);
+			error.maxNormalErrorDegrees = std::max(error.maxNormalErrorDegrees, degrees);
+			normalErrorSum += degrees;
+		}
+
+		error.maxTexcoordError = std::max({ error.maxTexcoordError,
+			std::abs(unpacked.texcoord.x - vertex.texcoord.x), std::abs(unpacked.texcoord.y - vertex.texcoord.y) });
+	}
+
+	float diagonalX = modelData.boundsMax.x - modelData.boundsMin.x;
+	float diagonalY = modelData.boundsMax.y - modelData.boundsMin.y;
+	float diagonalZ = modelData.boundsMax.z - modelData.boundsMin.z;
+	float diagonal = std::sqrt(diagonalX * diagonalX + diagonalY * diagonalY + diagonalZ * diagonalZ);
+	error.maxPositionErrorRatio = diagonal > 0.0f ? error.maxPositionError / diagonal : 0.0f;
+	error.meanNormalErrorDegrees = modelData.vertices.empty() ? 0.0f : static_cast<float>(normalErrorSum / static_cast<double>(modelData.vertices.size()));
+	return error;
+}
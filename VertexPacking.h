@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include "ModelData.h"
+
+/// <summary>
+/// 圧縮による誤差。圧縮前の頂点と、圧縮した頂点を戻したものとの差
+/// </summary>
+struct VertexPackingError final {
+	float maxPositionError; // 位置の誤差の最大(モデルの座標系での距離)
+	float maxPositionErrorRatio; // 位置の誤差の最大をAABBの対角線の長さで割ったもの
+	float maxNormalErrorDegrees; // 法線の角度の誤差の最大(度)
+	float meanNormalErrorDegrees; // 法線の角度の誤差の平均(度)
+	float maxTexcoordError; // UVの誤差の最大
+};
+
+/// <summary>
+/// floatを半精度浮動小数点数にする(最近接丸め)
+/// </summary>
+uint16_t FloatToHalf(float value);
+
+/// <summary>
+/// 半精度浮動小数点数をfloatにする
+/// </summary>
+float HalfToFloat(uint16_t value);
+
+/// <summary>
+/// 正規化した法線を八面体に展開して2つのSNORM16にする
+/// </summary>
+void EncodeOctahedralNormal(const Vector3& normal, int16_t encoded[2]);
+
+/// <summary>
+/// 八面体に展開した法線を戻す。Object3d.VS.hlslのDecodeOctahedralNormalと同じ計算
+/// </summary>
+Vector3 DecodeOctahedralNormal(const int16_t encoded[2]);
+
+/// <summary>
+/// 頂点を圧縮する
+/// </summary>
+/// <param name="vertex">圧縮前の頂点</param>
+/// <param name="boundsMin">AABBの最小</param>
+/// <param name="boundsMax">AABBの最大</param>
+/// <returns>圧縮した頂点</returns>
+PackedVertexData PackVertex(const VertexData& vertex, const Vector3& boundsMin, const Vector3& boundsMax);
+
+/// <summary>
+/// 圧縮した頂点を戻す。シェーダーと同じ計算で、誤差を測るのに使う
+/// </summary>
+VertexData UnpackVertex(const PackedVertexData& packedVertex, const Vector3& boundsMin, const Vector3& boundsMax);
+
+/// <summary>
+/// modelData.verticesを圧縮してpackedVerticesを作る
+/// </summary>
+/// <param name="modelData">verticesとboundsMin/boundsMaxを読み、packedVerticesを書く</param>
+/// <returns>圧縮による誤差</returns>
+VertexPackingError PackVertices(ModelData& modelData);
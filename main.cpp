@@ -9,8 +9,11 @@
 #include <dxgidebug.h>
 #include <dxcapi.h>
 #include <vector>
-#include <fstream>
-#include <sstream>
+#include <unordered_map>
+#include <filesystem>
+#include <numeric>
+#include <algorithm>
+#include <cmath>
 
 #include "externals/imgui/imgui.h"
 #include "externals/imgui/imgui_impl_dx12.h"
@@ -19,6 +22,27 @@
 #include "externals/DirectXTex/DirectXTex.h"
 
 #include "MyMath.h"
+#include "MatrixExpression.h"
+#include "VectorMath.h"
+#include "Logger.h"
+#include "VertexData.h"
+#include "PackedVertexData.h"
+#include "ModelData.h"
+#include "ObjLoader.h"
+#include "TransformationMatrix.h"
+#include "Frustum.h"
+#include "FrustumCulling.h"
+#include "Bvh.h"
+#include "UploadAllocator.h"
+#include "D3D12UploadPageBackend.h"
+#include "FrameRingAllocator.h"
+#include "FramePacer.h"
+#include "D3D12FrameFence.h"
+#include "UploadManager.h"
+#include "D3D12CopyQueueBackend.h"
+#include "AssetLoader.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
 
 extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -45,15 +69,6 @@ struct D3DResourceLeakChecker {
 	}
 };
 
-/// *****************************************************
-///　頂点データの拡張
-/// *****************************************************
-struct VertexData {
-	Vector4 position;
-	Vector2 texcoord;
-	Vector3 normal;
-};
-
 /// *****************************************************
 /// Transform情報を作る
 /// *****************************************************
@@ -73,14 +88,6 @@ struct Material {
 	Matrix4x4 uvTransform;
 };
 
-/// *****************************************************
-///　TransformationMatrixを拡張
-/// *****************************************************
-struct TransformationMatrix {
-	Matrix4x4 WVP;
-	Matrix4x4 World;
-};
-
 /// *****************************************************
 ///　平行光源を拡張
 /// *****************************************************
@@ -91,10 +98,15 @@ struct DirectionalLight {
 };
 
 /// *****************************************************
-///　ModelDataの構造体
+///　読み込んだTextureの一覧
 /// *****************************************************
-struct ModelData {
-	std::vector<VertexData> vertices;
+struct TextureTable {
+	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> resources;
+	std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> srvHandlesGPU;
+	std::unordered_map<std::string, uint32_t> indices; // 正規化したファイルパス -> 番号
+	uint32_t firstSrvIndex; // SRVを作り始めるDescriptorHeapの位置
+	uint32_t capacity; // firstSrvIndexから後ろに作れるSRVの数。越えた分は代わりのSRVのままにする
+	D3D12_GPU_DESCRIPTOR_HANDLE placeholderSrvHandleGPU; // 読み込み中のTextureの代わりに使うSRV
 };
 
 /// *****************************************************
@@ -129,21 +141,6 @@ const uint32_t kSubdivision = 32;
 
 #pragma region ///// 関数 /////
 
-/// *****************************************************
-/// Log関数
-/// *****************************************************
-
-// 出力ウィンドウに文字を出す
-void Log(const std::string& message) {
-
-	OutputDebugStringA(message.c_str());
-}
-
-void Log(const std::wstring& message) {
-
-	OutputDebugStringW(message.c_str());
-}
-
 /// *****************************************************
 /// ウィンドウブロージャー
 /// *****************************************************
@@ -274,7 +271,10 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
 	// 初期化で生成したものを3つ
 	IDxcUtils* dxcUtils,
 	IDxcCompiler3* dxcCompiler,
-	IDxcIncludeHandler* includeHandler) {
+	IDxcIncludeHandler* includeHandler,
+
+	// エントリーポイント。1つのファイルに複数ある時だけ指定する
+	const wchar_t* entryPoint = L"main") {
 
 	/* 1. hlslファイルを読み込む */
 	// これからシェーダーをコンパイルする旨をログに出す
@@ -296,7 +296,7 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShader(
 	/* 2. Compileする */
 	LPCWSTR arguments[] = {
 		filePath.c_str(), // コンパイル対象のhlslファイル名
-		L"-E", L"main",   // エントリーポイントの指定。基本的にmain以外にはしない
+		L"-E", entryPoint,   // エントリーポイントの指定。基本的にmain
 		L"-T", profile,   // ShaderProfileの設定
 		L"-Zi", L"-Qembed_debug",   // デバッグ用の情報を埋め込む
 		L"-Od",    // 最適化を外しておく
@@ -410,47 +410,25 @@ Microsoft::WRL::ComPtr<IDxcBlob> CompileShaderVertex(IDxcUtils* dxcUtils, IDxcCo
 }
 
 /// *****************************************************
-/// ShaderをCompileする(Pixel)
+/// ShaderをCompileする(Vertex、圧縮した頂点用)
 /// *****************************************************
-Microsoft::WRL::ComPtr<IDxcBlob> CompileShaderPixel(IDxcUtils* dxcUtils, IDxcCompiler3* dxcCompiler, IDxcIncludeHandler* includeHandler) {
+Microsoft::WRL::ComPtr<IDxcBlob> CompileShaderVertexPacked(IDxcUtils* dxcUtils, IDxcCompiler3* dxcCompiler, IDxcIncludeHandler* includeHandler) {
 	// Shaderをコンパイルする
-	Microsoft::WRL::ComPtr<IDxcBlob> pixelShaderBlob = CompileShader(L"Object3D.PS.hlsl", L"ps_6_0", dxcUtils, dxcCompiler, includeHandler);
-	assert(pixelShaderBlob != nullptr);
+	Microsoft::WRL::ComPtr<IDxcBlob> vertexShaderBlob = CompileShader(L"Object3d.VS.hlsl", L"vs_6_0", dxcUtils, dxcCompiler, includeHandler, L"mainPacked");
+	assert(vertexShaderBlob != nullptr);
 
-	return pixelShaderBlob;
+	return vertexShaderBlob;
 }
 
 /// *****************************************************
-/// VertexResourceを生成する
+/// ShaderをCompileする(Pixel)
 /// *****************************************************
-Microsoft::WRL::ComPtr<ID3D12Resource> CreateVertexResource(HRESULT hr, ID3D12Device* device, size_t sizeInBytes) {
-	// 頂点リソース用のヒープの設定
-	D3D12_HEAP_PROPERTIES uploadHeapProperties{};
-	uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;  // UploadHeapを使う
-
-	// 頂点リソースの設定
-	D3D12_RESOURCE_DESC vertexResourceDesc{};
-
-	// バッファリソース。テクスチャの場合はまた別の設定をする
-	vertexResourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	vertexResourceDesc.Width = sizeInBytes; // リソースのサイズ。今回はVector4を3頂点分
-
-	// バッファの場合はこれらは1にする決まり
-	vertexResourceDesc.Height = 1;
-	vertexResourceDesc.DepthOrArraySize = 1;
-	vertexResourceDesc.MipLevels = 1;
-	vertexResourceDesc.SampleDesc.Count = 1;
-
-	// バッファの場合はこれにする決まり
-	vertexResourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-	// 実際に頂点リソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexResource = nullptr;
-	hr = device->CreateCommittedResource(&uploadHeapProperties, D3D12_HEAP_FLAG_NONE, &vertexResourceDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&vertexResource));
-	assert(SUCCEEDED(hr));
+Microsoft::WRL::ComPtr<IDxcBlob> CompileShaderPixel(IDxcUtils* dxcUtils, IDxcCompiler3* dxcCompiler, IDxcIncludeHandler* includeHandler) {
+	// Shaderをコンパイルする
+	Microsoft::WRL::ComPtr<IDxcBlob> pixelShaderBlob = CompileShader(L"Object3D.PS.hlsl", L"ps_6_0", dxcUtils, dxcCompiler, includeHandler);
+	assert(pixelShaderBlob != nullptr);
 
-	return vertexResource;
+	return pixelShaderBlob;
 }
 
 /// *****************************************************
@@ -523,7 +501,7 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> CreateDescriptorHeap(
 }
 
 /// *****************************************************
-/// Textureデータを読む
+/// Textureデータを読む。読めなければ空のScratchImage(GetImageCountが0)を返す
 /// *****************************************************
 DirectX::ScratchImage LoadTexTure(const std::string& filePath) {
 
@@ -531,12 +509,18 @@ DirectX::ScratchImage LoadTexTure(const std::string& filePath) {
 	DirectX::ScratchImage image{};
 	std::wstring filePathW = ConvertString(filePath);
 	HRESULT hr = DirectX::LoadFromWICFile(filePathW.c_str(), DirectX::WIC_FLAGS_FORCE_SRGB, nullptr, image);
-	assert(SUCCEEDED(hr));
+	if (FAILED(hr)) {
+		Log(std::format("Failed to load texture: {} (hr=0x{:08X})\n", filePath, static_cast<uint32_t>(hr)));
+		return {};
+	}
 
 	// ミップマップの作成
 	DirectX::ScratchImage mipImages{};
 	hr = DirectX::GenerateMipMaps(image.GetImages(), image.GetImageCount(), image.GetMetadata(), DirectX::TEX_FILTER_SRGB, 0, mipImages);
-	assert(SUCCEEDED(hr));
+	if (FAILED(hr)) {
+		Log(std::format("Failed to generate mipmaps: {} (hr=0x{:08X})\n", filePath, static_cast<uint32_t>(hr)));
+		return {};
+	}
 
 	return mipImages;
 }
@@ -562,9 +546,7 @@ Microsoft::WRL::ComPtr<ID3D12Resource> CreateTextureResource(ID3D12Device* devic
 	/// 利用するHeapの設定
 	/// ***************************
 	D3D12_HEAP_PROPERTIES heapProperties{};
-	heapProperties.Type = D3D12_HEAP_TYPE_CUSTOM; // 細かい設定を行う
-	heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK; // WriteBackポリシーでCPUアクセス可能
-	heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0; // プロセッサの近くに配置
+	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT; // VRAM上に作る。中身はUploadManagerでコピーして送る
 
 	/// ***************************
 	/// Resourceの生成
@@ -574,17 +556,45 @@ Microsoft::WRL::ComPtr<ID3D12Resource> CreateTextureResource(ID3D12Device* devic
 		&heapProperties, // Heapの設定
 		D3D12_HEAP_FLAG_NONE, // Heapの特殊な設定。
 		&resourceDesc, // Resourceの設定
-		D3D12_RESOURCE_STATE_GENERIC_READ, // 初回のResourceState。Textureは基本読むだけ
+		D3D12_RESOURCE_STATE_COMMON, // 初回のResourceState。コピーでも描画でも、使う時に暗黙に遷移する
 		nullptr, // Clear最適値。
 		IID_PPV_ARGS(&resource)); // 作成するResourceポインタへのポインタ
 	assert(SUCCEEDED(hr));
 	return resource;
 }
 
+/// *****************************************************
+/// VRAM上のBufferResourceの作成
+/// *****************************************************
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(ID3D12Device* device, size_t sizeInBytes) {
+
+	// 利用するHeapの設定
+	D3D12_HEAP_PROPERTIES heapProperties{};
+	heapProperties.Type = D3D12_HEAP_TYPE_DEFAULT; // VRAM上に作る。中身はUploadManagerでコピーして送る
+
+	// バッファリソース。バッファの場合は高さなどを1にして、ROW_MAJORにする決まり
+	D3D12_RESOURCE_DESC resourceDesc{};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Width = sizeInBytes;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.SampleDesc.Count = 1;
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+	// Resourceの生成。バッファはCOMMONから、使う時に暗黙に遷移する
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource = nullptr;
+	HRESULT hr = device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+		D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&resource));
+	assert(SUCCEEDED(hr));
+
+	return resource;
+}
+
 /// *****************************************************
 /// データを転送するUploadTextureData関数の作成
 /// *****************************************************
-void UploadTextureData(ID3D12Resource* texture, const DirectX::ScratchImage& mipImages) {
+void UploadTextureData(UploadManager& uploadManager, ID3D12Resource* texture, const DirectX::ScratchImage& mipImages) {
 
 	// Meta情報を取得
 	const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
@@ -595,15 +605,15 @@ void UploadTextureData(ID3D12Resource* texture, const DirectX::ScratchImage& mip
 		// MipMapLevelを指定して各Imageを取得
 		const DirectX::Image* img = mipImages.GetImage(mipLevel, 0, 0);
 
-		// Textureに転送
-		HRESULT hr = texture->WriteToSubresource(
-			UINT(mipLevel),
-			nullptr,              // 全領域へコピー
-			img->pixels,          // 元データアドレス
-			UINT(img->rowPitch),  // １ラインサイズ
-			UINT(img->slicePitch) // １枚サイズ
-		);
-		assert(SUCCEEDED(hr));
+		// ステージングに写してコピーを積む。実際にGPUに送るのはFlushの時
+		TextureSubresourceData data{};
+		data.pixels = img->pixels;                                // 元データアドレス
+		data.rowPitch = img->rowPitch;                            // １ラインサイズ
+		data.rowCount = UINT(img->slicePitch / img->rowPitch);    // ライン数。圧縮形式ではブロックの行数
+		data.format = UINT(metadata.format);
+		data.width = UINT(img->width);
+		data.height = UINT(img->height);
+		uploadManager.UploadTexture(texture, UINT(mipLevel), data);
 	}
 }
 
@@ -668,88 +678,97 @@ D3D12_GPU_DESCRIPTOR_HANDLE GetGPUDescriptorHandle(ID3D12DescriptorHeap* descrip
 	return handleGPU;
 }
 
+/// <summary>
+/// スレッドごとに一度だけCOMを初期化し、スレッドが終わる時に片付ける
+/// WICはCOMを使うので、ワーカースレッドでTextureを読む前にEnsureを呼ぶ
+/// </summary>
+struct ComThreadScope final {
+	HRESULT hr;
+
+	ComThreadScope() : hr(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {
+		if (FAILED(hr)) {
+			Log(std::format("CoInitializeEx failed on a worker thread (hr=0x{:08X})\n", static_cast<uint32_t>(hr)));
+		}
+	}
+	~ComThreadScope() {
+		// 初期化できた時だけ対にする。S_FALSEは初期化済みだったという意味で、これも対にする
+		if (SUCCEEDED(hr)) {
+			CoUninitialize();
+		}
+	}
+
+	static void Ensure() { thread_local ComThreadScope scope; }
+};
+
 /// *****************************************************
-///　Objectファイルを読む関数
+/// Textureをワーカースレッドで読む。同じファイルは一度だけ読む
+/// 読めなかった時は空のScratchImageになるので、onLoadedではGetImageCountを確かめる
 /// *****************************************************
-ModelData LoadObjFile(const std::string& directoryPath, const std::string& filename) {
-
-	// 1.中で必要となる変数の宣言 //
-	ModelData modelData; // 構築するModelData
-	std::vector<Vector4> positions; // 位置
-	std::vector<Vector3> normals; // 法線
-	std::vector<Vector2> texcoords; // テクスチャ座標
-	std::string line; // ファイルから読んだ１行を格納するもの
-
-	// 2.ファイルを開く
-	std::ifstream file(directoryPath + "/" + filename); // ファイルを開く
-	assert(file.is_open()); // とりあえず開けなかったら止める
-
-	// 3. 実際にファイルを読み、ModelDataを構築していく
-	while (std::getline(file, line)) {
-		std::string identifier;
-		std::istringstream s(line);
-		s >> identifier; // 先頭の識別子を読む
-
-		// 頂点情報を得る
-		// 頂点位置
-		if (identifier == "v") {
-			Vector4 position;
-			s >> position.x >> position.y >> position.z;
-			position.w = 1.0f;
-			positions.push_back(position);
-			// 頂点テクスチャ座標
-		} else if (identifier == "vt") {
-			Vector2 texcoord;
-			s >> texcoord.x >> texcoord.y;
-			texcoords.push_back(texcoord);
-			// 頂点法線
-		} else if (identifier == "vn") {
-			Vector3 normal;
-			s >> normal.x >> normal.y >> normal.z;
-			normals.push_back(normal);
-
-			// 三角形を作る
-			// 面
-		} else if (identifier == "f") {
-
-			VertexData triangle[3];
-
-			// 面は三角形限定。その他は未対応
-			for (int32_t faceVertex = 0; faceVertex < 3; ++faceVertex) {
-				std::string vertexDefinition;
-				s >> vertexDefinition;
-
-				// 頂点の要素へのIndexは[位置/UV/法線]で格納されているので、分解してIndexを取得する
-				std::istringstream v(vertexDefinition);
-				uint32_t elementIndices[3];
-				for (int32_t element = 0; element < 3; ++element) {
-					std::string index;
-					std::getline(v, index, '/'); // 区切りでインデックスを読んでいく
-					elementIndices[element] = std::stoi(index);
-				}
+AssetHandle<DirectX::ScratchImage> LoadTextureAsync(AssetLoader& assetLoader, const std::string& filePath,
+	std::function<void(DirectX::ScratchImage&)> onLoaded = nullptr) {
 
-				//要素へのIndexから、実際の要素の値を取得して、頂点を構築する
-				Vector4 position = positions[elementIndices[0] - 1];
-				Vector2 texcoord = texcoords[elementIndices[1] - 1];
-				Vector3 normal = normals[elementIndices[2] - 1];
-				//position.x *= -1.0f; // 位置の反転
-				position.y *= -1.0f;
-				//normal.x *= -1.0f; // 法線の反転
-				normal.y *= -1.0f;
-				VertexData vertex = { position, texcoord, normal };
-				modelData.vertices.push_back(vertex);
-				triangle[faceVertex] = { position, texcoord, normal };
-			}
+	// "./Resources/a.png"と"Resources/a.png"を同じものとして扱う
+	std::string key = std::filesystem::path(filePath).lexically_normal().generic_string();
+	return assetLoader.Load<DirectX::ScratchImage>(key, [filePath]() {
+		ComThreadScope::Ensure();
+		return LoadTexTure(filePath);
+	}, std::move(onLoaded));
+}
 
-			// 頂点を逆順で登録することで、周り順を逆にする
-			modelData.vertices.push_back(triangle[2]);
-			modelData.vertices.push_back(triangle[1]);
-			modelData.vertices.push_back(triangle[0]);
-		}
+/// *****************************************************
+/// Textureの番号を決めて読み込みを頼む。読み終わるまでと、読めなかった時、DescriptorHeapに空きが無い時はplaceholderSrvHandleGPUを使う
+/// *****************************************************
+uint32_t RequestTexture(TextureTable& textureTable, AssetLoader& assetLoader, ID3D12Device* device, UploadManager& uploadManager,
+	ID3D12DescriptorHeap* srvDescriptorHeap, uint32_t descriptorSizeSRV, const std::string& filePath) {
+
+	// "./Resources/a.png"と"Resources/a.png"を同じものとして扱う
+	std::string key = std::filesystem::path(filePath).lexically_normal().generic_string();
+	auto it = textureTable.indices.find(key);
+	if (it != textureTable.indices.end()) {
+		return it->second;
 	}
 
-	// 4. ModelDataを返す
-	return modelData;
+	// 番号は先に決めて、読み終わるまでは代わりのSRVを指しておく
+	uint32_t index = static_cast<uint32_t>(textureTable.resources.size());
+	textureTable.resources.push_back(nullptr);
+	textureTable.srvHandlesGPU.push_back(textureTable.placeholderSrvHandleGPU);
+	textureTable.indices.emplace(key, index);
+
+	// DescriptorHeapに空きが無ければ読まずに、代わりのSRVのままにする
+	if (index >= textureTable.capacity) {
+		Log(std::format("No SRV slot left for texture: {} (capacity {})\n", filePath, textureTable.capacity));
+		return index;
+	}
+
+	// 読み終わったらメインスレッドで転送してSRVを作る。SRVは使っていない場所に作るので、描画中のフレームに影響しない
+	LoadTextureAsync(assetLoader, filePath, [&textureTable, device, &uploadManager, srvDescriptorHeap, descriptorSizeSRV, index](DirectX::ScratchImage& mipImages) {
+		// 読めなかった時は代わりのSRVを指したままにする
+		if (mipImages.GetImageCount() == 0) {
+			return;
+		}
+		const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
+		Microsoft::WRL::ComPtr<ID3D12Resource> textureResource = CreateTextureResource(device, metadata);
+		UploadTextureData(uploadManager, textureResource.Get(), mipImages);
+
+		// metadataを基にSRVの設定
+		D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
+		srvDesc.Format = metadata.format;
+		srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
+		srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels);
+
+		// 番号の場所にSRVを作成する。RequestTextureで空きを確かめてある
+		uint32_t srvIndex = textureTable.firstSrvIndex + index;
+		assert(index < textureTable.capacity);
+		device->CreateShaderResourceView(textureResource.Get(), &srvDesc, GetCPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, srvIndex));
+
+		textureTable.resources[index] = textureResource;
+		textureTable.srvHandlesGPU[index] = GetGPUDescriptorHandle(srvDescriptorHeap, descriptorSizeSRV, srvIndex);
+
+		// ステージングに写したので、CPU側の画像はもう要らない
+		mipImages.Release();
+	});
+	return index;
 }
 
 #pragma endregion
@@ -789,8 +808,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	RegisterClass(&wc);
 
 	// クライアント領域のサイズ 
-	const int32_t kClientWindth = 1280;
-	const int32_t kClientHeight = 720;
+	constexpr int32_t kClientWindth = 1280;
+	constexpr int32_t kClientHeight = 720;
+
+	// 透視投影の設定。LODを選ぶ時にも同じ値を使う
+	constexpr float kFovY = 0.45f;
+	constexpr float kNearClip = 0.1f;
+	constexpr float kFarClip = 100.0f;
 
 	// ウィンドウサイズを表す構造体にクライアント領域を入れる
 	RECT wrc = { 0,0,kClientWindth, kClientHeight };
@@ -953,14 +977,22 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	///  CommandAllocatorを生成する
 	/// *****************************************************
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator =
-		CreateCommandAllocator(hr, device.Get());
+	// 同時に進めるフレームの数。GPUが前のフレームを描いている間に、CPUは次のフレームを積める
+	constexpr uint32_t kFramesInFlight = 2;
+	static_assert(kFramesInFlight >= FramePacer::kMinFramesInFlight && kFramesInFlight <= FramePacer::kMaxFramesInFlight);
+
+	// GPUが使っている間はResetできないので、フレームの枠ごとに持つ
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocators[kFramesInFlight];
+	for (uint32_t i = 0; i < kFramesInFlight; ++i) {
+		commandAllocators[i] = CreateCommandAllocator(hr, device.Get());
+	}
 
 	/// *****************************************************
 	///  CommandListを生成する
 	/// *****************************************************
+	// 最初のフレームは枠0を使う
 	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> commandList =
-		CreateCommandList(hr, device.Get(), commandAllocator.Get());
+		CreateCommandList(hr, device.Get(), commandAllocators[0].Get());
 
 #pragma endregion
 
@@ -980,10 +1012,25 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	swapChainDesc.BufferCount = 2;  // ダブルバッファ
 	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;  // モニタに移したら、中身を破棄
 
+	// フレームの始めに、画面に出るのを待つ物を使うか。入力から表示までの遅れが減る
+	constexpr bool kUseFrameLatencyWaitableObject = true;
+	if (kUseFrameLatencyWaitableObject) {
+		swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	}
+
 	// コマンドキュー、ウィンドウハンドル、設定を渡して生成する
 	hr = dxgiFactory->CreateSwapChainForHwnd(commandQueue.Get(), hwnd, &swapChainDesc, nullptr, nullptr, reinterpret_cast<IDXGISwapChain1**>(swapChain.GetAddressOf()));
 	assert(SUCCEEDED(hr));
 
+	// 溜めるフレームを同時に進める数までにして、空くのを待つためのハンドルをもらう
+	HANDLE frameLatencyWaitableObject = nullptr;
+	if (kUseFrameLatencyWaitableObject) {
+		hr = swapChain->SetMaximumFrameLatency(kFramesInFlight);
+		assert(SUCCEEDED(hr));
+		frameLatencyWaitableObject = swapChain->GetFrameLatencyWaitableObject();
+		assert(frameLatencyWaitableObject != nullptr);
+	}
+
 	/// *****************************************************
 	///  SwapChainからResourceを引っ張ってくる
 	/// *****************************************************
@@ -998,75 +1045,133 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 #pragma endregion 
 
 #pragma region ///// Resourceの作成 /////
+	/// *****************************************************
+	/// UploadHeapのバッファをまとめて確保する所
+	/// *****************************************************
+	// 小さなCBufferや頂点ごとにリソースを作らず、Mapしたままの大きなページから切り出す
+	D3D12UploadPageBackend uploadPageBackend(device.Get());
+	LinearUploadAllocator uploadAllocator(uploadPageBackend);
+
+	/// *****************************************************
+	/// 書き換えないリソースをVRAMに送る所
+	/// *****************************************************
+	// ステージングに置いて、コピー用のキューでDEFAULTヒープのリソースにまとめて送る
+	constexpr size_t kUploadStagingSize = 16 * 1024 * 1024;
+	D3D12CopyQueueBackend copyQueueBackend(device.Get(), commandQueue.Get(), uploadPageBackend);
+	UploadManager uploadManager(uploadPageBackend, copyQueueBackend, kUploadStagingSize);
+
+	/// *****************************************************
+	/// アセットをワーカースレッドで読む所
+	/// *****************************************************
+	// 読み終わった物は、メインスレッドのUpdateかWaitでリソースを作って転送する
+	AssetLoader assetLoader;
+
 #pragma region ModelData
 	/// *****************************************************
 	/// ModelDataを使う
 	/// *****************************************************
-	// モデル読み込み
-	ModelData modelData = LoadObjFile("Resources", "fence.obj");
-
-	// 頂点リソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexResourceModel = CreateVertexResource(hr, device.Get(), sizeof(VertexData) * modelData.vertices.size());
+	// モデル読み込み。大きいファイルは全スレッドで分割して読む
+	// 頂点は圧縮した形式(PackedVertexData)でGPUに送る
+	ObjLoadDesc objLoadDesc{};
+	objLoadDesc.threadCount = 0;
+	objLoadDesc.packVertices = true;
+	AssetHandle<ModelData> modelHandle = assetLoader.Load<ModelData>("Resources/fence.obj", [objLoadDesc]() {
+		ModelData modelData;
+		LoadObjFile("Resources", "fence.obj", modelData, objLoadDesc);
+		return modelData;
+	});
+
+	// 使うと分かっているTextureも、モデルを読んでいる間に読み始めておく
+	LoadTextureAsync(assetLoader, "./Resources/fence.png");
+	LoadTextureAsync(assetLoader, "./Resources/monsterBall.png");
+
+	// この後はモデルが無いと作れないので、読み終わるまで待つ。読めなかった理由はLoadObjFileがログに出している
+	ModelData& modelData = assetLoader.Wait(modelHandle);
+	assert(!modelData.vertices.empty());
+	const bool usePackedVertices = objLoadDesc.packVertices;
+
+	// GPUに送る頂点。圧縮しているかどうかでサイズが変わる
+	const void* vertexSourceModel = usePackedVertices ? static_cast<const void*>(modelData.packedVertices.data()) : modelData.vertices.data();
+	const UINT vertexStrideModel = usePackedVertices ? UINT(sizeof(PackedVertexData)) : UINT(sizeof(VertexData));
+	const size_t vertexBufferSizeModel = size_t(vertexStrideModel) * modelData.vertices.size();
+
+	// 頂点リソースをVRAM上に作る
+	Microsoft::WRL::ComPtr<ID3D12Resource> vertexResourceModel = CreateBufferResource(device.Get(), vertexBufferSizeModel);
 
 	// 頂点バッファービューを作成する
 	D3D12_VERTEX_BUFFER_VIEW vertexBufferViewModel{};
 	vertexBufferViewModel.BufferLocation = vertexResourceModel->GetGPUVirtualAddress(); // リソースの先頭のアドレスから使う
-	vertexBufferViewModel.SizeInBytes = UINT(sizeof(VertexData) * modelData.vertices.size()); // 使用するリソースのサイズは頂点サイズ
-	vertexBufferViewModel.StrideInBytes = sizeof(VertexData); // 1頂点サイズ
+	vertexBufferViewModel.SizeInBytes = UINT(vertexBufferSizeModel); // 使用するリソースのサイズは頂点サイズ
+	vertexBufferViewModel.StrideInBytes = vertexStrideModel; // 1頂点サイズ
 
-	// 頂点リソースにデータを書き込む
-	VertexData* vertexDataModel = nullptr;
-	vertexResourceModel->Map(0, nullptr, reinterpret_cast<void**>(&vertexDataModel)); // 書き込むためのアドレスを取得
-	std::memcpy(vertexDataModel, modelData.vertices.data(), sizeof(VertexData) * modelData.vertices.size()); // 頂点データをリソースにコピー
+	// 頂点データをコピー用のキューで送る
+	uploadManager.UploadBuffer(vertexResourceModel.Get(), 0, vertexSourceModel, vertexBufferSizeModel);
 
-	/// *****************************************************
-	/// Material(ModelData)用のResourceを作る
-	/// *****************************************************
-	// マテリアル(スフィア)用のリソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> materialResourceModel =
-		CreateVertexResource(hr, device.Get(), sizeof(Material));
-
-	// マテリアルにデータをModel書き込む
-	Material* materialDataModel = nullptr;
+	// 圧縮した位置はAABBの中の[0,1]なので、元の位置に戻す変換をWVPの前に掛ける
+	Matrix4x4 dequantizeMatrixModel = MakeIdenitiy4x4();
+	if (usePackedVertices) {
+		Vector3 boundsExtent = modelData.boundsMax - modelData.boundsMin;
+		dequantizeMatrixModel = MakeAffineMatrix(boundsExtent, Vector3{ 0.0f, 0.0f, 0.0f }, modelData.boundsMin);
+	}
 
-	// 書き込むためのアドレスを取得
-	materialResourceModel->Map(0, nullptr, reinterpret_cast<void**>(&materialDataModel));
+	// インデックスリソースをVRAM上に作る
+	Microsoft::WRL::ComPtr<ID3D12Resource> indexResourceModel = CreateBufferResource(device.Get(), sizeof(uint32_t) * modelData.indices.size());
 
-	// 色の書き込み
-	materialDataModel->color = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
+	// インデックスバッファービューを作成する
+	D3D12_INDEX_BUFFER_VIEW indexBufferViewModel{};
+	indexBufferViewModel.BufferLocation = indexResourceModel->GetGPUVirtualAddress(); // リソースの先頭のアドレスから使う
+	indexBufferViewModel.SizeInBytes = UINT(sizeof(uint32_t) * modelData.indices.size()); // 使用するリソースのサイズはインデックスの数分
+	indexBufferViewModel.Format = DXGI_FORMAT_R32_UINT; // インデックスはUint32_tとする
 
-	// Lightingを有効化
-	materialDataModel->enableLighting = true;
+	// インデックスデータをコピー用のキューで送る
+	uploadManager.UploadBuffer(indexResourceModel.Get(), 0, modelData.indices.data(), sizeof(uint32_t) * modelData.indices.size());
 
-	// 単位行列で初期化
-	materialDataModel->uvTransform = MakeIdenitiy4x4();
+	// Meshletを間引いた後のインデックスリソース。毎フレームCPUで詰めて書き込むので、全部入る大きさにしておく
+	// 毎フレーム書き換えるので、GPUが読んでいる途中に書かないようにフレームの枠ごとに持つ
+	UploadAllocation culledIndexAllocationsModel[kFramesInFlight];
+	for (uint32_t i = 0; i < kFramesInFlight; ++i) {
+		culledIndexAllocationsModel[i] = uploadAllocator.Allocate(sizeof(uint32_t) * std::max<size_t>(modelData.lods[0].triangleCount * 3, 1));
+	}
+	D3D12_INDEX_BUFFER_VIEW culledIndexBufferViewModel{};
+	culledIndexBufferViewModel.Format = DXGI_FORMAT_R32_UINT;
+	std::vector<uint32_t> culledIndicesModel;
+	std::vector<SubMesh> culledSubMeshesModel;
+	culledIndicesModel.reserve(modelData.indices.size());
 
 	/// *****************************************************
-	/// TransformationMatrix(スフィア)用のResourceを作る
+	/// Material(ModelData)用のResourceを作る
 	/// *****************************************************
-	// WVP(スフィア)用のリソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> wvpResourceModel =
-		CreateVertexResource(hr, device.Get(), sizeof(TransformationMatrix));
+	// CBVのアドレスは256バイト境界でなければならないので、マテリアルごとに間を空けて並べる
+	const uint32_t kMaterialStride = (sizeof(Material) + D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1) & ~(D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT - 1);
+
+	// ImGuiで書き換えるので、CPU側に持っておき、毎フレームFrameRingAllocatorから切り出した所に書き込む
+	std::vector<Material> materialDataModel(modelData.materials.size());
+	for (size_t i = 0; i < modelData.materials.size(); ++i) {
+		// 色の書き込み。mtlファイルのKdとd
+		materialDataModel[i].color = modelData.materials[i].color;
 
-	// データを書き込む
-	TransformationMatrix* wvpDataModel = nullptr;
+		// Lightingを有効化
+		materialDataModel[i].enableLighting = true;
 
-	// 書き込むためのアドレスを取得
-	wvpResourceModel->Map(0, nullptr, reinterpret_cast<void**>(&wvpDataModel));
+		// 単位行列で初期化
+		materialDataModel[i].uvTransform = MakeIdenitiy4x4();
+	}
+	const size_t materialBufferSizeModel = kMaterialStride * std::max<size_t>(modelData.materials.size(), 1);
+
+	// WVP(モデル)用のCBufferは毎フレームFrameRingAllocatorから切り出す
 #pragma endregion
 #pragma region Sprite
 	/// *****************************************************
 	/// Sprite用のResourceの用意
 	/// *****************************************************
-	// スプライトの表示用Resource
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexResourceSprite =
-		CreateVertexResource(hr, device.Get(), sizeof(VertexData) * 6);
+	// スプライトの表示用の頂点を切り出す
+	UploadAllocation vertexAllocationSprite = uploadAllocator.Allocate(sizeof(VertexData) * 6);
 
 	// スプライト用の頂点バッファービューを作成
 	D3D12_VERTEX_BUFFER_VIEW vertexBufferViewSprite{};
 
-	// リソースの先頭のアドレスから使う
-	vertexBufferViewSprite.BufferLocation = vertexResourceSprite->GetGPUVirtualAddress();
+	// 切り出した所の先頭のアドレスから使う
+	vertexBufferViewSprite.BufferLocation = vertexAllocationSprite.gpuAddress;
 
 	// 使用するリソースのサイズは頂点6つ分のサイズ
 	vertexBufferViewSprite.SizeInBytes = sizeof(VertexData) * 6;
@@ -1077,15 +1182,11 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// Material(スプライト)用のResourceを作る
 	/// *****************************************************
-	// Material(スプライト)用のResource
-	Microsoft::WRL::ComPtr<ID3D12Resource> materialResourceSprite =
-		CreateVertexResource(hr, device.Get(), sizeof(Material) * 3);
-
-	// マテリアルにデータを書き込む
-	Material* materialDataSprite = nullptr;
+	// Material(スプライト)用のCBufferを切り出す
+	UploadAllocation materialAllocationSprite = uploadAllocator.AllocateConstantBuffer(sizeof(Material));
 
-	// 書き込むためのアドレスを取得
-	materialResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&materialDataSprite));
+	// マテリアルにデータを書き込むためのアドレス
+	Material* materialDataSprite = static_cast<Material*>(materialAllocationSprite.cpuAddress);
 
 	// 色の書き込み
 	materialDataSprite->color = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -1099,14 +1200,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// Index(スプライト)のResourceの作成
 	/// *****************************************************
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexResourceSprite =
-		CreateVertexResource(hr, device.Get(), sizeof(uint32_t) * 6);
+	UploadAllocation indexAllocationSprite = uploadAllocator.Allocate(sizeof(uint32_t) * 6);
 
 	// Viewの作成(IndexBufferView<IBV>)
 	D3D12_INDEX_BUFFER_VIEW indexBufferViewSprite{};
 
-	// リソースの先頭のアドレスから使う
-	indexBufferViewSprite.BufferLocation = indexResourceSprite->GetGPUVirtualAddress();
+	// 切り出した所の先頭のアドレスから使う
+	indexBufferViewSprite.BufferLocation = indexAllocationSprite.gpuAddress;
 
 	// 使用するリソースのサイズはインデックス6つ分
 	indexBufferViewSprite.SizeInBytes = sizeof(uint32_t) * 6;
@@ -1118,15 +1218,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// スフィア用のResourceの用意
 	/// *****************************************************
-	// スフィアの表示用のResource
-	Microsoft::WRL::ComPtr<ID3D12Resource> vertexResourceSphere =
-		CreateVertexResource(hr, device.Get(), sizeof(VertexData) * (kSubdivision * kSubdivision * 6));
+	// スフィアの表示用の頂点を切り出す
+	UploadAllocation vertexAllocationSphere = uploadAllocator.Allocate(sizeof(VertexData) * (kSubdivision * kSubdivision * 6));
 
 	// スフィア用の頂点バッファービューを作成
 	D3D12_VERTEX_BUFFER_VIEW vertexBufferViewSphere{};
 
-	// リソースの先頭のアドレスから使う
-	vertexBufferViewSphere.BufferLocation = vertexResourceSphere->GetGPUVirtualAddress();
+	// 切り出した所の先頭のアドレスから使う
+	vertexBufferViewSphere.BufferLocation = vertexAllocationSphere.gpuAddress;
 
 	// 使用するリソースのサイズは頂点6つ分のサイズ
 	vertexBufferViewSphere.SizeInBytes = sizeof(VertexData) * (kSubdivision * kSubdivision * 6);
@@ -1137,15 +1236,11 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// Material(スフィア)用のResourceを作る
 	/// *****************************************************
-	// マテリアル(スフィア)用のリソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> materialResourceSphere = 
-		CreateVertexResource(hr, device.Get(), sizeof(Material));
-
-	// マテリアルにデータを書き込む
-	Material* materialDataSphere = nullptr;
+	// マテリアル(スフィア)用のCBufferを切り出す
+	UploadAllocation materialAllocationSphere = uploadAllocator.AllocateConstantBuffer(sizeof(Material));
 
-	// 書き込むためのアドレスを取得
-	materialResourceSphere->Map(0, nullptr, reinterpret_cast<void**>(&materialDataSphere));
+	// マテリアルにデータを書き込むためのアドレス
+	Material* materialDataSphere = static_cast<Material*>(materialAllocationSphere.cpuAddress);
 
 	// 色の書き込み
 	materialDataSphere->color = Vector4(1.0f, 1.0f, 1.0f, 1.0f);
@@ -1159,14 +1254,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// Index(スフィア)のResourceの作成
 	/// *****************************************************
-	Microsoft::WRL::ComPtr<ID3D12Resource> indexResourceSphere =
-		CreateVertexResource(hr, device.Get(), sizeof(uint32_t) * (kSubdivision * kSubdivision * 6));
+	UploadAllocation indexAllocationSphere = uploadAllocator.Allocate(sizeof(uint32_t) * (kSubdivision * kSubdivision * 6));
 
 	// Viewの作成
 	D3D12_INDEX_BUFFER_VIEW indexBufferViewSphere{};
 
-	// リソースの先頭のアドレスから使う
-	indexBufferViewSphere.BufferLocation = indexResourceSphere->GetGPUVirtualAddress();
+	// 切り出した所の先頭のアドレスから使う
+	indexBufferViewSphere.BufferLocation = indexAllocationSphere.gpuAddress;
 
 	// 使用するリソースのサイズはインデックス６つ分
 	indexBufferViewSphere.SizeInBytes = sizeof(uint32_t) * (kSubdivision * kSubdivision * 6);
@@ -1177,29 +1271,18 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// TransformationMatrix(スフィア)用のResourceを作る
 	/// *****************************************************
-	// WVP(スフィア)用のリソースを作る
-	Microsoft::WRL::ComPtr<ID3D12Resource> wvpResourceSphere = 
-		CreateVertexResource(hr, device.Get(), sizeof(TransformationMatrix));
+	// WVP(スフィア)用のCBufferを切り出す
+	UploadAllocation wvpAllocationSphere = uploadAllocator.AllocateConstantBuffer(sizeof(TransformationMatrix));
 
-	// データを書き込む
-	TransformationMatrix* wvpDataSphere = nullptr;
-
-	// 書き込むためのアドレスを取得
-	wvpResourceSphere->Map(0, nullptr, reinterpret_cast<void**>(&wvpDataSphere));
+	// データを書き込むためのアドレス
+	TransformationMatrix* wvpDataSphere = static_cast<TransformationMatrix*>(wvpAllocationSphere.cpuAddress);
 #pragma endregion
 
 	/// *****************************************************
-	/// 平行光源のResourceの作成
+	/// 平行光源のデータ
 	/// *****************************************************
-	// 平行光源のResource
-	Microsoft::WRL::ComPtr<ID3D12Resource> directionalLightResource =
-		CreateVertexResource(hr, device.Get(), sizeof(DirectionalLight));
-
-	// データを書き込む
-	DirectionalLight* directionalLightData = nullptr;
-
-	// 書き込むアドレスを取得
-	directionalLightResource->Map(0, nullptr, reinterpret_cast<void**>(&directionalLightData));
+	// ImGuiで書き換えるのでCPU側に持っておき、毎フレームFrameRingAllocatorから切り出した所に書き込む
+	DirectionalLight directionalLightData{};
 
 	/// *****************************************************
 	/// depthStencilResourceの作成
@@ -1208,18 +1291,7 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	Microsoft::WRL::ComPtr<ID3D12Resource> depthStencilResource =
 		CreateDepthStencilTetureResource(device.Get(), kClientWindth, kClientHeight);
 
-	/// *****************************************************
-	/// Transform周りを作る
-	/// *****************************************************
-	// Sprite用のTransformMatrix用のリソースを作る。
-	Microsoft::WRL::ComPtr<ID3D12Resource> transformMatrixResourceSprite = 
-		CreateVertexResource(hr, device.Get(), sizeof(TransformationMatrix));
-
-	//データを書き込む
-	TransformationMatrix* transformtionMatrixDataSprite = nullptr;
-
-	// 書き込む為のアドレスを取得
-	transformMatrixResourceSprite->Map(0, nullptr, reinterpret_cast<void**>(&transformtionMatrixDataSprite));
+	// Sprite用のTransformMatrix用のCBufferも、毎フレームFrameRingAllocatorから切り出す
 
 #pragma endregion
 
@@ -1233,8 +1305,13 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 		CreateDescriptorHeap(device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 2, false);
 
 	// SRV用のディスクリプタヒープの生成
+	// 0番はImGui、1番は読み込み中の代わりの白い1x1のTexture。2番から順にTextureのSRVを作る
+	// Textureは固定の2枚と、マテリアルごとに1枚までなので、全部違うファイルでも入る数にする
+	constexpr uint32_t kPlaceholderSrvIndex = 1;
+	constexpr uint32_t kFixedTextureCount = 2;
+	const uint32_t textureSrvCapacity = kFixedTextureCount + static_cast<uint32_t>(modelData.materials.size());
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> srvDescriptorHeap = 
-		CreateDescriptorHeap(device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 128, true);
+		CreateDescriptorHeap(device.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kPlaceholderSrvIndex + 1 + textureSrvCapacity, true);
 
 	// DSV用のヒープでディスクリプタの数は1。
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvDescriptorHeap = 
@@ -1271,48 +1348,59 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	device->CreateRenderTargetView(swapChainResources[1].Get(), &rtvDesc, rtvHandles[1]);
 
 	/// *****************************************************
-	/// Textureの転送
-	/// *****************************************************
-	// Textureを読んで転送する
-	DirectX::ScratchImage mipImages = LoadTexTure("./Resources/fence.png");
-	const DirectX::TexMetadata& metadata = mipImages.GetMetadata();
-	Microsoft::WRL::ComPtr<ID3D12Resource> textureResource = CreateTextureResource(device.Get(), metadata);
-	UploadTextureData(textureResource.Get(), mipImages);
-
-	// ２枚目のTextureを読んで転送する
-	DirectX::ScratchImage mipImages2 = LoadTexTure("./Resources/monsterBall.png");
-	const DirectX::TexMetadata& metadata2 = mipImages2.GetMetadata();
-	Microsoft::WRL::ComPtr<ID3D12Resource> textureResource2 = CreateTextureResource(device.Get(), metadata2);
-	UploadTextureData(textureResource2.Get(), mipImages2);
-
-	/// *****************************************************
-	///  SRVの作成
-	/// *****************************************************
-	// metadataを基にSRVの設定
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc{};
-	srvDesc.Format = metadata.format;
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-	srvDesc.Texture2D.MipLevels = UINT(metadata.mipLevels); 
-
-	// metadata2を基に2個目のSRVの設定
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc2{};
-	srvDesc2.Format = metadata.format;
-	srvDesc2.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc2.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D; // 2Dテクスチャ
-	srvDesc2.Texture2D.MipLevels = UINT(metadata2.mipLevels);
-
-	// SRVを作成するDescriptorHeapの場所を決める
-	D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU = GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 1);
-	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU = GetGPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 1);
-
-	// SRVを作成するDescriptorHeapの場所を決める
-	D3D12_CPU_DESCRIPTOR_HANDLE textureSrvHandleCPU2 = GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 2);
-	D3D12_GPU_DESCRIPTOR_HANDLE textureSrvHandleGPU2 = GetGPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, 2);
+	/// Textureの転送とSRVの作成
+	/// *****************************************************
+	// DescriptorHeapの0番はImGuiが使い、1番は読み込み中の代わりの白い1x1のTexture。2番から順に作る
+	TextureTable textureTable{};
+	textureTable.firstSrvIndex = kPlaceholderSrvIndex + 1;
+	textureTable.capacity = textureSrvCapacity;
+
+	// 代わりのTextureはすぐに使うので、ここで作って転送する
+	DirectX::TexMetadata placeholderMetadata{};
+	placeholderMetadata.width = 1;
+	placeholderMetadata.height = 1;
+	placeholderMetadata.depth = 1;
+	placeholderMetadata.arraySize = 1;
+	placeholderMetadata.mipLevels = 1;
+	placeholderMetadata.format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	placeholderMetadata.dimension = DirectX::TEX_DIMENSION_TEXTURE2D;
+	Microsoft::WRL::ComPtr<ID3D12Resource> placeholderTextureResource = CreateTextureResource(device.Get(), placeholderMetadata);
+	const uint32_t kPlaceholderPixel = 0xFFFFFFFF;
+	uploadManager.UploadTexture(placeholderTextureResource.Get(), 0, { &kPlaceholderPixel, sizeof(kPlaceholderPixel), 1, UINT(placeholderMetadata.format), 1, 1 });
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC placeholderSrvDesc{};
+	placeholderSrvDesc.Format = placeholderMetadata.format;
+	placeholderSrvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	placeholderSrvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+	placeholderSrvDesc.Texture2D.MipLevels = 1;
+	device->CreateShaderResourceView(placeholderTextureResource.Get(), &placeholderSrvDesc, GetCPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, kPlaceholderSrvIndex));
+	textureTable.placeholderSrvHandleGPU = GetGPUDescriptorHandle(srvDescriptorHeap.Get(), descriptorSizeSRV, kPlaceholderSrvIndex);
+
+	// Textureの読み込みを頼む。読み終わったフレームから本物に切り替わる
+	uint32_t textureIndex = RequestTexture(textureTable, assetLoader, device.Get(), uploadManager, srvDescriptorHeap.Get(), descriptorSizeSRV, "./Resources/fence.png");
+
+	// ２枚目のTexture
+	RequestTexture(textureTable, assetLoader, device.Get(), uploadManager, srvDescriptorHeap.Get(), descriptorSizeSRV, "./Resources/monsterBall.png");
+
+	// モデルのマテリアルが使うTexture。読み込み済みのファイルは使い回す
+	std::vector<uint32_t> materialTextureIndices(modelData.materials.size());
+	for (size_t i = 0; i < modelData.materials.size(); ++i) {
+		const std::string& textureFilePath = modelData.materials[i].textureFilePath;
+		materialTextureIndices[i] = textureFilePath.empty() ? textureIndex :
+			RequestTexture(textureTable, assetLoader, device.Get(), uploadManager, srvDescriptorHeap.Get(), descriptorSizeSRV, textureFilePath);
+	}
 
-	// SRVの生成
-	device->CreateShaderResourceView(textureResource.Get(), &srvDesc, textureSrvHandleCPU);
-	device->CreateShaderResourceView(textureResource2.Get(), &srvDesc2, textureSrvHandleCPU2);
+	// 描画中の切り替えが少なくなるように、SubMeshをTexture、マテリアルの順に並べておく
+	std::vector<uint32_t> subMeshDrawOrder(modelData.subMeshes.size());
+	std::iota(subMeshDrawOrder.begin(), subMeshDrawOrder.end(), 0);
+	std::stable_sort(subMeshDrawOrder.begin(), subMeshDrawOrder.end(), [&](uint32_t a, uint32_t b) {
+		uint32_t materialA = modelData.subMeshes[a].materialIndex;
+		uint32_t materialB = modelData.subMeshes[b].materialIndex;
+		if (materialTextureIndices[materialA] != materialTextureIndices[materialB]) {
+			return materialTextureIndices[materialA] < materialTextureIndices[materialB];
+		}
+		return materialA < materialB;
+	});
 
 
 	/// *****************************************************
@@ -1337,15 +1425,41 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// FenceとEventを生成する
 	/// *****************************************************
-	// 初期値0でFenceを作る{
-	Microsoft::WRL::ComPtr<ID3D12Fence> fence = nullptr;
-	uint64_t fenceValue = 0;
-	hr = device->CreateFence(fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence));
-	assert(SUCCEEDED(hr));
+	// 初期値0のFenceと、Signalを待つためのイベントを作る
+	D3D12FrameFence frameFence(device.Get(), commandQueue.Get());
 
-	// FenceのSignalを待つためのイベントを作成する
-	HANDLE fenceEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
-	assert(fenceEvent != nullptr);
+	// フレームの枠を順に使い回し、枠をもう一度使う時だけ、その枠の前のフレームを待つ
+	FramePacer framePacer(frameFence, kFramesInFlight);
+
+	/// *****************************************************
+	/// 毎フレーム書き換えるCBufferの置き場所
+	/// *****************************************************
+	// GPUが読んでいる途中のCBufferを書き換えないように、フレームごとに新しい所を切り出す
+	// 同時に進む最大3フレームと、終わりから先頭に戻る時に捨てる1フレーム分が入る大きさにする
+	constexpr size_t kFrameRingFrameCount = 4;
+	const size_t frameConstantBufferSize = materialBufferSizeModel + LinearUploadAllocator::kConstantBufferAlignment * 3;
+	const size_t frameRingSize = (frameConstantBufferSize * kFrameRingFrameCount + LinearUploadAllocator::kPageAlignment - 1) & ~(LinearUploadAllocator::kPageAlignment - 1);
+	FrameRingAllocator frameRingAllocator(uploadPageBackend, frameRingSize);
+
+	// 入らない時は、一番古いフレームをGPUが使い終わるまで待って空ける
+	auto allocateFrameConstantBuffer = [&](size_t size) {
+		UploadAllocation allocation{};
+		while (!frameRingAllocator.TryAllocateConstantBuffer(size, allocation)) {
+			assert(frameRingAllocator.GetPendingFrameCount() > 0);
+			frameFence.Wait(frameRingAllocator.GetOldestFenceValue());
+			frameRingAllocator.Reclaim(frameFence.GetCompletedValue());
+		}
+		return allocation;
+	};
+
+	// 次のフレームの枠を空けてから、画面に出るのを待つ。待っている間に来た入力も、次のフレームで拾える
+	auto beginFrame = [&]() {
+		uint32_t frameIndex = framePacer.BeginFrame();
+		if (frameLatencyWaitableObject != nullptr) {
+			WaitForSingleObjectEx(frameLatencyWaitableObject, 1000, TRUE);
+		}
+		return frameIndex;
+	};
 
 #pragma endregion
 
@@ -1463,10 +1577,32 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	inputLayoutDesc.pInputElementDescs = inputElementDescs;
 	inputLayoutDesc.NumElements = _countof(inputElementDescs);
 
+	// 圧縮した頂点(PackedVertexData)用。IAで[0,1]、floatに戻し、法線の展開だけShaderで行う
+	D3D12_INPUT_ELEMENT_DESC inputElementDescsPacked[3] = {};
+	inputElementDescsPacked[0].SemanticName = "POSITION";
+	inputElementDescsPacked[0].SemanticIndex = 0;
+	inputElementDescsPacked[0].Format = DXGI_FORMAT_R16G16B16A16_UNORM;
+	inputElementDescsPacked[0].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+	inputElementDescsPacked[1].SemanticName = "TEXCOORD";
+	inputElementDescsPacked[1].SemanticIndex = 0;
+	inputElementDescsPacked[1].Format = DXGI_FORMAT_R16G16_FLOAT;
+	inputElementDescsPacked[1].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+	inputElementDescsPacked[2].SemanticName = "NORMAL";
+	inputElementDescsPacked[2].SemanticIndex = 0;
+	inputElementDescsPacked[2].Format = DXGI_FORMAT_R16G16_SNORM;
+	inputElementDescsPacked[2].AlignedByteOffset = D3D12_APPEND_ALIGNED_ELEMENT;
+
+	D3D12_INPUT_LAYOUT_DESC inputLayoutDescPacked{};
+	inputLayoutDescPacked.pInputElementDescs = inputElementDescsPacked;
+	inputLayoutDescPacked.NumElements = _countof(inputElementDescsPacked);
+
 	/// *******************************************************************
 	/// VertexShader
 	/// *******************************************************************
 	Microsoft::WRL::ComPtr<IDxcBlob> vertexShaderBlob = CompileShaderVertex(dxcUtils.Get(), dxcCompiler.Get(), includeHandler.Get());
+	Microsoft::WRL::ComPtr<IDxcBlob> vertexShaderBlobPacked = CompileShaderVertexPacked(dxcUtils.Get(), dxcCompiler.Get(), includeHandler.Get());
 
 	/// *******************************************************************
 	/// PixelShader
@@ -1508,6 +1644,14 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	hr = device->CreateGraphicsPipelineState(&graphicsPipelineStateDesc, IID_PPV_ARGS(&grapicsPipelineState));
 	assert(SUCCEEDED(hr));
 
+	// 圧縮した頂点用。InputLayoutとVertexShaderだけが違う
+	graphicsPipelineStateDesc.InputLayout = inputLayoutDescPacked;
+	graphicsPipelineStateDesc.VS = { vertexShaderBlobPacked->GetBufferPointer(),
+		vertexShaderBlobPacked->GetBufferSize() };
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> grapicsPipelineStatePacked = nullptr;
+	hr = device->CreateGraphicsPipelineState(&graphicsPipelineStateDesc, IID_PPV_ARGS(&grapicsPipelineStatePacked));
+	assert(SUCCEEDED(hr));
+
 #pragma endregion
 
 #pragma region ///// データの書き込み /////
@@ -1524,15 +1668,11 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	uint32_t* indexDataSprite = nullptr;
 	uint32_t* indexDataSphere = nullptr;
 
-	// 書き込むためのアドレスを取得
-	vertexResourceSprite->Map(
-		0, nullptr, reinterpret_cast<void**>(&vertexDataSprite));
-	vertexResourceSphere->Map(
-		0, nullptr, reinterpret_cast<void**>(&vertexDataSphere));
-	indexResourceSprite->Map(
-		0, nullptr, reinterpret_cast<void**>(&indexDataSprite));
-	indexResourceSphere->Map(
-		0, nullptr, reinterpret_cast<void**>(&indexDataSphere));
+	// 書き込むためのアドレス
+	vertexDataSprite = static_cast<VertexData*>(vertexAllocationSprite.cpuAddress);
+	vertexDataSphere = static_cast<VertexData*>(vertexAllocationSphere.cpuAddress);
+	indexDataSprite = static_cast<uint32_t*>(indexAllocationSprite.cpuAddress);
+	indexDataSphere = static_cast<uint32_t*>(indexAllocationSphere.cpuAddress);
 
 	/* /////////////////////////
 		      スプライト
@@ -1565,9 +1705,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// 平行光源をShaderで使う
 	/// *****************************************************
 	// デフォルト値はとりあえず以下のようにしておく
-	directionalLightData->color = { 1.0f, 1.0f, 1.0f, 1.0f };
-	directionalLightData->direction = { 0.0f, -1.0f, 0.0f };
-	directionalLightData->intensity = 1.0f;
+	directionalLightData.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+	directionalLightData.direction = { 0.0f, -1.0f, 0.0f };
+	directionalLightData.intensity = 1.0f;
+
+	// ImGuiで触る向き。Shaderは向きを正規化しないので、長さを1にしてから書き込む
+	Vector3 lightDirection = directionalLightData.direction;
 
 	/// *****************************************************
 	/// Transform情報を作る
@@ -1605,8 +1748,9 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	ImGui::CreateContext();
 	ImGui::StyleColorsDark();
 	ImGui_ImplWin32_Init(hwnd);
+	// ImGuiも頂点バッファをフレームごとに持つので、同時に進むフレームの数以上にする
 	ImGui_ImplDX12_Init(device.Get(),
-		swapChainDesc.BufferCount,
+		std::max<UINT>(swapChainDesc.BufferCount, kFramesInFlight),
 		rtvDesc.Format,
 		srvDescriptorHeap.Get(),
 		srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
@@ -1619,11 +1763,56 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	bool useMonsterBall = true;
 
+	// Meshlet単位で見えない三角形を間引くか
+	bool useMeshletCulling = true;
+	MeshletCullStatistics meshletCullStatistics{};
+
+	// モデル全体のAABBが視錐台に入っているか。外なら描かない
+	bool isModelVisible = true;
+
+	// シーンのオブジェクトのワールド座標のAABBと、それをまとめたBVH。今はモデルだけ
+	// 動いたオブジェクトだけを毎フレームRefitする
+	constexpr uint32_t kModelObjectIndex = 0;
+	BoundingBoxArrays sceneBoxes;
+	ResizeBoundingBoxArrays(sceneBoxes, 1);
+	SetTransformedBoundingBox(sceneBoxes, kModelObjectIndex, modelData.boundsMin, modelData.boundsMax, MakeAffineMatrix(transform.scale, transform.rotate, transform.translate));
+	Bvh sceneBvh;
+	BuildBvh(sceneBoxes, sceneBvh);
+	const std::vector<uint32_t> changedObjectsModel = { kModelObjectIndex };
+
+	// マウスで選んだオブジェクト。選んでいなければ-1
+	int32_t pickedObject = -1;
+
+	// LODの選び方。forcedLodModelが-1なら、画面上の誤差がmaxScreenErrorModel(ピクセル)に収まる一番粗い段を選ぶ
+	int32_t forcedLodModel = -1;
+	float maxScreenErrorModel = 1.0f;
+	uint32_t lodModel = 0;
+	float lodScreenErrorModel = 0.0f;
+
+	/// *****************************************************
+	/// 毎フレーム変わらない行列
+	/// *****************************************************
+	// 単位行列と、Sprite用のView(単位行列)*正射影はコンパイル時に作る
+	constexpr Matrix4x4 kIdentityMatrix = MakeIdenitiy4x4();
+	constexpr Matrix4x4 kViewProjectionMatrixSprite =
+		Mutiply(kIdentityMatrix, MakeOrethographicMatrx(0.0f, 0.0f, float(kClientWindth), float(kClientHeight), 0.0f, 100.0f));
+	static_assert(TransformPoint({ float(kClientWindth), float(kClientHeight), 0.0f }, kViewProjectionMatrixSprite).x == 1.0f);
+	static_assert(TransformPoint({ float(kClientWindth), float(kClientHeight), 0.0f }, kViewProjectionMatrixSprite).y == -1.0f);
+
+	// 透視投影はtanを使うのでコンパイル時には作れないが、ウィンドウの大きさで決まるのでループの前で1回だけ作る
+	const Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(kFovY, float(kClientWindth) / float(kClientHeight), kNearClip, kFarClip);
+
 	/// *****************************************************
 	/// メインループ
 	/// *****************************************************
 	MSG msg{};
 
+	// 積んだコピーを出して、描画用のキューがそれを待ってから描くようにする
+	uploadManager.SynchronizeDirectQueue();
+
+	// 最初のフレームの枠を使い始める。CommandListは枠0のAllocatorで開いたまま
+	beginFrame();
+
 	// ウィンドウのxボタンが押されるまでループ
 	while (msg.message != WM_QUIT) {
 
@@ -1633,6 +1822,12 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			DispatchMessage(&msg);
 		} else {
 
+			// 読み終わったアセットをメインスレッドで仕上げる。Textureはここで転送を積んでSRVを切り替える
+			assetLoader.Update();
+
+			// 積んだ転送を出して、このフレームの描画がそれを待つようにする
+			uploadManager.SynchronizeDirectQueue();
+
 			// フレームの先頭でImGuiに、ここからフレームが始まる旨を告げる
 			ImGui_ImplDX12_NewFrame();
 			ImGui_ImplWin32_NewFrame();
@@ -1657,19 +1852,64 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			ImGui::Checkbox("useMonsterBall", &useMonsterBall);
 			ImGui::End();
 
+			ImGui::Begin("Meshlet");
+			ImGui::Text("model %s", isModelVisible ? "visible" : "culled");
+			ImGui::Checkbox("useMeshletCulling", &useMeshletCulling);
+			ImGui::Text("meshlets %zu / %zu (frustum %zu, backface %zu)", meshletCullStatistics.visibleMeshletCount, modelData.meshlets.size(),
+				meshletCullStatistics.frustumCulledMeshletCount, meshletCullStatistics.backfaceCulledMeshletCount);
+			ImGui::Text("triangles %zu / %u", meshletCullStatistics.visibleTriangleCount, modelData.lods[0].triangleCount);
+			ImGui::End();
+
+			ImGui::Begin("Picking");
+			ImGui::Text("picked %d", pickedObject);
+			ImGui::End();
+
+			ImGui::Begin("Assets");
+			AssetLoadProgress assetLoadProgress = assetLoader.GetProgress();
+			ImGui::ProgressBar(assetLoadProgress.GetRatio());
+			ImGui::Text("ready %u / %u, decoded %u", assetLoadProgress.readyCount, assetLoadProgress.requestedCount, assetLoadProgress.decodedCount);
+			ImGui::End();
+
+			ImGui::Begin("LOD");
+			ImGui::SliderInt("forcedLod", &forcedLodModel, -1, static_cast<int>(modelData.lods.size()) - 1);
+			ImGui::DragFloat("maxScreenError", &maxScreenErrorModel, 0.05f, 0.1f, 32.0f);
+			ImGui::Text("LOD %u / %zu, triangles %u, error %.2fpx", lodModel, modelData.lods.size(), modelData.lods[lodModel].triangleCount, lodScreenErrorModel);
+			ImGui::End();
+
 			ImGui::Begin("info");
 			ImGui::SliderAngle("UVRotate", &uvTransformSprite.rotate.z);
 			ImGui::SliderAngle("SphereRotateX", &transform.rotate.x);
 			ImGui::SliderAngle("SphereRotateY", &transform.rotate.y);
 			ImGui::SliderAngle("SphereRotateZ", &transform.rotate.z);
-			ImGui::ColorEdit4("Color", &materialDataModel->color.x);
-			ImGui::ColorEdit4("LigthColor", &directionalLightData->color.x);
-			ImGui::DragFloat3("LightDirection", &directionalLightData->direction.x, 0.01f);
-			ImGui::SliderAngle("LightIntensity", &directionalLightData->intensity);
+			for (size_t i = 0; i < materialDataModel.size(); ++i) {
+				ImGui::PushID(static_cast<int>(i));
+				ImGui::ColorEdit4(modelData.materials[i].name.c_str(), &materialDataModel[i].color.x);
+				ImGui::PopID();
+			}
+			ImGui::ColorEdit4("LigthColor", &directionalLightData.color.x);
+			ImGui::DragFloat3("LightDirection", &lightDirection.x, 0.01f);
+			ImGui::SliderAngle("LightIntensity", &directionalLightData.intensity);
 			ImGui::End();
 
 #endif // DEBUG
 
+			if (Dot(lightDirection, lightDirection) > 0.0f) {
+				directionalLightData.direction = Normalize(lightDirection);
+			}
+
+			// このフレームのCBufferを切り出して書き込む。GPUが終わったフレームの分は先に空けておく
+			frameRingAllocator.Reclaim(frameFence.GetCompletedValue());
+			UploadAllocation materialFrameAllocationModel = allocateFrameConstantBuffer(materialBufferSizeModel);
+			for (size_t i = 0; i < materialDataModel.size(); ++i) {
+				std::memcpy(static_cast<uint8_t*>(materialFrameAllocationModel.cpuAddress) + kMaterialStride * i, &materialDataModel[i], sizeof(Material));
+			}
+			UploadAllocation directionalLightFrameAllocation = allocateFrameConstantBuffer(sizeof(DirectionalLight));
+			std::memcpy(directionalLightFrameAllocation.cpuAddress, &directionalLightData, sizeof(DirectionalLight));
+			UploadAllocation wvpFrameAllocationModel = allocateFrameConstantBuffer(sizeof(TransformationMatrix));
+			TransformationMatrix* wvpDataModel = static_cast<TransformationMatrix*>(wvpFrameAllocationModel.cpuAddress);
+			UploadAllocation transformMatrixFrameAllocationSprite = allocateFrameConstantBuffer(sizeof(TransformationMatrix));
+			TransformationMatrix* transformtionMatrixDataSprite = static_cast<TransformationMatrix*>(transformMatrixFrameAllocationSprite.cpuAddress);
+
 			// WorldMatrixを作る
 			Matrix4x4 worldMatrix = MakeAffineMatrix(transform.scale, transform.rotate, transform.translate);
 			Matrix4x4 worldMatrixSprite = MakeAffineMatrix(transformSprite.scale, transformSprite.rotate, transformSprite.translate);
@@ -1677,23 +1917,70 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			/// *****************************************************
 			/// WorldViewProjectionMatrixを作る
 			/// *****************************************************
-			// WorldMatrixを作る
-			Matrix4x4 cameraMatrix = MakeAffineMatrix(cameraTransform.scale, cameraTransform.rotate, cameraTransform.translate);
-			Matrix4x4 viewMatrix = Inverse(cameraMatrix);
-			Matrix4x4 viewMatrixSprite = MakeIdenitiy4x4();
-			Matrix4x4 projectionMatrix = MakePerspectiveFovMatrix(0.45f, float(kClientWindth) / float(kClientHeight), 0.1f, 100.0f);
-			Matrix4x4 projectionMatrixSprite = MakeOrethographicMatrx(0.0f, 0.0f, float(kClientWindth), float(kClientHeight), 0.0f, 100.0f);
+			// カメラのWorldMatrixの逆行列をViewMatrixにする
+			Matrix4x4 viewMatrix = MakeAffineInverse(cameraTransform.scale, cameraTransform.rotate, cameraTransform.translate);
 
 			// WVPMatrixを作る
-			Matrix4x4 worldViewProjectionMatrix = Mutiply(worldMatrix, Mutiply(viewMatrix, projectionMatrix));
-			Matrix4x4 worldViewProjectionMatrixSprite = Mutiply(worldMatrixSprite, Mutiply(viewMatrixSprite, projectionMatrixSprite));
+			Matrix4x4 worldViewProjectionMatrix = worldMatrix * viewMatrix * projectionMatrix;
+
+			// モデルのAABBをワールド座標にして、BVHを合わせる
+			SetTransformedBoundingBox(sceneBoxes, kModelObjectIndex, modelData.boundsMin, modelData.boundsMax, worldMatrix);
+			RefitBvh(sceneBvh, sceneBoxes, changedObjectsModel);
+
+			// 左クリックした所へカメラから光線を飛ばし、最初に当たったオブジェクトを選ぶ。ImGuiの上をクリックした時は選ばない
+			const ImGuiIO& imguiIO = ImGui::GetIO();
+			if (ImGui::IsMouseClicked(ImGuiMouseButton_Left) && !imguiIO.WantCaptureMouse) {
+				// クリップ空間の近い面(z=0)と遠い面(z=1)の点をワールド座標に戻して結ぶ
+				Matrix4x4 viewProjectionMatrix = viewMatrix * projectionMatrix;
+				Matrix4x4 inverseViewProjectionMatrix = Inverse(viewProjectionMatrix);
+				float mouseNdcX = imguiIO.MousePos.x / float(kClientWindth) * 2.0f - 1.0f;
+				float mouseNdcY = 1.0f - imguiIO.MousePos.y / float(kClientHeight) * 2.0f;
+				Vector3 rayNear = TransformPoint(Vector3{ mouseNdcX, mouseNdcY, 0.0f }, inverseViewProjectionMatrix);
+				Vector3 rayFar = TransformPoint(Vector3{ mouseNdcX, mouseNdcY, 1.0f }, inverseViewProjectionMatrix);
+
+				// 向きを近い面から遠い面までにしたので、距離1までを調べる
+				BvhRayHit rayHit{};
+				pickedObject = RaycastBvh(sceneBvh, sceneBoxes, rayNear, rayFar - rayNear, 1.0f, rayHit) ? int32_t(rayHit.objectIndex) : -1;
+			}
 
-			// CBufferの中身を更新する
-			wvpDataModel->WVP = worldViewProjectionMatrix;
-			wvpDataModel->World = MakeIdenitiy4x4();
+			// CBufferの中身を更新する。EvaluateToは4行とも求めてから、MapしたCBufferへ直接書き込む(途中の行列を作らない)
+			(dequantizeMatrixModel * worldViewProjectionMatrix).EvaluateTo(wvpDataModel->WVP);
+
+			// カメラからAABBの中心までの距離と、画面上の誤差からLODを選ぶ
+			Vector3 boundsCenterModel = TransformPoint((modelData.boundsMin + modelData.boundsMax) * 0.5f, worldMatrix);
+			float distanceModel = Length(boundsCenterModel - cameraTransform.translate);
+			float worldScaleModel = std::max({ std::abs(transform.scale.x), std::abs(transform.scale.y), std::abs(transform.scale.z) });
+			if (forcedLodModel >= 0) {
+				lodModel = std::min(static_cast<uint32_t>(forcedLodModel), static_cast<uint32_t>(modelData.lods.size()) - 1);
+			} else {
+				lodModel = SelectLod(modelData.lods, worldScaleModel, distanceModel, kFovY, float(kClientHeight), maxScreenErrorModel);
+			}
+			lodScreenErrorModel = ComputeScreenError(modelData.lods[lodModel].error * worldScaleModel, distanceModel, kFovY, float(kClientHeight));
+
+			// 視錐台はモデルの座標系で比べる。まずモデル全体のAABBで調べ、外なら何も描かない
+			Frustum frustumModel = MakeFrustum(worldViewProjectionMatrix);
+			isModelVisible = IsAabbInFrustum(frustumModel, modelData.boundsMin, modelData.boundsMax);
+
+			// 見えないMeshletを間引いて、残りのIndexを詰めて書き込む。カメラもモデルの座標系にする
+			// MeshletはLOD0にしか無いので、粗い段を描く時は間引かない
+			bool cullMeshletsModel = isModelVisible && useMeshletCulling && lodModel == 0;
+			if (cullMeshletsModel) {
+				Vector3 cameraPositionModel = TransformPoint(cameraTransform.translate, MakeAffineInverse(transform.scale, transform.rotate, transform.translate));
+				meshletCullStatistics = CullMeshlets(modelData, frustumModel, cameraPositionModel, culledIndicesModel, culledSubMeshesModel);
+				const UploadAllocation& culledIndexAllocationModel = culledIndexAllocationsModel[framePacer.GetFrameIndex()];
+				std::memcpy(culledIndexAllocationModel.cpuAddress, culledIndicesModel.data(), sizeof(uint32_t) * culledIndicesModel.size());
+				culledIndexBufferViewModel.BufferLocation = culledIndexAllocationModel.gpuAddress;
+				culledIndexBufferViewModel.SizeInBytes = UINT(sizeof(uint32_t) * std::max<size_t>(culledIndicesModel.size(), 1));
+			} else if (isModelVisible) {
+				meshletCullStatistics = { modelData.meshlets.size(), modelData.lods[lodModel].triangleCount, 0, 0 };
+			} else {
+				meshletCullStatistics = { 0, 0, modelData.meshlets.size(), 0 };
+			}
+			const SubMesh* drawSubMeshesModel = cullMeshletsModel ? culledSubMeshesModel.data() : modelData.lodSubMeshes.data() + modelData.lods[lodModel].subMeshStart;
+			wvpDataModel->World = kIdentityMatrix;
 
-			transformtionMatrixDataSprite->WVP = worldViewProjectionMatrixSprite;
-			transformtionMatrixDataSprite->World = MakeIdenitiy4x4();
+			(worldMatrixSprite * kViewProjectionMatrixSprite).EvaluateTo(transformtionMatrixDataSprite->WVP);
+			transformtionMatrixDataSprite->World = kIdentityMatrix;
 
 			/// *****************************************************
 			/// コマンドを積み込んで確定させる
@@ -1765,34 +2052,65 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			        ModelDataの描画
 			*/ ////////////////////////
 
-			// マテリアルCBufferの場所設定
-			commandList->SetGraphicsRootConstantBufferView(0, materialResourceModel->GetGPUVirtualAddress());
+			// 圧縮した頂点ならそれ用のPSOにする
+			if (usePackedVertices) {
+				commandList->SetPipelineState(grapicsPipelineStatePacked.Get());
+			}
 
 			// VBVを設定
 			commandList->IASetVertexBuffers(0, 1, &vertexBufferViewModel);
 
+			// IBVを設定。間引いた時は詰めたIndexを使う。LODのIndexは元のIndexの後ろにある
+			commandList->IASetIndexBuffer(cullMeshletsModel ? &culledIndexBufferViewModel : &indexBufferViewModel);
+
 			// 平行光源CBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(3, directionalLightResource->GetGPUVirtualAddress());
+			commandList->SetGraphicsRootConstantBufferView(3, directionalLightFrameAllocation.gpuAddress);
 
 			// vertexBufferViewSphere用のBufferの場所設定
-			commandList->SetGraphicsRootConstantBufferView(1, wvpResourceModel->GetGPUVirtualAddress());
+			commandList->SetGraphicsRootConstantBufferView(1, wvpFrameAllocationModel.gpuAddress);
 
 			// ModelDataを使う
 			//commandList->DrawInstanced(UINT(modelData.vertices.size()), 1, 0, 0);
 
-			//SRVのDescriptorTableの先頭を設定。Textureの貼り付け
-			//useMonsterBallがTrueならTextureSRVHandleGPU2を貼り付け
-			commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
+			// SubMeshごとに描く。並べ替えてあるので、変わった時だけマテリアルとTextureを設定し直す
+			if (isModelVisible) {
+				uint32_t boundMaterialIndex = UINT32_MAX;
+				uint32_t boundTextureIndex = UINT32_MAX;
+				for (uint32_t subMeshIndex : subMeshDrawOrder) {
+					const SubMesh& subMesh = drawSubMeshesModel[subMeshIndex];
+					if (subMesh.indexCount == 0) {
+						continue; // 全て間引かれた
+					}
+
+					// マテリアルCBufferの場所設定
+					if (subMesh.materialIndex != boundMaterialIndex) {
+						commandList->SetGraphicsRootConstantBufferView(0, materialFrameAllocationModel.gpuAddress + kMaterialStride * subMesh.materialIndex);
+						boundMaterialIndex = subMesh.materialIndex;
+					}
+
+					//SRVのDescriptorTableの先頭を設定。Textureの貼り付け
+					uint32_t subMeshTextureIndex = materialTextureIndices[subMesh.materialIndex];
+					if (subMeshTextureIndex != boundTextureIndex) {
+						commandList->SetGraphicsRootDescriptorTable(2, textureTable.srvHandlesGPU[subMeshTextureIndex]);
+						boundTextureIndex = subMeshTextureIndex;
+					}
+
+					// SubMeshのIndexの範囲を描く
+					commandList->DrawIndexedInstanced(subMesh.indexCount, 1, subMesh.indexStart, 0, 0);
+				}
+			}
 
-			// ModelDataの数を利用する
-			commandList->DrawInstanced(UINT(modelData.vertices.size()), 1, 0, 0);
+			// 他の描画は通常の頂点なのでPSOを戻す
+			if (usePackedVertices) {
+				commandList->SetPipelineState(grapicsPipelineState.Get());
+			}
 
 			/* /////////////////////////
 					Spriteの描画
 			*/ ////////////////////////
 
 			// マテリアルCBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(0, materialResourceSprite->GetGPUVirtualAddress());
+			commandList->SetGraphicsRootConstantBufferView(0, materialAllocationSprite.gpuAddress);
 
 			// VBVを設定
 			commandList->IASetVertexBuffers(0, 1, &vertexBufferViewSprite);
@@ -1800,11 +2118,11 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			// IBVを設定
 			commandList->IASetIndexBuffer(&indexBufferViewSprite);
 
-			// transformMatrixResourceSprite用のBufferの場所を設定
-			commandList->SetGraphicsRootConstantBufferView(1, transformMatrixResourceSprite->GetGPUVirtualAddress());
+			// transformMatrixFrameAllocationSprite用のBufferの場所を設定
+			commandList->SetGraphicsRootConstantBufferView(1, transformMatrixFrameAllocationSprite.gpuAddress);
 
 			// テクスチャの再設定
-			commandList->SetGraphicsRootDescriptorTable(2, textureSrvHandleGPU);
+			commandList->SetGraphicsRootDescriptorTable(2, textureTable.srvHandlesGPU[textureIndex]);
 
 			// 描画!(DrawCall/ドローコール)
 			//commandList->DrawInstanced(6, 1, 0, 0);
@@ -1844,33 +2162,29 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 			/// *****************************************************
 			/// GPUにSignalを送る
 			/// *****************************************************
-			// Fenceの値を更新
-			fenceValue++;
+			// フレームを閉じてSignalを送る。GPUがこの値に着いたら、この枠を使い回せる
+			uint64_t fenceValue = framePacer.EndFrame();
 
-			// GPUがここまでたどり着いたときに、Fenceの当た値を指定した値に代入するようにSignalを送る
-			commandQueue->Signal(fence.Get(), fenceValue);
+			// このフレームで切り出したCBufferは、GPUがこの値に着いたら使い回せる
+			frameRingAllocator.FinishFrame(fenceValue);
 
 			/// *****************************************************
-			/// Fenceの値を確認してGPUを持つ
+			/// 次のフレームの枠を空ける
 			/// *****************************************************
-			// Fenceの値が指定したSignal値にたどり着いているか確認する
-			// GetCompletedValueの初期値はFence作成時に渡した初期値
-			if (fence->GetCompletedValue() < fenceValue) {
-
-				// 指定したSignalにたどり着いていないので、たどり着くまで待つようにイベントを設定する
-				fence->SetEventOnCompletion(fenceValue, fenceEvent);
-
-				// イベント待つ
-				WaitForSingleObject(fenceEvent, INFINITE);
-			}
+			// 枠の前のフレームがGPUで終わっていない時だけ待つ
+			uint32_t frameIndex = beginFrame();
 
 			// 次のフレーム用のコマンドリストを準備
-			hr = commandAllocator->Reset();
+			hr = commandAllocators[frameIndex]->Reset();
 			assert(SUCCEEDED(hr));
-			hr = commandList->Reset(commandAllocator.Get(), nullptr);
+			hr = commandList->Reset(commandAllocators[frameIndex].Get(), nullptr);
 			assert(SUCCEEDED(hr));
 		}
 	}
+
+	// GPUが全部のフレームを描き終わってから消す
+	framePacer.WaitForIdle();
+	uploadManager.WaitForIdle();
 	// ImGuiの終了処理.。
 	ImGui_ImplDX12_Shutdown();
 	ImGui_ImplWin32_Shutdown();
@@ -1879,7 +2193,9 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int) {
 	/// *****************************************************
 	/// 解放処理
 	/// *****************************************************
-	CloseHandle(fenceEvent);
+	if (frameLatencyWaitableObject != nullptr) {
+		CloseHandle(frameLatencyWaitableObject);
+	}
 	CloseWindow(hwnd);
 
 	CoUninitialize();
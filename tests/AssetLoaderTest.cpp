@@ -0,0 +1,154 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AssetLoader.h"
+#include "TestCommon.h"
+
+namespace {
+	// ワーカースレッドが読み終わるまで待つ。Updateはメインスレッドでしか進まないので、decodedCountを見る
+	void WaitDecoded(const AssetLoader& loader, uint32_t count) {
+		while (loader.GetProgress().decodedCount < count) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	// 同じキーは一度だけ読み、コールバックは全部メインスレッドで呼ぶ
+	void TestDeduplicateAndMainThreadCallbacks() {
+		AssetLoader loader(2);
+		std::atomic<int> loadCount = 0;
+		std::thread::id mainThread = std::this_thread::get_id();
+		std::vector<std::string> calls;
+		bool onMainThread = true;
+
+		auto load = [&loadCount]() { ++loadCount; return std::string("data"); };
+		AssetHandle<std::string> first = loader.Load<std::string>("a", load, [&](std::string& value) {
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			calls.push_back("first:" + value);
+		});
+		AssetHandle<std::string> second = loader.Load<std::string>("a", load, [&](std::string& value) {
+			onMainThread = onMainThread && std::this_thread::get_id() == mainThread;
+			calls.push_back("second:" + value);
+		});
+		CHECK(first.index == second.index);
+
+		WaitDecoded(loader, 1);
+		CHECK(calls.empty()); // Updateまでは呼ばない
+		CHECK(loader.Find(first) == nullptr);
+		loader.Update();
+
+		CHECK(loadCount == 1);
+		CHECK(onMainThread);
+		CHECK(calls == std::vector<std::string>({ "first:data", "second:data" }));
+		CHECK(loader.Find(first) != nullptr && *loader.Find(first) == "data");
+
+		// 使えるようになった後に足したコールバックは、次のUpdateで呼ぶ
+		loader.Load<std::string>("a", load, [&](std::string& value) { calls.push_back("late:" + value); });
+		CHECK(calls.size() == 2);
+		loader.Update();
+		CHECK(calls.size() == 3 && calls.back() == "late:data");
+		CHECK(loadCount == 1);
+	}
+
+	// Updateは読み終わった順に、maxCompletionsの数だけ終わらせる
+	void TestUpdateLimit() {
+		AssetLoader loader(1); // 1スレッドなので読み終わる順は頼んだ順
+		std::vector<int> completed;
+		std::vector<AssetHandle<int>> handles;
+		for (int i = 0; i < 4; ++i) {
+			handles.push_back(loader.Load<int>("item" + std::to_string(i), [i]() { return i * 10; }, [&completed](int& value) { completed.push_back(value); }));
+		}
+		WaitDecoded(loader, 4);
+
+		loader.Update(1);
+		CHECK(completed == std::vector<int>({ 0 }));
+		CHECK(loader.GetProgress().readyCount == 1);
+		loader.Update(2);
+		CHECK(completed == std::vector<int>({ 0, 10, 20 }));
+		CHECK(!loader.IsReady(handles[3].index));
+		loader.Update();
+		CHECK(completed == std::vector<int>({ 0, 10, 20, 30 }));
+
+		AssetLoadProgress progress = loader.GetProgress();
+		CHECK(progress.requestedCount == 4 && progress.decodedCount == 4 && progress.readyCount == 4);
+		CHECK(progress.GetRatio() == 1.0f);
+	}
+
+	// Waitは待ったアセットのコールバックだけを呼び、Updateでは二度呼ばない
+	void TestWaitCompletesOnlyItself() {
+		AssetLoader loader(2);
+		std::promise<void> gate;
+		std::shared_future<void> opened = gate.get_future().share();
+		int slowCalls = 0;
+		int fastCalls = 0;
+
+		AssetHandle<int> slow = loader.Load<int>("slow", [opened]() { opened.wait(); return 1; }, [&slowCalls](int&) { ++slowCalls; });
+		AssetHandle<int> fast = loader.Load<int>("fast", []() { return 2; }, [&fastCalls](int&) { ++fastCalls; });
+
+		CHECK(loader.Wait(fast) == 2);
+		CHECK(fastCalls == 1);
+		CHECK(slowCalls == 0);
+		CHECK(!loader.IsReady(slow.index));
+		CHECK(loader.Get(slow, -1) == -1); // 読み終わるまでは代わりの物
+
+		gate.set_value();
+		loader.WaitAll();
+		CHECK(slowCalls == 1);
+		CHECK(fastCalls == 1);
+		CHECK(loader.Get(slow, -1) == 1);
+	}
+
+	// 読めなかった時に空の物を返す読み込みも、普通に終わってコールバックで見分けられる
+	void TestFailedLoadIsDelivered() {
+		AssetLoader loader(1);
+		bool sawEmpty = false;
+		AssetHandle<std::vector<int>> handle = loader.Load<std::vector<int>>("missing", []() { return std::vector<int>(); },
+			[&sawEmpty](std::vector<int>& value) { sawEmpty = value.empty(); });
+		loader.WaitAll();
+		CHECK(sawEmpty);
+		CHECK(loader.IsReady(handle.index));
+		CHECK(loader.Find(handle) != nullptr && loader.Find(handle)->empty());
+	}
+
+	// コールバックの中から次の読み込みを頼める
+	void TestLoadFromCallback() {
+		AssetLoader loader(2);
+		int childValue = 0;
+		loader.Load<int>("parent", []() { return 1; }, [&](int& parent) {
+			loader.Load<int>("child", [parent]() { return parent + 1; }, [&childValue](int& child) { childValue = child; });
+		});
+		loader.WaitAll(); // 親のコールバックで子が積まれる
+		loader.WaitAll();
+		CHECK(childValue == 2);
+		CHECK(loader.GetProgress().requestedCount == 2);
+		CHECK(loader.GetProgress().readyCount == 2);
+	}
+
+	// 消す時に、積んだままの読み込みを全部終わらせる
+	void TestDestroyWithPendingLoads() {
+		std::atomic<int> finished = 0;
+		{
+			AssetLoader loader(2);
+			for (int i = 0; i < 16; ++i) {
+				loader.Load<int>("pending" + std::to_string(i), [&finished, i]() {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					++finished;
+					return i;
+				});
+			}
+		}
+		CHECK(finished == 16);
+	}
+}
+
+int main() {
+	TestDeduplicateAndMainThreadCallbacks();
+	TestUpdateLimit();
+	TestWaitCompletesOnlyItself();
+	TestFailedLoadIsDelivered();
+	TestLoadFromCallback();
+	TestDestroyWithPendingLoads();
+	return FinishTests("AssetLoaderTest");
+}
@@ -0,0 +1,155 @@
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <utility>
+#include <vector>
+#include "FramePacer.h"
+#include "TestCommon.h"
+
+namespace {
+	/// <summary>
+	/// GPUの代わり。Signalされた値を順に積み、Tickで一番古いものを終わらせる。Waitは着くまでTickする
+	/// </summary>
+	class FakeFrameFence final : public FrameFence {
+	public:
+		void Signal(uint64_t value) override {
+			queued_.push_back(value);
+			if (queued_.size() > maxQueuedCount_) {
+				maxQueuedCount_ = queued_.size();
+			}
+		}
+
+		uint64_t GetCompletedValue() override { return completed_; }
+
+		void Wait(uint64_t value) override {
+			++waitCount_;
+			// Signalしていない値を待つと終わらない
+			CHECK(value <= (queued_.empty() ? completed_ : queued_.back()));
+			while (completed_ < value && !queued_.empty()) {
+				Tick();
+			}
+		}
+
+		void Tick() {
+			if (!queued_.empty()) {
+				completed_ = queued_.front();
+				queued_.pop_front();
+			}
+		}
+
+		size_t GetQueuedCount() const { return queued_.size(); }
+		size_t GetMaxQueuedCount() const { return maxQueuedCount_; }
+		uint64_t GetWaitCount() const { return waitCount_; }
+
+	private:
+		std::deque<uint64_t> queued_;
+		uint64_t completed_ = 0;
+		size_t maxQueuedCount_ = 0;
+		uint64_t waitCount_ = 0;
+	};
+
+	// 枠は順に回り、初めて使う枠では待たない。GPUが遅れている時に枠を使い回す所で初めて待つ
+	void TestRotationAndWaits(uint32_t framesInFlight) {
+		FakeFrameFence fence;
+		FramePacer pacer(fence, framesInFlight);
+		CHECK(pacer.GetFramesInFlight() == framesInFlight);
+
+		for (uint32_t i = 0; i < framesInFlight; ++i) {
+			CHECK(pacer.BeginFrame() == i);
+			CHECK(pacer.IsFrameOpen());
+			CHECK(pacer.EndFrame() == i + 1);
+			CHECK(pacer.GetFrameIndex() == (i + 1) % framesInFlight);
+		}
+		CHECK(pacer.GetWaitCount() == 0);
+		CHECK(fence.GetQueuedCount() == framesInFlight);
+
+		// 枠0を使い回す。枠0のフレーム(値1)だけを待ち、後のフレームは進めたままにする
+		CHECK(pacer.BeginFrame() == 0);
+		CHECK(pacer.GetWaitCount() == 1);
+		CHECK(fence.GetCompletedValue() == 1);
+		CHECK(fence.GetQueuedCount() == framesInFlight - 1);
+		pacer.EndFrame();
+
+		// GPUが追いついていれば、枠を使い回しても待たない
+		while (fence.GetQueuedCount() > 0) {
+			fence.Tick();
+		}
+		for (uint32_t i = 0; i < framesInFlight * 2; ++i) {
+			CHECK(pacer.BeginFrame() == (i + 1) % framesInFlight);
+			pacer.EndFrame();
+			fence.Tick();
+		}
+		CHECK(pacer.GetWaitCount() == 1);
+
+		// 全部終わっていればWaitForIdleは待たない
+		uint64_t fenceWaits = fence.GetWaitCount();
+		pacer.WaitForIdle();
+		CHECK(fence.GetWaitCount() == fenceWaits);
+
+		// 終わっていなければ最後の値まで待つ
+		pacer.BeginFrame();
+		pacer.EndFrame();
+		pacer.WaitForIdle();
+		CHECK(fence.GetCompletedValue() == pacer.GetLastSignaledValue());
+		CHECK(fence.GetWaitCount() == fenceWaits + 1);
+	}
+
+	// GPUが全く進まない時は、最初の枠が一周した後、毎フレーム1回ずつ待つ
+	void TestStalledGpuWaitsEveryFrame(uint32_t framesInFlight) {
+		FakeFrameFence fence;
+		FramePacer pacer(fence, framesInFlight);
+		const uint32_t kFrameCount = 20;
+		for (uint32_t i = 0; i < kFrameCount; ++i) {
+			pacer.BeginFrame();
+			pacer.EndFrame();
+		}
+		CHECK(pacer.GetWaitCount() == kFrameCount - framesInFlight);
+		CHECK(fence.GetMaxQueuedCount() == framesInFlight);
+	}
+
+	// GPUがばらばらに進む時も、使う枠はGPUが読み終えた枠だけで、積まれるフレームは枠の数を越えない
+	void TestRandomProgress(uint32_t framesInFlight) {
+		FakeFrameFence fence;
+		FramePacer pacer(fence, framesInFlight);
+		std::mt19937 random(framesInFlight);
+		std::vector<uint64_t> slotData(framesInFlight, 0);
+		std::deque<std::pair<uint32_t, uint64_t>> inFlight; // 枠と、その枠のフレームの値
+		bool slotFree = true;
+		bool dataIntact = true;
+
+		for (int frame = 0; frame < 10000; ++frame) {
+			uint32_t slot = pacer.BeginFrame();
+			while (!inFlight.empty() && inFlight.front().second <= fence.GetCompletedValue()) {
+				dataIntact = dataIntact && slotData[inFlight.front().first] == inFlight.front().second;
+				inFlight.pop_front();
+			}
+			slotFree = slotFree && inFlight.size() < framesInFlight;
+			for (const std::pair<uint32_t, uint64_t>& entry : inFlight) {
+				slotFree = slotFree && entry.first != slot;
+			}
+			uint64_t value = pacer.GetLastSignaledValue() + 1;
+			slotData[slot] = value;
+			CHECK(pacer.EndFrame() == value);
+			inFlight.push_back({ slot, value });
+
+			int ticks = static_cast<int>(random() % 3);
+			for (int i = 0; i < ticks; ++i) {
+				fence.Tick();
+			}
+		}
+		pacer.WaitForIdle();
+		CHECK(slotFree);
+		CHECK(dataIntact);
+		CHECK(fence.GetMaxQueuedCount() <= framesInFlight);
+		CHECK(fence.GetCompletedValue() == pacer.GetLastSignaledValue());
+	}
+}
+
+int main() {
+	for (uint32_t framesInFlight : { 2u, 3u }) {
+		TestRotationAndWaits(framesInFlight);
+		TestStalledGpuWaitsEveryFrame(framesInFlight);
+		TestRandomProgress(framesInFlight);
+	}
+	return FinishTests("FramePacerTest");
+}
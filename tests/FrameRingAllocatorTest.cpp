@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <utility>
+#include "FrameRingAllocator.h"
+#include "TestCommon.h"
+
+namespace {
+	const uint64_t kGpuBase = 0x40000000;
+
+	/// <summary>
+	/// 普通のメモリでページを作る。GPUアドレスは64KB境界の偽物
+	/// </summary>
+	class FakePageBackend final : public UploadPageBackend {
+	public:
+		UploadPage CreatePage(size_t size) override {
+			++liveCount_;
+			return { static_cast<uint8_t*>(std::malloc(size)), kGpuBase, size, 0 };
+		}
+
+		void DestroyPage(const UploadPage& page) override {
+			--liveCount_;
+			std::free(page.cpuAddress);
+		}
+
+		int GetLiveCount() const { return liveCount_; }
+
+	private:
+		int liveCount_ = 0;
+	};
+
+	/// <summary>
+	/// GPUの進み具合の代わり。Signalした値を、呼んだ所まで完了させる
+	/// </summary>
+	struct FakeFence final {
+		uint64_t signaled = 0;
+		uint64_t completed = 0;
+
+		uint64_t Signal() { return ++signaled; }
+		void CompleteUpTo(uint64_t value) { completed = std::max(completed, std::min(value, signaled)); }
+	};
+
+	uint64_t OffsetOf(const UploadAllocation& allocation) {
+		return allocation.gpuAddress - kGpuBase;
+	}
+
+	// 終わりに入らない時は先頭に戻り、捨てた所と境界の分もusedBytesに入る
+	void TestWrapAndPadding() {
+		FakePageBackend backend;
+		FakeFence fence;
+		FrameRingAllocator ring(backend, 1024);
+		UploadAllocation allocation = {};
+
+		CHECK(ring.TryAllocate(600, 16, allocation) && OffsetOf(allocation) == 0);
+		ring.FinishFrame(fence.Signal());
+		CHECK(ring.GetUsedBytes() == 600);
+
+		// 終わりには424しか無く、先頭はまだGPUが使っている
+		CHECK(!ring.TryAllocate(500, 16, allocation));
+		CHECK(ring.TryAllocate(400, 16, allocation) && OffsetOf(allocation) == 608);
+		ring.FinishFrame(fence.Signal());
+		CHECK(ring.GetUsedBytes() == 1008); // 600 + 境界の8 + 400
+		CHECK(ring.GetPendingFrameCount() == 2);
+
+		// GPUが進まなければ空かない
+		CHECK(!ring.TryAllocate(100, 16, allocation));
+		ring.Reclaim(fence.completed);
+		CHECK(!ring.TryAllocate(100, 16, allocation));
+
+		// 1フレーム目が終わると、その分(境界の分を含まない600)が空く
+		fence.CompleteUpTo(1);
+		ring.Reclaim(fence.completed);
+		CHECK(ring.GetPendingFrameCount() == 1);
+		CHECK(ring.GetOldestFenceValue() == 2);
+		CHECK(ring.GetUsedBytes() == 408);
+
+		// 終わりの残り16を捨てて先頭に戻る
+		CHECK(ring.TryAllocate(100, 16, allocation) && OffsetOf(allocation) == 0);
+		CHECK(ring.GetUsedBytes() == 408 + 16 + 100);
+
+		// 折り返した後は、まだ使われている1フレーム目の終わり(608)を越えられない
+		CHECK(!ring.TryAllocate(500, 16, allocation));
+		CHECK(ring.TryAllocate(480, 16, allocation) && OffsetOf(allocation) == 112);
+		CHECK(ring.GetUsedBytes() == 408 + 16 + 100 + 12 + 480);
+		CHECK(!ring.TryAllocate(9, 1, allocation));
+		CHECK(ring.TryAllocate(8, 1, allocation));
+		CHECK(ring.GetUsedBytes() == ring.GetCapacity());
+
+		// 満杯の時は何も入らない
+		CHECK(!ring.TryAllocate(1, 1, allocation));
+
+		ring.FinishFrame(fence.Signal());
+		fence.CompleteUpTo(3);
+		ring.Reclaim(fence.completed);
+		CHECK(ring.GetUsedBytes() == 0);
+		CHECK(ring.GetPendingFrameCount() == 0);
+
+		// 全部空いたら先頭から、輪の大きさいっぱいまで入る
+		CHECK(ring.TryAllocate(1024, 16, allocation) && OffsetOf(allocation) == 0);
+	}
+
+	// 境界が大きくて終わりに入らず、先頭もまだ使われている時は失敗する
+	void TestAlignmentDoesNotWrapIntoLiveData() {
+		FakePageBackend backend;
+		{
+			FrameRingAllocator ring(backend, 1024);
+			UploadAllocation allocation = {};
+			CHECK(ring.TryAllocate(600, 16, allocation));
+			ring.FinishFrame(1);
+			CHECK(!ring.TryAllocate(300, 256, allocation)); // 768 + 300 > 1024
+			CHECK(ring.GetUsedBytes() == 600);
+			CHECK(!ring.TryAllocate(1025, 1, allocation));
+		}
+		CHECK(backend.GetLiveCount() == 0);
+	}
+
+	// CBVの大きさとアドレスは256の倍数
+	void TestConstantBuffer() {
+		FakePageBackend backend;
+		FrameRingAllocator ring(backend, 4096);
+		UploadAllocation allocation = {};
+		CHECK(ring.TryAllocate(4, 4, allocation));
+		CHECK(ring.TryAllocateConstantBuffer(96, allocation));
+		CHECK(allocation.size == 256);
+		CHECK(allocation.gpuAddress % 256 == 0);
+		CHECK(OffsetOf(allocation) == 256);
+		CHECK(ring.GetUsedBytes() == 512);
+	}
+
+	// 数フレーム先まで進むCPUと、遅れて進むGPUを真似る。書いたものがGPUが読むまで上書きされないことと、
+	// usedBytesが、待っているフレームと今のフレームが使った大きさの合計と一致することを確かめる
+	void TestRandomFramesInFlight() {
+		struct Written final {
+			uint64_t fenceValue;
+			const uint8_t* data;
+			size_t size;
+			uint8_t tag;
+		};
+
+		for (uint64_t framesInFlight = 1; framesInFlight <= 3; ++framesInFlight) {
+			FakePageBackend backend;
+			FakeFence fence;
+			FrameRingAllocator ring(backend, 64 * 1024);
+			std::mt19937 random(static_cast<uint32_t>(framesInFlight));
+			std::deque<Written> written;
+			// 切り出した位置から数え直した、フレームごとの使った大きさ(境界と折り返しで捨てた分を含む)
+			std::deque<std::pair<uint64_t, size_t>> expectedFrames;
+			size_t expectedFrameBytes = 0;
+			size_t expectedTail = 0;
+			bool intact = true;
+			bool inRange = true;
+			bool invariant = true;
+
+			// GPUを進め、終わったフレームの中身が書いた時のままかを見る
+			auto complete = [&](uint64_t value) {
+				fence.CompleteUpTo(value);
+				while (!written.empty() && written.front().fenceValue <= fence.completed) {
+					const Written& entry = written.front();
+					for (size_t i = 0; i < entry.size; ++i) {
+						intact = intact && entry.data[i] == entry.tag;
+					}
+					written.pop_front();
+				}
+				while (!expectedFrames.empty() && expectedFrames.front().first <= fence.completed) {
+					expectedFrames.pop_front();
+				}
+				ring.Reclaim(fence.completed);
+				if (expectedFrames.empty() && expectedFrameBytes == 0) {
+					expectedTail = 0;
+				}
+			};
+			auto expectedUsedBytes = [&]() {
+				size_t bytes = expectedFrameBytes;
+				for (const std::pair<uint64_t, size_t>& entry : expectedFrames) {
+					bytes += entry.second;
+				}
+				return bytes;
+			};
+
+			for (int frame = 0; frame < 2000; ++frame) {
+				while (fence.signaled - fence.completed >= framesInFlight) {
+					complete(fence.completed + 1);
+				}
+				uint8_t tag = static_cast<uint8_t>(frame);
+				int count = 1 + static_cast<int>(random() % 12);
+				for (int i = 0; i < count; ++i) {
+					size_t size = 16 + random() % 5000;
+					size_t alignment = size_t(1) << (random() % 9);
+					UploadAllocation allocation = {};
+					while (!ring.TryAllocate(size, alignment, allocation)) {
+						CHECK(ring.GetPendingFrameCount() > 0);
+						if (ring.GetPendingFrameCount() == 0) {
+							return;
+						}
+						complete(ring.GetOldestFenceValue());
+					}
+					inRange = inRange && allocation.gpuAddress % alignment == 0 &&
+						OffsetOf(allocation) + size <= ring.GetCapacity();
+					size_t offset = static_cast<size_t>(OffsetOf(allocation));
+					expectedFrameBytes += offset >= expectedTail ? offset + size - expectedTail : ring.GetCapacity() - expectedTail + offset + size;
+					expectedTail = offset + size;
+					invariant = invariant && ring.GetUsedBytes() == expectedUsedBytes();
+					std::memset(allocation.cpuAddress, tag, size);
+					written.push_back({ fence.signaled + 1, static_cast<const uint8_t*>(allocation.cpuAddress), size, tag });
+				}
+				uint64_t fenceValue = fence.Signal();
+				ring.FinishFrame(fenceValue);
+				expectedFrames.push_back({ fenceValue, expectedFrameBytes });
+				expectedFrameBytes = 0;
+				invariant = invariant && ring.GetUsedBytes() <= ring.GetCapacity();
+				invariant = invariant && ring.GetPendingFrameCount() <= fence.signaled - fence.completed;
+
+				if (random() % 2 == 0) {
+					complete(fence.completed + random() % 3);
+				}
+			}
+			complete(fence.signaled);
+			CHECK(intact);
+			CHECK(inRange);
+			CHECK(invariant);
+			CHECK(ring.GetUsedBytes() == 0);
+			CHECK(ring.GetPendingFrameCount() == 0);
+		}
+	}
+}
+
+int main() {
+	TestWrapAndPadding();
+	TestAlignmentDoesNotWrapIntoLiveData();
+	TestConstantBuffer();
+	TestRandomFramesInFlight();
+	return FinishTests("FrameRingAllocatorTest");
+}
@@ -0,0 +1,161 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include "FrustumCulling.h"
+#include "MyMath.h"
+#include "TestCommon.h"
+
+namespace {
+	// 8つずつ比べる分と、スカラー版で比べる端数の組み合わせ
+	const size_t kCounts[] = { 0, 1, 7, 8, 9, 16, 1003 };
+
+	// 斜めから見た透視投影の視錐台
+	Frustum MakePerspectiveFrustum() {
+		Matrix4x4 view = MakeAffineInverse({ 1.0f, 1.0f, 1.0f }, { 0.3f, -0.5f, 0.1f }, { 2.0f, 3.0f, -20.0f });
+		Matrix4x4 projection = MakePerspectiveFovMatrix(0.45f, 16.0f / 9.0f, 0.1f, 100.0f);
+		return MakeFrustum(Mutiply(view, projection));
+	}
+
+	// -1から1の箱。平面の係数が整数なので、ちょうど面に接する球や箱を誤差無く作れる
+	Frustum MakeUnitBoxFrustum() {
+		Frustum frustum;
+		frustum.planes[0] = { 1.0f, 0.0f, 0.0f, 1.0f };
+		frustum.planes[1] = { -1.0f, 0.0f, 0.0f, 1.0f };
+		frustum.planes[2] = { 0.0f, 1.0f, 0.0f, 1.0f };
+		frustum.planes[3] = { 0.0f, -1.0f, 0.0f, 1.0f };
+		frustum.planes[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+		frustum.planes[5] = { 0.0f, 0.0f, -1.0f, 1.0f };
+		return frustum;
+	}
+
+	// 1つずつのIsSphereInFrustumで見える番号
+	std::vector<uint32_t> ExpectedSpheres(const Frustum& frustum, const BoundingSphereArrays& spheres) {
+		std::vector<uint32_t> visible;
+		for (size_t i = 0; i < spheres.radius.size(); ++i) {
+			if (IsSphereInFrustum(frustum, { spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i] }, spheres.radius[i])) {
+				visible.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		return visible;
+	}
+
+	std::vector<uint32_t> ExpectedBoxes(const Frustum& frustum, const BoundingBoxArrays& boxes) {
+		std::vector<uint32_t> visible;
+		for (size_t i = 0; i < boxes.minX.size(); ++i) {
+			if (IsAabbInFrustum(frustum, { boxes.minX[i], boxes.minY[i], boxes.minZ[i] }, { boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i] })) {
+				visible.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		return visible;
+	}
+
+	// ランダムな球と箱で、まとめて比べた結果が1つずつ比べた結果と一致する。見えるものと見えないものが混ざるように置く
+	void TestMatchesPerObject() {
+		Frustum frustum = MakePerspectiveFrustum();
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> size(0.0f, 8.0f);
+		for (size_t count : kCounts) {
+			BoundingSphereArrays spheres;
+			ResizeBoundingSphereArrays(spheres, count);
+			BoundingBoxArrays boxes;
+			ResizeBoundingBoxArrays(boxes, count);
+			for (size_t i = 0; i < count; ++i) {
+				Vector3 center = { position(random), position(random), position(random) + 40.0f };
+				SetBoundingSphere(spheres, i, center, size(random));
+				Vector3 extent = { size(random), size(random), size(random) };
+				SetBoundingBox(boxes, i, { center.x - extent.x, center.y - extent.y, center.z - extent.z }, { center.x + extent.x, center.y + extent.y, center.z + extent.z });
+			}
+
+			std::vector<uint32_t> visible = { 12345 }; // 前の中身は上書きされる
+			CullSpheres(frustum, spheres, visible);
+			std::vector<uint32_t> expected = ExpectedSpheres(frustum, spheres);
+			CHECK(visible == expected);
+			if (count == 1003) {
+				CHECK(!expected.empty() && expected.size() < count); // 両方が混ざっている
+			}
+
+			CullBoxes(frustum, boxes, visible);
+			expected = ExpectedBoxes(frustum, boxes);
+			CHECK(visible == expected);
+			if (count == 1003) {
+				CHECK(!expected.empty() && expected.size() < count);
+			}
+		}
+	}
+
+	// 面にちょうど接するものは見える。NaNの座標は外側にしない(1つずつの比べ方と同じ)
+	void TestBoundaryAndNaN() {
+		Frustum frustum = MakeUnitBoxFrustum();
+		const float kNaN = std::numeric_limits<float>::quiet_NaN();
+		const size_t kCount = 19; // 8つずつ2回と端数3つ
+
+		BoundingSphereArrays spheres;
+		ResizeBoundingSphereArrays(spheres, kCount);
+		BoundingBoxArrays boxes;
+		ResizeBoundingBoxArrays(boxes, kCount);
+		for (size_t i = 0; i < kCount; ++i) {
+			switch (i % 4) {
+			case 0: // 左の面の外で、ちょうど接する
+				SetBoundingSphere(spheres, i, { -2.0f, 0.0f, 0.0f }, 1.0f);
+				SetBoundingBox(boxes, i, { -3.0f, 0.0f, 0.0f }, { -1.0f, 0.5f, 0.5f });
+				break;
+			case 1: // わずかに離れている
+				SetBoundingSphere(spheres, i, { -2.0f, 0.0f, 0.0f }, 0.999f);
+				SetBoundingBox(boxes, i, { -3.0f, 0.0f, 0.0f }, { -1.001f, 0.5f, 0.5f });
+				break;
+			case 2:
+				SetBoundingSphere(spheres, i, { kNaN, 0.0f, 0.0f }, 1.0f);
+				SetBoundingBox(boxes, i, { kNaN, 0.0f, 0.0f }, { kNaN, 0.5f, 0.5f });
+				break;
+			default: // 上の面の外
+				SetBoundingSphere(spheres, i, { 0.0f, 5.0f, 0.0f }, 1.0f);
+				SetBoundingBox(boxes, i, { 0.0f, 2.0f, 0.0f }, { 0.5f, 3.0f, 0.5f });
+				break;
+			}
+		}
+
+		std::vector<uint32_t> visible;
+		CullSpheres(frustum, spheres, visible);
+		CHECK(visible == ExpectedSpheres(frustum, spheres));
+		CullBoxes(frustum, boxes, visible);
+		CHECK(visible == ExpectedBoxes(frustum, boxes));
+		std::vector<uint32_t> expected;
+		for (uint32_t i = 0; i < kCount; ++i) {
+			if (i % 4 == 0 || i % 4 == 2) {
+				expected.push_back(i);
+			}
+		}
+		CHECK(visible == expected);
+	}
+
+	// 動かしたAABBは、8つの角を動かした点を全て含む
+	void TestTransformedBoundingBox() {
+		Matrix4x4 world = MakeAffineMatrix(Vector3{ 2.0f, 0.5f, 3.0f }, Vector3{ 0.7f, -1.2f, 2.5f }, Vector3{ 10.0f, -4.0f, 1.0f });
+		Vector3 localMin = { -1.0f, -2.0f, -0.5f };
+		Vector3 localMax = { 3.0f, 1.0f, 0.5f };
+		BoundingBoxArrays boxes;
+		ResizeBoundingBoxArrays(boxes, 1);
+		SetTransformedBoundingBox(boxes, 0, localMin, localMax, world);
+
+		const float kEpsilon = 1e-4f;
+		bool isInside = true;
+		for (int corner = 0; corner < 8; ++corner) {
+			Vector3 local = { corner & 1 ? localMax.x : localMin.x, corner & 2 ? localMax.y : localMin.y, corner & 4 ? localMax.z : localMin.z };
+			Vector3 p = TransformPoint(local, world);
+			isInside = isInside &&
+				p.x >= boxes.minX[0] - kEpsilon && p.x <= boxes.maxX[0] + kEpsilon &&
+				p.y >= boxes.minY[0] - kEpsilon && p.y <= boxes.maxY[0] + kEpsilon &&
+				p.z >= boxes.minZ[0] - kEpsilon && p.z <= boxes.maxZ[0] + kEpsilon;
+		}
+		CHECK(isInside);
+	}
+}
+
+int main() {
+	TestMatchesPerObject();
+	TestBoundaryAndNaN();
+	TestTransformedBoundingBox();
+	return FinishTests("FrustumCullingTest");
+}
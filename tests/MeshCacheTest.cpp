@@ -0,0 +1,161 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "MeshCache.h"
+#include "TestCommon.h"
+
+namespace {
+	/// <summary>
+	/// テスト用のキャッシュを置く一時ディレクトリ
+	/// </summary>
+	const std::filesystem::path& TestDirectory() {
+		static const std::filesystem::path directory = [] {
+			std::filesystem::path path = std::filesystem::temp_directory_path() / "cg3_meshcache_test";
+			std::filesystem::create_directories(path);
+			return path;
+		}();
+		return directory;
+	}
+
+	const uint64_t kSourceHash = 0x1234567890ABCDEFull;
+	const uint64_t kSourceSize = 4096;
+	const uint32_t kProcessingFlags = 3;
+
+	// 全ての配列に中身がある小さなModelData
+	ModelData MakeModelData() {
+		ModelData modelData;
+		for (uint32_t i = 0; i < 5; ++i) {
+			VertexData vertex{};
+			vertex.position = { float(i), float(i * 2), float(i * 3), 1.0f };
+			vertex.texcoord = { float(i) * 0.25f, 1.0f };
+			vertex.normal = { 0.0f, 0.0f, 1.0f };
+			modelData.vertices.push_back(vertex);
+		}
+		modelData.indices = { 0, 1, 2, 2, 3, 4 };
+		modelData.subMeshes = { SubMesh{ 0, 6, 0 } };
+		modelData.meshlets.resize(1);
+		modelData.meshlets[0].indexCount = 6;
+		modelData.lods = { MeshLod{ 0, 2, 0.0f } };
+		modelData.lodSubMeshes = modelData.subMeshes;
+		modelData.materials = { MaterialData{ "", { 1.0f, 1.0f, 1.0f, 1.0f }, {} } };
+		return modelData;
+	}
+
+	std::vector<char> ReadAll(const std::filesystem::path& path) {
+		std::ifstream stream(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+	}
+
+	void WriteAll(const std::filesystem::path& path, const std::vector<char>& bytes) {
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+	}
+
+	// 書き出したキャッシュは同じ中身で読める。元ファイルや読み込み設定が違えば読まない
+	void TestRoundTrip() {
+		std::string cachePath = (TestDirectory() / "round.meshcache").string();
+		ModelData source = MakeModelData();
+		CHECK(SaveMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, source));
+
+		ModelData loaded;
+		CHECK(LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, loaded));
+		CHECK(loaded.vertices.size() == source.vertices.size());
+		CHECK(std::memcmp(loaded.vertices.data(), source.vertices.data(), sizeof(VertexData) * source.vertices.size()) == 0);
+		CHECK(loaded.indices == source.indices);
+		CHECK(loaded.subMeshes.size() == 1 && loaded.subMeshes[0].indexCount == 6);
+		CHECK(loaded.meshlets.size() == 1 && loaded.meshlets[0].indexCount == 6);
+		CHECK(loaded.lods.size() == 1 && loaded.lods[0].triangleCount == 2);
+		CHECK(loaded.lodSubMeshes.size() == 1);
+
+		ModelData other;
+		CHECK(!LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash + 1, kSourceSize, kProcessingFlags, other));
+		CHECK(!LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags ^ 1, other));
+	}
+
+	// 数を壊したヘッダは、数×サイズが64bitで溢れて小さくなる値でも読まない
+	void TestCorruptCounts() {
+		std::string cachePath = (TestDirectory() / "corrupt.meshcache").string();
+		CHECK(SaveMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, MakeModelData()));
+		const std::vector<char> original = ReadAll(cachePath);
+
+		// 数のメンバと要素のサイズ
+		struct CountField final {
+			size_t offset;
+			uint64_t elementSize;
+		};
+		const CountField kFields[] = {
+			{ offsetof(MeshCacheHeader, vertexCount), sizeof(VertexData) },
+			{ offsetof(MeshCacheHeader, indexCount), sizeof(uint32_t) },
+			{ offsetof(MeshCacheHeader, subMeshCount), sizeof(SubMesh) },
+			{ offsetof(MeshCacheHeader, meshletCount), sizeof(Meshlet) },
+			{ offsetof(MeshCacheHeader, lodCount), sizeof(MeshLod) },
+			{ offsetof(MeshCacheHeader, lodSubMeshCount), sizeof(SubMesh) },
+			{ offsetof(MeshCacheHeader, materialSize), 1 },
+		};
+		for (const CountField& field : kFields) {
+			// 2^64 / elementSize + 1 個なら、掛けると elementSize 未満に戻る
+			uint64_t counts[] = { UINT64_MAX / field.elementSize + 1, UINT64_MAX, original.size() };
+			for (uint64_t count : counts) {
+				if (field.elementSize == 1 && count == UINT64_MAX / field.elementSize + 1) {
+					continue; // 1バイトの要素は溢れない
+				}
+				std::vector<char> bytes = original;
+				std::memcpy(bytes.data() + field.offset, &count, sizeof(count));
+				WriteAll(cachePath, bytes);
+				ModelData modelData;
+				CHECK(!LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, modelData));
+			}
+		}
+
+		// ヘッダより短いファイルも読まない
+		WriteAll(cachePath, std::vector<char>(original.begin(), original.begin() + sizeof(MeshCacheHeader) / 2));
+		ModelData modelData;
+		CHECK(!LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, modelData));
+	}
+
+	// 保存してからバイト列を書き換え、読めないことを確かめる
+	template<typename T>
+	bool LoadsAfterPatch(const char* name, uint64_t MeshCacheHeader::*offsetField, size_t element, const T& value) {
+		std::string cachePath = (TestDirectory() / name).string();
+		CHECK(SaveMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, MakeModelData()));
+		std::vector<char> bytes = ReadAll(cachePath);
+		MeshCacheHeader header;
+		std::memcpy(&header, bytes.data(), sizeof(header));
+		std::memcpy(bytes.data() + header.*offsetField + element * sizeof(T), &value, sizeof(T));
+		WriteAll(cachePath, bytes);
+		ModelData modelData;
+		bool isLoaded = LoadMeshCache(cachePath, TestDirectory().string(), kSourceHash, kSourceSize, kProcessingFlags, modelData);
+		CHECK(isLoaded || modelData.vertices.empty());
+		return isLoaded;
+	}
+
+	// 数が正しくても、中身が配列の外を指すキャッシュは読まない
+	void TestCorruptContents() {
+		const uint32_t kVertexCount = 5;
+		const uint32_t kIndexCount = 6;
+		CHECK(!LoadsAfterPatch("index.meshcache", &MeshCacheHeader::indexOffset, 3, kVertexCount));
+		CHECK(!LoadsAfterPatch("submesh.meshcache", &MeshCacheHeader::subMeshOffset, 0, SubMesh{ 1, kIndexCount, 0 }));
+		CHECK(!LoadsAfterPatch("material.meshcache", &MeshCacheHeader::subMeshOffset, 0, SubMesh{ 0, kIndexCount, 1 }));
+		CHECK(!LoadsAfterPatch("lodsubmesh.meshcache", &MeshCacheHeader::lodSubMeshOffset, 0, SubMesh{ UINT32_MAX, kIndexCount, 0 }));
+		CHECK(!LoadsAfterPatch("lod.meshcache", &MeshCacheHeader::lodOffset, 0, MeshLod{ 1, 2, 0.0f }));
+
+		Meshlet meshlet{};
+		meshlet.indexStart = 3;
+		meshlet.indexCount = kIndexCount;
+		CHECK(!LoadsAfterPatch("meshlet.meshcache", &MeshCacheHeader::meshletOffset, 0, meshlet));
+
+		// 範囲内への書き換えなら読める
+		CHECK(LoadsAfterPatch("valid.meshcache", &MeshCacheHeader::indexOffset, 3, kVertexCount - 1));
+	}
+}
+
+int main() {
+	TestRoundTrip();
+	TestCorruptCounts();
+	TestCorruptContents();
+	std::filesystem::remove_all(TestDirectory());
+	return FinishTests("MeshCacheTest");
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "MeshOptimizer.h"
+#include "TestCommon.h"
+
+namespace {
+	const uint32_t kGridSize = 32; // 1辺のマスの数
+
+	/// <summary>
+	/// 格子状のメッシュのIndex。三角形の順番は決まった乱数で混ぜて、キャッシュに乗りにくくしておく
+	/// </summary>
+	std::vector<uint32_t> MakeShuffledGrid(uint32_t baseVertex) {
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y < kGridSize; ++y) {
+			for (uint32_t x = 0; x < kGridSize; ++x) {
+				uint32_t v0 = baseVertex + y * (kGridSize + 1) + x;
+				uint32_t v1 = v0 + 1;
+				uint32_t v2 = v0 + kGridSize + 1;
+				uint32_t v3 = v2 + 1;
+				triangles.push_back({ v0, v2, v1 });
+				triangles.push_back({ v1, v2, v3 });
+			}
+		}
+		uint32_t state = 12345;
+		for (size_t i = triangles.size() - 1; i > 0; --i) {
+			state = state * 1664525u + 1013904223u;
+			std::swap(triangles[i], triangles[state % (i + 1)]);
+		}
+		std::vector<uint32_t> indices;
+		for (const std::array<uint32_t, 3>& triangle : triangles) {
+			indices.insert(indices.end(), triangle.begin(), triangle.end());
+		}
+		return indices;
+	}
+
+	/// <summary>
+	/// 三角形を頂点の順番を回した形で揃えて、並べ替えの前後で同じ集合かを比べられるようにする
+	/// </summary>
+	std::vector<std::array<uint32_t, 3>> CanonicalTriangles(const std::vector<uint32_t>& indices) {
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+			// 向きを保ったまま、最小の頂点を先頭にする
+			while (triangle[0] != std::min({ triangle[0], triangle[1], triangle[2] })) {
+				std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+			}
+			triangles.push_back(triangle);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// ACMRが下がり、三角形とその向きは変わらない
+	void TestImprovesAcmr() {
+		const size_t vertexCount = (kGridSize + 1) * (kGridSize + 1);
+		std::vector<uint32_t> indices = MakeShuffledGrid(0);
+		std::vector<uint32_t> original = indices;
+
+		VertexCacheStatistics before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+		OptimizeVertexCache(indices.data(), indices.size(), vertexCount);
+		VertexCacheStatistics after = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+		CHECK(before.acmr > 1.5f);
+		CHECK(after.acmr < 0.8f);
+		CHECK(after.vertexTransformCount < before.vertexTransformCount);
+		CHECK(CanonicalTriangles(indices) == CanonicalTriangles(original));
+	}
+
+	// 同じ入力からは毎回同じバイト列になる
+	void TestDeterministic() {
+		const size_t vertexCount = (kGridSize + 1) * (kGridSize + 1);
+		std::vector<uint32_t> first = MakeShuffledGrid(0);
+		std::vector<uint32_t> second = MakeShuffledGrid(0);
+		OptimizeVertexCache(first.data(), first.size(), vertexCount);
+		OptimizeVertexCache(second.data(), second.size(), vertexCount);
+		CHECK(first.size() == second.size());
+		CHECK(std::memcmp(first.data(), second.data(), first.size() * sizeof(uint32_t)) == 0);
+	}
+
+	// OptimizeMeshで作業用の配列を使い回しても、SubMeshごとに単独で並べ替えたのと同じ結果になる
+	void TestSubMeshesMatchStandalone() {
+		const uint32_t gridVertexCount = (kGridSize + 1) * (kGridSize + 1);
+		ModelData modelData;
+		modelData.vertices.resize(gridVertexCount * 2);
+		for (size_t i = 0; i < modelData.vertices.size(); ++i) {
+			modelData.vertices[i].position = { static_cast<float>(i), 0.0f, 0.0f, 1.0f };
+		}
+		// 2つ目のSubMeshは1つ目と頂点を共有する三角形も持つ
+		std::vector<uint32_t> first = MakeShuffledGrid(0);
+		std::vector<uint32_t> second = MakeShuffledGrid(gridVertexCount);
+		second.insert(second.end(), first.begin(), first.begin() + 30);
+		modelData.indices = first;
+		modelData.indices.insert(modelData.indices.end(), second.begin(), second.end());
+		modelData.subMeshes.push_back({ 0, static_cast<uint32_t>(first.size()), 0 });
+		modelData.subMeshes.push_back({ static_cast<uint32_t>(first.size()), static_cast<uint32_t>(second.size()), 1 });
+
+		OptimizeVertexCache(first.data(), first.size(), modelData.vertices.size());
+		OptimizeVertexCache(second.data(), second.size(), modelData.vertices.size());
+		std::vector<uint32_t> expected = first;
+		expected.insert(expected.end(), second.begin(), second.end());
+		std::vector<VertexData> originalVertices = modelData.vertices;
+
+		OptimizeMesh(modelData);
+
+		// 頂点は並べ替えられているので、元の頂点の番号(position.x)に戻して比べる
+		CHECK(modelData.indices.size() == expected.size());
+		bool same = modelData.indices.size() == expected.size();
+		for (size_t i = 0; same && i < expected.size(); ++i) {
+			uint32_t originalIndex = static_cast<uint32_t>(modelData.vertices[modelData.indices[i]].position.x);
+			same = originalIndex == expected[i];
+		}
+		CHECK(same);
+		CHECK(modelData.vertices.size() == originalVertices.size());
+	}
+}
+
+int main() {
+	TestImprovesAcmr();
+	TestDeterministic();
+	TestSubMeshesMatchStandalone();
+	return FinishTests("MeshOptimizerTest");
+}
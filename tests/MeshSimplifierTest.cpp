@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "MeshSimplifier.h"
+#include "TestCommon.h"
+
+namespace {
+	const uint32_t kGridSize = 40; // 1辺のマスの数
+
+	/// <summary>
+	/// 起伏のある格子のメッシュ。左半分と右半分を別のSubMeshにする
+	/// </summary>
+	ModelData MakeBumpyGrid() {
+		ModelData modelData;
+		for (uint32_t y = 0; y <= kGridSize; ++y) {
+			for (uint32_t x = 0; x <= kGridSize; ++x) {
+				float u = static_cast<float>(x) / kGridSize;
+				float v = static_cast<float>(y) / kGridSize;
+				float height = 0.08f * std::sin(u * 7.0f) * std::cos(v * 5.0f) + 0.02f * std::sin(u * 23.0f + v * 17.0f);
+				VertexData vertex{};
+				vertex.position = { u, v, height, 1.0f };
+				vertex.normal = { 0.0f, 0.0f, 1.0f };
+				modelData.vertices.push_back(vertex);
+			}
+		}
+		for (uint32_t half = 0; half < 2; ++half) {
+			SubMesh subMesh{ static_cast<uint32_t>(modelData.indices.size()), 0, half };
+			for (uint32_t y = 0; y < kGridSize; ++y) {
+				for (uint32_t x = half * kGridSize / 2; x < (half + 1) * kGridSize / 2; ++x) {
+					uint32_t v0 = y * (kGridSize + 1) + x;
+					uint32_t v1 = v0 + 1;
+					uint32_t v2 = v0 + kGridSize + 1;
+					uint32_t v3 = v2 + 1;
+					modelData.indices.insert(modelData.indices.end(), { v0, v1, v2, v1, v3, v2 });
+				}
+			}
+			subMesh.indexCount = static_cast<uint32_t>(modelData.indices.size()) - subMesh.indexStart;
+			modelData.subMeshes.push_back(subMesh);
+		}
+		return modelData;
+	}
+
+	struct Point final {
+		double x, y, z;
+	};
+
+	Point Sub(const Point& a, const Point& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	double Dot(const Point& a, const Point& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Point Mad(const Point& a, const Point& b, double t) { return { a.x + b.x * t, a.y + b.y * t, a.z + b.z * t }; }
+
+	// 点から三角形までの一番近い点(Ericson, "Real-Time Collision Detection" 5.1.5)
+	Point ClosestPointOnTriangle(const Point& p, const Point& a, const Point& b, const Point& c) {
+		Point ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+		double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0) { return a; }
+		Point bp = Sub(p, b);
+		double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3) { return b; }
+		double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) { return Mad(a, ab, d1 / (d1 - d3)); }
+		Point cp = Sub(p, c);
+		double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6) { return c; }
+		double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) { return Mad(a, ac, d2 / (d2 - d6)); }
+		double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) { return Mad(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6))); }
+		double denominator = 1.0 / (va + vb + vc);
+		return Mad(Mad(a, ab, vb * denominator), ac, vc * denominator);
+	}
+
+	Point ToPoint(const VertexData& vertex) {
+		return { vertex.position.x, vertex.position.y, vertex.position.z };
+	}
+
+	// 元の頂点から、その段の面までの距離の最大
+	double MeasureVertexToSurface(const ModelData& modelData, size_t level) {
+		const MeshLod& lod = modelData.lods[level];
+		double maxDistance = 0.0;
+		for (const VertexData& vertex : modelData.vertices) {
+			Point p = ToPoint(vertex);
+			double best = 1e30;
+			for (size_t s = 0; s < modelData.subMeshes.size(); ++s) {
+				const SubMesh& subMesh = modelData.lodSubMeshes[lod.subMeshStart + s];
+				for (uint32_t i = 0; i < subMesh.indexCount; i += 3) {
+					const uint32_t* corners = modelData.indices.data() + subMesh.indexStart + i;
+					Point q = ClosestPointOnTriangle(p, ToPoint(modelData.vertices[corners[0]]), ToPoint(modelData.vertices[corners[1]]), ToPoint(modelData.vertices[corners[2]]));
+					Point d = Sub(p, q);
+					best = std::min(best, Dot(d, d));
+				}
+			}
+			maxDistance = std::max(maxDistance, std::sqrt(best));
+		}
+		return maxDistance;
+	}
+
+	// 段ごとの三角形の数と範囲
+	void TestTriangleCounts(const ModelData& modelData) {
+		const uint32_t originalTriangleCount = kGridSize * kGridSize * 2;
+		CHECK(modelData.lods.size() >= 3);
+		CHECK(modelData.lods.size() <= kMaxLodCount);
+		CHECK(modelData.lods[0].triangleCount == originalTriangleCount);
+		CHECK(modelData.lods[0].error == 0.0f);
+		CHECK(modelData.lodSubMeshes.size() == modelData.lods.size() * modelData.subMeshes.size());
+
+		for (size_t level = 0; level < modelData.lods.size(); ++level) {
+			const MeshLod& lod = modelData.lods[level];
+			CHECK(lod.subMeshStart == level * modelData.subMeshes.size());
+
+			// SubMeshの三角形の合計が段の三角形の数になり、マテリアルは元と同じ
+			uint32_t indexCount = 0;
+			bool inRange = true;
+			for (size_t s = 0; s < modelData.subMeshes.size(); ++s) {
+				const SubMesh& subMesh = modelData.lodSubMeshes[lod.subMeshStart + s];
+				CHECK(subMesh.materialIndex == modelData.subMeshes[s].materialIndex);
+				CHECK(subMesh.indexCount > 0);
+				indexCount += subMesh.indexCount;
+				for (uint32_t i = 0; i < subMesh.indexCount; ++i) {
+					inRange = inRange && modelData.indices[subMesh.indexStart + i] < modelData.vertices.size();
+				}
+			}
+			CHECK(indexCount == lod.triangleCount * 3);
+			CHECK(inRange);
+
+			// 段ごとに前の段の半分くらいまで減る
+			if (level > 0) {
+				uint32_t previous = modelData.lods[level - 1].triangleCount;
+				CHECK(lod.triangleCount <= previous * kLodTriangleRatio + 1);
+				CHECK(lod.triangleCount > 0);
+			}
+		}
+	}
+
+	// 誤差は段が進んでも小さくならず、元の頂点から段の面までの実際の距離を下回らない
+	void TestErrorIsMonotonicAndConservative(const ModelData& modelData) {
+		for (size_t level = 1; level < modelData.lods.size(); ++level) {
+			CHECK(modelData.lods[level].error >= modelData.lods[level - 1].error);
+			double measured = MeasureVertexToSurface(modelData, level);
+			CHECK(measured <= static_cast<double>(modelData.lods[level].error));
+			if (measured > static_cast<double>(modelData.lods[level].error)) {
+				std::fprintf(stderr, "LOD%zu measured %.7f > error %.7f\n", level, measured, modelData.lods[level].error);
+			}
+		}
+		CHECK(modelData.lods.back().error > 0.0f);
+	}
+
+	// 誤差が許容範囲に収まる一番粗い段を選ぶ
+	void TestSelectLod(const ModelData& modelData) {
+		const float kFovY = 0.45f;
+		const float kScreenHeight = 720.0f;
+		CHECK(SelectLod(modelData.lods, 1.0f, 0.01f, kFovY, kScreenHeight) == 0);
+		CHECK(SelectLod(modelData.lods, 1.0f, 1e6f, kFovY, kScreenHeight) == modelData.lods.size() - 1);
+		for (float distance = 0.5f; distance < 200.0f; distance *= 1.5f) {
+			uint32_t level = SelectLod(modelData.lods, 1.0f, distance, kFovY, kScreenHeight, 1.0f);
+			CHECK(ComputeScreenError(modelData.lods[level].error, distance, kFovY, kScreenHeight) <= 1.0f);
+		}
+	}
+
+	// 同じ入力からは同じLODになる
+	void TestDeterministic(const ModelData& modelData) {
+		ModelData again = MakeBumpyGrid();
+		BuildLods(again);
+		CHECK(again.indices == modelData.indices);
+		CHECK(again.lods.size() == modelData.lods.size());
+	}
+}
+
+int main() {
+	ModelData modelData = MakeBumpyGrid();
+	BuildLods(modelData);
+	TestTriangleCounts(modelData);
+	TestErrorIsMonotonicAndConservative(modelData);
+	TestSelectLod(modelData);
+	TestDeterministic(modelData);
+	return FinishTests("MeshSimplifierTest");
+}
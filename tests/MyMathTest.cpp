@@ -0,0 +1,100 @@
+#include <cmath>
+#include "MatrixExpression.h"
+#include "MyMath.h"
+#include "TestCommon.h"
+
+namespace {
+	// 対角にscaleを並べ、少し回した行列
+	Matrix4x4 MakeScaledMatrix(float scale) {
+		return MakeAffineMatrix(Vector3{ scale, scale, scale }, Vector3{ 0.3f, 0.7f, 1.1f }, Vector3{ 1.0f, 2.0f, 3.0f });
+	}
+
+	// 積が単位行列に近いか。許容誤差は要素の大きさに合わせずに相対で見る
+	bool IsNearIdentity(const Matrix4x4& m, float tolerance) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				float expected = row == column ? 1.0f : 0.0f;
+				if (!(std::fabs(m.m[row][column] - expected) <= tolerance)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// 大きい/小さい行列でも、各行の長さの積が溢れずに逆行列を求められる。floatでは積が1e60になって溢れていた
+	void TestExtremeScales() {
+		for (float scale : { 1e-10f, 1e-6f, 1e-3f, 1.0f, 1e3f, 1e6f, 1e10f }) {
+			Matrix4x4 m = MakeScaledMatrix(scale);
+			Matrix4x4 inverse;
+			CHECK(TryInverseAffine(m, inverse));
+			CHECK(IsNearIdentity(Matrix4x4(m * inverse), 1e-4f));
+			CHECK(TryInverseScalar(m, inverse));
+			CHECK(TryInverse(m, inverse));
+			if (!TryInverse(m, inverse)) {
+				std::fprintf(stderr, "scale %g rejected\n", scale);
+			}
+		}
+	}
+
+	// 逆行列が無い行列は、大きさに関わらず単位行列を入れて失敗する
+	void TestSingular() {
+		Matrix4x4 inverse;
+		for (float scale : { 1e-14f, 1.0f, 1e14f }) {
+			Matrix4x4 m = MakeScaledMatrix(scale);
+			for (int column = 0; column < 4; ++column) {
+				m.m[1][column] = m.m[0][column] * 2.0f; // 2行目を1行目の2倍にする
+			}
+			CHECK(!TryInverseScalar(m, inverse));
+			CHECK(IsNearIdentity(inverse, 0.0f));
+			CHECK(!TryInverse(m, inverse));
+			CHECK(IsNearIdentity(inverse, 0.0f));
+			m.m[3][3] = 0.0f;
+			CHECK(!TryInverseAffine(m, inverse));
+		}
+		// 行列式がfloatで表せない大きさなら、でたらめな逆行列を返さずに失敗する
+		Matrix4x4 huge = MakeScaledMatrix(1e14f);
+		CHECK(!TryInverseAffine(huge, inverse));
+		CHECK(!TryInverseScalar(huge, inverse));
+		CHECK(!TryInverse(huge, inverse));
+		CHECK(IsNearIdentity(inverse, 0.0f));
+
+		Matrix4x4 zero{};
+		CHECK(!TryInverse(zero, inverse));
+		CHECK(!TryInverseAffine(zero, inverse));
+	}
+
+	// 掛け算の式は一時的な行列を値で持つので、式を作った文が終わった後に求めても同じ結果になる
+	void TestExpressionOwnsTemporaries() {
+		Matrix4x4 world = MakeScaledMatrix(2.0f);
+		Matrix4x4 projection = MakeScaledMatrix(0.5f);
+		Matrix4x4 expected = Matrix4x4(world * MakeTranslateMatrix({ 4.0f, 5.0f, 6.0f })) * projection;
+
+		auto product = world * MakeTranslateMatrix({ 4.0f, 5.0f, 6.0f }) * projection;
+		Matrix4x4 stackNoise = MakeScaledMatrix(100.0f); // 消えた一時的な行列の場所を上書きする
+		(void)stackNoise;
+		Matrix4x4 actual = product;
+		CHECK(IsNearIdentity(Matrix4x4(actual * Inverse(expected)), 1e-5f));
+	}
+
+	// EvaluateToの書き込み先が式の中の行列でもよい
+	void TestEvaluateToAliasing() {
+		Matrix4x4 a = MakeScaledMatrix(2.0f);
+		Matrix4x4 b = MakeScaledMatrix(3.0f);
+		Matrix4x4 expected = a * b;
+		(a * b).EvaluateTo(a);
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				CHECK(a.m[row][column] == expected.m[row][column]);
+			}
+		}
+	}
+}
+
+int main() {
+	TestExtremeScales();
+	TestSingular();
+	TestExpressionOwnsTemporaries();
+	TestEvaluateToAliasing();
+	return FinishTests("MyMathTest");
+}
@@ -0,0 +1,167 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "ObjLoader.h"
+#include "TestCommon.h"
+
+namespace {
+	/// <summary>
+	/// テスト用のObjファイルを置く一時ディレクトリ
+	/// </summary>
+	const std::filesystem::path& TestDirectory() {
+		static const std::filesystem::path directory = [] {
+			std::filesystem::path path = std::filesystem::temp_directory_path() / "cg3_objloader_test";
+			std::filesystem::create_directories(path);
+			return path;
+		}();
+		return directory;
+	}
+
+	// 中身を書き出して読む。キャッシュは使わない
+	bool LoadText(const std::string& filename, const std::string& text, ModelData& modelData, uint32_t threadCount = 1) {
+		{
+			std::ofstream stream(TestDirectory() / filename, std::ios::binary);
+			stream << text;
+		}
+		ObjLoadDesc desc{};
+		desc.threadCount = threadCount;
+		desc.useCache = false;
+		return LoadObjFile(TestDirectory().string(), filename, modelData, desc);
+	}
+
+	const char* const kQuadPositions =
+		"v 0 0 0\n"
+		"v 1 0 0\n"
+		"v 1 1 0\n"
+		"v 0 1 0\n"
+		"vt 0 0\n"
+		"vn 0 0 1\n";
+
+	// 正しいファイルは読める。相対指定も解決される
+	void TestValidFaces() {
+		ModelData modelData;
+		CHECK(LoadText("valid.obj", std::string(kQuadPositions) + "f 1/1/1 2/1/1 3/1/1\nf -4 -2 -1\n", modelData));
+		CHECK(modelData.indices.size() == 6);
+		CHECK(!modelData.vertices.empty());
+	}
+
+	// 範囲外の番号を参照する面があれば失敗して、ModelDataは空になる
+	void TestInvalidIndices() {
+		const char* const kFaces[] = {
+			"f 0 1 2\n", // 0は無効
+			"f 1 2 5\n", // 位置は4つまで
+			"f -5 -4 -3\n", // 相対指定がファイルの先頭より前
+			"f /1/1 2/1/1 3/1/1\n", // 位置が無い
+			"f 1/2 2/2 3/2\n", // UVは1つだけ
+			"f 1//2 2//2 3//2\n", // 法線は1つだけ
+			"f 1//-2 2//-2 3//-2\n", // 相対指定の法線が先頭より前
+			"f 1/-2 2/-2 3/-2\n", // 相対指定のUVが先頭より前
+		};
+		for (const char* face : kFaces) {
+			ModelData modelData;
+			modelData.indices.push_back(1); // 失敗した時に空にするか
+			bool isLoaded = LoadText("invalid.obj", std::string(kQuadPositions) + "f 1 2 3\n" + face, modelData);
+			CHECK(!isLoaded);
+			CHECK(modelData.indices.empty() && modelData.vertices.empty());
+			if (isLoaded) {
+				std::fprintf(stderr, "accepted: %s", face);
+			}
+		}
+	}
+
+	// 分割して読んでも、後ろのチャンクの範囲外の番号で失敗する
+	void TestInvalidIndexInLaterChunk() {
+		std::string text = kQuadPositions;
+		while (text.size() < 1024 * 1024) {
+			text += "f 1/1/1 2/1/1 3/1/1\nf -4 -2 -1\n";
+		}
+		text += "f 1 2 9\n";
+		ModelData modelData;
+		CHECK(!LoadText("invalid_large.obj", text, modelData, 4));
+		CHECK(modelData.vertices.empty());
+	}
+
+	// 並べ替えとLODは読み込みの設定で止められる
+	void TestProcessingOptions() {
+		std::string text = "vt 0 0\nvn 0 0 1\n";
+		const int kGridSize = 16;
+		for (int y = 0; y <= kGridSize; ++y) {
+			for (int x = 0; x <= kGridSize; ++x) {
+				text += "v " + std::to_string(x) + " " + std::to_string(y) + " " + std::to_string((x * y) % 3) + "\n";
+			}
+		}
+		for (int y = 0; y < kGridSize; ++y) {
+			for (int x = 0; x < kGridSize; ++x) {
+				int v0 = y * (kGridSize + 1) + x + 1;
+				int v2 = v0 + kGridSize + 1;
+				// 法線を共有して、隣の面と頂点がつながるようにする
+				text += "f " + std::to_string(v0) + "//1 " + std::to_string(v0 + 1) + "//1 " + std::to_string(v2) + "//1\n";
+				text += "f " + std::to_string(v0 + 1) + "//1 " + std::to_string(v2 + 1) + "//1 " + std::to_string(v2) + "//1\n";
+			}
+		}
+		{
+			std::ofstream stream(TestDirectory() / "grid.obj", std::ios::binary);
+			stream << text;
+		}
+		const uint32_t triangleCount = kGridSize * kGridSize * 2;
+
+		ObjLoadDesc desc{};
+		desc.useCache = false;
+		ModelData full;
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", full, desc));
+		CHECK(full.lods.size() > 1);
+		CHECK(full.lods[0].triangleCount == triangleCount);
+
+		desc.optimizeMesh = false;
+		desc.buildLods = false;
+		ModelData plain;
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", plain, desc));
+		CHECK(plain.lods.size() == 1);
+		CHECK(plain.lods[0].triangleCount == triangleCount && plain.lods[0].error == 0.0f);
+		CHECK(plain.lodSubMeshes.size() == plain.subMeshes.size());
+		CHECK(plain.indices.size() == triangleCount * 3);
+		// 並べ替えなければ、面はファイルの順のまま
+		CHECK(plain.indices[0] == 0 && plain.indices[1] == 1 && plain.indices[2] == 2);
+	}
+
+	// 設定ごとに別のキャッシュを書き、交互に読んでも互いを上書きしない(grid.objはTestProcessingOptionsで書いたもの)
+	void TestCachePerSettings() {
+		ObjLoadDesc full{};
+		ObjLoadDesc plain{};
+		plain.optimizeMesh = false;
+		plain.buildLods = false;
+		ModelData fullParsed, plainParsed;
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", fullParsed, full));
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", plainParsed, plain));
+		CHECK(std::filesystem::exists(TestDirectory() / "grid.obj.3.meshcache"));
+		CHECK(std::filesystem::exists(TestDirectory() / "grid.obj.0.meshcache"));
+
+		auto fullTime = std::filesystem::last_write_time(TestDirectory() / "grid.obj.3.meshcache");
+		ModelData fullCached, plainCached;
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", fullCached, full));
+		CHECK(LoadObjFile(TestDirectory().string(), "grid.obj", plainCached, plain));
+		CHECK(fullCached.indices == fullParsed.indices && fullCached.lods.size() == fullParsed.lods.size());
+		CHECK(plainCached.indices == plainParsed.indices && plainCached.lods.size() == 1);
+		CHECK(std::filesystem::last_write_time(TestDirectory() / "grid.obj.3.meshcache") == fullTime);
+	}
+
+	// 開けないファイルは止まらずに失敗する
+	void TestMissingFile() {
+		ModelData modelData;
+		ObjLoadDesc desc{};
+		desc.useCache = false;
+		CHECK(!LoadObjFile(TestDirectory().string(), "missing.obj", modelData, desc));
+		CHECK(modelData.vertices.empty());
+	}
+}
+
+int main() {
+	TestValidFaces();
+	TestInvalidIndices();
+	TestInvalidIndexInLaterChunk();
+	TestProcessingOptions();
+	TestCachePerSettings();
+	TestMissingFile();
+	std::filesystem::remove_all(TestDirectory());
+	return FinishTests("ObjLoaderTest");
+}
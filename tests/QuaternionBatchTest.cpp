@@ -0,0 +1,125 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "MyMath.h"
+#include "QuaternionBatch.h"
+#include "TestCommon.h"
+
+namespace {
+	// SIMDで4つずつ計算する分と、スカラー版で計算する端数の両方を含む数
+	const size_t kCount = 1027;
+
+	struct Inputs final {
+		QuaternionArrays from;
+		QuaternionArrays to;
+		std::vector<float> t;
+	};
+
+	// ばらばらの向きの組と、ほぼ同じ向き、反対向き(内積が負)の組を混ぜる
+	Inputs MakeInputs(uint32_t seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> angle(-3.14159265f, 3.14159265f);
+		std::uniform_real_distribution<float> factor(0.0f, 1.0f);
+		Inputs inputs;
+		ResizeQuaternionArrays(inputs.from, kCount);
+		ResizeQuaternionArrays(inputs.to, kCount);
+		inputs.t.resize(kCount);
+		for (size_t i = 0; i < kCount; ++i) {
+			Quaternion from = MakeRotateQuaternion(Vector3{ angle(random), angle(random), angle(random) });
+			Quaternion to = MakeRotateQuaternion(Vector3{ angle(random), angle(random), angle(random) });
+			if (i % 7 == 0) {
+				to = Normalize(Quaternion{ from.x + 1e-4f, from.y, from.z, from.w });
+			} else if (i % 7 == 1) {
+				to = { -to.x, -to.y, -to.z, -to.w };
+			}
+			SetQuaternion(inputs.from, i, from);
+			SetQuaternion(inputs.to, i, to);
+			inputs.t[i] = i % 11 == 0 ? 0.0f : i % 11 == 1 ? 1.0f : factor(random);
+		}
+		return inputs;
+	}
+
+	QuaternionArrays Single(const QuaternionArrays& quaternions, size_t i) {
+		QuaternionArrays single;
+		ResizeQuaternionArrays(single, 1);
+		SetQuaternion(single, 0, GetQuaternion(quaternions, i));
+		return single;
+	}
+
+	bool IsSameBits(const Quaternion& a, const Quaternion& b) {
+		return std::memcmp(&a, &b, sizeof(Quaternion)) == 0;
+	}
+
+	// 2つの回転の間の角度(ラジアン)。qと-qは同じ回転。内積が1に近いとfloatのacosでは粗いので、差の長さから求める
+	float AngleBetween(const Quaternion& a, const Quaternion& b) {
+		double sign = Dot(a, b) < 0.0f ? -1.0 : 1.0;
+		double dx = a.x - sign * b.x, dy = a.y - sign * b.y, dz = a.z - sign * b.z, dw = a.w - sign * b.w;
+		double chord = std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw);
+		return static_cast<float>(4.0 * std::asin(std::min(chord * 0.5, 1.0)));
+	}
+
+	using BatchFunction = void (*)(const QuaternionArrays&, const QuaternionArrays&, const std::vector<float>&, QuaternionArrays&);
+
+	// SIMDで4つずつ補間した結果が、1つずつのスカラー版とビットまで一致する
+	void TestSimdMatchesScalar(BatchFunction interpolate) {
+		Inputs inputs = MakeInputs(1);
+		QuaternionArrays result;
+		ResizeQuaternionArrays(result, kCount);
+		interpolate(inputs.from, inputs.to, inputs.t, result);
+
+		bool isSame = true;
+		for (size_t i = 0; i < kCount; ++i) {
+			QuaternionArrays single;
+			ResizeQuaternionArrays(single, 1);
+			interpolate(Single(inputs.from, i), Single(inputs.to, i), { inputs.t[i] }, single);
+			isSame = isSame && IsSameBits(GetQuaternion(result, i), GetQuaternion(single, 0));
+		}
+		CHECK(isSame);
+	}
+
+	// Nlerpは1つずつのNlerpと、Slerpは1つずつのSlerpと、ヘッダーに書いた誤差の範囲で一致する
+	void TestMatchesReference() {
+		Inputs inputs = MakeInputs(2);
+		QuaternionArrays nlerp, slerp;
+		ResizeQuaternionArrays(nlerp, kCount);
+		ResizeQuaternionArrays(slerp, kCount);
+		NlerpQuaternions(inputs.from, inputs.to, inputs.t, nlerp);
+		SlerpQuaternions(inputs.from, inputs.to, inputs.t, slerp);
+
+		float maxNlerpError = 0.0f;
+		float maxSlerpError = 0.0f;
+		bool isUnit = true;
+		for (size_t i = 0; i < kCount; ++i) {
+			Quaternion from = GetQuaternion(inputs.from, i);
+			Quaternion to = GetQuaternion(inputs.to, i);
+			maxNlerpError = std::max(maxNlerpError, AngleBetween(GetQuaternion(nlerp, i), Nlerp(from, to, inputs.t[i])));
+			maxSlerpError = std::max(maxSlerpError, AngleBetween(GetQuaternion(slerp, i), Slerp(from, to, inputs.t[i])));
+			isUnit = isUnit && std::fabs(Dot(GetQuaternion(slerp, i), GetQuaternion(slerp, i)) - 1.0f) < 1e-5f;
+		}
+		CHECK(maxNlerpError < 1e-3f);
+		CHECK(maxSlerpError < 2e-3f);
+		CHECK(isUnit);
+		if (maxSlerpError >= 2e-3f) {
+			std::fprintf(stderr, "slerp error %g\n", maxSlerpError);
+		}
+	}
+
+	// 書き込み先にfromを渡しても、別に書き込んだ時と同じになる
+	void TestResultAliasesInput() {
+		Inputs inputs = MakeInputs(3);
+		QuaternionArrays expected;
+		ResizeQuaternionArrays(expected, kCount);
+		SlerpQuaternions(inputs.from, inputs.to, inputs.t, expected);
+		SlerpQuaternions(inputs.from, inputs.to, inputs.t, inputs.from);
+		CHECK(inputs.from.x == expected.x && inputs.from.y == expected.y && inputs.from.z == expected.z && inputs.from.w == expected.w);
+	}
+}
+
+int main() {
+	TestSimdMatchesScalar(NlerpQuaternions);
+	TestSimdMatchesScalar(SlerpQuaternions);
+	TestMatchesReference();
+	TestResultAliasesInput();
+	return FinishTests("QuaternionBatchTest");
+}
@@ -0,0 +1,97 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include "SinCos.h"
+#include "TestCommon.h"
+
+namespace {
+	// 誤差の上限。ヘッダーに書いた最大誤差に少し余裕を持たせる
+	float Tolerance(SinCosPrecision precision) {
+		return precision == SinCosPrecision::Fast ? 2e-5f : 5e-7f;
+	}
+
+	// ±数千ラジアンまで、libmのsin/cosとの差が精度の範囲に収まる。象限の境目(π/4の奇数倍)も含める
+	void TestAccuracy(SinCosPrecision precision) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> distribution(-4000.0f, 4000.0f);
+		float maxError = 0.0f;
+		for (int i = 0; i < 200000; ++i) {
+			float radian = i < 1000 ? (2 * i - 999) * 0.785398163f : distribution(random);
+			float sinValue, cosValue;
+			SinCos(radian, sinValue, cosValue, precision);
+			maxError = std::max(maxError, static_cast<float>(std::fabs(sinValue - std::sin(static_cast<double>(radian)))));
+			maxError = std::max(maxError, static_cast<float>(std::fabs(cosValue - std::cos(static_cast<double>(radian)))));
+		}
+		CHECK(maxError <= Tolerance(precision));
+		if (maxError > Tolerance(precision)) {
+			std::fprintf(stderr, "max error %g\n", maxError);
+		}
+	}
+
+	// NaNと無限大ではNaN、intに入らないほど大きい角度ではlibmと同じ値を返す
+	void TestNonFiniteAndHuge() {
+		const float kInputs[] = {
+			std::numeric_limits<float>::quiet_NaN(),
+			std::numeric_limits<float>::infinity(),
+			-std::numeric_limits<float>::infinity(),
+		};
+		for (float radian : kInputs) {
+			float sinValue = 0.0f, cosValue = 0.0f;
+			SinCos(radian, sinValue, cosValue);
+			CHECK(std::isnan(sinValue) && std::isnan(cosValue));
+		}
+		for (float radian : { 1e10f, -1e10f, 3.4e38f }) {
+			float sinValue, cosValue;
+			SinCos(radian, sinValue, cosValue);
+			CHECK(sinValue == std::sin(radian) && cosValue == std::cos(radian));
+		}
+	}
+
+#if MYMATH_USE_SIMD
+	// SIMD版の各要素は、スカラー版とビットまで一致する
+	void TestSimdMatchesScalar(SinCosPrecision precision) {
+		std::mt19937 random(2);
+		std::uniform_real_distribution<float> distribution(-4000.0f, 4000.0f);
+		bool isEqual = true;
+		for (int i = 0; i < 50000; ++i) {
+			alignas(32) float radians[8];
+			for (float& radian : radians) {
+				radian = distribution(random);
+			}
+			alignas(32) float sinValues[8];
+			alignas(32) float cosValues[8];
+			__m128 sin4, cos4;
+			SinCos(_mm_load_ps(radians), sin4, cos4, precision);
+			_mm_store_ps(sinValues, sin4);
+			_mm_store_ps(cosValues, cos4);
+#if defined(__AVX__)
+			__m256 sin8, cos8;
+			SinCos(_mm256_load_ps(radians), sin8, cos8, precision);
+			alignas(32) float sinValues8[8];
+			alignas(32) float cosValues8[8];
+			_mm256_store_ps(sinValues8, sin8);
+			_mm256_store_ps(cosValues8, cos8);
+			isEqual = isEqual && std::memcmp(sinValues, sinValues8, sizeof(float) * 4) == 0 && std::memcmp(cosValues, cosValues8, sizeof(float) * 4) == 0;
+#endif
+			for (int lane = 0; lane < 4; ++lane) {
+				float sinValue, cosValue;
+				SinCos(radians[lane], sinValue, cosValue, precision);
+				isEqual = isEqual && std::memcmp(&sinValue, &sinValues[lane], sizeof(float)) == 0 && std::memcmp(&cosValue, &cosValues[lane], sizeof(float)) == 0;
+			}
+		}
+		CHECK(isEqual);
+	}
+#endif
+}
+
+int main() {
+	for (SinCosPrecision precision : { SinCosPrecision::Fast, SinCosPrecision::Precise }) {
+		TestAccuracy(precision);
+#if MYMATH_USE_SIMD
+		TestSimdMatchesScalar(precision);
+#endif
+	}
+	TestNonFiniteAndHuge();
+	return FinishTests("SinCosTest");
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdio>
+
+/// <summary>
+/// テストの失敗の数。mainの戻り値にする
+/// </summary>
+inline int& TestFailureCount() {
+	static int count = 0;
+	return count;
+}
+
+/// <summary>
+/// 条件が偽なら場所と式を出して失敗を数える。続きのテストは止めない
+/// </summary>
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++TestFailureCount(); \
+		} \
+	} while (false)
+
+/// <summary>
+/// 失敗が無ければ0を返す
+/// </summary>
+inline int FinishTests(const char* name) {
+	if (TestFailureCount() == 0) {
+		std::printf("%s: passed\n", name);
+		return 0;
+	}
+	std::printf("%s: %d failure(s)\n", name, TestFailureCount());
+	return 1;
+}
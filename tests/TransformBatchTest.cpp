@@ -0,0 +1,149 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "MyMath.h"
+#include "QuaternionBatch.h"
+#include "TransformBatch.h"
+#include "TestCommon.h"
+
+namespace {
+	// SIMDで4つずつ計算する分と、スカラー版で計算する端数の両方を含む数
+	const size_t kObjectCount = 103;
+
+	const Matrix4x4 kViewProjection = { {
+		{ 1.2f, 0.1f, 0.3f, 0.2f },
+		{ 0.4f, 1.5f, 0.1f, 0.3f },
+		{ 0.2f, 0.3f, 1.1f, 1.0f },
+		{ 0.5f, 0.7f, 2.0f, 3.0f } } };
+
+	TransformArrays MakeRandomTransforms(std::mt19937& random) {
+		std::uniform_real_distribution<float> scale(0.1f, 4.0f);
+		std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		TransformArrays transforms;
+		ResizeTransformArrays(transforms, kObjectCount);
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			SetTransform(transforms, i, { scale(random), scale(random), scale(random) }, { angle(random), angle(random), angle(random) },
+				{ position(random), position(random), position(random) });
+		}
+		return transforms;
+	}
+
+	// i番目だけを取り出した1つ分のTransform。1つならSIMDを使わずスカラー版で計算される
+	TransformArrays Single(const TransformArrays& transforms, size_t i) {
+		TransformArrays single;
+		ResizeTransformArrays(single, 1);
+		SetTransform(single, 0, { transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i] },
+			{ transforms.rotateX[i], transforms.rotateY[i], transforms.rotateZ[i] },
+			{ transforms.translateX[i], transforms.translateY[i], transforms.translateZ[i] });
+		return single;
+	}
+
+	bool IsSameBits(const Matrix4x4& a, const Matrix4x4& b) {
+		return std::memcmp(a.m, b.m, sizeof(a.m)) == 0;
+	}
+
+	bool IsNear(const Matrix4x4& a, const Matrix4x4& b, float tolerance) {
+		for (int row = 0; row < 4; ++row) {
+			for (int column = 0; column < 4; ++column) {
+				float scale = std::max(1.0f, std::fabs(b.m[row][column]));
+				if (!(std::fabs(a.m[row][column] - b.m[row][column]) <= tolerance * scale)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// オイラー角の版。SIMDで4つずつ求めた結果が、1つずつのスカラー版とビットまで一致する
+	void TestEulerSimdMatchesScalar(SinCosPrecision precision) {
+		std::mt19937 random(1);
+		TransformArrays transforms = MakeRandomTransforms(random);
+		std::vector<TransformationMatrix> batch(kObjectCount);
+		ComputeTransformBatch(transforms, kViewProjection, batch.data(), sizeof(TransformationMatrix), precision);
+
+		bool isSame = true;
+		bool isNearReference = true;
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			TransformationMatrix single;
+			ComputeTransformBatch(Single(transforms, i), kViewProjection, &single, sizeof(TransformationMatrix), precision);
+			isSame = isSame && IsSameBits(batch[i].World, single.World) && IsSameBits(batch[i].WVP, single.WVP);
+
+			// Preciseの時は、1つずつ作るMakeAffineMatrixと同じWorldになる
+			Vector3 scale = { transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i] };
+			Vector3 rotate = { transforms.rotateX[i], transforms.rotateY[i], transforms.rotateZ[i] };
+			Vector3 translate = { transforms.translateX[i], transforms.translateY[i], transforms.translateZ[i] };
+			if (precision == SinCosPrecision::Precise) {
+				CHECK(IsSameBits(batch[i].World, MakeAffineMatrix(scale, rotate, translate)));
+			}
+			Matrix4x4 reference = MakeAffineMatrixReference(scale, rotate, translate);
+			isNearReference = isNearReference && IsNear(batch[i].World, reference, 1e-4f) &&
+				IsNear(batch[i].WVP, Mutiply(reference, kViewProjection), 1e-4f);
+		}
+		CHECK(isSame);
+		CHECK(isNearReference);
+	}
+
+	// クォータニオンの版も、SIMDとスカラー版がビットまで一致し、MakeAffineMatrix(Quaternion)に近い
+	void TestQuaternionSimdMatchesScalar() {
+		std::mt19937 random(2);
+		TransformArrays transforms = MakeRandomTransforms(random);
+		std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+		QuaternionArrays rotations;
+		ResizeQuaternionArrays(rotations, kObjectCount);
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			SetQuaternion(rotations, i, MakeRotateQuaternion(Vector3{ angle(random), angle(random), angle(random) }));
+		}
+		std::vector<TransformationMatrix> batch(kObjectCount);
+		ComputeTransformBatch(transforms, rotations, kViewProjection, batch.data());
+
+		bool isSame = true;
+		bool isNearReference = true;
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			QuaternionArrays singleRotation;
+			ResizeQuaternionArrays(singleRotation, 1);
+			SetQuaternion(singleRotation, 0, GetQuaternion(rotations, i));
+			TransformationMatrix single;
+			ComputeTransformBatch(Single(transforms, i), singleRotation, kViewProjection, &single);
+			isSame = isSame && IsSameBits(batch[i].World, single.World) && IsSameBits(batch[i].WVP, single.WVP);
+
+			Matrix4x4 reference = MakeAffineMatrix(Vector3{ transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i] }, GetQuaternion(rotations, i),
+				Vector3{ transforms.translateX[i], transforms.translateY[i], transforms.translateZ[i] });
+			isNearReference = isNearReference && IsNear(batch[i].World, reference, 1e-5f) &&
+				IsNear(batch[i].WVP, Mutiply(reference, kViewProjection), 1e-4f);
+		}
+		CHECK(isSame);
+		CHECK(isNearReference);
+	}
+
+	// 書き込み先の間隔を空けても同じ結果になり、間は書き換えない
+	void TestOutputStride() {
+		std::mt19937 random(3);
+		TransformArrays transforms = MakeRandomTransforms(random);
+		std::vector<TransformationMatrix> packed(kObjectCount);
+		ComputeTransformBatch(transforms, kViewProjection, packed.data());
+
+		const size_t kStride = 256; // 1つずつCBVにする時の間隔
+		std::vector<unsigned char> strided(kStride * kObjectCount, 0xCD);
+		ComputeTransformBatch(transforms, kViewProjection, reinterpret_cast<TransformationMatrix*>(strided.data()), kStride);
+		bool isSame = true;
+		bool isGapUntouched = true;
+		for (size_t i = 0; i < kObjectCount; ++i) {
+			isSame = isSame && std::memcmp(strided.data() + i * kStride, &packed[i], sizeof(TransformationMatrix)) == 0;
+			for (size_t byte = sizeof(TransformationMatrix); byte < kStride; ++byte) {
+				isGapUntouched = isGapUntouched && strided[i * kStride + byte] == 0xCD;
+			}
+		}
+		CHECK(isSame);
+		CHECK(isGapUntouched);
+	}
+}
+
+int main() {
+	TestEulerSimdMatchesScalar(SinCosPrecision::Precise);
+	TestEulerSimdMatchesScalar(SinCosPrecision::Fast);
+	TestQuaternionSimdMatchesScalar();
+	TestOutputStride();
+	return FinishTests("TransformBatchTest");
+}
@@ -0,0 +1,183 @@
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "TestCommon.h"
+#include "UploadAllocator.h"
+
+namespace {
+	/// <summary>
+	/// 普通のメモリでページを作る。GPUアドレスは64KB境界の偽物を振る
+	/// </summary>
+	class FakePageBackend final : public UploadPageBackend {
+	public:
+		~FakePageBackend() override {
+			for (uint8_t* memory : live_) {
+				std::free(memory);
+			}
+		}
+
+		UploadPage CreatePage(size_t size) override {
+			uint8_t* memory = static_cast<uint8_t*>(std::malloc(size));
+			live_.push_back(memory);
+			UploadPage page = { memory, nextGpuAddress_, size, static_cast<uint32_t>(createCount_) };
+			nextGpuAddress_ += (size + LinearUploadAllocator::kPageAlignment - 1) & ~(LinearUploadAllocator::kPageAlignment - 1);
+			++createCount_;
+			return page;
+		}
+
+		void DestroyPage(const UploadPage& page) override {
+			for (size_t i = 0; i < live_.size(); ++i) {
+				if (live_[i] == page.cpuAddress) {
+					std::free(live_[i]);
+					live_.erase(live_.begin() + i);
+					break;
+				}
+			}
+			++destroyCount_;
+		}
+
+		size_t GetCreateCount() const { return createCount_; }
+		size_t GetDestroyCount() const { return destroyCount_; }
+		size_t GetLiveCount() const { return live_.size(); }
+
+	private:
+		std::vector<uint8_t*> live_;
+		uint64_t nextGpuAddress_ = 0x10000000;
+		size_t createCount_ = 0;
+		size_t destroyCount_ = 0;
+	};
+
+	/// <summary>
+	/// GPUの進み具合の代わり。Signalした値をTickで完了させる
+	/// </summary>
+	struct FakeFence final {
+		uint64_t signaled = 0;
+		uint64_t completed = 0;
+
+		uint64_t Signal() { return ++signaled; }
+		void Tick() { completed = signaled; }
+	};
+
+	// CPUとGPUのアドレスがページの先頭から同じだけずれているか
+	bool IsSameOffset(const UploadAllocation& a, const UploadAllocation& b) {
+		return static_cast<uint8_t*>(b.cpuAddress) - static_cast<uint8_t*>(a.cpuAddress) == static_cast<int64_t>(b.gpuAddress - a.gpuAddress);
+	}
+
+	// 境界をそろえ、そろえた分を数える
+	void TestAlignment() {
+		FakePageBackend backend;
+		LinearUploadAllocator allocator(backend);
+
+		UploadAllocation first = allocator.Allocate(10, 16);
+		CHECK(first.gpuAddress % 16 == 0);
+		CHECK(first.size == 10);
+
+		UploadAllocation second = allocator.Allocate(4, 256);
+		CHECK(second.gpuAddress % 256 == 0);
+		CHECK(second.gpuAddress == first.gpuAddress + 256);
+		CHECK(IsSameOffset(first, second));
+		CHECK(allocator.GetPaddingBytes() == 256 - 10);
+
+		UploadAllocation constant = allocator.AllocateConstantBuffer(100);
+		CHECK(constant.gpuAddress % LinearUploadAllocator::kConstantBufferAlignment == 0);
+		CHECK(constant.size == 256);
+		CHECK(constant.gpuAddress == second.gpuAddress + 256);
+		CHECK(allocator.GetPaddingBytes() == (256 - 10) + (256 - 4));
+		CHECK(allocator.GetAllocatedBytes() == 10 + 4 + 256);
+
+		UploadAllocation page = allocator.Allocate(1, LinearUploadAllocator::kPageAlignment);
+		CHECK(page.gpuAddress % LinearUploadAllocator::kPageAlignment == 0);
+		CHECK(allocator.GetPageCount() == 2);
+	}
+
+	// 入らなければ残りを捨てて次のページへ。ページより大きいものは専用のページ
+	void TestPageRollover() {
+		const size_t kPageSize = 1024;
+		FakePageBackend backend;
+		LinearUploadAllocator allocator(backend, kPageSize);
+
+		UploadAllocation a = allocator.Allocate(608);
+		UploadAllocation b = allocator.Allocate(608);
+		CHECK(allocator.GetPageCount() == 2);
+		CHECK(allocator.GetWastedBytes() == kPageSize - 608);
+		CHECK(b.gpuAddress % LinearUploadAllocator::kPageAlignment == 0);
+		CHECK(b.gpuAddress != a.gpuAddress);
+
+		// ちょうど残りに収まるものは同じページから切り出す
+		UploadAllocation c = allocator.Allocate(kPageSize - 608);
+		CHECK(c.gpuAddress == b.gpuAddress + 608);
+		CHECK(allocator.GetPageCount() == 2);
+
+		UploadAllocation large = allocator.Allocate(kPageSize * 3 + 1);
+		CHECK(large.size == kPageSize * 3 + 1);
+		CHECK(large.gpuAddress % LinearUploadAllocator::kPageAlignment == 0);
+		CHECK(allocator.GetPageCount() == 3);
+		CHECK(allocator.GetReservedBytes() == kPageSize * 2 + kPageSize * 3 + 16);
+
+		// 専用のページは今のページを進めない。今のページは埋まったので、次は新しいページから
+		UploadAllocation d = allocator.Allocate(16);
+		CHECK(d.gpuAddress % LinearUploadAllocator::kPageAlignment == 0);
+		CHECK(d.gpuAddress != b.gpuAddress && d.gpuAddress != large.gpuAddress);
+		CHECK(allocator.GetPageCount() == 4);
+		CHECK(allocator.GetWastedBytes() == kPageSize - 608);
+	}
+
+	// GPUが使い終わったらResetして、同じページを同じ順に使い回す
+	void TestReuseAfterFence() {
+		const size_t kPageSize = 4096;
+		FakePageBackend backend;
+		FakeFence fence;
+		LinearUploadAllocator allocator(backend, kPageSize);
+
+		std::vector<uint64_t> firstAddresses;
+		for (int i = 0; i < 40; ++i) {
+			firstAddresses.push_back(allocator.AllocateConstantBuffer(200).gpuAddress);
+		}
+		allocator.Allocate(kPageSize * 2);
+		uint64_t fenceValue = fence.Signal();
+		size_t pageCount = allocator.GetPageCount();
+		CHECK(pageCount == 4);
+		CHECK(backend.GetCreateCount() == 4);
+
+		// まだGPUが使っている間はResetしない
+		CHECK(fence.completed < fenceValue);
+		fence.Tick();
+		CHECK(fence.completed >= fenceValue);
+		allocator.Reset();
+
+		CHECK(allocator.GetAllocatedBytes() == 0);
+		CHECK(allocator.GetPaddingBytes() == 0);
+		CHECK(allocator.GetWastedBytes() == 0);
+		CHECK(backend.GetDestroyCount() == 1); // 専用のページだけ消す
+		CHECK(allocator.GetPageCount() == 3);
+
+		bool sameAddresses = true;
+		for (uint64_t expected : firstAddresses) {
+			sameAddresses = sameAddresses && allocator.AllocateConstantBuffer(200).gpuAddress == expected;
+		}
+		CHECK(sameAddresses);
+		CHECK(backend.GetCreateCount() == 4); // 普通のページは作り直さない
+	}
+
+	// 消える時に全てのページを返す
+	void TestReleasesPages() {
+		FakePageBackend backend;
+		{
+			LinearUploadAllocator allocator(backend, 1024);
+			allocator.Allocate(1000);
+			allocator.Allocate(1000);
+			allocator.Allocate(5000);
+			CHECK(backend.GetLiveCount() == 3);
+		}
+		CHECK(backend.GetLiveCount() == 0);
+		CHECK(backend.GetDestroyCount() == 3);
+	}
+}
+
+int main() {
+	TestAlignment();
+	TestPageRollover();
+	TestReuseAfterFence();
+	TestReleasesPages();
+	return FinishTests("UploadAllocatorTest");
+}
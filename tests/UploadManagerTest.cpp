@@ -0,0 +1,296 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "TestCommon.h"
+#include "UploadManager.h"
+
+namespace {
+	const uint32_t kFormatR8G8B8A8 = 28; // DXGI_FORMAT_R8G8B8A8_UNORM
+	const uint32_t kBytesPerPixel = 4;
+
+	/// <summary>
+	/// 普通のメモリでページを作る。コピーを真似るために、handleからページを引けるようにしておく
+	/// </summary>
+	class FakePageBackend final : public UploadPageBackend {
+	public:
+		UploadPage CreatePage(size_t size) override {
+			UploadPage page = { static_cast<uint8_t*>(std::malloc(size)), 0x20000000 + 0x10000 * pages_.size(), size, static_cast<uint32_t>(pages_.size()) };
+			pages_.push_back(page);
+			return page;
+		}
+
+		void DestroyPage(const UploadPage& page) override {
+			std::free(page.cpuAddress);
+			pages_[page.handle].cpuAddress = nullptr;
+		}
+
+		const uint8_t* GetMemory(uint32_t handle) const { return pages_[handle].cpuAddress; }
+
+	private:
+		std::vector<UploadPage> pages_;
+	};
+
+	/// <summary>
+	/// コピー先のTexture。1行に隙間の無いピクセルの並び
+	/// </summary>
+	struct FakeTexture final {
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> pixels;
+	};
+
+	/// <summary>
+	/// コピー用のキューの代わり。出されたコピーを全部覚えておき、GPUが終わった時(TickかWait)に
+	/// ステージングから読んでコピー先に書く。その時までステージングが上書きされていなければ、中身が合う
+	/// </summary>
+	class RecordingCopyQueue final : public CopyQueueBackend {
+	public:
+		struct Batch final {
+			std::vector<BufferCopy> bufferCopies;
+			std::vector<TextureCopy> textureCopies;
+			uint64_t fenceValue;
+		};
+
+		explicit RecordingCopyQueue(const FakePageBackend& pages) : pages_(pages) {}
+
+		void ExecuteCopies(const std::vector<BufferCopy>& bufferCopies, const std::vector<TextureCopy>& textureCopies, uint64_t fenceValue) override {
+			batches_.push_back({ bufferCopies, textureCopies, fenceValue });
+			queued_.push_back(batches_.size() - 1);
+		}
+
+		uint64_t GetCompletedValue() override { return completed_; }
+
+		void Wait(uint64_t value) override {
+			++waitCount_;
+			while (completed_ < value && !queued_.empty()) {
+				Tick();
+			}
+		}
+
+		void WaitOnDirectQueue(uint64_t value) override {
+			directQueueWaits_.push_back(value);
+		}
+
+		// 一番古いまとまりを終わらせる
+		void Tick() {
+			if (queued_.empty()) {
+				return;
+			}
+			const Batch& batch = batches_[queued_.front()];
+			queued_.pop_front();
+			for (const BufferCopy& copy : batch.bufferCopies) {
+				std::vector<uint8_t>& destination = *static_cast<std::vector<uint8_t>*>(copy.destination);
+				std::memcpy(destination.data() + copy.destinationOffset, pages_.GetMemory(copy.sourcePage) + copy.sourceOffset, copy.size);
+			}
+			for (const TextureCopy& copy : batch.textureCopies) {
+				FakeTexture& destination = *static_cast<FakeTexture*>(copy.destination);
+				size_t rowSize = copy.width * kBytesPerPixel;
+				for (uint32_t row = 0; row < copy.height; ++row) {
+					std::memcpy(destination.pixels.data() + rowSize * (copy.destinationY + row),
+						pages_.GetMemory(copy.sourcePage) + copy.sourceOffset + static_cast<size_t>(copy.rowPitch) * row, rowSize);
+				}
+			}
+			completed_ = batch.fenceValue;
+		}
+
+		const std::vector<Batch>& GetBatches() const { return batches_; }
+		const std::vector<uint64_t>& GetDirectQueueWaits() const { return directQueueWaits_; }
+		uint64_t GetWaitCount() const { return waitCount_; }
+
+	private:
+		const FakePageBackend& pages_;
+		std::vector<Batch> batches_;
+		std::deque<size_t> queued_;
+		std::vector<uint64_t> directQueueWaits_;
+		uint64_t completed_ = 0;
+		uint64_t waitCount_ = 0;
+	};
+
+	std::vector<uint8_t> MakePattern(size_t size, uint8_t seed) {
+		std::vector<uint8_t> data(size);
+		for (size_t i = 0; i < size; ++i) {
+			data[i] = static_cast<uint8_t>(seed + i * 7 + (i >> 8));
+		}
+		return data;
+	}
+
+	// maxChunkSizeを越えるバッファは、決まった大きさで順に分けて1回で出す
+	void TestLargeBufferCopyList() {
+		const size_t kCapacity = 4096; // maxChunkSizeは1024になる
+		FakePageBackend pages;
+		RecordingCopyQueue queue(pages);
+		UploadManager manager(pages, queue, kCapacity);
+
+		std::vector<uint8_t> source = MakePattern(2500, 1);
+		std::vector<uint8_t> destination(2600, 0);
+		manager.UploadBuffer(&destination, 100, source.data(), source.size());
+		CHECK(manager.GetPendingCopyCount() == 3);
+		CHECK(queue.GetBatches().empty());
+		CHECK(manager.Flush() == 1);
+
+		CHECK(queue.GetBatches().size() == 1);
+		const RecordingCopyQueue::Batch& batch = queue.GetBatches()[0];
+		CHECK(batch.fenceValue == 1);
+		CHECK(batch.textureCopies.empty());
+		CHECK(batch.bufferCopies.size() == 3);
+		if (batch.bufferCopies.size() == 3) {
+			const uint64_t expected[3][3] = {
+				// destinationOffset, sourceOffset, size
+				{ 100, 0, 1024 },
+				{ 1124, 1024, 1024 },
+				{ 2148, 2048, 452 },
+			};
+			for (size_t i = 0; i < 3; ++i) {
+				const BufferCopy& copy = batch.bufferCopies[i];
+				CHECK(copy.destination == &destination);
+				CHECK(copy.sourcePage == 0);
+				CHECK(copy.destinationOffset == expected[i][0]);
+				CHECK(copy.sourceOffset == expected[i][1]);
+				CHECK(copy.size == expected[i][2]);
+			}
+		}
+
+		queue.Tick();
+		CHECK(std::memcmp(destination.data() + 100, source.data(), source.size()) == 0);
+		CHECK(manager.GetStagedBytes() == 2500);
+		CHECK(manager.GetBatchCount() == 1);
+	}
+
+	// 1行が256の倍数でないTextureは、ステージングで1行を256に広げ、maxChunkSizeに入る行数ずつ送る
+	void TestUnalignedTextureCopyList() {
+		const size_t kCapacity = 4096;
+		FakePageBackend pages;
+		RecordingCopyQueue queue(pages);
+		UploadManager manager(pages, queue, kCapacity);
+
+		const uint32_t kWidth = 25; // 1行100バイト
+		const uint32_t kHeight = 10;
+		std::vector<uint8_t> source = MakePattern(kWidth * kBytesPerPixel * kHeight, 3);
+		FakeTexture texture = { kWidth, kHeight, std::vector<uint8_t>(source.size(), 0) };
+		TextureSubresourceData data = { source.data(), kWidth * kBytesPerPixel, kHeight, kFormatR8G8B8A8, kWidth, kHeight };
+		manager.UploadTexture(&texture, 2, data);
+		manager.Flush();
+
+		CHECK(queue.GetBatches().size() == 1);
+		const RecordingCopyQueue::Batch& batch = queue.GetBatches()[0];
+		CHECK(batch.bufferCopies.empty());
+		CHECK(batch.textureCopies.size() == 3);
+		if (batch.textureCopies.size() == 3) {
+			const uint32_t expected[3][3] = {
+				// destinationY, sourceOffset, height
+				{ 0, 0, 4 },
+				{ 4, 1024, 4 },
+				{ 8, 2048, 2 },
+			};
+			for (size_t i = 0; i < 3; ++i) {
+				const TextureCopy& copy = batch.textureCopies[i];
+				CHECK(copy.destination == &texture);
+				CHECK(copy.subresource == 2);
+				CHECK(copy.destinationY == expected[i][0]);
+				CHECK(copy.sourceOffset == expected[i][1]);
+				CHECK(copy.sourceOffset % UploadManager::kTexturePlacementAlignment == 0);
+				CHECK(copy.height == expected[i][2]);
+				CHECK(copy.width == kWidth);
+				CHECK(copy.format == kFormatR8G8B8A8);
+				CHECK(copy.rowPitch == 256);
+			}
+		}
+
+		queue.Tick();
+		CHECK(texture.pixels == source);
+		CHECK(manager.GetStagedBytes() == 256 * kHeight);
+	}
+
+	// 行で分けずに1回で送れるTextureは、heightをそのまま渡す
+	void TestSmallTextureSingleCopy() {
+		FakePageBackend pages;
+		RecordingCopyQueue queue(pages);
+		UploadManager manager(pages, queue, 4096);
+
+		std::vector<uint8_t> source = MakePattern(3 * kBytesPerPixel * 2, 5);
+		FakeTexture texture = { 3, 2, std::vector<uint8_t>(source.size(), 0) };
+		manager.UploadTexture(&texture, 0, { source.data(), 3 * kBytesPerPixel, 2, kFormatR8G8B8A8, 3, 2 });
+		manager.WaitForIdle();
+
+		CHECK(queue.GetBatches().size() == 1);
+		CHECK(queue.GetBatches()[0].textureCopies.size() == 1);
+		CHECK(queue.GetBatches()[0].textureCopies[0].height == 2);
+		CHECK(texture.pixels == source);
+	}
+
+	// ステージングが埋まったら、積んだコピーを出して一番古いものを待ち、空いた所を使い回す
+	void TestStagingReclaim() {
+		const size_t kCapacity = 4096;
+		FakePageBackend pages;
+		RecordingCopyQueue queue(pages);
+		UploadManager manager(pages, queue, kCapacity);
+
+		std::vector<std::vector<uint8_t>> sources;
+		std::vector<std::vector<uint8_t>> destinations(6, std::vector<uint8_t>(1024, 0));
+		for (size_t i = 0; i < destinations.size(); ++i) {
+			sources.push_back(MakePattern(1024, static_cast<uint8_t>(i * 31)));
+		}
+
+		// 4つで輪がちょうど埋まる。まだ何も出していない
+		for (size_t i = 0; i < 4; ++i) {
+			manager.UploadBuffer(&destinations[i], 0, sources[i].data(), 1024);
+		}
+		CHECK(queue.GetBatches().empty());
+		CHECK(queue.GetWaitCount() == 0);
+
+		// 5つ目は入らないので、4つを出して待ち、先頭から使う
+		manager.UploadBuffer(&destinations[4], 0, sources[4].data(), 1024);
+		CHECK(queue.GetBatches().size() == 1);
+		CHECK(queue.GetBatches()[0].bufferCopies.size() == 4);
+		CHECK(queue.GetWaitCount() == 1);
+		CHECK(manager.GetPendingCopyCount() == 1);
+		CHECK(manager.Flush() == 2);
+		CHECK(queue.GetBatches()[1].bufferCopies[0].sourceOffset == 0);
+
+		// GPUが終わってからReclaimすれば、待たずに入る。全部空いたので先頭に戻っている
+		queue.Tick();
+		manager.Reclaim();
+		manager.UploadBuffer(&destinations[5], 0, sources[5].data(), 1024);
+		CHECK(queue.GetWaitCount() == 1);
+		manager.SynchronizeDirectQueue();
+		CHECK(queue.GetBatches().size() == 3);
+		CHECK(queue.GetBatches()[2].bufferCopies[0].sourceOffset == 0);
+
+		// 描画用のキューには、進んだ時だけ待たせる
+		manager.SynchronizeDirectQueue();
+		CHECK(queue.GetDirectQueueWaits().size() == 1);
+		CHECK(queue.GetDirectQueueWaits()[0] == 3);
+
+		manager.WaitForIdle();
+		CHECK(queue.GetCompletedValue() == manager.GetSubmittedFenceValue());
+		bool intact = true;
+		for (size_t i = 0; i < destinations.size(); ++i) {
+			intact = intact && destinations[i] == sources[i];
+		}
+		CHECK(intact);
+	}
+
+	// 何も積んでいなければ出さない
+	void TestEmptyFlush() {
+		FakePageBackend pages;
+		RecordingCopyQueue queue(pages);
+		UploadManager manager(pages, queue, 4096);
+		CHECK(manager.Flush() == 0);
+		manager.SynchronizeDirectQueue();
+		manager.WaitForIdle();
+		CHECK(queue.GetBatches().empty());
+		CHECK(queue.GetDirectQueueWaits().empty());
+		CHECK(queue.GetWaitCount() == 0);
+	}
+}
+
+int main() {
+	TestLargeBufferCopyList();
+	TestUnalignedTextureCopyList();
+	TestSmallTextureSingleCopy();
+	TestStagingReclaim();
+	TestEmptyFlush();
+	return FinishTests("UploadManagerTest");
+}